@@ -1,10 +1,16 @@
 #include <atmel_start.h>
+#include <ram_monitor.h>
 
 /**
  * Initializes MCU, drivers and middleware in the project
  **/
 void atmel_start_init(void)
 {
+#if RAM_MONITOR_ENABLE == 1
+	/* Before any interrupt can use the stack */
+	ram_monitor_init();
+#endif
+
 	system_init();
 
 	touch_init();
@@ -0,0 +1,382 @@
+/**
+ * \file
+ *
+ * \brief Cycle benchmark of the touch scan path.
+ *
+ * Replaces main.c in the benchmark build (see the Makefile in this directory)
+ * and runs the normal scan loop, with the product sources and the QTouch
+ * libraries linked unchanged. The entry points of the scan path are
+ * intercepted with the linker --wrap option and timed with TCA0, which counts
+ * CLK_PER cycles and is extended to 32 bits by its overflow interrupt:
+ *
+ * - touch_start: touch_process() calls that start a measurement sequence
+ * - touch_post: touch_process() calls that run the post processing
+ * - qtm_acquisition_process(), qtm_key_sensors_process(), datastreamer_output()
+ * - isr_ptc_eoc: qtm_t81x_ptc_handler_eoc(), the body of ADC0_RESRDY_vect
+ * - isr_timer: timer_queue_isr(), the body of RTC_CNT_vect
+ * - irq_latency: cycles from a TCA0 compare match to the first instruction of
+ *   its handler body, sampled at pseudo-random points of the frame. It
+ *   includes the fixed interrupt response and prologue, plus any time spent
+ *   with interrupts disabled or in another handler.
+ *
+ * Times include the interrupts serviced during the measured call.
+ *
+ * Once all keys have calibrated, the node signals measured by the PTC are
+ * replaced before qtm_acquisition_process() with a synthetic pattern built on
+ * the calibrated signals: each key in turn is touched with twice its threshold
+ * for BENCH_TOUCH_FRAMES frames out of every BENCH_PATTERN_FRAMES, followed by
+ * an untouched window. The key state machine then follows the same path on
+ * every board and every run.
+ *
+ * Every BENCH_FRAMES frames a report is written to the USART once the
+ * datastreamer output has drained:
+ *
+ *   #bench begin <build> <f_cpu> <frames>
+ *   <stage> <count> <min> <max> <mean>
+ *   #bench end
+ *
+ * bench_report.py turns it into JSON.
+ */
+
+#include <string.h>
+
+#include <atmel_start.h>
+#include <atomic.h>
+#include <sleep_scheduler.h>
+#include <timer_queue.h>
+
+#include "touch.h"
+#include "datastreamer.h"
+
+#ifndef BENCH_BUILD_ID
+#define BENCH_BUILD_ID "unknown"
+#endif
+
+/* Frames measured per report */
+#ifndef BENCH_FRAMES
+#define BENCH_FRAMES 500u
+#endif
+
+/* Length of one step of the synthetic touch pattern, in frames */
+#define BENCH_PATTERN_FRAMES 50u
+
+/* Frames of each pattern step during which the key is touched */
+#define BENCH_TOUCH_FRAMES 15u
+
+/* Peak to peak noise added to the synthetic signals, power of two */
+#define BENCH_NOISE 4u
+
+/* Spacing of the latency probes, in cycles: fixed part plus a random part */
+#define BENCH_PROBE_MIN_CYCLES 4096u
+#define BENCH_PROBE_RANDOM_MASK 0x0fffu
+
+enum bench_stage {
+	BENCH_TOUCH_START,
+	BENCH_TOUCH_POST,
+	BENCH_ACQUISITION,
+	BENCH_KEY_SENSORS,
+	BENCH_DATASTREAMER,
+	BENCH_ISR_PTC_EOC,
+	BENCH_ISR_TIMER,
+	BENCH_IRQ_LATENCY,
+	BENCH_STAGE_COUNT
+};
+
+static const char *const bench_stage_names[BENCH_STAGE_COUNT] = {
+    "touch_start",
+    "touch_post",
+    "qtm_acquisition_process",
+    "qtm_key_sensors_process",
+    "datastreamer_output",
+    "isr_ptc_eoc",
+    "isr_timer",
+    "irq_latency",
+};
+
+struct bench_stat {
+	uint16_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+};
+
+static struct bench_stat bench_stats[BENCH_STAGE_COUNT];
+static volatile uint16_t bench_overflows;
+static uint16_t          bench_frames;
+static uint8_t           bench_injecting;
+static uint16_t          bench_base[DEF_NUM_SENSORS];
+static uint16_t          bench_random = 1u;
+
+extern volatile uint8_t        time_to_measure_touch_flag;
+extern volatile uint8_t        touch_postprocess_request;
+extern volatile uint8_t        measurement_done_touch;
+extern qtm_touch_key_config_t qtlib_key_configs_set1[DEF_NUM_SENSORS];
+
+touch_ret_t __real_qtm_acquisition_process(void);
+touch_ret_t __real_qtm_key_sensors_process(qtm_touch_key_control_t *qtm_lib_key_group_ptr);
+void        __real_datastreamer_output(void);
+void        __real_qtm_t81x_ptc_handler_eoc(void);
+void        __real_timer_queue_isr(void);
+
+/**
+ * \brief Start TCA0 as a free running CLK_PER cycle counter with latency probe
+ */
+static void bench_timer_init(void)
+{
+	TCA0.SINGLE.PER     = 0xffffu;
+	TCA0.SINGLE.CMP0    = BENCH_PROBE_MIN_CYCLES;
+	TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm | TCA_SINGLE_CMP0_bm;
+	TCA0.SINGLE.CTRLA   = TCA_SINGLE_CLKSEL_DIV1_gc | TCA_SINGLE_ENABLE_bm;
+}
+
+/**
+ * \brief Read the 32-bit cycle count
+ */
+static uint32_t bench_cycles(void)
+{
+	uint16_t low;
+	uint16_t high;
+
+	ENTER_CRITICAL(R);
+	low  = TCA0.SINGLE.CNT;
+	high = bench_overflows;
+	/* Overflow not yet serviced, either before or after reading CNT */
+	if ((TCA0.SINGLE.INTFLAGS & TCA_SINGLE_OVF_bm) && (low < 0x8000u)) {
+		high++;
+	}
+	EXIT_CRITICAL(R);
+
+	return ((uint32_t)high << 16) | low;
+}
+
+static uint16_t bench_rand(void)
+{
+	/* 16-bit xorshift */
+	bench_random ^= bench_random << 7;
+	bench_random ^= bench_random >> 9;
+	bench_random ^= bench_random << 8;
+	return bench_random;
+}
+
+static void bench_record(enum bench_stage stage, uint32_t cycles)
+{
+	struct bench_stat *stat = &bench_stats[stage];
+
+	if (stat->count == UINT16_MAX) {
+		return;
+	}
+	if ((stat->count == 0u) || (cycles < stat->min)) {
+		stat->min = cycles;
+	}
+	if (cycles > stat->max) {
+		stat->max = cycles;
+	}
+	stat->sum += cycles;
+	stat->count++;
+}
+
+static void bench_clear(void)
+{
+	ENTER_CRITICAL(R);
+	memset(bench_stats, 0, sizeof(bench_stats));
+	EXIT_CRITICAL(R);
+	bench_frames = 0u;
+}
+
+ISR(TCA0_OVF_vect)
+{
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+	bench_overflows++;
+}
+
+ISR(TCA0_CMP0_vect)
+{
+	uint16_t now = TCA0.SINGLE.CNT;
+	uint16_t due = TCA0.SINGLE.CMP0;
+
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_CMP0_bm;
+	TCA0.SINGLE.CMP0     = due + BENCH_PROBE_MIN_CYCLES + (bench_rand() & BENCH_PROBE_RANDOM_MASK);
+	bench_record(BENCH_IRQ_LATENCY, (uint16_t)(now - due));
+}
+
+/**
+ * \brief Replace the measured node signals with the synthetic pattern
+ */
+static void bench_inject_signals(void)
+{
+	uint16_t sensor;
+	uint16_t step = bench_frames / BENCH_PATTERN_FRAMES;
+	uint16_t key  = step % (DEF_NUM_SENSORS + 1u);
+	uint16_t signal;
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		signal = bench_base[sensor] + (bench_rand() & (BENCH_NOISE - 1u));
+		if ((sensor == key) && ((bench_frames % BENCH_PATTERN_FRAMES) < BENCH_TOUCH_FRAMES)) {
+			signal += 2u * qtlib_key_configs_set1[sensor].channel_threshold;
+		}
+		update_sensor_node_signal(sensor, signal);
+	}
+}
+
+/**
+ * \brief Start the synthetic pattern once every key has calibrated
+ */
+static void bench_check_calibrated(void)
+{
+	uint16_t sensor;
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		if (get_sensor_state(sensor) != QTM_KEY_STATE_NO_DET) {
+			return;
+		}
+	}
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		bench_base[sensor] = get_sensor_node_signal(sensor);
+	}
+	bench_injecting = 1u;
+	bench_clear();
+}
+
+touch_ret_t __wrap_qtm_acquisition_process(void)
+{
+	uint32_t    start;
+	touch_ret_t ret;
+
+	if (bench_injecting) {
+		bench_inject_signals();
+	}
+
+	start = bench_cycles();
+	ret   = __real_qtm_acquisition_process();
+	bench_record(BENCH_ACQUISITION, bench_cycles() - start);
+
+	return ret;
+}
+
+touch_ret_t __wrap_qtm_key_sensors_process(qtm_touch_key_control_t *qtm_lib_key_group_ptr)
+{
+	uint32_t    start = bench_cycles();
+	touch_ret_t ret   = __real_qtm_key_sensors_process(qtm_lib_key_group_ptr);
+
+	bench_record(BENCH_KEY_SENSORS, bench_cycles() - start);
+
+	return ret;
+}
+
+void __wrap_datastreamer_output(void)
+{
+	uint32_t start = bench_cycles();
+
+	__real_datastreamer_output();
+	bench_record(BENCH_DATASTREAMER, bench_cycles() - start);
+}
+
+void __wrap_qtm_t81x_ptc_handler_eoc(void)
+{
+	uint32_t start = bench_cycles();
+
+	__real_qtm_t81x_ptc_handler_eoc();
+	bench_record(BENCH_ISR_PTC_EOC, bench_cycles() - start);
+}
+
+void __wrap_timer_queue_isr(void)
+{
+	uint32_t start = bench_cycles();
+
+	__real_timer_queue_isr();
+	bench_record(BENCH_ISR_TIMER, bench_cycles() - start);
+}
+
+static void bench_put_string(const char *s)
+{
+	while (*s != '\0') {
+		USART_write(*s++);
+	}
+}
+
+static void bench_put_u32(uint32_t value)
+{
+	char  buf[11];
+	char *p = &buf[sizeof(buf) - 1u];
+
+	*p = '\0';
+	do {
+		*--p = '0' + (value % 10u);
+		value /= 10u;
+	} while (value != 0u);
+	bench_put_string(p);
+}
+
+/**
+ * \brief Write the report for the frames measured so far
+ */
+static void bench_report(void)
+{
+	struct bench_stat stats[BENCH_STAGE_COUNT];
+	uint8_t           stage;
+
+	ENTER_CRITICAL(R);
+	memcpy(stats, bench_stats, sizeof(stats));
+	EXIT_CRITICAL(R);
+
+	/* Let the datastreamer frames drain, the report bypasses the ring */
+	while (!USART_is_tx_idle())
+		;
+
+	bench_put_string("\r\n#bench begin " BENCH_BUILD_ID " ");
+	bench_put_u32(F_CPU);
+	bench_put_string(" ");
+	bench_put_u32(bench_frames);
+	bench_put_string("\r\n");
+	for (stage = 0u; stage < BENCH_STAGE_COUNT; stage++) {
+		bench_put_string(bench_stage_names[stage]);
+		bench_put_string(" ");
+		bench_put_u32(stats[stage].count);
+		bench_put_string(" ");
+		bench_put_u32(stats[stage].min);
+		bench_put_string(" ");
+		bench_put_u32(stats[stage].max);
+		bench_put_string(" ");
+		bench_put_u32(stats[stage].count ? stats[stage].sum / stats[stage].count : 0u);
+		bench_put_string("\r\n");
+	}
+	bench_put_string("#bench end\r\n");
+}
+
+int main(void)
+{
+	uint32_t start;
+	uint8_t  measure;
+	uint8_t  post;
+
+	atmel_start_init();
+	bench_timer_init();
+
+	/* Keep the fast rate, the pattern has idle windows */
+	touch_set_scan_rate(DEF_TOUCH_MEASUREMENT_PERIOD_MS, DEF_TOUCH_MEASUREMENT_PERIOD_MS, UINT16_MAX);
+
+	cpu_irq_enable();
+
+	while (1) {
+		measure = time_to_measure_touch_flag;
+		post    = touch_postprocess_request;
+		start   = bench_cycles();
+		touch_process();
+		if (post) {
+			bench_record(BENCH_TOUCH_POST, bench_cycles() - start);
+			bench_frames++;
+		} else if (measure) {
+			bench_record(BENCH_TOUCH_START, bench_cycles() - start);
+		}
+		measurement_done_touch = 0u;
+
+		if (post && !bench_injecting) {
+			bench_check_calibrated();
+		} else if (bench_frames >= BENCH_FRAMES) {
+			bench_report();
+			bench_clear();
+		}
+
+		sleep_scheduler_run();
+	}
+}
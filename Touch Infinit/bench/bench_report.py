@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Capture the cycle benchmark report of bench_main.c and write it as JSON.
+
+The report is read from the board's serial port (needs pyserial) or from a
+file holding a raw capture of the USART output. The datastreamer frames sent
+between reports are skipped.
+
+    bench_report.py --port /dev/ttyACM0 --output bench.json
+    bench_report.py --input capture.bin --baseline old.json
+"""
+
+import argparse
+import json
+import sys
+
+BEGIN = "#bench begin"
+END = "#bench end"
+
+
+def lines_from_port(port, baud, timeout):
+    import serial
+
+    with serial.Serial(port, baud, timeout=timeout) as link:
+        while True:
+            raw = link.readline()
+            if not raw:
+                raise TimeoutError("no report within %d s" % timeout)
+            yield raw
+
+
+def lines_from_file(path):
+    with open(path, "rb") as capture:
+        yield from capture
+
+
+def parse_report(lines):
+    """Return the first complete report found in an iterable of raw lines."""
+    report = None
+    for raw in lines:
+        line = raw.decode("ascii", errors="replace").strip()
+        if line.startswith(BEGIN):
+            fields = line[len(BEGIN):].split()
+            if len(fields) != 3:
+                continue
+            report = {
+                "build": fields[0],
+                "f_cpu": int(fields[1]),
+                "frames": int(fields[2]),
+                "stages": {},
+            }
+        elif report is None:
+            continue
+        elif line == END:
+            return report
+        else:
+            fields = line.split()
+            if len(fields) != 5:
+                # Corrupted line, wait for the next report
+                report = None
+                continue
+            name = fields[0]
+            count, low, high, mean = (int(f) for f in fields[1:])
+            to_us = 1e6 / report["f_cpu"]
+            report["stages"][name] = {
+                "count": count,
+                "min": low,
+                "max": high,
+                "mean": mean,
+                "min_us": round(low * to_us, 2),
+                "max_us": round(high * to_us, 2),
+                "mean_us": round(mean * to_us, 2),
+            }
+    raise EOFError("no complete report in the input")
+
+
+def compare(report, baseline):
+    print("%-26s %10s %10s %8s %10s %10s %8s" %
+          ("stage", "mean", "was", "change", "max", "was", "change"))
+    for name, stage in report["stages"].items():
+        old = baseline["stages"].get(name)
+        if old is None:
+            print("%-26s %10d %10s" % (name, stage["mean"], "-"))
+            continue
+        print("%-26s %10d %10d %7.1f%% %10d %10d %7.1f%%" % (
+            name,
+            stage["mean"], old["mean"], percent(stage["mean"], old["mean"]),
+            stage["max"], old["max"], percent(stage["max"], old["max"])))
+
+
+def percent(new, old):
+    return 100.0 * (new - old) / old if old else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the board")
+    source.add_argument("--input", help="raw capture of the USART output")
+    parser.add_argument("--baud", type=int, default=38400)
+    parser.add_argument("--timeout", type=int, default=60,
+                        help="seconds to wait for a report line")
+    parser.add_argument("--output", help="JSON file, default stdout")
+    parser.add_argument("--baseline", help="earlier JSON report to compare with")
+    args = parser.parse_args()
+
+    if args.port:
+        lines = lines_from_port(args.port, args.baud, args.timeout)
+    else:
+        lines = lines_from_file(args.input)
+    report = parse_report(lines)
+
+    text = json.dumps(report, indent=2) + "\n"
+    if args.output:
+        with open(args.output, "w") as out:
+            out.write(text)
+    else:
+        sys.stdout.write(text)
+
+    if args.baseline:
+        with open(args.baseline) as old:
+            compare(report, json.load(old))
+
+
+if __name__ == "__main__":
+    main()
@@ -35,13 +35,105 @@
 
 #include <driver_init.h>
 #include <compiler.h>
+#include <timer_queue.h>
+#include <relay_scheduler.h>
+#include <led_pwm.h>
+#include <supply_monitor.h>
+#include <module_bus.h>
 
-ISR(RTC_CNT_vect)
+ISR(BOD_VLM_vect)
 {
+	/* Interrupt flag has to be cleared manually */
+	BOD.INTFLAGS = BOD_VLMIF_bm;
 
-	/* Insert your RTC Compare interrupt handling code */
-	touch_timer_handler();
+	/* VDD crossed the voltage level monitor threshold */
+	supply_monitor_vlm_isr();
+}
 
-	/* Compare interrupt flag has to be cleared manually */
+ISR(RTC_CNT_vect)
+{
+	/* Compare interrupt flag has to be cleared manually, before RTC.CMP is
+	 * reprogrammed for the next deadline */
 	RTC.INTFLAGS = RTC_CMP_bm;
+
+	/* Run the expired software timers */
+	timer_queue_isr();
+}
+
+#if MODULE_BUS_ENABLE == 1
+ISR(PORTA_PORT_vect)
+{
+	/* Pin interrupt flags have to be cleared manually */
+	PORTA.INTFLAGS = PIN7_bm;
+
+	/* Acknowledgement of module 0 on RELAY_MOD1 */
+	module_bus_line_isr(0);
+}
+
+ISR(PORTB_PORT_vect)
+{
+	uint8_t flags = PORTB.INTFLAGS;
+
+	PORTB.INTFLAGS = flags;
+
+	/* Acknowledgements of modules 1 and 2 on RELAY_MOD2 and RELAY_MOD3 */
+	if (flags & PIN2_bm) {
+		module_bus_line_isr(1);
+	}
+	if (flags & PIN4_bm) {
+		module_bus_line_isr(2);
+	}
+}
+#endif
+
+ISR(PORTC_PORT_vect)
+{
+	/* Pin interrupt flags have to be cleared manually */
+	PORTC.INTFLAGS = PIN3_bm;
+
+	/* Mains zero-cross on ZERO_CROSS */
+	relay_scheduler_zero_cross_isr();
+}
+
+#if LED_PWM_ENABLE == 1
+ISR(TCA0_OVF_vect)
+{
+	/* Interrupt flags have to be cleared manually */
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+
+	/* Start of a PWM period */
+	led_pwm_overflow_isr();
+}
+
+ISR(TCA0_CMP0_vect)
+{
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_CMP0_bm;
+
+	led_pwm_compare_isr(0);
+}
+
+ISR(TCA0_CMP1_vect)
+{
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_CMP1_bm;
+
+	led_pwm_compare_isr(1);
+}
+
+ISR(TCA0_CMP2_vect)
+{
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_CMP2_bm;
+
+	led_pwm_compare_isr(2);
+}
+#endif
+
+#if MODULE_BUS_ENABLE == 1
+ISR(TCB0_INT_vect)
+{
+	/* Interrupt flag has to be cleared manually */
+	TCB0.INTFLAGS = TCB_CAPT_bm;
+
+	/* End of a module bus phase */
+	module_bus_timer_isr();
 }
+#endif
@@ -22,11 +22,19 @@ Copyright (c) 2021 Microchip. All rights reserved.
 #ifndef TOUCH_EXAMPLE_H_
 #define TOUCH_EXAMPLE_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void touch_example(void);
+void touch_sensor_set_led(uint8_t sensor, bool on);
+void touch_leds_init(void);
+void touch_sensor_set_relay(uint8_t sensor, bool on);
+void touch_relays_restore(void);
+void touch_supply_init(void);
 
 #ifdef __cplusplus
 }
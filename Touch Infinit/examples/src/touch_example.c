@@ -25,7 +25,32 @@ Copyright (c) 2021 Microchip. All rights reserved.
  *----------------------------------------------------------------------------*/
 #include <atmel_start.h>
 #include "touch_example.h"
+#include "touch_store.h"
+#include "touch_gesture.h"
+#include <relay_scheduler.h>
+#include <led_pwm.h>
+#include <module_bus.h>
+#include <supply_monitor.h>
+#include <timer_queue.h>
 #include <util/delay.h>
+/*----------------------------------------------------------------------------
+ *     defines
+ *----------------------------------------------------------------------------*/
+/* LED fade times over the whole brightness range */
+#define TOUCH_LED_FADE_IN_MS 50u
+#define TOUCH_LED_FADE_OUT_MS 400u
+
+/* Sensor n also commands relay module n over the module bus. RELAY_MOD1 is
+ * TOUCH4 on the 4-gang board and a Y line of the matrix panels, which have no
+ * module bus. */
+#if (MODULE_BUS_ENABLE == 1) && (DEF_TOUCH_MATRIX == 0u) && (DEF_TOUCH_GANG <= 3)
+#define TOUCH_MODULE_BUS 1
+#else
+#define TOUCH_MODULE_BUS 0
+#endif
+
+_Static_assert(DEF_NUM_SENSORS <= RELAY_SCHEDULER_RELAYS, "The keys and relays are kept in 16-bit masks");
+
 /*----------------------------------------------------------------------------
  *   Extern variables
  *----------------------------------------------------------------------------*/
@@ -36,10 +61,34 @@ extern volatile uint8_t measurement_done_touch;
  *----------------------------------------------------------------------------*/
 uint8_t key_status = 0;
 
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+/* Milli second clock of the gesture engine and the RTC count it was last
+ * advanced to */
+static uint16_t touch_time_ms;
+static uint16_t touch_time_ticks;
+static uint16_t touch_time_fraction;
+#else
+/* Keys detected at the last status update, bit n for sensor n */
+static uint16_t touch_keys_detected;
+#endif
+
 /*----------------------------------------------------------------------------
  *   prototypes
  *----------------------------------------------------------------------------*/
 void touch_status_display(void);
+static void touch_led_output(uint8_t sensor, bool on);
+static void touch_relay_output(uint8_t sensor, bool on);
+static void touch_supply_changed(bool low);
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+static uint16_t touch_time_update(void);
+static void     touch_gesture_handle(const struct touch_gesture_event *event);
+#endif
+
+/* Stand-in for the LED and relay pins of sensors that have none */
+static inline void NO_PIN_set_level(const bool level)
+{
+	(void)level;
+}
 
 /*----------------------------------------------------------------------------
  *   function definitions
@@ -91,27 +140,291 @@ Purpose: Sample code snippet to demonstrate how to check the status of the
          sensors
 Input  : none
 Output : none
-Notes  : none
+Notes  : The LED of a key follows its touch. With gestures, a tap or long
+         press toggles its relay and a double tap switches all relays to the
+         opposite of its relay, otherwise each new touch toggles its relay.
 ============================================================================*/
 void touch_status_display(void)
 {
-	key_status = get_sensor_state(0) & KEY_TOUCHED_MASK;
-	if (0u != key_status) {
-		LED_TOUCH1_set_level(0);
-	} else{
-		LED_TOUCH1_set_level(1);
+	uint8_t sensor;
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+	uint16_t                   keys = 0u;
+	struct touch_gesture_event event;
+#else
+	uint16_t mask;
+#endif
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		key_status = get_sensor_state(sensor) & KEY_TOUCHED_MASK;
+		touch_sensor_set_led(sensor, 0u != key_status);
+
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+		if (0u != key_status) {
+			keys |= (uint16_t)(1u << sensor);
+		}
+#else
+		mask = (uint16_t)(1u << sensor);
+		if ((0u != key_status) && !(touch_keys_detected & mask)) {
+			touch_sensor_set_relay(sensor, !relay_scheduler_get(sensor));
+		}
+		if (0u != key_status) {
+			touch_keys_detected |= mask;
+		} else {
+			touch_keys_detected &= (uint16_t)~mask;
+		}
+#endif
 	}
-	key_status = get_sensor_state(1) & KEY_TOUCHED_MASK;
-	if (0u != key_status) {
-		LED_TOUCH2_set_level(0);
-	} else{
-		BUTTON_MOD2_set_level(1);
-		LED_TOUCH2_set_level(1);
+
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+	touch_gesture_process(keys, touch_time_update());
+	while (touch_gesture_get_event(&event)) {
+		touch_gesture_handle(&event);
 	}
-	key_status = get_sensor_state(2) & KEY_TOUCHED_MASK;
-	if (0u != key_status) {
-		LED_TOUCH3_set_level(0);
-	} else{
-		LED_TOUCH3_set_level(1);
+#endif
+}
+
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+/*============================================================================
+static uint16_t touch_time_update(void)
+------------------------------------------------------------------------------
+Purpose: Advances the milli second clock of the gesture engine to the RTC
+Input  : none
+Output : Time in milli seconds, wrapping
+Notes  : The RTC counts 1024 ticks per second, the fraction of a milli
+         second is carried over. Needs a call at least every 64 s to follow
+         the RTC, gestures only time measurements much closer together.
+============================================================================*/
+static uint16_t touch_time_update(void)
+{
+	uint16_t ticks = timer_now();
+	uint32_t scaled;
+
+	/* 1000 / 1024 ms per tick, in 1/128 ms */
+	scaled = (uint32_t)(uint16_t)(ticks - touch_time_ticks) * 125u + touch_time_fraction;
+
+	touch_time_ticks    = ticks;
+	touch_time_ms       = (uint16_t)(touch_time_ms + (uint16_t)(scaled >> 7u));
+	touch_time_fraction = (uint16_t)(scaled & 0x7Fu);
+	return touch_time_ms;
+}
+
+/*============================================================================
+static void touch_gesture_handle(const struct touch_gesture_event *event)
+------------------------------------------------------------------------------
+Purpose: Sample code snippet to demonstrate how to act on gesture events
+Input  : Event taken from the gesture queue
+Output : none
+Notes  : Repeats and the end of a long press are left for dimming.
+============================================================================*/
+static void touch_gesture_handle(const struct touch_gesture_event *event)
+{
+	uint8_t sensor;
+	bool    on;
+
+	switch (event->type) {
+	case TOUCH_GESTURE_TAP:
+	case TOUCH_GESTURE_LONG_PRESS:
+		touch_sensor_set_relay(event->sensor, !relay_scheduler_get(event->sensor));
+		break;
+
+	case TOUCH_GESTURE_DOUBLE_TAP:
+		/* Scene: all relays on or all off */
+		on = !relay_scheduler_get(event->sensor);
+		for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+			touch_sensor_set_relay(sensor, on);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+#endif
+
+/*============================================================================
+void touch_sensor_set_led(uint8_t sensor, bool on)
+------------------------------------------------------------------------------
+Purpose: Switches the LED bound to a sensor in TOUCH_SENSOR_TABLE
+Input  : sensor: sensor index, on: LED on
+Output : none
+Notes  : With LED PWM, the LEDs of the first LED_PWM_COUNT sensors fade in
+         quickly on a touch and fade out slowly to LED_PWM_NIGHT_LEVEL.
+         The other LEDs are switched.
+============================================================================*/
+void touch_sensor_set_led(uint8_t sensor, bool on)
+{
+#if LED_PWM_ENABLE == 1
+	if (sensor < LED_PWM_COUNT) {
+		if (on) {
+			led_pwm_fade(sensor, LED_PWM_MAX_LEVEL, TOUCH_LED_FADE_IN_MS);
+		} else {
+			led_pwm_fade(sensor, LED_PWM_NIGHT_LEVEL, TOUCH_LED_FADE_OUT_MS);
+		}
+		return;
 	}
+#endif
+
+	touch_led_output(sensor, on);
+}
+
+/*============================================================================
+static void touch_led_output(uint8_t sensor, bool on)
+------------------------------------------------------------------------------
+Purpose: Drives the LED output bound to a sensor in TOUCH_SENSOR_TABLE
+Input  : sensor: sensor index, on: LED on
+Output : none
+Notes  : LEDs are active low. Also called by the LED PWM from interrupt
+         context. Sensors without an LED are ignored.
+============================================================================*/
+static void touch_led_output(uint8_t sensor, bool on)
+{
+#define TOUCH_SENSOR_LED(name, x, y, csd, prsc, again, dgain, filter, threshold, hysteresis, aks, led, relay)          \
+	case TOUCH_SENSOR_##name:                                                                                          \
+		led##_set_level(!on);                                                                                          \
+		break;
+
+	switch (sensor) {
+		TOUCH_SENSOR_TABLE(TOUCH_SENSOR_LED)
+	default:
+		break;
+	}
+
+#undef TOUCH_SENSOR_LED
+}
+
+/*============================================================================
+void touch_leds_init(void)
+------------------------------------------------------------------------------
+Purpose: Starts the LED PWM and sets the LEDs to their idle level
+Input  : none
+Output : none
+Notes  : Call once after touch_init().
+============================================================================*/
+void touch_leds_init(void)
+{
+#if LED_PWM_ENABLE == 1
+	uint8_t led;
+
+	led_pwm_init(touch_led_output);
+
+	for (led = 0u; led < LED_PWM_COUNT; led++) {
+		led_pwm_fade(led, LED_PWM_NIGHT_LEVEL, 0u);
+	}
+#endif
+}
+
+/*============================================================================
+void touch_sensor_set_relay(uint8_t sensor, bool on)
+------------------------------------------------------------------------------
+Purpose: Switches the relay bound to a sensor in TOUCH_SENSOR_TABLE
+Input  : sensor: sensor index, on: relay on
+Output : none
+Notes  : The relay scheduler switches it at a zero-cross of the mains, and
+         the relay module of the sensor is commanded the same state. The
+         state is saved in EEPROM and restored by touch_relays_restore()
+         after a reset.
+============================================================================*/
+void touch_sensor_set_relay(uint8_t sensor, bool on)
+{
+#if DEF_TOUCH_STORE_ENABLE == 1u
+	uint16_t relays = touch_store_get_relays();
+
+	if (on) {
+		relays |= (uint16_t)(1u << sensor);
+	} else {
+		relays &= (uint16_t)~(1u << sensor);
+	}
+	touch_store_set_relays(relays);
+#endif
+
+	relay_scheduler_set(sensor, on);
+
+#if TOUCH_MODULE_BUS == 1
+	if (sensor < MODULE_BUS_MODULES) {
+		module_bus_set(sensor, on);
+	}
+#endif
+}
+
+/*============================================================================
+static void touch_relay_output(uint8_t sensor, bool on)
+------------------------------------------------------------------------------
+Purpose: Drives the relay output bound to a sensor in TOUCH_SENSOR_TABLE
+Input  : sensor: sensor index, on: relay on
+Output : none
+Notes  : Called by the relay scheduler from interrupt context. Sensors
+         without a relay are ignored.
+============================================================================*/
+static void touch_relay_output(uint8_t sensor, bool on)
+{
+#define TOUCH_SENSOR_RELAY(name, x, y, csd, prsc, again, dgain, filter, threshold, hysteresis, aks, led, relay)        \
+	case TOUCH_SENSOR_##name:                                                                                          \
+		relay##_set_level(on);                                                                                         \
+		break;
+
+	switch (sensor) {
+		TOUCH_SENSOR_TABLE(TOUCH_SENSOR_RELAY)
+	default:
+		break;
+	}
+
+#undef TOUCH_SENSOR_RELAY
+}
+
+/*============================================================================
+void touch_relays_restore(void)
+------------------------------------------------------------------------------
+Purpose: Starts the relay scheduler and the module bus and sets the relays
+         to the states saved before the last reset
+Input  : none
+Output : none
+Notes  : Call once after touch_init(). All relays stay off without a saved
+         record.
+============================================================================*/
+void touch_relays_restore(void)
+{
+#if DEF_TOUCH_STORE_ENABLE == 1u
+	uint16_t relays = touch_store_get_relays();
+	uint8_t  sensor;
+#endif
+
+	relay_scheduler_init(touch_relay_output);
+#if TOUCH_MODULE_BUS == 1
+	module_bus_init();
+#endif
+
+#if DEF_TOUCH_STORE_ENABLE == 1u
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		touch_sensor_set_relay(sensor, 0u != (relays & (1u << sensor)));
+	}
+#endif
+}
+
+/*============================================================================
+void touch_supply_init(void)
+------------------------------------------------------------------------------
+Purpose: Starts the supply monitor and records the cause of the last reset
+Input  : none
+Output : none
+Notes  : Call once after touch_init() and before touch_relays_restore(), so
+         relays restored after a brown-out wait for the supply to recover.
+============================================================================*/
+void touch_supply_init(void)
+{
+	supply_monitor_init(touch_supply_changed);
+}
+
+/*============================================================================
+static void touch_supply_changed(bool low)
+------------------------------------------------------------------------------
+Purpose: Sheds load while the supply is low
+Input  : low: VDD below the voltage level monitor threshold
+Output : none
+Notes  : Called by the supply monitor from interrupt context. Relays are not
+         pulled in while the supply is low, the datastreamer and EEPROM
+         writes check supply_monitor_is_low() themselves.
+============================================================================*/
+static void touch_supply_changed(bool low)
+{
+	relay_scheduler_hold(low);
 }
@@ -1405,4 +1405,97 @@ static inline bool LED_TOUCH1_get_level()
 	return PORTC_get_pin_level(2);
 }
 
+/**
+ * \brief Set ZERO_CROSS pull mode
+ *
+ * Configure pin to pull up, down or disable pull mode, supported pull
+ * modes are defined by device used
+ *
+ * \param[in] pull_mode Pin pull mode
+ */
+static inline void ZERO_CROSS_set_pull_mode(const enum port_pull_mode pull_mode)
+{
+	PORTC_set_pin_pull_mode(3, pull_mode);
+}
+
+/**
+ * \brief Set ZERO_CROSS data direction
+ *
+ * Select if the pin data direction is input, output or disabled.
+ * If disabled state is not possible, this function throws an assert.
+ *
+ * \param[in] direction PORT_DIR_IN  = Data direction in
+ *                      PORT_DIR_OUT = Data direction out
+ *                      PORT_DIR_OFF = Disables the pin
+ *                      (low power state)
+ */
+static inline void ZERO_CROSS_set_dir(const enum port_dir dir)
+{
+	PORTC_set_pin_dir(3, dir);
+}
+
+/**
+ * \brief Set ZERO_CROSS input/sense configuration
+ *
+ * Enable/disable ZERO_CROSS digital input buffer and pin change interrupt,
+ * select pin interrupt edge/level sensing mode
+ *
+ * \param[in] isc PORT_ISC_INTDISABLE_gc    = Iterrupt disabled but input buffer enabled
+ *                PORT_ISC_BOTHEDGES_gc     = Sense Both Edges
+ *                PORT_ISC_RISING_gc        = Sense Rising Edge
+ *                PORT_ISC_FALLING_gc       = Sense Falling Edge
+ *                PORT_ISC_INPUT_DISABLE_gc = Digital Input Buffer disabled
+ *                PORT_ISC_LEVEL_gc         = Sense low Level
+ */
+static inline void ZERO_CROSS_set_isc(const PORT_ISC_t isc)
+{
+	PORTC_pin_set_isc(3, isc);
+}
+
+/**
+ * \brief Set ZERO_CROSS inverted mode
+ *
+ * Enable or disable inverted I/O on a pin
+ *
+ * \param[in] inverted true  = I/O on ZERO_CROSS is inverted
+ *                     false = I/O on ZERO_CROSS is not inverted
+ */
+static inline void ZERO_CROSS_set_inverted(const bool inverted)
+{
+	PORTC_pin_set_inverted(3, inverted);
+}
+
+/**
+ * \brief Set ZERO_CROSS level
+ *
+ * Sets output level on a pin
+ *
+ * \param[in] level true  = Pin level set to "high" state
+ *                  false = Pin level set to "low" state
+ */
+static inline void ZERO_CROSS_set_level(const bool level)
+{
+	PORTC_set_pin_level(3, level);
+}
+
+/**
+ * \brief Toggle output level on ZERO_CROSS
+ *
+ * Toggle the pin level
+ */
+static inline void ZERO_CROSS_toggle_level()
+{
+	PORTC_toggle_pin_level(3);
+}
+
+/**
+ * \brief Get level on ZERO_CROSS
+ *
+ * Reads the level on a pin
+ */
+static inline bool ZERO_CROSS_get_level()
+{
+	return PORTC_get_pin_level(3);
+}
+
 #endif /* ATMEL_START_PINS_H_INCLUDED */
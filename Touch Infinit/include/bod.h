@@ -34,8 +34,16 @@
 extern "C" {
 #endif
 
+/* Voltage level monitor threshold above the BOD level set by the BODCFG fuse.
+ * VDD falling below it sheds load, see supply_monitor.h. */
+#ifndef BOD_VLM_LEVEL
+#define BOD_VLM_LEVEL BOD_VLMLVL_5ABOVE_gc
+#endif
+
 int8_t BOD_init();
 
+bool BOD_is_supply_low(void);
+
 #ifdef __cplusplus
 }
 #endif
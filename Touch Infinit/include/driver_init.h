@@ -47,6 +47,8 @@
 
 #include <usart_basic.h>
 
+#include <nvmctrl_basic.h>
+
 #include <cpuint.h>
 #include <slpctrl.h>
 #include <bod.h>
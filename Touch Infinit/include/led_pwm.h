@@ -0,0 +1,66 @@
+/**
+ * \file
+ *
+ * \brief TCA0 based LED PWM with gamma corrected fades declaration.
+ *
+ */
+
+#ifndef LED_PWM_H_INCLUDED
+#define LED_PWM_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* LED brightness control by PWM. Without it the LEDs are only switched on and
+ * off, and TCA0 is left free, e.g. for the cycle benchmark. */
+#ifndef LED_PWM_ENABLE
+#define LED_PWM_ENABLE 1
+#endif
+
+/* Number of LEDs, one TCA0 compare channel each */
+#ifndef LED_PWM_COUNT
+#define LED_PWM_COUNT 3u
+#endif
+
+/* Brightness levels run from 0 (off) to LED_PWM_MAX_LEVEL (fully on), in
+ * steps of equal perceived brightness */
+#define LED_PWM_MAX_LEVEL 63u
+
+/* Level of an LED that is off, so the keys can be found in the dark. TCA0
+ * keeps running while an LED is between off and fully on, which keeps the
+ * device out of standby. */
+#ifndef LED_PWM_NIGHT_LEVEL
+#define LED_PWM_NIGHT_LEVEL 0u
+#endif
+
+/* PWM period: TCA0 counts CLK_PER / 64 up to LED_PWM_PERIOD - 1, about
+ * 305 Hz at 20 MHz */
+#define LED_PWM_PERIOD 1024u
+
+/* Drives the output of an LED, called from interrupt context */
+typedef void (*led_pwm_output_cb_t)(uint8_t led, bool on);
+
+#if LED_PWM_ENABLE == 1
+
+void led_pwm_init(led_pwm_output_cb_t output);
+
+void led_pwm_fade(uint8_t led, uint8_t level, uint16_t time_ms);
+
+uint8_t led_pwm_get(uint8_t led);
+
+bool led_pwm_is_running(void);
+
+void led_pwm_overflow_isr(void);
+
+void led_pwm_compare_isr(uint8_t led);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_PWM_H_INCLUDED */
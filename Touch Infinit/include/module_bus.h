@@ -0,0 +1,106 @@
+/**
+ * \file
+ *
+ * \brief Relay module bus on the BUTTON_MOD and RELAY_MOD lines declaration.
+ *
+ */
+
+#ifndef MODULE_BUS_H_INCLUDED
+#define MODULE_BUS_H_INCLUDED
+
+#include <compiler.h>
+#include <atmel_start.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Commands to relay modules over the BUTTON_MOD and RELAY_MOD lines. The bus
+ * uses TCB0 and the pin interrupts of PORTA and PORTB. */
+#ifndef MODULE_BUS_ENABLE
+#define MODULE_BUS_ENABLE 1
+#endif
+
+/* Number of modules, one pair of lines each. Module n commands on
+ * BUTTON_MODn+1 and is answered on RELAY_MODn+1. RELAY_MOD1 is TOUCH4 on the
+ * 4-gang board. RELAY_MOD2 is PB2, the TxD pin of USART0, where the
+ * datastreamer frames would show as acknowledgements of module 1, so the bus
+ * has module 0 only while DEF_TOUCH_DATA_STREAMER_ENABLE is set. */
+#ifndef MODULE_BUS_MODULES
+#if DEF_TOUCH_DATA_STREAMER_ENABLE == 1u
+#define MODULE_BUS_MODULES 1u
+#else
+#define MODULE_BUS_MODULES 3u
+#endif
+#endif
+
+/* Time unit of the pulse widths, in us */
+#ifndef MODULE_BUS_UNIT_US
+#define MODULE_BUS_UNIT_US 50u
+#endif
+
+/* Retransmissions of a command that is not acknowledged */
+#ifndef MODULE_BUS_RETRIES
+#define MODULE_BUS_RETRIES 3u
+#endif
+
+/* Time from the acknowledgement of a switching command until the relay
+ * state is read back, in ms. At least the operate time of the module. */
+#ifndef MODULE_BUS_SETTLE_MS
+#define MODULE_BUS_SETTLE_MS 50u
+#endif
+
+/* Pulse widths in units. A command is a high pulse on the BUTTON_MOD line of
+ * the module, the acknowledgement a high pulse on its RELAY_MOD line that
+ * starts within MODULE_BUS_ACK_DELAY units of the end of the command and
+ * gives the relay state. Widths are accepted within one unit. */
+#define MODULE_BUS_OFF_UNITS 2u
+#define MODULE_BUS_ON_UNITS 4u
+#define MODULE_BUS_QUERY_UNITS 6u
+#define MODULE_BUS_ACK_DELAY 4u
+#define MODULE_BUS_GAP_UNITS 4u
+
+/* Commands */
+enum module_bus_command {
+	MODULE_BUS_OFF,   /* Switch the relay off */
+	MODULE_BUS_ON,    /* Switch the relay on */
+	MODULE_BUS_QUERY, /* Report the relay state */
+};
+
+/* Module bus statistics */
+struct module_bus_stats {
+	uint16_t commands;    /* Transactions started */
+	uint16_t acks;        /* Transactions acknowledged */
+	uint16_t retries;     /* Commands sent again */
+	uint16_t failures;    /* Transactions given up after MODULE_BUS_RETRIES */
+	uint16_t mismatches;  /* Relay states read back that differ from the request */
+	uint16_t max_latency; /* Longest time from a command to its acknowledgement, in us */
+};
+
+#if MODULE_BUS_ENABLE == 1
+
+void module_bus_init(void);
+
+void module_bus_set(uint8_t module, bool on);
+
+void module_bus_query(uint8_t module);
+
+bool module_bus_get(uint8_t module);
+
+bool module_bus_is_present(uint8_t module);
+
+bool module_bus_is_busy(void);
+
+void module_bus_get_stats(struct module_bus_stats *stats);
+
+void module_bus_timer_isr(void);
+
+void module_bus_line_isr(uint8_t module);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODULE_BUS_H_INCLUDED */
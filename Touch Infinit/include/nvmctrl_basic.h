@@ -0,0 +1,67 @@
+/**
+ * \file
+ *
+ * \brief NVMCTRL basic driver.
+ *
+ (c) 2020 Microchip Technology Inc. and its subsidiaries.
+
+    Subject to your compliance with these terms,you may use this software and
+    any derivatives exclusively with Microchip products.It is your responsibility
+    to comply with third party license terms applicable to your use of third party
+    software (including open source software) that may accompany Microchip software.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ */
+
+#ifndef NVMCTRL_BASIC_H_INCLUDED
+#define NVMCTRL_BASIC_H_INCLUDED
+
+#include <compiler.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* EEPROM address, offset from the start of the EEPROM */
+typedef uint8_t eeprom_adr_t;
+
+/* Status of a write request */
+typedef enum {
+	NVM_OK,    /* Write started */
+	NVM_ERROR, /* Data outside the EEPROM or user row, or across a page boundary */
+	NVM_BUSY   /* A previous write is still in progress */
+} nvmctrl_status_t;
+
+uint8_t FLASH_read_eeprom_byte(eeprom_adr_t eeprom_adr);
+
+void FLASH_read_eeprom_block(eeprom_adr_t eeprom_adr, uint8_t *data, size_t size);
+
+const uint8_t *FLASH_eeprom_map(eeprom_adr_t eeprom_adr);
+
+nvmctrl_status_t FLASH_write_eeprom_page(eeprom_adr_t eeprom_adr, const uint8_t *data, uint8_t size);
+
+void FLASH_read_userrow_block(uint8_t offset, uint8_t *data, size_t size);
+
+nvmctrl_status_t FLASH_write_userrow(uint8_t offset, const uint8_t *data, uint8_t size);
+
+bool FLASH_is_eeprom_ready(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NVMCTRL_BASIC_H_INCLUDED */
@@ -0,0 +1,58 @@
+/**
+ * \file
+ *
+ * \brief RAM usage and stack high-water mark declaration.
+ *
+ */
+
+#ifndef RAM_MONITOR_H_INCLUDED
+#define RAM_MONITOR_H_INCLUDED
+
+#include <compiler.h>
+#include <atmel_start.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* RAM usage and stack high-water mark. The host reads them with the
+ * datastreamer commands, so they are only kept with the command receiver,
+ * DEF_TOUCH_COMMAND_RX_ENABLE. */
+#ifndef RAM_MONITOR_ENABLE
+#define RAM_MONITOR_ENABLE DEF_TOUCH_COMMAND_RX_ENABLE
+#endif
+
+/* Value the free RAM is painted with at start up */
+#ifndef RAM_MONITOR_PAINT
+#define RAM_MONITOR_PAINT 0xC5u
+#endif
+
+/* Time between two scans for the stack high-water mark, at most 32 s */
+#ifndef RAM_MONITOR_PERIOD_MS
+#define RAM_MONITOR_PERIOD_MS 1000u
+#endif
+
+/* RAM usage in bytes */
+struct ram_monitor_stats {
+	uint16_t static_size; /* .data, .bss and .noinit */
+	uint16_t stack_size;  /* RAM above the static data, for the stack */
+	uint16_t stack_free;  /* Fewest bytes of the stack left unused, 0 after an overflow */
+};
+
+#if RAM_MONITOR_ENABLE == 1
+
+void ram_monitor_init(void);
+
+void ram_monitor_process(void);
+
+void ram_monitor_scan(void);
+
+void ram_monitor_get_stats(struct ram_monitor_stats *stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAM_MONITOR_H_INCLUDED */
@@ -0,0 +1,76 @@
+/**
+ * \file
+ *
+ * \brief Zero-cross synchronised relay switching declaration.
+ *
+ */
+
+#ifndef RELAY_SCHEDULER_H_INCLUDED
+#define RELAY_SCHEDULER_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Time from energising the coil until the contacts close, in us. Includes the
+ * delay of the zero-cross detector, which is measured as lead time. */
+#ifndef RELAY_SCHEDULER_OPERATE_US
+#define RELAY_SCHEDULER_OPERATE_US 7000u
+#endif
+
+/* Time from releasing the coil until the contacts open, in us */
+#ifndef RELAY_SCHEDULER_RELEASE_US
+#define RELAY_SCHEDULER_RELEASE_US 3000u
+#endif
+
+/* Contact bounce after the contacts have moved, in us */
+#ifndef RELAY_SCHEDULER_BOUNCE_US
+#define RELAY_SCHEDULER_BOUNCE_US 2000u
+#endif
+
+/* Touch acquisition is blanked from this long before the coil is switched
+ * until the contacts have settled, in us. At least the length of a
+ * measurement sequence. */
+#ifndef RELAY_SCHEDULER_BLANK_LEAD_US
+#define RELAY_SCHEDULER_BLANK_LEAD_US 2000u
+#endif
+
+/* Mains frequency range the zero-cross input is accepted in, in Hz */
+#ifndef RELAY_SCHEDULER_MIN_HZ
+#define RELAY_SCHEDULER_MIN_HZ 45u
+#endif
+#ifndef RELAY_SCHEDULER_MAX_HZ
+#define RELAY_SCHEDULER_MAX_HZ 65u
+#endif
+
+/* Time a switching request waits for the mains phase before it is carried
+ * out without it, in ms */
+#ifndef RELAY_SCHEDULER_SYNC_TIMEOUT_MS
+#define RELAY_SCHEDULER_SYNC_TIMEOUT_MS 200u
+#endif
+
+/* Number of relays the scheduler switches, one bit each in 16-bit masks */
+#define RELAY_SCHEDULER_RELAYS 16u
+
+/* Drives the output of a relay, called from interrupt context */
+typedef void (*relay_output_cb_t)(uint8_t relay, bool on);
+
+void relay_scheduler_init(relay_output_cb_t output);
+
+void relay_scheduler_set(uint8_t relay, bool on);
+
+void relay_scheduler_hold(bool hold);
+
+bool relay_scheduler_get(uint8_t relay);
+
+bool relay_scheduler_is_synchronised(void);
+
+void relay_scheduler_zero_cross_isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RELAY_SCHEDULER_H_INCLUDED */
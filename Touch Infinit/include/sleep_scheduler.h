@@ -0,0 +1,41 @@
+/**
+ * \file
+ *
+ * \brief Main loop sleep scheduler declaration.
+ *
+ */
+
+#ifndef SLEEP_SCHEDULER_H_INCLUDED
+#define SLEEP_SCHEDULER_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Power states tracked by the scheduler */
+enum sleep_state {
+	SLEEP_STATE_ACTIVE,
+	SLEEP_STATE_IDLE,
+	SLEEP_STATE_STANDBY,
+	SLEEP_STATE_COUNT
+};
+
+/* Residency statistics per power state */
+struct sleep_stats {
+	uint32_t entries[SLEEP_STATE_COUNT];         /* Number of times the state was entered */
+	uint32_t residency_ticks[SLEEP_STATE_COUNT]; /* Time spent in the state, in 1/1024 s RTC ticks */
+};
+
+void sleep_scheduler_run(void);
+
+void sleep_scheduler_get_stats(struct sleep_stats *stats);
+
+void sleep_scheduler_clear_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SLEEP_SCHEDULER_H_INCLUDED */
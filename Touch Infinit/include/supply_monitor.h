@@ -0,0 +1,47 @@
+/**
+ * \file
+ *
+ * \brief Supply voltage monitoring and load shedding declaration.
+ *
+ */
+
+#ifndef SUPPLY_MONITOR_H_INCLUDED
+#define SUPPLY_MONITOR_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Offset in the user row of the reset log, which takes 6 bytes */
+#ifndef SUPPLY_MONITOR_USERROW_OFFSET
+#define SUPPLY_MONITOR_USERROW_OFFSET 0u
+#endif
+
+/* Supply monitoring statistics */
+struct supply_monitor_stats {
+	uint16_t dips;        /* Times VDD fell below the voltage level monitor threshold */
+	uint8_t  reset_cause; /* RSTCTRL.RSTFR of the last reset */
+	uint16_t brownouts;   /* Brown-out resets logged in the user row, saturating */
+};
+
+/* Called from interrupt context when VDD falls below the voltage level
+ * monitor threshold (low true) or rises above it again (low false) */
+typedef void (*supply_monitor_cb_t)(bool low);
+
+void supply_monitor_init(supply_monitor_cb_t changed);
+
+void supply_monitor_process(void);
+
+bool supply_monitor_is_low(void);
+
+void supply_monitor_get_stats(struct supply_monitor_stats *stats);
+
+void supply_monitor_vlm_isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUPPLY_MONITOR_H_INCLUDED */
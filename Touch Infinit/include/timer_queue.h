@@ -0,0 +1,50 @@
+/**
+ * \file
+ *
+ * \brief Tickless software timer queue declaration.
+ *
+ */
+
+#ifndef TIMER_QUEUE_H_INCLUDED
+#define TIMER_QUEUE_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* RTC tick rate: 32.768 kHz OSCULP32K divided by 32 */
+#define TIMER_TICKS_PER_SECOND 1024u
+
+/* Convert milli seconds to RTC ticks, rounded to the nearest tick */
+#define TIMER_MS_TO_TICKS(ms) ((uint16_t)((((uint32_t)(ms)) * TIMER_TICKS_PER_SECOND + 500u) / 1000u))
+
+/* Longest delay or period that can be scheduled, half the counter range */
+#define TIMER_MAX_TICKS 0x7fffu
+
+typedef void (*timer_callback_t)(void);
+
+/* Software timer, owned by the caller and linked into the queue while running */
+struct timer_struct {
+	uint16_t             due;      /* RTC count at which the timer expires */
+	uint16_t             period;   /* Reload in ticks, 0 for a one-shot timer */
+	timer_callback_t     callback; /* Called from the RTC interrupt on expiry */
+	struct timer_struct *next;
+};
+
+uint16_t timer_now(void);
+
+void timer_start(struct timer_struct *timer, uint16_t delay, uint16_t period);
+
+void timer_stop(struct timer_struct *timer);
+
+bool timer_is_running(const struct timer_struct *timer);
+
+void timer_queue_isr(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_QUEUE_H_INCLUDED */
@@ -38,6 +38,36 @@ extern "C" {
 /* Normal Mode, Baud register value */
 #define USART0_BAUD_RATE(BAUD_RATE) ((float)(20000000 * 64 / (16 * (float)BAUD_RATE)) + 0.5)
 
+/* Size of the interrupt-driven transmit ring buffer.
+ * Must be a power of two, at most 128 bytes.
+ */
+#ifndef USART_TX_BUFFER_SIZE
+#define USART_TX_BUFFER_SIZE 64
+#endif
+#define USART_TX_BUFFER_MASK (USART_TX_BUFFER_SIZE - 1)
+
+#if (USART_TX_BUFFER_SIZE & USART_TX_BUFFER_MASK) != 0 || USART_TX_BUFFER_SIZE > 128
+#error "USART_TX_BUFFER_SIZE must be a power of two, at most 128"
+#endif
+
+/* Receiver on RxD, PB3. 1 enables it with its ring buffer and interrupt, 0
+ * leaves PB3 to the port, where it is RELAY3. See DEF_TOUCH_COMMAND_RX_ENABLE
+ * in touch.h.
+ */
+#ifndef USART_RX_ENABLE
+#define USART_RX_ENABLE DEF_TOUCH_COMMAND_RX_ENABLE
+#endif
+
+/* Size of the interrupt-driven receive ring buffer.
+ * Must be a power of two, at most 128 bytes.
+ */
+#define USART_RX_BUFFER_SIZE 16
+#define USART_RX_BUFFER_MASK (USART_RX_BUFFER_SIZE - 1)
+
+#if (USART_RX_BUFFER_SIZE & USART_RX_BUFFER_MASK) != 0 || USART_RX_BUFFER_SIZE > 128
+#error "USART_RX_BUFFER_SIZE must be a power of two, at most 128"
+#endif
+
 int8_t USART_init();
 
 void USART_enable();
@@ -60,6 +90,26 @@ uint8_t USART_read(void);
 
 void USART_write(const uint8_t data);
 
+bool USART_write_buffer(const uint8_t *data, uint8_t len);
+
+uint8_t USART_tx_buffer_free();
+
+bool USART_is_tx_idle();
+
+uint16_t USART_get_tx_overflow_frames();
+
+uint16_t USART_get_tx_overflow_bytes();
+
+#if USART_RX_ENABLE == 1
+
+uint8_t USART_read_buffer(uint8_t *data, uint8_t len);
+
+uint8_t USART_rx_count();
+
+uint16_t USART_get_rx_overflow_bytes();
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
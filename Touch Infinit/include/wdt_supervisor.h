@@ -0,0 +1,85 @@
+/**
+ * \file
+ *
+ * \brief Watchdog supervision of the touch processing cycle declaration.
+ *
+ */
+
+#ifndef WDT_SUPERVISOR_H_INCLUDED
+#define WDT_SUPERVISOR_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Closed and open window of the watchdog. A kick in the closed window resets
+ * the device like no kick until the end of the open window. The watchdog
+ * counts the 1.024 kHz ULP oscillator, about 32 ms closed and 4 s open. */
+#ifndef WDT_SUPERVISOR_WINDOW
+#define WDT_SUPERVISOR_WINDOW WDT_WINDOW_32CLK_gc
+#endif
+
+#ifndef WDT_SUPERVISOR_PERIOD
+#define WDT_SUPERVISOR_PERIOD WDT_PERIOD_4KCLK_gc
+#endif
+
+/* Watchdog clocks of the windows, 1 ms each */
+#define WDT_SUPERVISOR_WINDOW_CLK (4ul << ((WDT_SUPERVISOR_WINDOW) >> 4))
+#define WDT_SUPERVISOR_PERIOD_CLK (4ul << (WDT_SUPERVISOR_PERIOD))
+
+/* Deadlines of the stages, each from the stage before it. A cycle with a
+ * stage past its deadline is late and does not kick the watchdog. */
+#ifndef WDT_SUPERVISOR_EOC_DEADLINE_MS
+#define WDT_SUPERVISOR_EOC_DEADLINE_MS 10u
+#endif
+
+#ifndef WDT_SUPERVISOR_PROCESS_DEADLINE_MS
+#define WDT_SUPERVISOR_PROCESS_DEADLINE_MS 40u
+#endif
+
+#ifndef WDT_SUPERVISOR_OUTPUT_DEADLINE_MS
+#define WDT_SUPERVISOR_OUTPUT_DEADLINE_MS 50u
+#endif
+
+/* Offset in the user row of the watchdog log, which takes 6 bytes */
+#ifndef WDT_SUPERVISOR_USERROW_OFFSET
+#define WDT_SUPERVISOR_USERROW_OFFSET 8u
+#endif
+
+/* Stages of the touch processing cycle, in order */
+enum wdt_supervisor_stage {
+	WDT_SUPERVISOR_STAGE_START,   /* Measurement started */
+	WDT_SUPERVISOR_STAGE_EOC,     /* Measurement complete */
+	WDT_SUPERVISOR_STAGE_PROCESS, /* Acquisition and key post-processing done */
+	WDT_SUPERVISOR_STAGE_OUTPUT,  /* Datastreamer output done */
+	WDT_SUPERVISOR_STAGES,
+	WDT_SUPERVISOR_STAGE_NONE = WDT_SUPERVISOR_STAGES
+};
+
+/* Watchdog supervision statistics */
+struct wdt_supervisor_stats {
+	uint16_t kicks;      /* Watchdog resets by completed cycles */
+	uint16_t late;       /* Cycles with a stage past its deadline */
+	uint8_t  last_stage; /* Stage blamed for the last watchdog reset, from the user row */
+	uint16_t resets;     /* Watchdog resets logged in the user row, saturating */
+};
+
+void wdt_supervisor_init(void);
+
+void wdt_supervisor_checkpoint(enum wdt_supervisor_stage stage);
+
+enum wdt_supervisor_stage wdt_supervisor_get_pending_stage(void);
+
+enum wdt_supervisor_stage wdt_supervisor_get_overrun_stage(void);
+
+void wdt_supervisor_process(void);
+
+void wdt_supervisor_get_stats(struct wdt_supervisor_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WDT_SUPERVISOR_H_INCLUDED */
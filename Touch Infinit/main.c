@@ -1,4 +1,9 @@
 #include <atmel_start.h>
+#include <ram_monitor.h>
+#include <sleep_scheduler.h>
+#include <supply_monitor.h>
+#include <wdt_supervisor.h>
+#include <touch_example.h>
 #include <util/delay.h>
 
 
@@ -8,10 +13,34 @@ int main(void)
 	/* Initializes MCU, drivers and middleware */
 	atmel_start_init();
 
+	/* The watchdog resets the device when touch processing stalls, the
+	 * stalled stage is logged. Before the reset cause is cleared below. */
+	wdt_supervisor_init();
+
+	/* Load is shed while the supply sags, and the reset cause is recorded */
+	touch_supply_init();
+
+	/* Relays keep their state over a reset or power failure, switched at
+	 * zero-crosses of the mains */
+	touch_relays_restore();
+
+	/* Key LEDs fade in and out by PWM */
+	touch_leds_init();
+
 	/* Replace with your application code */
 	while (1) {
 		touch_example();
-		
-		
+
+		/* Log the last reset in the user row */
+		supply_monitor_process();
+		wdt_supervisor_process();
+
+#if RAM_MONITOR_ENABLE == 1
+		/* Stack high-water mark */
+		ram_monitor_process();
+#endif
+
+		/* Sleep until the next timer or PTC conversion when there is no work */
+		sleep_scheduler_run();
 	}
 }
@@ -35,11 +35,33 @@ Support: Visit http://www.microchip.com/support/hottopics.aspx
 #define MEGA_328PB_XPLAINED_MINI 0xF015
 #define MEGA_324PB_XPLAINED_PRO 0xF016
 
+/* Compact frames: sync, payload length, sequence, flags, payload, CRC-8.
+ * Flags bits 3:0 give the frame type.
+ */
+#define DATASTREAMER_SYNC 0xA5u
+#define DATASTREAMER_TYPE_MASK 0x0Fu
+#define DATASTREAMER_TYPE_SAMPLES 0x00u
+#define DATASTREAMER_TYPE_INFO 0x01u
+#define DATASTREAMER_TYPE_COMMAND 0x02u
+#define DATASTREAMER_TYPE_RESPONSE 0x03u
+#define DATASTREAMER_TYPE_PROFILE 0x04u
+
 /*----------------------------------------------------------------------------
  *   prototypes
  *----------------------------------------------------------------------------*/
 void datastreamer_init(void);
 void datastreamer_output(void);
+#if (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+uint8_t datastreamer_output_ready(void);
+#endif
+void datastreamer_request_header(void);
+
+uint8_t *datastreamer_frame_begin(uint8_t *frame_ptr, uint8_t sequence, uint8_t flags);
+uint8_t *datastreamer_frame_end(uint8_t *frame_start, uint8_t *frame_ptr);
+uint8_t  datastreamer_crc8(const uint8_t *data, uint8_t len);
+
+void    datastreamer_command_process(void);
+uint8_t datastreamer_command_pending(void);
 
 #endif
 
@@ -23,14 +23,79 @@ Copyright (c) 2021 Microchip. All rights reserved.
 /*----------------------------------------------------------------------------
   include files
 ----------------------------------------------------------------------------*/
+#include <string.h>
 #include "datastreamer.h"
 #include "driver_init.h"
+#include "touch_freq_hop.h"
+#include "touch_profile.h"
 
 #if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1u)
 
 /*----------------------------------------------------------------------------
  *     defines
  *--------------------------------------------------------------------------*/
+/* Frequency hop data: acquisition frequency and noise figure per hop step */
+#if (DEF_TOUCH_FREQ_HOP_ENABLE == 1u)
+#define DATASTREAMER_HOP_SIZE (2u * NUM_FREQ_STEPS)
+#else
+#define DATASTREAMER_HOP_SIZE 0u
+#endif
+
+#if (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+
+/* Frame layout: start token, sequence, 10 bytes per channel, module error code,
+ * frequency hop data, sequence, end token. The 19-byte header is prepended
+ * every 16th frame.
+ */
+#define DATASTREAMER_FRAME_SIZE (2u + (10u * DEF_NUM_CHANNELS) + 1u + DATASTREAMER_HOP_SIZE + 2u)
+
+#else
+
+/* Compact frame layout:
+ *   sync 0xA5, payload length, sequence, flags, payload, CRC-8
+ * The CRC-8 (polynomial 0x07, initial value 0) covers length to payload.
+ * Flags bits 3:0 give the frame type, bit 4 marks a key frame, bit 5 a
+ * module error code and bit 6 frequency hop data in the payload. Command and response frames are described
+ * in datastreamer_command.c.
+ *
+ * Samples payload:
+ *   state bits, bit n: key n in detect, bit DEF_NUM_CHANNELS + n: reference
+ *   and compensation of node n follow; module error code if flagged;
+ *   frequency hop data if flagged: number of hop steps, then acquisition
+ *   frequency and noise figure per step, in key frames; per node the signal,
+ *   then reference and compensation if flagged.
+ * Values are LEB128 varints, absolute in key frames and zigzag encoded
+ * differences to the last value sent otherwise. Key frames carry all values
+ * and are sent every DATASTREAMER_KEYFRAME_INTERVAL frames, after the header
+ * and after a dropped frame.
+ *
+ * Info payload, the header, sent at start up and on request:
+ *   protocol version, number of channels, threshold per key
+ *
+ * Profile payload, with DEF_TOUCH_PROFILE_ENABLE, after a samples frame and
+ * with its sequence:
+ *   TCB0 counts per us, stage (enum touch_profile_stage), number of samples,
+ *   then the shortest, longest and mean time of the stage in TCB0 counts, all
+ *   0 without samples
+ * Values are LEB128 varints. One stage is sent per frame, in turn, each with
+ * its samples since it was sent last. A stage waits while the UART ring is
+ * busy.
+ */
+#define DATASTREAMER_FLAG_KEYFRAME 0x10u
+#define DATASTREAMER_FLAG_ERROR 0x20u
+#define DATASTREAMER_FLAG_HOP 0x40u
+#define DATASTREAMER_VERSION 1u
+#define DATASTREAMER_KEYFRAME_INTERVAL 32u
+
+#define DATASTREAMER_BITS_SIZE ((2u * DEF_NUM_CHANNELS + 7u) / 8u)
+/* Worst case, three 3-byte varints per node */
+#define DATASTREAMER_SAMPLES_SIZE                                                                                      \
+	(4u + DATASTREAMER_BITS_SIZE + 1u + 1u + DATASTREAMER_HOP_SIZE + (9u * DEF_NUM_CHANNELS) + 1u)
+#define DATASTREAMER_INFO_SIZE (4u + 2u + DEF_NUM_CHANNELS + 1u)
+/* Worst case, 3-byte sample count and three 5-byte varints */
+#define DATASTREAMER_PROFILE_SIZE (4u + 2u + 3u + (3u * 5u) + 1u)
+
+#endif
 
 /*----------------------------------------------------------------------------
   global variables
@@ -41,13 +106,54 @@ extern qtm_touch_key_config_t    qtlib_key_configs_set1[DEF_NUM_SENSORS];
 
 extern uint8_t module_error_code;
 
+/* Set to send the header with the next frame */
+static volatile uint8_t datastreamer_header_requested = 1u;
+
+#if (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+
 uint8_t data[] = {
     0x5F, 0xB4, 0x00, 0x86, 0x4A, 0x03, 0xEB, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xAA, 0x55, 0x01, 0x6E, 0xA0};
 
+/* 19-byte Data Visualizer header, a full frame must fit into the UART ring */
+#if (19u + DATASTREAMER_FRAME_SIZE) > USART_TX_BUFFER_SIZE
+#error "Datastreamer frame does not fit into USART_TX_BUFFER_SIZE, define it as 128"
+#endif
+
+/* Sequence number of the next frame, the header goes with every 16th */
+static uint8_t datastreamer_sequence;
+
+#else
+
+/* Values as last sent: signal, reference, compensation per node */
+static uint16_t datastreamer_last[DEF_NUM_CHANNELS][3];
+static uint8_t  datastreamer_sequence;
+/* Frames until the next key frame, 0 forces one */
+static uint8_t datastreamer_keyframe_count;
+#if (DEF_TOUCH_PROFILE_ENABLE == 1u)
+/* Stage of the next profile frame */
+static uint8_t datastreamer_profile_stage;
+#endif
+
+/* Header and samples are queued as one block */
+#if (DATASTREAMER_INFO_SIZE + DATASTREAMER_SAMPLES_SIZE) > USART_TX_BUFFER_SIZE
+#error "Datastreamer frame does not fit into USART_TX_BUFFER_SIZE"
+#endif
+
+#endif
+
 /*----------------------------------------------------------------------------
   prototypes
 ----------------------------------------------------------------------------*/
-void datastreamer_transmit(uint8_t data);
+#if (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+static uint8_t *datastreamer_put_u16(uint8_t *frame_ptr, uint16_t value);
+#else
+static uint8_t *datastreamer_put_varint(uint8_t *frame_ptr, uint16_t value);
+static uint8_t *datastreamer_put_value(uint8_t *frame_ptr, uint16_t value, uint16_t *last, uint8_t keyframe);
+#if (DEF_TOUCH_PROFILE_ENABLE == 1u)
+static uint8_t *datastreamer_put_varint32(uint8_t *frame_ptr, uint32_t value);
+static void     datastreamer_profile_output(uint8_t sequence, uint8_t samples_size);
+#endif
+#endif
 
 /*----------------------------------------------------------------------------
  *   function definitions
@@ -66,22 +172,114 @@ void datastreamer_init(void)
 }
 
 /*============================================================================
-void datastreamer_transmit(uint8_t data_byte)
+void datastreamer_request_header(void)
 ------------------------------------------------------------------------------
-Purpose: Transmits the single byte through the configured UART port.
-Input  : Byte to be transmitted
+Purpose: Sends the header with the next frame
+Input  : none
 Output : none
+Notes  : Can be called from interrupt context. In compact mode this is the only
+         way the header is sent after start up.
+============================================================================*/
+void datastreamer_request_header(void)
+{
+	datastreamer_header_requested = 1u;
+}
+
+/*============================================================================
+uint8_t datastreamer_crc8(const uint8_t *data, uint8_t len)
+------------------------------------------------------------------------------
+Purpose: CRC-8 of the compact frames, polynomial 0x07, initial value 0
+Input  : Data, length
+Output : CRC
 Notes  :
 ============================================================================*/
-void datastreamer_transmit(uint8_t data_byte)
+uint8_t datastreamer_crc8(const uint8_t *data, uint8_t len)
 {
-	while (!USART_is_tx_ready())
-		;
+	uint8_t crc = 0u;
+	uint8_t bit;
 
-	USART_write(data_byte);
+	while (len--) {
+		crc ^= *data++;
+		for (bit = 0u; bit < 8u; bit++) {
+			crc = (crc & 0x80u) ? (uint8_t)((crc << 1u) ^ 0x07u) : (uint8_t)(crc << 1u);
+		}
+	}
 
-	while (USART_is_tx_busy())
-		;
+	return crc;
+}
+
+/*============================================================================
+uint8_t *datastreamer_frame_begin(uint8_t *frame_ptr, uint8_t sequence, uint8_t flags)
+------------------------------------------------------------------------------
+Purpose: Appends the sync, length, sequence and flags bytes of a compact frame
+Input  : Write position, sequence, flags
+Output : Payload write position
+Notes  : The length is filled in by datastreamer_frame_end()
+============================================================================*/
+uint8_t *datastreamer_frame_begin(uint8_t *frame_ptr, uint8_t sequence, uint8_t flags)
+{
+	*frame_ptr++ = DATASTREAMER_SYNC;
+	*frame_ptr++ = 0u;
+	*frame_ptr++ = sequence;
+	*frame_ptr++ = flags;
+
+	return frame_ptr;
+}
+
+/*============================================================================
+uint8_t *datastreamer_frame_end(uint8_t *frame_start, uint8_t *frame_ptr)
+------------------------------------------------------------------------------
+Purpose: Fills in the payload length of a compact frame and appends the CRC-8
+Input  : Start of the frame, end of the payload
+Output : End of the frame
+Notes  :
+============================================================================*/
+uint8_t *datastreamer_frame_end(uint8_t *frame_start, uint8_t *frame_ptr)
+{
+	uint8_t length = (uint8_t)(frame_ptr - frame_start);
+
+	frame_start[1] = length - 4u;
+	*frame_ptr++   = datastreamer_crc8(&frame_start[1], length - 1u);
+
+	return frame_ptr;
+}
+
+#if (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+
+/*============================================================================
+static uint8_t *datastreamer_put_u16(uint8_t *frame_ptr, uint16_t value)
+------------------------------------------------------------------------------
+Purpose: Appends a 16-bit value to the frame being built, LSB first.
+Input  : Write position in the frame, value to append
+Output : Next write position
+Notes  :
+============================================================================*/
+static uint8_t *datastreamer_put_u16(uint8_t *frame_ptr, uint16_t value)
+{
+	*frame_ptr++ = (uint8_t)value;
+	*frame_ptr++ = (uint8_t)(value >> 8u);
+
+	return frame_ptr;
+}
+
+/*============================================================================
+uint8_t datastreamer_output_ready(void)
+------------------------------------------------------------------------------
+Purpose: Checks that the next frame fits into the UART transmit ring
+Input  : none
+Output : 1 if datastreamer_output() can queue the frame now
+Notes  : At 38400 baud a frame takes longer to send than a reburst to
+         measure, the frames of back to back measurements overrun the ring.
+============================================================================*/
+uint8_t datastreamer_output_ready(void)
+{
+	uint8_t size = DATASTREAMER_FRAME_SIZE;
+
+	if (((datastreamer_sequence & 0x0fu) == 0u) || (datastreamer_header_requested != 0u)) {
+		size += sizeof(data);
+	}
+
+	return USART_tx_buffer_free() >= size;
 }
 
 /*============================================================================
@@ -93,71 +291,289 @@ Input  : none
 Output : none
 Notes  : The data visualizer scripts that are generated in the project should be
          set on the data visualizer software.
+         The frame is built in a local buffer and queued on the interrupt-driven
+         UART transmit ring in one call, so this function returns without
+         waiting for the bytes to go out. touch_process() waits for
+         datastreamer_output_ready() first. If the ring is still busy with the
+         previous frame, the whole frame is dropped and counted by the USART
+         driver; the sequence number still advances so the gap is visible.
 ============================================================================*/
 void datastreamer_output(void)
 {
-	int16_t           i, temp_int_calc;
-	static uint8_t    sequence = 0u;
-	uint16_t          u16temp_output;
-	uint8_t           u8temp_output, send_header;
-	volatile uint16_t count_bytes_out;
-
-	send_header = sequence & (0x0f);
-	if (send_header == 0) {
-		for (i = 0; i < sizeof(data); i++) {
-			datastreamer_transmit(data[i]);
-		}
+	int16_t  temp_int_calc;
+	uint16_t count_bytes_out;
+	uint8_t  frame[sizeof(data) + DATASTREAMER_FRAME_SIZE];
+	uint8_t *frame_ptr = &frame[0];
+
+	if (((datastreamer_sequence & 0x0fu) == 0u) || (datastreamer_header_requested != 0u)) {
+		datastreamer_header_requested = 0u;
+		memcpy(frame_ptr, data, sizeof(data));
+		frame_ptr += sizeof(data);
 	}
 
 	// Start token
-	datastreamer_transmit(0x55);
+	*frame_ptr++ = 0x55;
 
 	// Frame Start
-	datastreamer_transmit(sequence);
+	*frame_ptr++ = datastreamer_sequence;
 	for (count_bytes_out = 0u; count_bytes_out < DEF_NUM_CHANNELS; count_bytes_out++) {
 
 		/* Signals */
-		u16temp_output = get_sensor_node_signal(count_bytes_out);
-		datastreamer_transmit((uint8_t)u16temp_output);
-		datastreamer_transmit((uint8_t)(u16temp_output >> 8u));
+		frame_ptr = datastreamer_put_u16(frame_ptr, get_sensor_node_signal(count_bytes_out));
 
 		/* Reference */
-		u16temp_output = get_sensor_node_reference(count_bytes_out);
-		datastreamer_transmit((uint8_t)u16temp_output);
-		datastreamer_transmit((uint8_t)(u16temp_output >> 8u));
+		frame_ptr = datastreamer_put_u16(frame_ptr, get_sensor_node_reference(count_bytes_out));
 
 		/* Touch delta */
 		temp_int_calc = get_sensor_node_signal(count_bytes_out);
 		temp_int_calc -= get_sensor_node_reference(count_bytes_out);
-		u16temp_output = (uint16_t)(temp_int_calc);
-		datastreamer_transmit((uint8_t)u16temp_output);
-		datastreamer_transmit((uint8_t)(u16temp_output >> 8u));
+		frame_ptr = datastreamer_put_u16(frame_ptr, (uint16_t)(temp_int_calc));
 
 		/* Comp Caps */
-		u16temp_output = get_sensor_cc_val(count_bytes_out);
-		datastreamer_transmit((uint8_t)u16temp_output);
-		datastreamer_transmit((uint8_t)(u16temp_output >> 8u));
+		frame_ptr = datastreamer_put_u16(frame_ptr, get_sensor_cc_val(count_bytes_out));
 
 		/* State */
-		u8temp_output = get_sensor_state(count_bytes_out);
-		if (0u != (u8temp_output & 0x80)) {
-			datastreamer_transmit(0x01);
+		if (0u != (get_sensor_state(count_bytes_out) & 0x80)) {
+			*frame_ptr++ = 0x01;
 		} else {
-			datastreamer_transmit(0x00);
+			*frame_ptr++ = 0x00;
 		}
 
 		/* Threshold */
-		datastreamer_transmit(qtlib_key_configs_set1[count_bytes_out].channel_threshold);
+		*frame_ptr++ = qtlib_key_configs_set1[count_bytes_out].channel_threshold;
 	}
 
 	/* Other Debug Parameters */
-	datastreamer_transmit(module_error_code);
+	*frame_ptr++ = module_error_code;
+
+#if (DEF_TOUCH_FREQ_HOP_ENABLE == 1u)
+	for (count_bytes_out = 0u; count_bytes_out < NUM_FREQ_STEPS; count_bytes_out++) {
+		*frame_ptr++ = touch_freq_hop_get_freq(count_bytes_out);
+		*frame_ptr++ = touch_freq_hop_get_noise(count_bytes_out);
+	}
+#endif
 
 	/* Frame End */
-	datastreamer_transmit(sequence++);
+	*frame_ptr++ = datastreamer_sequence++;
 
 	/* End token */
-	datastreamer_transmit(~0x55);
+	*frame_ptr++ = (uint8_t)(~0x55);
+
+	USART_write_buffer(&frame[0], (uint8_t)(frame_ptr - &frame[0]));
 }
 
+#else
+
+/*============================================================================
+static uint8_t *datastreamer_put_varint(uint8_t *frame_ptr, uint16_t value)
+------------------------------------------------------------------------------
+Purpose: Appends a value as LEB128 varint, 7 bits per byte, LSB group first.
+Input  : Write position in the frame, value to append
+Output : Next write position
+Notes  : 1 to 3 bytes
+============================================================================*/
+static uint8_t *datastreamer_put_varint(uint8_t *frame_ptr, uint16_t value)
+{
+	while (value >= 0x80u) {
+		*frame_ptr++ = (uint8_t)value | 0x80u;
+		value >>= 7u;
+	}
+	*frame_ptr++ = (uint8_t)value;
+
+	return frame_ptr;
+}
+
+/*============================================================================
+static uint8_t *datastreamer_put_value(uint8_t *frame_ptr, uint16_t value, uint16_t *last, uint8_t keyframe)
+------------------------------------------------------------------------------
+Purpose: Appends a sample value, absolute in key frames, otherwise as zigzag
+         encoded difference to the last value sent.
+Input  : Write position in the frame, value to append, last value sent,
+         key frame
+Output : Next write position
+Notes  : Updates *last
+============================================================================*/
+static uint8_t *datastreamer_put_value(uint8_t *frame_ptr, uint16_t value, uint16_t *last, uint8_t keyframe)
+{
+	int16_t diff = (int16_t)(value - *last);
+
+	*last = value;
+	if (keyframe == 0u) {
+		value = (uint16_t)((uint16_t)diff << 1u) ^ (uint16_t)(diff >> 15u);
+	}
+
+	return datastreamer_put_varint(frame_ptr, value);
+}
+
+#if (DEF_TOUCH_PROFILE_ENABLE == 1u)
+
+/*============================================================================
+static uint8_t *datastreamer_put_varint32(uint8_t *frame_ptr, uint32_t value)
+------------------------------------------------------------------------------
+Purpose: Appends a 32-bit value as LEB128 varint
+Input  : Write position in the frame, value to append
+Output : Next write position
+Notes  : 1 to 5 bytes
+============================================================================*/
+static uint8_t *datastreamer_put_varint32(uint8_t *frame_ptr, uint32_t value)
+{
+	while (value >= 0x80u) {
+		*frame_ptr++ = (uint8_t)value | 0x80u;
+		value >>= 7u;
+	}
+	*frame_ptr++ = (uint8_t)value;
+
+	return frame_ptr;
+}
+
+/*============================================================================
+static void datastreamer_profile_output(uint8_t sequence, uint8_t samples_size)
+------------------------------------------------------------------------------
+Purpose: Queues the profile frame of the next stage behind a samples frame
+Input  : Sequence and size of the samples frame
+Output : none
+Notes  : Only behind a samples frame that found the UART ring empty, so
+         profile frames do not make samples frames drop while measurements
+         follow each other closely. The statistics of the stage are only read,
+         and so started again, when the frame is sent.
+============================================================================*/
+static void datastreamer_profile_output(uint8_t sequence, uint8_t samples_size)
+{
+	uint8_t                   frame[DATASTREAMER_PROFILE_SIZE];
+	uint8_t *                 frame_ptr;
+	struct touch_profile_stat stat;
+	uint32_t                  mean = 0u;
+	uint8_t                   free = USART_tx_buffer_free();
+
+	if ((free < DATASTREAMER_PROFILE_SIZE) || ((uint16_t)free + samples_size < USART_TX_BUFFER_SIZE)) {
+		return;
+	}
+
+	touch_profile_get((enum touch_profile_stage)datastreamer_profile_stage, &stat);
+	if (stat.count == 0u) {
+		stat.min = 0u;
+	} else {
+		mean = stat.sum / stat.count;
+	}
+
+	frame_ptr    = datastreamer_frame_begin(&frame[0], sequence, DATASTREAMER_TYPE_PROFILE);
+	*frame_ptr++ = TOUCH_PROFILE_COUNTS_PER_US;
+	*frame_ptr++ = datastreamer_profile_stage;
+	frame_ptr    = datastreamer_put_varint(frame_ptr, stat.count);
+	frame_ptr    = datastreamer_put_varint32(frame_ptr, stat.min);
+	frame_ptr    = datastreamer_put_varint32(frame_ptr, stat.max);
+	frame_ptr    = datastreamer_put_varint32(frame_ptr, mean);
+	frame_ptr    = datastreamer_frame_end(&frame[0], frame_ptr);
+	USART_write_buffer(&frame[0], (uint8_t)(frame_ptr - &frame[0]));
+
+	if (++datastreamer_profile_stage == TOUCH_PROFILE_STAGES) {
+		datastreamer_profile_stage = 0u;
+	}
+}
+
+#endif
+
+/*============================================================================
+void datastreamer_output(void)
+------------------------------------------------------------------------------
+Purpose: Forms the compact datastreamer frame, preceded by the header frame
+         when requested, and queues it on the UART port.
+Input  : none
+Output : none
+Notes  : As in Data Visualizer mode the frames are queued in one call without
+         waiting. A dropped block forces a key frame, and the header again if
+         it was part of the block, so the receiver resynchronises.
+============================================================================*/
+void datastreamer_output(void)
+{
+	uint8_t  frame[DATASTREAMER_INFO_SIZE + DATASTREAMER_SAMPLES_SIZE];
+	uint8_t *frame_ptr = &frame[0];
+	uint8_t *frame_start;
+	uint8_t *bits;
+	uint8_t  flags  = DATASTREAMER_TYPE_SAMPLES;
+	uint8_t  header = datastreamer_header_requested;
+	uint8_t  keyframe;
+	uint16_t node;
+
+	if (header != 0u) {
+		datastreamer_header_requested = 0u;
+		frame_start                   = frame_ptr;
+
+		frame_ptr    = datastreamer_frame_begin(frame_ptr, datastreamer_sequence++, DATASTREAMER_TYPE_INFO);
+		*frame_ptr++ = DATASTREAMER_VERSION;
+		*frame_ptr++ = DEF_NUM_CHANNELS;
+		for (node = 0u; node < DEF_NUM_SENSORS; node++) {
+			*frame_ptr++ = qtlib_key_configs_set1[node].channel_threshold;
+		}
+		frame_ptr                   = datastreamer_frame_end(frame_start, frame_ptr);
+		datastreamer_keyframe_count = 0u;
+	}
+
+	if (datastreamer_keyframe_count == 0u) {
+		datastreamer_keyframe_count = DATASTREAMER_KEYFRAME_INTERVAL;
+		flags |= DATASTREAMER_FLAG_KEYFRAME;
+	}
+	datastreamer_keyframe_count--;
+	keyframe = flags & DATASTREAMER_FLAG_KEYFRAME;
+	if (module_error_code != 0u) {
+		flags |= DATASTREAMER_FLAG_ERROR;
+	}
+#if (DEF_TOUCH_FREQ_HOP_ENABLE == 1u)
+	if (keyframe != 0u) {
+		flags |= DATASTREAMER_FLAG_HOP;
+	}
+#endif
+
+	frame_start = frame_ptr;
+	frame_ptr   = datastreamer_frame_begin(frame_ptr, datastreamer_sequence++, flags);
+	bits        = frame_ptr;
+	memset(bits, 0, DATASTREAMER_BITS_SIZE);
+	frame_ptr += DATASTREAMER_BITS_SIZE;
+	if (0u != (flags & DATASTREAMER_FLAG_ERROR)) {
+		*frame_ptr++ = module_error_code;
+	}
+#if (DEF_TOUCH_FREQ_HOP_ENABLE == 1u)
+	if (0u != (flags & DATASTREAMER_FLAG_HOP)) {
+		*frame_ptr++ = NUM_FREQ_STEPS;
+		for (node = 0u; node < NUM_FREQ_STEPS; node++) {
+			*frame_ptr++ = touch_freq_hop_get_freq(node);
+			*frame_ptr++ = touch_freq_hop_get_noise(node);
+		}
+	}
+#endif
+
+	for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+		uint16_t *last      = datastreamer_last[node];
+		uint16_t  reference = get_sensor_node_reference(node);
+		uint16_t  cc        = get_sensor_cc_val(node);
+
+		if (0u != (get_sensor_state(node) & 0x80)) {
+			bits[node >> 3u] |= (uint8_t)(1u << (node & 7u));
+		}
+
+		frame_ptr = datastreamer_put_value(frame_ptr, get_sensor_node_signal(node), &last[0], keyframe);
+
+		if ((keyframe != 0u) || (reference != last[1]) || (cc != last[2])) {
+			bits[(DEF_NUM_CHANNELS + node) >> 3u] |= (uint8_t)(1u << ((DEF_NUM_CHANNELS + node) & 7u));
+			frame_ptr = datastreamer_put_value(frame_ptr, reference, &last[1], keyframe);
+			frame_ptr = datastreamer_put_value(frame_ptr, cc, &last[2], keyframe);
+		}
+	}
+	frame_ptr = datastreamer_frame_end(frame_start, frame_ptr);
+
+	if (!USART_write_buffer(&frame[0], (uint8_t)(frame_ptr - &frame[0]))) {
+		datastreamer_keyframe_count = 0u;
+		if (header != 0u) {
+			datastreamer_header_requested = 1u;
+		}
+	}
+#if (DEF_TOUCH_PROFILE_ENABLE == 1u)
+	else {
+		datastreamer_profile_output(frame_start[2], (uint8_t)(frame_ptr - frame_start));
+	}
+#endif
+}
+
+#endif
+
 #endif
@@ -0,0 +1,330 @@
+/*============================================================================
+Filename : datastreamer_command.c
+Project : QTouch Modular Library
+Purpose : Command protocol on the datastreamer UART port, reads and writes key
+          and scan rate parameters at runtime, and reports the RAM usage.
+
+------------------------------------------------------------------------------
+Commands and responses use the compact frame layout of
+datastreamer_UART_avr.c:
+  sync 0xA5, payload length, sequence, flags, payload, CRC-8
+
+Command, type DATASTREAMER_TYPE_COMMAND, sent by the host:
+  opcode, parameter, index[, value LSB, value MSB for write]
+Response, type DATASTREAMER_TYPE_RESPONSE, sequence of the command:
+  status, opcode, parameter, index, value LSB, value MSB
+
+Commands with a CRC error are ignored, the host repeats them after a timeout.
+Writes are idempotent and answered with the value read back.
+
+Commands arrive on PB3, RELAY3 of the 3-gang board, so the protocol is only
+built with DEF_TOUCH_COMMAND_RX_ENABLE.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include "datastreamer.h"
+#include "driver_init.h"
+#include "ram_monitor.h"
+
+#if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1u) && (DEF_TOUCH_COMMAND_RX_ENABLE == 1u)
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *--------------------------------------------------------------------------*/
+/* Opcodes */
+#define DATASTREAMER_COMMAND_READ 0x01u
+#define DATASTREAMER_COMMAND_WRITE 0x02u
+#define DATASTREAMER_COMMAND_HEADER 0x03u
+
+/* Parameters, the index selects the key of per-key parameters and is 0
+ * otherwise */
+#define DATASTREAMER_PARAM_THRESHOLD 0x01u           /* key threshold, 1 to 255 */
+#define DATASTREAMER_PARAM_HYSTERESIS 0x02u          /* key hysteresis, HYST_50 to HYST_6_25 */
+#define DATASTREAMER_PARAM_TOUCH_DI 0x03u            /* DEF_TOUCH_DET_INT */
+#define DATASTREAMER_PARAM_TOUCH_DRIFT_RATE 0x04u    /* DEF_TCH_DRIFT_RATE */
+#define DATASTREAMER_PARAM_ANTI_TOUCH_DRIFT 0x05u    /* DEF_ANTI_TCH_DRIFT_RATE */
+#define DATASTREAMER_PARAM_DRIFT_HOLD_TIME 0x06u     /* DEF_DRIFT_HOLD_TIME */
+#define DATASTREAMER_PARAM_MEASUREMENT_PERIOD 0x07u  /* fast period in ms, 1 to 255 */
+#define DATASTREAMER_PARAM_IDLE_PERIOD 0x08u         /* idle period in ms, 1 to 255 */
+#define DATASTREAMER_PARAM_IDLE_TIMEOUT 0x09u        /* idle timeout in ms */
+#define DATASTREAMER_PARAM_STATIC_RAM 0x0Au          /* static data in bytes, read only */
+#define DATASTREAMER_PARAM_STACK_FREE 0x0Bu          /* fewest stack bytes left free, read only */
+
+/* Response status */
+#define DATASTREAMER_STATUS_OK 0x00u
+#define DATASTREAMER_STATUS_BAD_COMMAND 0x01u
+#define DATASTREAMER_STATUS_BAD_PARAMETER 0x02u
+#define DATASTREAMER_STATUS_BAD_INDEX 0x03u
+#define DATASTREAMER_STATUS_BAD_VALUE 0x04u
+
+#define DATASTREAMER_COMMAND_MAX_PAYLOAD 5u
+#define DATASTREAMER_RESPONSE_PAYLOAD 6u
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+extern qtm_touch_key_group_config_t qtlib_key_grp_config_set1;
+extern qtm_touch_key_config_t       qtlib_key_configs_set1[DEF_NUM_SENSORS];
+
+extern uint8_t  touch_fast_period_ms;
+extern uint8_t  touch_idle_period_ms;
+extern uint16_t touch_idle_timeout_ms;
+
+/* Command frame being received */
+static uint8_t datastreamer_command_frame[4u + DATASTREAMER_COMMAND_MAX_PAYLOAD + 1u];
+static uint8_t datastreamer_command_length;
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static uint8_t datastreamer_command_read(uint8_t parameter, uint8_t index, uint16_t *value);
+static uint8_t datastreamer_command_write(uint8_t parameter, uint8_t index, uint16_t value);
+static void    datastreamer_command_execute(void);
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+static uint8_t datastreamer_command_read(uint8_t parameter, uint8_t index, uint16_t *value)
+------------------------------------------------------------------------------
+Purpose: Reads a parameter
+Input  : Parameter, key index for per-key parameters
+Output : Response status, the value in *value
+Notes  : The stack is scanned for its high-water mark before it is reported.
+============================================================================*/
+static uint8_t datastreamer_command_read(uint8_t parameter, uint8_t index, uint16_t *value)
+{
+#if RAM_MONITOR_ENABLE == 1
+	struct ram_monitor_stats ram;
+#endif
+
+	if ((parameter == DATASTREAMER_PARAM_THRESHOLD) || (parameter == DATASTREAMER_PARAM_HYSTERESIS)) {
+		if (index >= DEF_NUM_SENSORS) {
+			return DATASTREAMER_STATUS_BAD_INDEX;
+		}
+	} else if (index != 0u) {
+		return DATASTREAMER_STATUS_BAD_INDEX;
+	}
+
+	switch (parameter) {
+	case DATASTREAMER_PARAM_THRESHOLD:
+		*value = qtlib_key_configs_set1[index].channel_threshold;
+		break;
+	case DATASTREAMER_PARAM_HYSTERESIS:
+		*value = qtlib_key_configs_set1[index].channel_hysteresis;
+		break;
+	case DATASTREAMER_PARAM_TOUCH_DI:
+		*value = qtlib_key_grp_config_set1.sensor_touch_di;
+		break;
+	case DATASTREAMER_PARAM_TOUCH_DRIFT_RATE:
+		*value = qtlib_key_grp_config_set1.sensor_touch_drift_rate;
+		break;
+	case DATASTREAMER_PARAM_ANTI_TOUCH_DRIFT:
+		*value = qtlib_key_grp_config_set1.sensor_anti_touch_drift_rate;
+		break;
+	case DATASTREAMER_PARAM_DRIFT_HOLD_TIME:
+		*value = qtlib_key_grp_config_set1.sensor_drift_hold_time;
+		break;
+	case DATASTREAMER_PARAM_MEASUREMENT_PERIOD:
+		*value = touch_fast_period_ms;
+		break;
+	case DATASTREAMER_PARAM_IDLE_PERIOD:
+		*value = touch_idle_period_ms;
+		break;
+	case DATASTREAMER_PARAM_IDLE_TIMEOUT:
+		*value = touch_idle_timeout_ms;
+		break;
+#if RAM_MONITOR_ENABLE == 1
+	case DATASTREAMER_PARAM_STATIC_RAM:
+		ram_monitor_get_stats(&ram);
+		*value = ram.static_size;
+		break;
+	case DATASTREAMER_PARAM_STACK_FREE:
+		ram_monitor_scan();
+		ram_monitor_get_stats(&ram);
+		*value = ram.stack_free;
+		break;
+#endif
+	default:
+		return DATASTREAMER_STATUS_BAD_PARAMETER;
+	}
+
+	return DATASTREAMER_STATUS_OK;
+}
+
+/*============================================================================
+static uint8_t datastreamer_command_write(uint8_t parameter, uint8_t index, uint16_t value)
+------------------------------------------------------------------------------
+Purpose: Writes a parameter
+Input  : Parameter, key index for per-key parameters, new value
+Output : Response status
+Notes  : The key module picks up new key settings with the next measurement.
+         A new threshold is sent to the host with the next header.
+============================================================================*/
+static uint8_t datastreamer_command_write(uint8_t parameter, uint8_t index, uint16_t value)
+{
+	uint16_t current;
+	uint8_t  status = datastreamer_command_read(parameter, index, &current);
+
+	if (status != DATASTREAMER_STATUS_OK) {
+		return status;
+	}
+
+	/* All parameters but the idle timeout are bytes */
+	if ((parameter != DATASTREAMER_PARAM_IDLE_TIMEOUT) && (value > UINT8_MAX)) {
+		return DATASTREAMER_STATUS_BAD_VALUE;
+	}
+
+	switch (parameter) {
+	case DATASTREAMER_PARAM_THRESHOLD:
+		if (value == 0u) {
+			return DATASTREAMER_STATUS_BAD_VALUE;
+		}
+		qtlib_key_configs_set1[index].channel_threshold = (uint8_t)value;
+		datastreamer_request_header();
+		break;
+	case DATASTREAMER_PARAM_HYSTERESIS:
+		if (value >= MAX_HYST) {
+			return DATASTREAMER_STATUS_BAD_VALUE;
+		}
+		qtlib_key_configs_set1[index].channel_hysteresis = (uint8_t)value;
+		break;
+	case DATASTREAMER_PARAM_TOUCH_DI:
+		qtlib_key_grp_config_set1.sensor_touch_di = (uint8_t)value;
+		break;
+	case DATASTREAMER_PARAM_TOUCH_DRIFT_RATE:
+		qtlib_key_grp_config_set1.sensor_touch_drift_rate = (uint8_t)value;
+		break;
+	case DATASTREAMER_PARAM_ANTI_TOUCH_DRIFT:
+		qtlib_key_grp_config_set1.sensor_anti_touch_drift_rate = (uint8_t)value;
+		break;
+	case DATASTREAMER_PARAM_DRIFT_HOLD_TIME:
+		qtlib_key_grp_config_set1.sensor_drift_hold_time = (uint8_t)value;
+		break;
+	case DATASTREAMER_PARAM_MEASUREMENT_PERIOD:
+	case DATASTREAMER_PARAM_IDLE_PERIOD:
+		if (value == 0u) {
+			return DATASTREAMER_STATUS_BAD_VALUE;
+		}
+		if (parameter == DATASTREAMER_PARAM_MEASUREMENT_PERIOD) {
+			touch_set_scan_rate((uint8_t)value, touch_idle_period_ms, touch_idle_timeout_ms);
+		} else {
+			touch_set_scan_rate(touch_fast_period_ms, (uint8_t)value, touch_idle_timeout_ms);
+		}
+		break;
+	case DATASTREAMER_PARAM_IDLE_TIMEOUT:
+		touch_set_scan_rate(touch_fast_period_ms, touch_idle_period_ms, value);
+		break;
+	default:
+		return DATASTREAMER_STATUS_BAD_PARAMETER;
+	}
+
+	return DATASTREAMER_STATUS_OK;
+}
+
+/*============================================================================
+static void datastreamer_command_execute(void)
+------------------------------------------------------------------------------
+Purpose: Executes the received command frame and queues the response
+Input  : none
+Output : none
+Notes  : If the transmit ring is full the response is dropped, the host
+         repeats the command.
+============================================================================*/
+static void datastreamer_command_execute(void)
+{
+	uint8_t *      frame   = datastreamer_command_frame;
+	uint8_t        length  = frame[1];
+	const uint8_t *payload = &frame[4];
+	uint8_t        response[4u + DATASTREAMER_RESPONSE_PAYLOAD + 1u];
+	uint8_t *      response_ptr;
+	uint8_t        status = DATASTREAMER_STATUS_BAD_COMMAND;
+	uint16_t       value  = 0u;
+
+	if ((datastreamer_crc8(&frame[1], 3u + length) != frame[4u + length])
+	    || ((frame[3] & DATASTREAMER_TYPE_MASK) != DATASTREAMER_TYPE_COMMAND)) {
+		return;
+	}
+
+	if (length >= 3u) {
+		switch (payload[0]) {
+		case DATASTREAMER_COMMAND_READ:
+			status = datastreamer_command_read(payload[1], payload[2], &value);
+			break;
+		case DATASTREAMER_COMMAND_WRITE:
+			if (length == 5u) {
+				status = datastreamer_command_write(payload[1], payload[2], (uint16_t)(payload[3] | (payload[4] << 8u)));
+				if (status == DATASTREAMER_STATUS_OK) {
+					datastreamer_command_read(payload[1], payload[2], &value);
+				}
+			}
+			break;
+		case DATASTREAMER_COMMAND_HEADER:
+			datastreamer_request_header();
+			status = DATASTREAMER_STATUS_OK;
+			break;
+		default:
+			break;
+		}
+	}
+
+	response_ptr    = datastreamer_frame_begin(&response[0], frame[2], DATASTREAMER_TYPE_RESPONSE);
+	*response_ptr++ = status;
+	*response_ptr++ = payload[0];
+	*response_ptr++ = payload[1];
+	*response_ptr++ = payload[2];
+	*response_ptr++ = (uint8_t)value;
+	*response_ptr++ = (uint8_t)(value >> 8u);
+	response_ptr    = datastreamer_frame_end(&response[0], response_ptr);
+
+	USART_write_buffer(&response[0], (uint8_t)(response_ptr - &response[0]));
+}
+
+/*============================================================================
+void datastreamer_command_process(void)
+------------------------------------------------------------------------------
+Purpose: Parses the received bytes and executes complete command frames
+Input  : none
+Output : none
+Notes  : Called from touch_process(), so parameters never change during the
+         key processing.
+============================================================================*/
+void datastreamer_command_process(void)
+{
+	uint8_t byte;
+
+	while (USART_read_buffer(&byte, 1u) != 0u) {
+		if ((datastreamer_command_length == 0u) && (byte != DATASTREAMER_SYNC)) {
+			continue;
+		}
+		datastreamer_command_frame[datastreamer_command_length++] = byte;
+
+		if ((datastreamer_command_length == 2u) && (byte > DATASTREAMER_COMMAND_MAX_PAYLOAD)) {
+			/* Not a command, wait for the next sync byte */
+			datastreamer_command_length = 0u;
+		} else if ((datastreamer_command_length > 2u)
+		           && (datastreamer_command_length == 4u + datastreamer_command_frame[1] + 1u)) {
+			datastreamer_command_execute();
+			datastreamer_command_length = 0u;
+		}
+	}
+}
+
+/*============================================================================
+uint8_t datastreamer_command_pending(void)
+------------------------------------------------------------------------------
+Purpose: Reports received bytes that datastreamer_command_process() has not
+         parsed yet
+Input  : none
+Output : 1 if bytes are waiting, 0 otherwise
+Notes  :
+============================================================================*/
+uint8_t datastreamer_command_pending(void)
+{
+	return (USART_rx_count() != 0u);
+}
+
+#endif
@@ -54,6 +54,13 @@ uint16_t get_scroller_position(uint16_t sensor_node);
 void touch_timer_handler(void);
 void touch_init(void);
 void touch_process(void);
+uint8_t touch_measurement_in_progress(void);
+uint8_t touch_processing_pending(void);
+void    touch_set_scan_rate(uint8_t fast_period_ms, uint8_t idle_period_ms, uint16_t idle_timeout_ms);
+uint8_t touch_get_measurement_period(void);
+uint8_t  touch_keys_calibrated(void);
+uint16_t touch_get_ready_time_ms(void);
+void     touch_blank_acquisition(uint16_t start, uint16_t end);
 
 #ifdef __cplusplus
 }
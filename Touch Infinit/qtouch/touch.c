@@ -36,11 +36,27 @@ Copyright (c) 2021 Microchip. All rights reserved.
 #include "port.h"
 
 #include "datastreamer.h"
+#include "timer_queue.h"
+#include "atomic.h"
+#include "touch_store.h"
+#include "touch_freq_hop.h"
+#include "supply_monitor.h"
+#include "wdt_supervisor.h"
+#include "touch_profile.h"
+#include "touch_reburst.h"
 
 #if DEF_PTC_CAL_OPTION != CAL_AUTO_TUNE_NONE
 #error "Autotune feature is NOT supported by this acquisition library. Enable Autotune featuers in START."
 #endif
 
+#if (DEF_TOUCH_WARM_START_ENABLE == 1u) && (DEF_TOUCH_STORE_ENABLE != 1u)
+#error "Warm start needs the saved calibration values, enable DEF_TOUCH_STORE_ENABLE."
+#endif
+
+#if (DEF_TOUCH_LOWPOWER_ENABLE == 1u) && (2u * DEF_TOUCH_DRIFT_PERIOD_MS >= WDT_SUPERVISOR_PERIOD_CLK)
+#error "The watchdog needs a full measurement in low power mode well within its period, shorten DEF_TOUCH_DRIFT_PERIOD_MS."
+#endif
+
 #if DEF_TOUCH_DATA_STREAMER_ENABLE == 0u
 #if DEF_PTC_CAL_OPTION != CAL_AUTO_TUNE_NONE
 #warning                                                                                                               \
@@ -69,6 +85,46 @@ static void qtm_measure_complete_callback(void);
  */
 static void qtm_error_callback(uint8_t error);
 
+/*! \brief Select the measurement period from the current key activity.
+ */
+static void touch_scan_rate_update(void);
+
+/*! \brief Change the measurement period and restart the scan timer.
+ */
+static void touch_set_measurement_period(uint8_t period_ms);
+
+/*! \brief Record the time the keys first became ready after reset.
+ */
+static void touch_ready_time_update(void);
+
+/*! \brief End of an acquisition blanking window.
+ */
+static void touch_blank_timer_handler(void);
+
+#if DEF_TOUCH_DATA_STREAMER_ENABLE == 1
+/*! \brief Queue the datastreamer frame of the last measurement.
+ */
+static void touch_datastreamer_output(void);
+#endif
+
+#if DEF_TOUCH_WARM_START_ENABLE == 1u
+/*! \brief Preload the saved calibration values and check them.
+ */
+static uint8_t touch_warm_start_init(void);
+static uint8_t touch_warm_start_check(void);
+#endif
+
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+/*! \brief Low power mode entry, exit and wake callbacks.
+ */
+static void touch_enable_lowpower_measurement(void);
+static void touch_disable_lowpower_measurement(void);
+static void touch_measure_wcomp_match(void);
+static void touch_drift_timer_handler(void);
+static void touch_lowpower_calibrate(void);
+static void touch_lowpower_cal_callback(void);
+#endif
+
 /*----------------------------------------------------------------------------
  *     Global Variables
  *----------------------------------------------------------------------------*/
@@ -82,6 +138,58 @@ volatile uint8_t touch_postprocess_request = 0;
 /* Measurement Done Touch Flag  */
 volatile uint8_t measurement_done_touch = 0;
 
+/* PTC measurement sequence in progress flag */
+volatile uint8_t touch_measurement_busy = 0;
+
+/* Scan-rate governor: fast period on activity, idle period after the timeout */
+uint8_t          touch_fast_period_ms        = DEF_TOUCH_MEASUREMENT_PERIOD_MS;
+uint8_t          touch_idle_period_ms        = DEF_TOUCH_IDLE_MEASUREMENT_PERIOD_MS;
+uint16_t         touch_idle_timeout_ms       = DEF_TOUCH_IDLE_TIMEOUT_MS;
+uint8_t          touch_measurement_period_ms = DEF_TOUCH_MEASUREMENT_PERIOD_MS;
+static uint16_t  touch_idle_time_ms;
+
+#if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1) && (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+/* Data Visualizer frame due, sent once the UART ring has room for it */
+static uint8_t touch_output_pending;
+#endif
+
+/* Time from reset until all keys were calibrated, 0 until then */
+static uint16_t touch_ready_time_ms;
+
+#if DEF_TOUCH_WARM_START_ENABLE == 1u
+/* Warm start check measurements still to do, and nodes that failed it */
+static uint8_t  touch_warm_start_bursts;
+static uint16_t touch_warm_start_failed;
+#endif
+
+/* Acquisition blanking window set by touch_blank_acquisition(), in RTC ticks.
+ * A measurement due in the window is deferred to its end, one that overlapped
+ * it is discarded and made again. */
+static struct timer_struct touch_blank_timer;
+static uint16_t            touch_blank_start;
+static uint16_t            touch_blank_end;
+static volatile uint8_t    touch_blank_active;
+static volatile uint8_t    touch_blank_deferred;
+static volatile uint8_t    touch_acq_blanked;
+
+/* Periodic timer starting the touch measurements */
+static struct timer_struct touch_scan_timer;
+static uint16_t            touch_scan_last_tick;
+static uint16_t            touch_scan_ms_remainder;
+
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+/* Low power mode: autoscan of a single node with window comparator wake */
+#define TOUCH_ACTIVE_MODE 0u
+#define TOUCH_LOWPOWER_MODE 1u
+
+volatile uint8_t           touch_measurement_mode = TOUCH_ACTIVE_MODE;
+static uint8_t             touch_lowpower_request;
+static struct timer_struct touch_drift_timer;
+
+/* A calibration measurement of the low power node has completed */
+static volatile uint8_t touch_lowpower_cal_done;
+#endif
+
 /* Error Handling */
 uint8_t module_error_code = 0;
 
@@ -96,11 +204,23 @@ qtm_acq_node_group_config_t ptc_qtlib_acq_gen1
 qtm_acq_node_data_t ptc_qtlib_node_stat1[DEF_NUM_CHANNELS];
 
 /* Node configurations */
-qtm_acq_t81x_node_config_t ptc_seq_node_cfg1[DEF_NUM_CHANNELS] = {NODE_0_PARAMS, NODE_1_PARAMS, NODE_2_PARAMS};
+qtm_acq_t81x_node_config_t ptc_seq_node_cfg1[DEF_NUM_CHANNELS] = TOUCH_NODE_CONFIGS;
 
 /* Container */
 qtm_acquisition_control_t qtlib_acq_set1 = {&ptc_qtlib_acq_gen1, &ptc_seq_node_cfg1[0], &ptc_qtlib_node_stat1[0]};
 
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+/* Low power set - the low power node only */
+qtm_acq_node_group_config_t ptc_qtlib_acq_gen_lp = {1u, DEF_SENSOR_TYPE, DEF_PTC_CAL_AUTO_TUNE, DEF_SEL_FREQ_INIT};
+qtm_acq_node_data_t         ptc_qtlib_node_stat_lp[1];
+qtm_acq_t81x_node_config_t  ptc_seq_node_cfg_lp[1] = {QTM_AUTOSCAN_NODE_CONFIG};
+qtm_acquisition_control_t   qtlib_acq_set_lp
+    = {&ptc_qtlib_acq_gen_lp, &ptc_seq_node_cfg_lp[0], &ptc_qtlib_node_stat_lp[0]};
+
+/* Autoscan settings for low power mode */
+qtm_auto_scan_config_t auto_scan_setup = {&qtlib_acq_set_lp, 0u, QTM_AUTOSCAN_THRESHOLD, QTM_AUTOSCAN_TRIGGER_PERIOD};
+#endif
+
 /**********************************************************/
 /*********************** Keys Module **********************/
 /**********************************************************/
@@ -122,23 +242,25 @@ qtm_touch_key_group_data_t qtlib_key_grp_data_set1;
 qtm_touch_key_data_t qtlib_key_data_set1[DEF_NUM_SENSORS];
 
 /* Key Configurations */
-qtm_touch_key_config_t qtlib_key_configs_set1[DEF_NUM_SENSORS] = {KEY_0_PARAMS, KEY_1_PARAMS, KEY_2_PARAMS};
+qtm_touch_key_config_t qtlib_key_configs_set1[DEF_NUM_SENSORS] = TOUCH_KEY_CONFIGS;
 
 /* Container */
 qtm_touch_key_control_t qtlib_key_set1
     = {&qtlib_key_grp_data_set1, &qtlib_key_grp_config_set1, &qtlib_key_data_set1[0], &qtlib_key_configs_set1[0]};
 
+/* Lines of other board variants can be outputs, e.g. RELAY2 */
 static void touch_ptc_pin_config(void)
 {
+#define TOUCH_PTC_PIN_CONFIG(line, port, pin)                                                                          \
+	if (TOUCH_PTC_LINES & (1u << (line))) {                                                                            \
+		PORT##port##_set_pin_dir(pin, PORT_DIR_IN);                                                                    \
+		PORT##port##_set_pin_pull_mode(pin, PORT_PULL_OFF);                                                            \
+		PORT##port##_pin_set_isc(pin, PORT_ISC_INPUT_DISABLE_gc);                                                      \
+	}
 
-	PORTA_set_pin_pull_mode(4, PORT_PULL_OFF);
-	PORTA_pin_set_isc(4, PORT_ISC_INPUT_DISABLE_gc);
-
-	PORTA_set_pin_pull_mode(6, PORT_PULL_OFF);
-	PORTA_pin_set_isc(6, PORT_ISC_INPUT_DISABLE_gc);
+	TOUCH_PTC_LINE_TABLE(TOUCH_PTC_PIN_CONFIG)
 
-	PORTA_set_pin_pull_mode(5, PORT_PULL_OFF);
-	PORTA_pin_set_isc(5, PORT_ISC_INPUT_DISABLE_gc);
+#undef TOUCH_PTC_PIN_CONFIG
 }
 
 /*============================================================================
@@ -155,17 +277,33 @@ static touch_ret_t touch_sensors_config(void)
 	uint16_t    sensor_nodes;
 	touch_ret_t touch_ret = TOUCH_SUCCESS;
 
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+	/* Low power node, calibrated when low power mode is first entered */
+	qtm_ptc_init_acquisition_module(&qtlib_acq_set_lp);
+	qtm_enable_sensor_node(&qtlib_acq_set_lp, 0u);
+	qtm_calibrate_sensor_node(&qtlib_acq_set_lp, 0u);
+#endif
+
 	/* Init acquisition module */
 	qtm_ptc_init_acquisition_module(&qtlib_acq_set1);
 
 	/* Init pointers to DMA sequence memory */
 	qtm_ptc_qtlib_assign_signal_memory(&touch_acq_signals_raw[0]);
 
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+	/* First hop frequency */
+	touch_freq_hop_init();
+#endif
+
+#if DEF_TOUCH_STORE_ENABLE == 1u
+	/* Key and scan settings saved by the last run replace the defaults */
+	touch_store_load();
+#endif
+
 	/* Initialize sensor nodes */
 	for (sensor_nodes = 0u; sensor_nodes < DEF_NUM_CHANNELS; sensor_nodes++) {
-		/* Enable each node for measurement and mark for calibration */
+		/* Enable each node for measurement */
 		qtm_enable_sensor_node(&qtlib_acq_set1, sensor_nodes);
-		qtm_calibrate_sensor_node(&qtlib_acq_set1, sensor_nodes);
 	}
 
 	/* Enable sensor keys and assign nodes */
@@ -173,6 +311,18 @@ static touch_ret_t touch_sensors_config(void)
 		qtm_init_sensor_key(&qtlib_key_set1, sensor_nodes, &ptc_qtlib_node_stat1[sensor_nodes]);
 	}
 
+#if DEF_TOUCH_WARM_START_ENABLE == 1u
+	/* Start from the saved calibration values if there are any */
+	if (touch_warm_start_init()) {
+		return (touch_ret);
+	}
+#endif
+
+	/* Mark all nodes for calibration */
+	for (sensor_nodes = 0u; sensor_nodes < DEF_NUM_CHANNELS; sensor_nodes++) {
+		qtm_calibrate_sensor_node(&qtlib_acq_set1, sensor_nodes);
+	}
+
 	return (touch_ret);
 }
 
@@ -188,7 +338,19 @@ Notes  :
 ============================================================================*/
 static void qtm_measure_complete_callback(void)
 {
+	/* The measurement ran into a blanking window */
+	if (touch_blank_active && ((int16_t)(timer_now() - touch_blank_start) >= 0)) {
+		touch_acq_blanked = 1u;
+	}
+
+	touch_measurement_busy    = 0u;
 	touch_postprocess_request = 1u;
+
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+	touch_profile_end(TOUCH_PROFILE_ACQUISITION);
+#endif
+
+	wdt_supervisor_checkpoint(WDT_SUPERVISOR_STAGE_EOC);
 }
 
 /*============================================================================
@@ -213,22 +375,6 @@ static void qtm_error_callback(uint8_t error)
 #endif
 }
 
-/*============================================================================
-void Timer_set_period(const uint8_t val)
-------------------------------------------------------------------------------
-Purpose: This function sets the time interval on the RTC/Timer peripheral based
-         on the user configuration.
-Input  : Time interval
-Output : none
-Notes  :
-============================================================================*/
-void Timer_set_period(const uint8_t val)
-{
-	while (RTC.STATUS & RTC_PERBUSY_bm) /* wait for RTC synchronization */
-		;
-	RTC.PER = val;
-}
-
 /*============================================================================
 void touch_init(void)
 ------------------------------------------------------------------------------
@@ -241,8 +387,21 @@ Notes  :
 void touch_init(void)
 {
 
-	/* Set match value for timer */
-	Timer_set_period(32);
+	/* Start the measurement timer */
+	touch_scan_timer.callback = touch_timer_handler;
+	touch_scan_last_tick      = timer_now();
+	timer_start(&touch_scan_timer,
+	            TIMER_MS_TO_TICKS(touch_measurement_period_ms),
+	            TIMER_MS_TO_TICKS(touch_measurement_period_ms));
+
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+	touch_drift_timer.callback = touch_drift_timer_handler;
+#endif
+	touch_blank_timer.callback = touch_blank_timer_handler;
+
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+	touch_profile_init();
+#endif
 
 	/* configure the PTC pins for Input*/
 	touch_ptc_pin_config();
@@ -250,6 +409,9 @@ void touch_init(void)
 	/* Configure touch sensors with Application specific settings */
 	touch_sensors_config();
 
+	/* Measure at once instead of after the first period */
+	time_to_measure_touch_flag = 1u;
+
 #if DEF_TOUCH_DATA_STREAMER_ENABLE == 1
 	datastreamer_init();
 #endif
@@ -268,16 +430,68 @@ Notes  :
 void touch_process(void)
 {
 	touch_ret_t touch_ret;
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+	/* Nodes of the measurement, all of them unless a reburst measured some */
+	const uint8_t *hop_nodes = NULL;
+	uint8_t        hop_count = 0u;
+#endif
+
+#if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1) && (DEF_TOUCH_COMMAND_RX_ENABLE == 1u)
+	/* Parameter changes from the host, between two key processing runs */
+	datastreamer_command_process();
+#endif
+
+#if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1) && (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+	/* A frame waiting for the UART ring, the transmit interrupt wakes the
+	 * device while the ring drains */
+	touch_datastreamer_output();
+#endif
 
-	/* check the time_to_measure_touch_flag flag for Touch Acquisition */
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+	/* Next calibration step of the low power node, or low power mode once it
+	 * is calibrated, unless a measurement of the keys is due first */
+	if (touch_lowpower_cal_done) {
+		touch_lowpower_cal_done = 0u;
+		qtm_acquisition_process();
+		if ((touch_lowpower_request != 0u) && (time_to_measure_touch_flag == 0u)) {
+			touch_enable_lowpower_measurement();
+		}
+	}
+#endif
+
+	/* Measurements due in a blanking window wait for its end */
 	if (time_to_measure_touch_flag == 1u) {
+		ENTER_CRITICAL(B);
+		if (touch_blank_active && ((int16_t)(timer_now() - touch_blank_start) >= 0)) {
+			time_to_measure_touch_flag = 0u;
+			touch_blank_deferred       = 1u;
+		}
+		EXIT_CRITICAL(B);
+	}
+
+	/* check the time_to_measure_touch_flag flag for Touch Acquisition, a
+	 * request made while a measurement runs waits for its end */
+	if ((time_to_measure_touch_flag == 1u) && (touch_measurement_busy == 0u)) {
+		/* Mark busy before starting, the callback may run before the call returns */
+		touch_measurement_busy = 1u;
+		wdt_supervisor_checkpoint(WDT_SUPERVISOR_STAGE_START);
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+		touch_profile_begin(TOUCH_PROFILE_ACQUISITION);
+#endif
+
 		/* Do the acquisition */
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+		touch_ret = qtm_ptc_start_measurement_seq(touch_reburst_acq_set(), qtm_measure_complete_callback);
+#else
 		touch_ret = qtm_ptc_start_measurement_seq(&qtlib_acq_set1, qtm_measure_complete_callback);
+#endif
 
 		/* if the Acquistion request was successful then clear the request flag */
 		if (TOUCH_SUCCESS == touch_ret) {
 			/* Clear the Measure request flag */
 			time_to_measure_touch_flag = 0u;
+		} else {
+			touch_measurement_busy = 0u;
 		}
 	}
 
@@ -285,35 +499,632 @@ void touch_process(void)
 	if (touch_postprocess_request == 1u) {
 		/* Reset the flags for node_level_post_processing */
 		touch_postprocess_request = 0u;
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+		touch_profile_end(TOUCH_PROFILE_PENDING);
+#endif
+
+		/* Discard a measurement disturbed by relay switching and measure again */
+		if (touch_acq_blanked) {
+			ENTER_CRITICAL(B);
+			touch_acq_blanked = 0u;
+			if (touch_blank_active) {
+				touch_blank_deferred = 1u;
+			} else {
+				time_to_measure_touch_flag = 1u;
+			}
+			EXIT_CRITICAL(B);
+			return;
+		}
 
 		/* Run Acquisition module level post processing*/
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+		touch_profile_begin(TOUCH_PROFILE_ACQ_PROCESS);
 		touch_ret = qtm_acquisition_process();
+		touch_profile_end(TOUCH_PROFILE_ACQ_PROCESS);
+#else
+		touch_ret = qtm_acquisition_process();
+#endif
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+		touch_reburst_merge();
+#endif
 
-		/* Check the return value */
-		if (TOUCH_SUCCESS == touch_ret) {
-			/* Returned with success: Start module level post processing */
-			touch_ret = qtm_key_sensors_process(&qtlib_key_set1);
-			if (TOUCH_SUCCESS != touch_ret) {
-				qtm_error_callback(1);
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+		/* Median across the hop frequencies, the next measurement hops on. The
+		 * keys wait until each node has been measured on all of them. */
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+		hop_count = touch_reburst_get_measured(&hop_nodes);
+#endif
+		if ((TOUCH_SUCCESS == touch_ret) && touch_freq_hop_process(hop_nodes, hop_count)) {
+			time_to_measure_touch_flag = 1u;
+		} else
+#endif
+#if DEF_TOUCH_WARM_START_ENABLE == 1u
+		/* The keys wait until the warm start values are checked */
+		if ((TOUCH_SUCCESS == touch_ret) && (touch_warm_start_bursts != 0u) && touch_warm_start_check()) {
+			time_to_measure_touch_flag = 1u;
+		} else
+#endif
+		{
+			/* Check the return value */
+			if (TOUCH_SUCCESS == touch_ret) {
+				/* Returned with success: Start module level post processing */
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+				touch_profile_begin(TOUCH_PROFILE_KEY_PROCESS);
+				touch_ret = qtm_key_sensors_process(&qtlib_key_set1);
+				touch_profile_end(TOUCH_PROFILE_KEY_PROCESS);
+#else
+				touch_ret = qtm_key_sensors_process(&qtlib_key_set1);
+#endif
+				if (TOUCH_SUCCESS != touch_ret) {
+					qtm_error_callback(1);
+				}
+			} else {
+				/* Acq module Eror Detected: Issue an Acq module common error code 0x80 */
+				qtm_error_callback(0);
 			}
-		} else {
-			/* Acq module Eror Detected: Issue an Acq module common error code 0x80 */
-			qtm_error_callback(0);
+
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+			/* Only the filtering nodes for a reburst */
+			touch_reburst_update();
+#endif
+			if ((0u != (qtlib_key_set1.qtm_touch_key_group_data->qtm_keys_status & 0x80u))) {
+				time_to_measure_touch_flag = 1u;
+			} else {
+				measurement_done_touch = 1u;
+#if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1) && (DEF_TOUCH_DATA_STREAMER_COMPACT == 0u)
+				/* A Data Visualizer frame takes longer to send than a reburst
+				 * to measure, one is sent once the keys are resolved */
+				touch_output_pending = 1u;
+#endif
+			}
+
+			touch_ready_time_update();
 		}
+		wdt_supervisor_checkpoint(WDT_SUPERVISOR_STAGE_PROCESS);
 
-		if ((0u != (qtlib_key_set1.qtm_touch_key_group_data->qtm_keys_status & 0x80u))) {
-			time_to_measure_touch_flag = 1u;
-		} else {
-			measurement_done_touch = 1u;
+		touch_scan_rate_update();
+
+#if DEF_TOUCH_STORE_ENABLE == 1u
+		/* Save changed settings and new calibration values */
+		touch_store_process();
+#endif
+
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+		/* Enter low power mode once the keys are resolved */
+		if ((touch_lowpower_request != 0u) && (measurement_done_touch != 0u)) {
+			touch_enable_lowpower_measurement();
 		}
+#endif
 
 #if DEF_TOUCH_DATA_STREAMER_ENABLE == 1
-		datastreamer_output();
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+		touch_profile_begin(TOUCH_PROFILE_OUTPUT);
+		touch_datastreamer_output();
+		touch_profile_end(TOUCH_PROFILE_OUTPUT);
+#else
+		touch_datastreamer_output();
+#endif
+#endif
+		wdt_supervisor_checkpoint(WDT_SUPERVISOR_STAGE_OUTPUT);
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+		touch_profile_end(TOUCH_PROFILE_CYCLE);
+#endif
+	}
+}
+
+/*============================================================================
+uint8_t touch_measurement_in_progress(void)
+------------------------------------------------------------------------------
+Purpose: Reports whether a PTC measurement sequence is running. The PTC needs
+         the peripheral clock, so only Idle sleep is allowed while it is set.
+Input  : none
+Output : 1 if a measurement sequence is running, 0 otherwise
+Notes  :
+============================================================================*/
+uint8_t touch_measurement_in_progress(void)
+{
+	return touch_measurement_busy;
+}
+
+#if DEF_TOUCH_DATA_STREAMER_ENABLE == 1
+/*============================================================================
+static void touch_datastreamer_output(void)
+------------------------------------------------------------------------------
+Purpose: Queues the datastreamer frame of the last measurement on the UART
+Input  : none
+Output : none
+Notes  : Nothing is sent while the supply is low. Compact frames are sent
+         after every measurement. A Data Visualizer frame is sent once per
+         resolved measurement and waits until the UART ring has room for it,
+         so the frames after a calibration are not dropped.
+============================================================================*/
+static void touch_datastreamer_output(void)
+{
+	/* Leave the UART quiet while the supply is low */
+	if (supply_monitor_is_low()) {
+		return;
+	}
+
+#if DEF_TOUCH_DATA_STREAMER_COMPACT == 0u
+	if ((touch_output_pending == 0u) || !datastreamer_output_ready()) {
+		return;
+	}
+	touch_output_pending = 0u;
+#endif
+
+	datastreamer_output();
+}
+#endif
+
+/*============================================================================
+uint8_t touch_processing_pending(void)
+------------------------------------------------------------------------------
+Purpose: Reports whether touch_process() or the application has work to do
+         before the device may go to sleep.
+Input  : none
+Output : 1 if a measurement, post processing, status update or host command
+         is pending
+Notes  : Call with interrupts disabled to avoid missing a flag set by an ISR
+         just before entering sleep. A measurement requested while one is
+         running is not pending until the running one completes, so the
+         device sleeps instead of spinning, also when the PTC stalls.
+============================================================================*/
+uint8_t touch_processing_pending(void)
+{
+	uint8_t pending = (time_to_measure_touch_flag & (uint8_t)!touch_measurement_busy) | touch_postprocess_request
+	                  | measurement_done_touch;
+
+#if (DEF_TOUCH_DATA_STREAMER_ENABLE == 1) && (DEF_TOUCH_COMMAND_RX_ENABLE == 1u)
+	pending |= datastreamer_command_pending();
+#endif
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+	pending |= touch_lowpower_cal_done;
+#endif
+
+	return pending;
+}
+
+/*============================================================================
+static void touch_scan_rate_update(void)
+------------------------------------------------------------------------------
+Purpose: Scan-rate governor. Keeps the fast measurement period while any key
+         is active and switches to the idle period once no key has been active
+         for touch_idle_timeout_ms.
+Input  : none
+Output : none
+Notes  : A key is active when it is not in the No Detect state (touched,
+         filtering, calibrating ...) or when its delta exceeds a fraction of
+         its threshold, so an approaching finger restores the fast rate before
+         the touch is confirmed.
+============================================================================*/
+static void touch_scan_rate_update(void)
+{
+	uint16_t sensor;
+	int16_t  delta;
+	uint8_t  activity = 0u;
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+		/* The median lags a touch by one measurement, a slow scan rate by long */
+		delta = (int16_t)(touch_freq_hop_get_last_signal(sensor) - get_sensor_node_reference(sensor));
+#else
+		delta = (int16_t)(get_sensor_node_signal(sensor) - get_sensor_node_reference(sensor));
+#endif
+		if ((get_sensor_state(sensor) != QTM_KEY_STATE_NO_DET)
+		    || (delta > (int16_t)(qtlib_key_configs_set1[sensor].channel_threshold >> DEF_TOUCH_ACTIVITY_THRESHOLD_SHIFT))) {
+			activity = 1u;
+			break;
+		}
+	}
+
+	if (activity) {
+		touch_idle_time_ms = 0u;
+		touch_set_measurement_period(touch_fast_period_ms);
+	} else {
+		if (touch_idle_time_ms <= (UINT16_MAX - UINT8_MAX)) {
+			touch_idle_time_ms += touch_measurement_period_ms;
+		}
+		if (touch_idle_time_ms >= touch_idle_timeout_ms) {
+			touch_set_measurement_period(touch_idle_period_ms);
+		}
+	}
+
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+	touch_lowpower_request = (touch_idle_time_ms >= DEF_TOUCH_LOWPOWER_TIMEOUT_MS);
+#endif
+}
+
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+/*============================================================================
+static void touch_enable_lowpower_measurement(void)
+------------------------------------------------------------------------------
+Purpose: Enters low power mode. Sequenced measurements are stopped and the PTC
+         measures the low power node on each RTC PIT event, in standby, until
+         the window comparator detects a delta above QTM_AUTOSCAN_THRESHOLD.
+Input  : none
+Output : none
+Notes  : The drift timer brings the device back for a full measurement every
+         DEF_TOUCH_DRIFT_PERIOD_MS. A low power node still calibrating takes
+         a calibration measurement instead.
+============================================================================*/
+static void touch_enable_lowpower_measurement(void)
+{
+	if (ptc_qtlib_node_stat_lp[0].node_acq_status & NODE_CAL_REQ) {
+		touch_lowpower_calibrate();
+		return;
+	}
+
+	timer_stop(&touch_scan_timer);
+
+	if (TOUCH_SUCCESS != qtm_autoscan_sensor_node(&auto_scan_setup, touch_measure_wcomp_match)) {
+		/* Stay in active mode */
+		timer_start(&touch_scan_timer,
+		            TIMER_MS_TO_TICKS(touch_measurement_period_ms),
+		            TIMER_MS_TO_TICKS(touch_measurement_period_ms));
+		return;
+	}
+
+	touch_measurement_mode = TOUCH_LOWPOWER_MODE;
+
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+	/* Measurements in low power mode are too far apart to filter together */
+	touch_freq_hop_restart();
+#endif
+
+	/* Autoscan trigger */
+	while (RTC.PITSTATUS & RTC_CTRLBUSY_bm) /* wait for RTC synchronization */
+		;
+	RTC.PITCTRLA = (QTM_AUTOSCAN_TRIGGER_PERIOD << RTC_PERIOD_gp) | RTC_PITEN_bm;
+
+	timer_start(&touch_drift_timer, TIMER_MS_TO_TICKS(DEF_TOUCH_DRIFT_PERIOD_MS), 0u);
+}
+
+/*============================================================================
+static void touch_lowpower_calibrate(void)
+------------------------------------------------------------------------------
+Purpose: Starts a sequenced measurement of the low power set, which steps the
+         calibration of the low power node.
+Input  : none
+Output : none
+Notes  : touch_process() runs the acquisition post processing when it has
+         completed and tries to enter low power mode again.
+============================================================================*/
+static void touch_lowpower_calibrate(void)
+{
+	if (touch_measurement_busy) {
+		return;
+	}
+
+	touch_measurement_busy = 1u;
+	if (TOUCH_SUCCESS != qtm_ptc_start_measurement_seq(&qtlib_acq_set_lp, touch_lowpower_cal_callback)) {
+		touch_measurement_busy = 0u;
+	}
+}
+
+/*============================================================================
+static void touch_lowpower_cal_callback(void)
+------------------------------------------------------------------------------
+Purpose: Measurement complete callback of the low power set
+Input  : none
+Output : none
+Notes  :
+============================================================================*/
+static void touch_lowpower_cal_callback(void)
+{
+	touch_measurement_busy  = 0u;
+	touch_lowpower_cal_done = 1u;
+}
+
+/*============================================================================
+static void touch_disable_lowpower_measurement(void)
+------------------------------------------------------------------------------
+Purpose: Leaves low power mode and restarts sequenced measurements.
+Input  : none
+Output : none
+Notes  : Called from interrupt context.
+============================================================================*/
+static void touch_disable_lowpower_measurement(void)
+{
+	qtm_autoscan_node_cancel();
+
+	while (RTC.PITSTATUS & RTC_CTRLBUSY_bm) /* wait for RTC synchronization */
+		;
+	RTC.PITCTRLA = 0;
+
+	timer_stop(&touch_drift_timer);
+	touch_measurement_mode = TOUCH_ACTIVE_MODE;
+
+	/* Measure now, the timer handler also feeds the time spent in low power
+	 * mode to the key module */
+	touch_timer_handler();
+	timer_start(&touch_scan_timer,
+	            TIMER_MS_TO_TICKS(touch_measurement_period_ms),
+	            TIMER_MS_TO_TICKS(touch_measurement_period_ms));
+}
+
+/*============================================================================
+static void touch_measure_wcomp_match(void)
+------------------------------------------------------------------------------
+Purpose: Autoscan callback, the window comparator detected a delta on the
+         autoscan node.
+Input  : none
+Output : none
+Notes  : Resumes sequenced measurements at the fast period.
+============================================================================*/
+static void touch_measure_wcomp_match(void)
+{
+	if (touch_measurement_mode == TOUCH_LOWPOWER_MODE) {
+		touch_idle_time_ms          = 0u;
+		touch_lowpower_request      = 0u;
+		touch_measurement_period_ms = touch_fast_period_ms;
+		touch_disable_lowpower_measurement();
+	}
+}
+
+/*============================================================================
+static void touch_drift_timer_handler(void)
+------------------------------------------------------------------------------
+Purpose: Drift timer callback, makes one full measurement in low power mode.
+Input  : none
+Output : none
+Notes  : Low power mode is entered again after the keys are processed if no
+         activity was found.
+============================================================================*/
+static void touch_drift_timer_handler(void)
+{
+	if (touch_measurement_mode == TOUCH_LOWPOWER_MODE) {
+		touch_disable_lowpower_measurement();
+	}
+}
+#endif
+
+#if DEF_TOUCH_WARM_START_ENABLE == 1u
+/*============================================================================
+static uint8_t touch_warm_start_init(void)
+------------------------------------------------------------------------------
+Purpose: Preloads the compensation capacitance values saved by the store
+Input  : none
+Output : 1 if the nodes start with saved values, 0 if they need a full
+         calibration
+Notes  : The keys stay in the calibration state until touch_warm_start_check()
+         has accepted or rejected the values.
+============================================================================*/
+static uint8_t touch_warm_start_init(void)
+{
+	uint16_t node;
+
+	for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+		if ((touch_store_get_comp_caps(node) == 0u) || (touch_store_get_reference(node) == 0u)) {
+			return 0u;
+		}
+	}
+
+	for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+		ptc_qtlib_node_stat1[node].node_comp_caps = touch_store_get_comp_caps(node);
+	}
+
+	touch_warm_start_bursts = DEF_TOUCH_WARM_START_BURSTS;
+	touch_warm_start_failed = 0u;
+
+	return 1u;
+}
+
+/*============================================================================
+static uint8_t touch_warm_start_check(void)
+------------------------------------------------------------------------------
+Purpose: Checks one measurement against the saved key references
+Input  : none
+Output : 1 if more check measurements follow, 0 once the keys have been
+         released to the key module
+Notes  : After the last check measurement the keys of good nodes continue
+         from the saved reference in No Detect, the other nodes are
+         calibrated.
+============================================================================*/
+static uint8_t touch_warm_start_check(void)
+{
+	uint16_t node;
+	int16_t  delta;
+	int16_t  threshold;
+
+	for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+		delta     = (int16_t)(get_sensor_node_signal(node) - touch_store_get_reference(node));
+		threshold = qtlib_key_configs_set1[node].channel_threshold;
+		if ((delta >= threshold) || (-delta >= threshold)) {
+			touch_warm_start_failed |= (uint16_t)(1u << node);
+		}
+	}
+
+	if (--touch_warm_start_bursts != 0u) {
+		return 1u;
+	}
+
+	for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+		if (touch_warm_start_failed & (1u << node)) {
+			calibrate_node(node);
+		} else {
+			qtlib_key_data_set1[node].channel_reference    = touch_store_get_reference(node);
+			qtlib_key_data_set1[node].sensor_state         = QTM_KEY_STATE_NO_DET;
+			qtlib_key_data_set1[node].sensor_state_counter = 0u;
+		}
+	}
+
+	return 0u;
+}
+#endif
+
+/*============================================================================
+static void touch_ready_time_update(void)
+------------------------------------------------------------------------------
+Purpose: Records the time from reset until all keys are calibrated for the
+         first time
+Input  : none
+Output : none
+Notes  : The RTC counts from reset, the time is exact up to 64 s after
+         reset.
+============================================================================*/
+static void touch_ready_time_update(void)
+{
+	if ((touch_ready_time_ms == 0u) && touch_keys_calibrated()) {
+		touch_ready_time_ms = (uint16_t)(((uint32_t)timer_now() * 1000u) / TIMER_TICKS_PER_SECOND);
+		if (touch_ready_time_ms == 0u) {
+			touch_ready_time_ms = 1u;
+		}
+	}
+}
+
+/*============================================================================
+void touch_blank_acquisition(uint16_t start, uint16_t end)
+------------------------------------------------------------------------------
+Purpose: Keeps touch measurements out of a time window, such as the switching
+         of a relay
+Input  : start: RTC count at which the window starts, at most half the
+                counter range ahead
+         end: RTC count at which it ends
+Output : none
+Notes  : A window set while another one is pending is joined with it. The
+         measurement due in the window is made at its end, and a measurement
+         that ran into it is repeated, so the keys only see undisturbed
+         signals. Callable from interrupt handlers.
+============================================================================*/
+void touch_blank_acquisition(uint16_t start, uint16_t end)
+{
+	int16_t remaining;
+
+	ENTER_CRITICAL(B);
+	if (!touch_blank_active) {
+		touch_blank_start  = start;
+		touch_blank_end    = end;
+		touch_blank_active = 1u;
+	} else {
+		if ((int16_t)(start - touch_blank_start) < 0) {
+			touch_blank_start = start;
+		}
+		if ((int16_t)(end - touch_blank_end) > 0) {
+			touch_blank_end = end;
+		}
+	}
+	remaining = (int16_t)(touch_blank_end - timer_now());
+	timer_start(&touch_blank_timer, (remaining > 0) ? (uint16_t)remaining : 0u, 0u);
+	EXIT_CRITICAL(B);
+}
+
+/*============================================================================
+static void touch_blank_timer_handler(void)
+------------------------------------------------------------------------------
+Purpose: Ends the blanking window and starts the measurement deferred by it
+Input  : none
+Output : none
+Notes  : Called from the RTC interrupt. A measurement still running has
+         overlapped the window and is discarded.
+============================================================================*/
+static void touch_blank_timer_handler(void)
+{
+	if (touch_measurement_busy) {
+		touch_acq_blanked = 1u;
+	}
+	touch_blank_active = 0u;
+
+	if (touch_blank_deferred) {
+		touch_blank_deferred       = 0u;
+		time_to_measure_touch_flag = 1u;
+	}
+}
+
+/*============================================================================
+uint16_t touch_get_ready_time_ms(void)
+------------------------------------------------------------------------------
+Purpose: Returns the time from reset until the keys were ready
+Input  : none
+Output : Time in ms, 0 while the keys are still being calibrated
+Notes  : Compare warm and full calibration starts with this.
+============================================================================*/
+uint16_t touch_get_ready_time_ms(void)
+{
+	return touch_ready_time_ms;
+}
+
+/*============================================================================
+uint8_t touch_keys_calibrated(void)
+------------------------------------------------------------------------------
+Purpose: Reports whether all keys have a valid reference
+Input  : none
+Output : 1 once every key has left the calibration states without error
+Notes  :
+============================================================================*/
+uint8_t touch_keys_calibrated(void)
+{
+	uint16_t sensor;
+	uint8_t  state;
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		state = get_sensor_state(sensor);
+		if ((state == QTM_KEY_STATE_INIT) || (state == QTM_KEY_STATE_CAL) || (state == QTM_KEY_STATE_CAL_ERR)) {
+			return 0u;
+		}
+	}
+
+	return 1u;
+}
+
+/*============================================================================
+static void touch_set_measurement_period(uint8_t period_ms)
+------------------------------------------------------------------------------
+Purpose: Changes the measurement period.
+Input  : Measurement period in ms
+Output : none
+Notes  : The scan timer is restarted so a shorter period takes effect at once
+         instead of after the remainder of a long idle period. In low power
+         mode the scan timer is stopped and only the period is recorded.
+============================================================================*/
+static void touch_set_measurement_period(uint8_t period_ms)
+{
+	if (period_ms != touch_measurement_period_ms) {
+		touch_measurement_period_ms = period_ms;
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+		/* The scan timer is restarted when low power mode is left */
+		if (touch_measurement_mode == TOUCH_LOWPOWER_MODE) {
+			return;
+		}
 #endif
+		timer_start(&touch_scan_timer, TIMER_MS_TO_TICKS(period_ms), TIMER_MS_TO_TICKS(period_ms));
 	}
 }
 
-uint8_t interrupt_cnt;
+/*============================================================================
+void touch_set_scan_rate(uint8_t fast_period_ms, uint8_t idle_period_ms, uint16_t idle_timeout_ms)
+------------------------------------------------------------------------------
+Purpose: Changes the scan-rate governor settings at runtime.
+Input  : Measurement period while active, measurement period when idle, time
+         without activity before the idle period is used (all in ms)
+Output : none
+Notes  : Restarts the idle timeout with the fast period.
+============================================================================*/
+void touch_set_scan_rate(uint8_t fast_period_ms, uint8_t idle_period_ms, uint16_t idle_timeout_ms)
+{
+	if ((fast_period_ms == 0u) || (idle_period_ms == 0u)) {
+		return;
+	}
+
+	touch_fast_period_ms  = fast_period_ms;
+	touch_idle_period_ms  = idle_period_ms;
+	touch_idle_timeout_ms = idle_timeout_ms;
+	touch_idle_time_ms    = 0u;
+	touch_set_measurement_period(fast_period_ms);
+}
+
+/*============================================================================
+uint8_t touch_get_measurement_period(void)
+------------------------------------------------------------------------------
+Purpose: Returns the measurement period currently selected by the governor.
+Input  : none
+Output : Measurement period in ms
+Notes  :
+============================================================================*/
+uint8_t touch_get_measurement_period(void)
+{
+	return touch_measurement_period_ms;
+}
+
 /*============================================================================
 void touch_timer_handler(void)
 ------------------------------------------------------------------------------
@@ -321,17 +1132,22 @@ Purpose: This function updates the time elapsed to the touch key module to
          synchronize the internal time counts used by the module.
 Input  : none
 Output : none
-Notes  :
+Notes  : Called from the RTC interrupt when the scan timer expires. The time
+         elapsed is taken from the RTC counter and converted from 1024 Hz ticks
+         to ms, the remainder is carried so no time is lost.
 ============================================================================*/
 void touch_timer_handler(void)
 {
-	interrupt_cnt++;
-	if (interrupt_cnt >= DEF_TOUCH_MEASUREMENT_PERIOD_MS) {
-		interrupt_cnt = 0;
-		/* Count complete - Measure touch sensors */
-		time_to_measure_touch_flag = 1u;
-		qtm_update_qtlib_timer(DEF_TOUCH_MEASUREMENT_PERIOD_MS);
-	}
+	uint16_t now = timer_now();
+	uint32_t elapsed;
+
+	elapsed = (uint32_t)(uint16_t)(now - touch_scan_last_tick) * 1000u + touch_scan_ms_remainder;
+	touch_scan_last_tick    = now;
+	touch_scan_ms_remainder = elapsed % TIMER_TICKS_PER_SECOND;
+
+	/* Measure touch sensors */
+	time_to_measure_touch_flag = 1u;
+	qtm_update_qtlib_timer(elapsed / TIMER_TICKS_PER_SECOND);
 }
 
 uint16_t get_sensor_node_signal(uint16_t sensor_node)
@@ -392,7 +1208,28 @@ Notes    :  none
 ============================================================================*/
 ISR(ADC0_RESRDY_vect)
 {
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+	touch_profile_begin(TOUCH_PROFILE_EOC);
 	qtm_t81x_ptc_handler_eoc();
+	touch_profile_end(TOUCH_PROFILE_EOC);
+#else
+	qtm_t81x_ptc_handler_eoc();
+#endif
 }
 
+#if DEF_TOUCH_LOWPOWER_ENABLE == 1u
+/*============================================================================
+ISR(ADC0_WCOMP_vect)
+------------------------------------------------------------------------------
+Purpose:  Interrupt handler for ADC / PTC window comparator Interrupt
+Input    :  none
+Output  :  none
+Notes    :  Autoscan wake in low power mode
+============================================================================*/
+ISR(ADC0_WCOMP_vect)
+{
+	qtm_t81x_ptc_handler_wcomp();
+}
+#endif
+
 #endif /* TOUCH_C */
@@ -41,10 +41,48 @@ extern "C" {
  */
 #define DEF_TOUCH_MEASUREMENT_PERIOD_MS 20
 
+/* Defines the Measurement Time in milli seconds once no activity has been seen
+ * for DEF_TOUCH_IDLE_TIMEOUT_MS. Any activity switches back to
+ * DEF_TOUCH_MEASUREMENT_PERIOD_MS.
+ * Range: 1 to 255.
+ * Default value: 200.
+ */
+#define DEF_TOUCH_IDLE_MEASUREMENT_PERIOD_MS 200
+
+/* Time without touch activity before the idle measurement period is used.
+ * Units: milli seconds
+ * Range: 0 to 65535.
+ * Default value: 5000.
+ */
+#define DEF_TOUCH_IDLE_TIMEOUT_MS 5000
+
+/* A key counts as active when its delta exceeds its threshold shifted right by
+ * this amount, e.g. 2 = delta above 25% of the threshold.
+ * Range: 0 to 7.
+ * Default value: 2.
+ */
+#define DEF_TOUCH_ACTIVITY_THRESHOLD_SHIFT 2
+
+/* Key layout of the panel.
+ * 0: self-cap, one Y line per key, DEF_TOUCH_GANG 2 to 4.
+ * 1: mutual-cap matrix, a key at each crossing of an X and a Y line,
+ *    DEF_TOUCH_GANG 4, 6 or 9. The datastreamer frames of more than 3 nodes
+ *    need USART_TX_BUFFER_SIZE 128. The matrix takes the module bus pins.
+ * Range: 0u or 1u.
+ * Default value: 0u.
+ */
+#ifndef DEF_TOUCH_MATRIX
+#define DEF_TOUCH_MATRIX 0u
+#endif
+
 /* Defines the Type of sensor
  * Default value: NODE_MUTUAL.
  */
+#if DEF_TOUCH_MATRIX == 1u
+#define DEF_SENSOR_TYPE NODE_MUTUAL
+#else
 #define DEF_SENSOR_TYPE NODE_SELFCAP
+#endif
 
 /* Set sensor calibration mode for charge share delay ,Prescaler or series resistor.
  * Range: CAL_AUTO_TUNE_NONE / CAL_AUTO_TUNE_RSEL / CAL_AUTO_TUNE_PRSC / CAL_AUTO_TUNE_CSD
@@ -72,6 +110,148 @@ extern "C" {
  *     defines
  *----------------------------------------------------------------------------*/
 
+/**********************************************************/
+/***************** Sensor Table   ******************/
+/**********************************************************/
+/* Number of keys on the panel, selects the rows of TOUCH_SENSOR_TABLE.
+ * Range: 2 to 4 self-cap, 4, 6 or 9 mutual-cap.
+ * Default value: 3.
+ */
+#ifndef DEF_TOUCH_GANG
+#define DEF_TOUCH_GANG 3
+#endif
+
+/* USART0 receiver for the host commands of datastreamer_command.c. RxD is
+ * PB3, which is RELAY3 of key 3. The receiver takes PB3 over as an input while
+ * RXEN is set, so relay 3 would never switch. With the receiver the key drives
+ * no relay, so it is off for the boards that use RELAY3.
+ * Range: 0u or 1u.
+ * Default value: 0u.
+ */
+#ifndef DEF_TOUCH_COMMAND_RX_ENABLE
+#define DEF_TOUCH_COMMAND_RX_ENABLE 0u
+#endif
+
+/* PTC lines of the ATtiny816, each one is X(n) and Y(n) on the same pin.
+ * X(line, PTC pin port, PTC pin)
+ * Line 3 is RELAY_MOD1 and line 4 RELAY2 on the 3-gang board.
+ */
+#define TOUCH_PTC_LINE_TABLE(X) X(0, A, 4) X(1, A, 5) X(2, A, 6) X(3, A, 7) X(4, B, 1) X(5, B, 0)
+
+/* No X line, the X-line of self-cap keys */
+#define TOUCH_NO_LINE 0xFFu
+
+/* Key rows. The node and key configurations, the PTC pin setup and the LED
+ * and relay bindings of the application are all generated from the sensor
+ * table, so a key is added or moved by editing one row.
+ * X(name, X-line, Y-line, Charge Share Delay, Prescaler, Analog Gain, Digital Gain, filter level,
+ *   Sensor Threshold, Sensor Hysterisis, Sensor AKS, LED pin, relay pin)
+ * LED and relay pins are START pin names, NO_PIN for none.
+ */
+#if DEF_TOUCH_MATRIX == 0u
+/* Self-cap keys. TOUCH4 is on PA7, which is RELAY_MOD1 on the 3-gang board.
+ * RELAY3 is PB3, USART0 RxD, see DEF_TOUCH_COMMAND_RX_ENABLE. */
+#define TOUCH_SENSOR_TOUCH1(X)                                                                                         \
+	X(TOUCH1, TOUCH_NO_LINE, 2, 20, PRSC_DIV_SEL_16, GAIN_1, GAIN_8, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP,       \
+	  LED_TOUCH1, RELAY1)
+#define TOUCH_SENSOR_TOUCH2(X)                                                                                         \
+	X(TOUCH2, TOUCH_NO_LINE, 0, 20, PRSC_DIV_SEL_16, GAIN_1, GAIN_8, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP,       \
+	  LED_TOUCH2, RELAY2)
+#if DEF_TOUCH_COMMAND_RX_ENABLE == 1u
+#define TOUCH_SENSOR_TOUCH3(X)                                                                                         \
+	X(TOUCH3, TOUCH_NO_LINE, 1, 20, PRSC_DIV_SEL_16, GAIN_1, GAIN_8, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP,       \
+	  LED_TOUCH3, NO_PIN)
+#else
+#define TOUCH_SENSOR_TOUCH3(X)                                                                                         \
+	X(TOUCH3, TOUCH_NO_LINE, 1, 20, PRSC_DIV_SEL_16, GAIN_1, GAIN_8, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP,       \
+	  LED_TOUCH3, RELAY3)
+#endif
+#define TOUCH_SENSOR_TOUCH4(X)                                                                                         \
+	X(TOUCH4, TOUCH_NO_LINE, 3, 20, PRSC_DIV_SEL_16, GAIN_1, GAIN_8, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP,       \
+	  NO_PIN, NO_PIN)
+
+/* Sensor table, in node order */
+#if DEF_TOUCH_GANG == 2
+#define TOUCH_SENSOR_TABLE(X) TOUCH_SENSOR_TOUCH1(X) TOUCH_SENSOR_TOUCH2(X)
+#elif DEF_TOUCH_GANG == 3
+#define TOUCH_SENSOR_TABLE(X) TOUCH_SENSOR_TOUCH1(X) TOUCH_SENSOR_TOUCH2(X) TOUCH_SENSOR_TOUCH3(X)
+#elif DEF_TOUCH_GANG == 4
+#define TOUCH_SENSOR_TABLE(X) TOUCH_SENSOR_TOUCH1(X) TOUCH_SENSOR_TOUCH2(X) TOUCH_SENSOR_TOUCH3(X) TOUCH_SENSOR_TOUCH4(X)
+#else
+#error "DEF_TOUCH_GANG must be 2, 3 or 4"
+#endif
+
+#else
+/* Mutual-cap matrix keys, X lines 0 to 2 in columns and Y lines 3, 5 and 4
+ * in rows. Y line 4 is only used by the 9-gang panel, which loses RELAY2 to
+ * it. */
+#define TOUCH_SENSOR_KEY1(X)                                                                                           \
+	X(KEY1, 0, 3, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, LED_TOUCH1, RELAY1)
+#if DEF_TOUCH_GANG == 9
+#define TOUCH_SENSOR_KEY2(X)                                                                                           \
+	X(KEY2, 1, 3, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, LED_TOUCH2, NO_PIN)
+#else
+#define TOUCH_SENSOR_KEY2(X)                                                                                           \
+	X(KEY2, 1, 3, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, LED_TOUCH2, RELAY2)
+#endif
+#if DEF_TOUCH_COMMAND_RX_ENABLE == 1u
+#define TOUCH_SENSOR_KEY3(X)                                                                                           \
+	X(KEY3, 2, 3, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, LED_TOUCH3, NO_PIN)
+#else
+#define TOUCH_SENSOR_KEY3(X)                                                                                           \
+	X(KEY3, 2, 3, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, LED_TOUCH3, RELAY3)
+#endif
+#define TOUCH_SENSOR_KEY4(X)                                                                                           \
+	X(KEY4, 0, 5, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, NO_PIN, NO_PIN)
+#define TOUCH_SENSOR_KEY5(X)                                                                                           \
+	X(KEY5, 1, 5, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, NO_PIN, NO_PIN)
+#define TOUCH_SENSOR_KEY6(X)                                                                                           \
+	X(KEY6, 2, 5, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, NO_PIN, NO_PIN)
+#define TOUCH_SENSOR_KEY7(X)                                                                                           \
+	X(KEY7, 0, 4, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, NO_PIN, NO_PIN)
+#define TOUCH_SENSOR_KEY8(X)                                                                                           \
+	X(KEY8, 1, 4, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, NO_PIN, NO_PIN)
+#define TOUCH_SENSOR_KEY9(X)                                                                                           \
+	X(KEY9, 2, 4, 0, PRSC_DIV_SEL_4, GAIN_1, GAIN_4, FILTER_LEVEL_16, 20, HYST_25, NO_AKS_GROUP, NO_PIN, NO_PIN)
+
+/* Sensor table, in node order, which is the scan sequence */
+#if DEF_TOUCH_GANG == 4
+#define TOUCH_SENSOR_TABLE(X) TOUCH_SENSOR_KEY1(X) TOUCH_SENSOR_KEY2(X) TOUCH_SENSOR_KEY4(X) TOUCH_SENSOR_KEY5(X)
+#elif DEF_TOUCH_GANG == 6
+#define TOUCH_SENSOR_TABLE(X)                                                                                          \
+	TOUCH_SENSOR_KEY1(X) TOUCH_SENSOR_KEY2(X) TOUCH_SENSOR_KEY3(X) TOUCH_SENSOR_KEY4(X) TOUCH_SENSOR_KEY5(X)           \
+	TOUCH_SENSOR_KEY6(X)
+#elif DEF_TOUCH_GANG == 9
+#define TOUCH_SENSOR_TABLE(X)                                                                                          \
+	TOUCH_SENSOR_KEY1(X) TOUCH_SENSOR_KEY2(X) TOUCH_SENSOR_KEY3(X) TOUCH_SENSOR_KEY4(X) TOUCH_SENSOR_KEY5(X)           \
+	TOUCH_SENSOR_KEY6(X) TOUCH_SENSOR_KEY7(X) TOUCH_SENSOR_KEY8(X) TOUCH_SENSOR_KEY9(X)
+#else
+#error "DEF_TOUCH_GANG must be 4, 6 or 9 with DEF_TOUCH_MATRIX"
+#endif
+#endif
+
+/* Sensor table expansions */
+#define TOUCH_SENSOR_COUNT(name, ...) +1
+#define TOUCH_SENSOR_ID(name, ...) TOUCH_SENSOR_##name,
+#if DEF_TOUCH_MATRIX == 1u
+#define TOUCH_NODE_PARAMS(name, x, y, csd, prsc, again, dgain, filter, ...)                                            \
+	{X(x), Y(y), csd, prsc, NODE_GAIN(again, dgain), filter},
+#else
+#define TOUCH_NODE_PARAMS(name, x, y, csd, prsc, again, dgain, filter, ...)                                            \
+	{X_NONE, Y(y), csd, prsc, NODE_GAIN(again, dgain), filter},
+#endif
+#define TOUCH_KEY_PARAMS(name, x, y, csd, prsc, again, dgain, filter, threshold, hysteresis, aks, ...)                 \
+	{threshold, hysteresis, aks},
+#define TOUCH_SENSOR_LINES(name, x, y, ...) | (1u << (y)) | (((x) != TOUCH_NO_LINE) ? (1u << ((x)&7u)) : 0u)
+#define TOUCH_SENSOR_XMASK(name, x, y, ...) | (((x) != TOUCH_NO_LINE) ? X((x)&7u) : X_NONE)
+#define TOUCH_SENSOR_YMASK(name, x, y, ...) | Y(y)
+
+/* PTC lines used by the sensors, bit n for line n */
+#define TOUCH_PTC_LINES ((uint8_t)(0u TOUCH_SENSOR_TABLE(TOUCH_SENSOR_LINES)))
+
+/* Sensor indices, TOUCH_SENSOR_<name> */
+enum touch_sensor_id { TOUCH_SENSOR_TABLE(TOUCH_SENSOR_ID) };
+
 /**********************************************************/
 /***************** Node Params   ******************/
 /**********************************************************/
@@ -80,22 +260,14 @@ extern "C" {
  * Range: 1 to 65535.
  * Default value: 1
  */
-#define DEF_NUM_CHANNELS (3)
+#define DEF_NUM_CHANNELS (0 TOUCH_SENSOR_TABLE(TOUCH_SENSOR_COUNT))
 
-/* Defines self-cap node parameter setting
+/* Defines node parameter setting
  * {X-line, Y-line, Charge Share Delay, Prescaler, NODE_G(Analog Gain , Digital Gain), filter level}
  */
-#define NODE_0_PARAMS                                                                                                  \
+#define TOUCH_NODE_CONFIGS                                                                                             \
 	{                                                                                                                  \
-		X_NONE, Y(2), 20, PRSC_DIV_SEL_16, NODE_GAIN(GAIN_1, GAIN_8), FILTER_LEVEL_16                                  \
-	}
-#define NODE_1_PARAMS                                                                                                  \
-	{                                                                                                                  \
-		X_NONE, Y(0), 20, PRSC_DIV_SEL_16, NODE_GAIN(GAIN_1, GAIN_8), FILTER_LEVEL_16                                  \
-	}
-#define NODE_2_PARAMS                                                                                                  \
-	{                                                                                                                  \
-		X_NONE, Y(1), 20, PRSC_DIV_SEL_16, NODE_GAIN(GAIN_1, GAIN_8), FILTER_LEVEL_16                                  \
+		TOUCH_SENSOR_TABLE(TOUCH_NODE_PARAMS)                                                                          \
 	}
 
 /**********************************************************/
@@ -105,22 +277,14 @@ extern "C" {
  * Range: 1 to 65535.
  * Default value: 1
  */
-#define DEF_NUM_SENSORS (3)
+#define DEF_NUM_SENSORS DEF_NUM_CHANNELS
 
 /* Defines Key Sensor setting
  * {Sensor Threshold, Sensor Hysterisis, Sensor AKS}
  */
-#define KEY_0_PARAMS                                                                                                   \
-	{                                                                                                                  \
-		20, HYST_25, NO_AKS_GROUP                                                                                      \
-	}
-#define KEY_1_PARAMS                                                                                                   \
-	{                                                                                                                  \
-		20, HYST_25, NO_AKS_GROUP                                                                                      \
-	}
-#define KEY_2_PARAMS                                                                                                   \
+#define TOUCH_KEY_CONFIGS                                                                                              \
 	{                                                                                                                  \
-		20, HYST_25, NO_AKS_GROUP                                                                                      \
+		TOUCH_SENSOR_TABLE(TOUCH_KEY_PARAMS)                                                                           \
 	}
 
 /* De-bounce counter for additional measurements to confirm touch detection
@@ -171,19 +335,263 @@ extern "C" {
  */
 #define DEF_REBURST_MODE REBURST_UNRESOLVED
 
+/* Rebursts of REBURST_UNRESOLVED measure a set of only the nodes whose keys
+ * filter in or out, instead of the sequence of all nodes, and the rebursts per
+ * confirmed touch are counted, see touch_reburst.c.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 0u
+ */
+#ifndef DEF_TOUCH_SELECTIVE_REBURST
+#define DEF_TOUCH_SELECTIVE_REBURST 0u
+#endif
+
+/* Nodes a selective reburst measures at most, more keys filtering take a
+ * reburst of all nodes.
+ * Range: 1 to DEF_NUM_CHANNELS.
+ * Default value: 2
+ */
+#ifndef DEF_TOUCH_REBURST_NODES
+#define DEF_TOUCH_REBURST_NODES 2u
+#endif
+
 /* Sensor maximum ON duration upon touch.
  * Range: 0-255
  * Default value: 0
  */
 #define DEF_MAX_ON_DURATION 0
 
+/* Key detection by the open implementation in touch_key.c instead of
+ * libqtm_touch_key_t816. Same structures and results as the library, in fewer
+ * cycles per measurement.
+ * Range: 0u(library) or 1u(touch_key.c)
+ * Default value: 0u
+ */
+#ifndef DEF_TOUCH_KEY_OPEN
+#define DEF_TOUCH_KEY_OPEN 0u
+#endif
+
+/**********************************************************/
+/***************** Frequency Hop Auto tune ******************/
+/**********************************************************/
+
+/* Frequency hopping. Consecutive measurements cycle through NUM_FREQ_STEPS
+ * acquisition frequencies and the keys see the median of the last measurement
+ * on each, see touch_freq_hop.c. DEF_SEL_FREQ_INIT is not used then.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 1u
+ */
+#ifndef DEF_TOUCH_FREQ_HOP_ENABLE
+#define DEF_TOUCH_FREQ_HOP_ENABLE 1u
+#endif
+
+/* Number of hop frequencies.
+ * Range: 3 to 7.
+ * Default value: 3
+ */
+#define NUM_FREQ_STEPS 3u
+
+/* Hop frequencies at start up, one per step.
+ * Range: FREQ_SEL_0 - FREQ_SEL_15
+ */
+#define DEF_MEDIAN_FILTER_FREQUENCIES FREQ_SEL_0, FREQ_SEL_1, FREQ_SEL_2
+
+/* Replace a noisy hop frequency by another one.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 1u
+ */
+#define DEF_FREQ_AUTOTUNE_ENABLE 1u
+
+/* Noise figure above which a hop frequency counts as noisy. The noise figure
+ * is the filtered deviation of the signals measured on the frequency below
+ * the median, in signal counts.
+ * Range: 1 to 255.
+ * Default value: 5
+ */
+#define FREQ_AUTOTUNE_MAX_VARIANCE 5u
+
+/* Consecutive noisy measurements on a hop frequency before it is replaced.
+ * Range: 1 to 255.
+ * Default value: 6
+ */
+#define FREQ_AUTOTUNE_COUNT_IN 6u
+
+/**********************************************************/
+/***************** Low Power ******************/
+/**********************************************************/
+
+/* Enable low power mode. After DEF_TOUCH_LOWPOWER_TIMEOUT_MS without activity
+ * only the low power node is measured, by the PTC in standby, and a window
+ * comparator hit wakes the device to resume sequenced measurements.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 1u
+ */
+#define DEF_TOUCH_LOWPOWER_ENABLE 1u
+
+/* Low power node, measured by the autoscan in low power mode. It combines the
+ * Y lines of all keys, and on the matrix their X lines too, so a touch on any
+ * key wakes the device. It is the node of an acquisition set of its own,
+ * calibrated before low power mode is entered the first time.
+ * {Charge Share Delay, Prescaler, NODE_G(Analog Gain , Digital Gain), filter level}
+ */
+#if DEF_TOUCH_MATRIX == 1u
+#define QTM_AUTOSCAN_NODE_PARAMS 0, PRSC_DIV_SEL_4, NODE_GAIN(GAIN_1, GAIN_4), FILTER_LEVEL_16
+#else
+#define QTM_AUTOSCAN_NODE_PARAMS 20, PRSC_DIV_SEL_16, NODE_GAIN(GAIN_1, GAIN_4), FILTER_LEVEL_16
+#endif
+
+#define QTM_AUTOSCAN_NODE_CONFIG                                                                                       \
+	{                                                                                                                  \
+		(uint8_t)(X_NONE TOUCH_SENSOR_TABLE(TOUCH_SENSOR_XMASK)),                                                      \
+		    (uint8_t)(0u TOUCH_SENSOR_TABLE(TOUCH_SENSOR_YMASK)), QTM_AUTOSCAN_NODE_PARAMS                             \
+	}
+
+/* Delta above the node reference that wakes the device from low power mode.
+ * Range: 1 to 255.
+ * Default value: 10
+ */
+#define QTM_AUTOSCAN_THRESHOLD 10
+
+/* Autoscan trigger, RTC PIT period select. The PIT counts the 32.768 kHz RTC
+ * clock while the NODE_SCAN_xMS names assume 1.024 kHz, so the actual period is
+ * 1/32 of the name.
+ * Range: NODE_SCAN_4MS to NODE_SCAN_32768MS.
+ * Default value: NODE_SCAN_2048MS = 64 ms
+ */
+#define QTM_AUTOSCAN_TRIGGER_PERIOD NODE_SCAN_2048MS
+
+/* Time without touch activity before low power mode is entered.
+ * Units: milli seconds
+ * Range: 0 to 65535.
+ * Default value: 10000
+ */
+#define DEF_TOUCH_LOWPOWER_TIMEOUT_MS 10000u
+
+/* Interval of full measurements in low power mode, so references keep
+ * drifting with the environment.
+ * Units: milli seconds
+ * Range: 1 to 31999.
+ * Default value: 2000
+ */
+#define DEF_TOUCH_DRIFT_PERIOD_MS 2000u
+
+/**********************************************************/
+/***************** Persistent settings ******************/
+/**********************************************************/
+
+/* Keep the key and scan settings, the compensation capacitance of each node
+ * and the relay states in EEPROM, see touch_store.c. The settings of the last
+ * valid record replace the defaults above at start up, changes are written
+ * back automatically.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 1u
+ */
+#ifndef DEF_TOUCH_STORE_ENABLE
+#define DEF_TOUCH_STORE_ENABLE 1u
+#endif
+
+/* Warm start. After a reset the nodes start with the compensation capacitance
+ * values and key references saved by the store instead of a full
+ * calibration. DEF_TOUCH_WARM_START_BURSTS back to back measurements check
+ * them; a node whose signal is a key threshold or more away from the saved
+ * reference in any of them is calibrated as usual.
+ * Requires DEF_TOUCH_STORE_ENABLE.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: DEF_TOUCH_STORE_ENABLE
+ */
+#ifndef DEF_TOUCH_WARM_START_ENABLE
+#define DEF_TOUCH_WARM_START_ENABLE DEF_TOUCH_STORE_ENABLE
+#endif
+
+/* Measurements that check the saved values of a warm start.
+ * Range: 1 to 255.
+ * Default value: 2
+ */
+#define DEF_TOUCH_WARM_START_BURSTS 2u
+
+/**********************************************************/
+/***************** Gestures ******************/
+/**********************************************************/
+
+/* Key gestures. Taps, double taps, long presses and hold repeats are
+ * recognised from the key states of each measurement and queued as events
+ * for the application, see touch_gesture.c.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 1u
+ */
+#ifndef DEF_TOUCH_GESTURE_ENABLE
+#define DEF_TOUCH_GESTURE_ENABLE 1u
+#endif
+
+/* Touch duration from which a press is a long press, shorter ones are taps.
+ * Units: milli seconds
+ * Range: 1 to 32767.
+ * Default value: 600
+ */
+#define DEF_GESTURE_LONG_PRESS_MS 600u
+
+/* Interval of repeat events while a long press is held.
+ * Units: milli seconds
+ * Range: 0 (no repeat) to 16383.
+ * Default value: 200
+ */
+#define DEF_GESTURE_REPEAT_MS 200u
+
+/* Time after the release of a tap within which a second touch is a double
+ * tap.
+ * Units: milli seconds
+ * Range: 1 to 32767.
+ * Default value: 300
+ */
+#define DEF_GESTURE_DOUBLE_TAP_MS 300u
+
+/* Keys with double tap, bit n for sensor n. Their taps are reported after
+ * DEF_GESTURE_DOUBLE_TAP_MS, taps of the other keys on release.
+ * Default value: all sensors
+ */
+#define DEF_GESTURE_DOUBLE_TAP_KEYS ((uint16_t)((1ul << DEF_NUM_SENSORS) - 1u))
+
+/* Gesture events queued for the application.
+ * Range: 2 to 128, a power of two.
+ * Default value: 8
+ */
+#define DEF_GESTURE_QUEUE_SIZE 8u
+
 /**********************************************************/
 /***************** Communication - Data Streamer ******************/
 /**********************************************************/
 
+/* Datastreamer output on USART0 TxD, PB2, which is RELAY_MOD2 of module 1 on
+ * the module bus. With the datastreamer the bus has module 0 only, see
+ * MODULE_BUS_MODULES.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 1u
+ */
+#ifndef DEF_TOUCH_DATA_STREAMER_ENABLE
 #define DEF_TOUCH_DATA_STREAMER_ENABLE 1u
+#endif
 #define DATA_STREAMER_BOARD_TYPE USER_BOARD
 
+/* Datastreamer frame format. 0u sends Data Visualizer frames, one per resolved
+ * measurement, 1u sends compact CRC-8 protected frames with delta encoded
+ * samples after every measurement, see datastreamer_UART_avr.c.
+ * Range: 0u or 1u
+ * Default value: 0u
+ */
+#ifndef DEF_TOUCH_DATA_STREAMER_COMPACT
+#define DEF_TOUCH_DATA_STREAMER_COMPACT 0u
+#endif
+
+/* Time of each stage of the scan pipeline, from the start of a measurement to
+ * the end of its datastreamer output, and the interrupt entry latency, see
+ * touch_profile.c. Compact frames carry them in profile frames. Takes TCB0
+ * from the module bus, MODULE_BUS_ENABLE has to be 0.
+ * Range: 0u(disable) or 1u(enable)
+ * Default value: 0u
+ */
+#ifndef DEF_TOUCH_PROFILE_ENABLE
+#define DEF_TOUCH_PROFILE_ENABLE 0u
+#endif
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
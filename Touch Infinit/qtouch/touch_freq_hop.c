@@ -0,0 +1,305 @@
+/*============================================================================
+Filename : touch_freq_hop.c
+Project : QTouch Modular Library
+Purpose : Frequency hopping with a median filter across the hop frequencies
+
+------------------------------------------------------------------------------
+Sits between qtm_acquisition_process() and qtm_key_sensors_process().
+Consecutive measurement sequences run on NUM_FREQ_STEPS acquisition
+frequencies in turn, and the key module sees, per node, the median of the last
+signal measured on each of them. Noise that couples in near one acquisition
+frequency, e.g. from dimmers or switch-mode LED drivers, then only disturbs one
+of the values and does not reach the keys.
+
+Each hop frequency has a noise figure: the deviation of its signals below the
+median, filtered over its measurements and taken over the nodes whose key is
+in No Detect. A touch raises the signal, so an approaching finger that shows
+on one frequency first does not count as noise. With DEF_FREQ_AUTOTUNE_ENABLE
+a frequency whose noise figure stays above FREQ_AUTOTUNE_MAX_VARIANCE for
+FREQ_AUTOTUNE_COUNT_IN of its measurements is replaced by the next frequency
+not in use.
+
+A node that is calibrating passes its signal through unfiltered. Afterwards
+it is measured on each hop frequency in turn, with its first signal standing
+for the frequencies not measured yet, and the keys wait for that so their
+references start from a median too.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "touch_freq_hop.h"
+
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *--------------------------------------------------------------------------*/
+/* Highest selectable hop frequency, FREQ_SEL_SPREAD is not used */
+#define TOUCH_FREQ_HOP_MAX_FREQ FREQ_SEL_15
+
+_Static_assert((NUM_FREQ_STEPS >= 3u) && (NUM_FREQ_STEPS <= 7u), "NUM_FREQ_STEPS must be 3 to 7");
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+extern qtm_acq_node_group_config_t ptc_qtlib_acq_gen1;
+extern qtm_acq_node_data_t         ptc_qtlib_node_stat1[DEF_NUM_CHANNELS];
+
+/* Hop frequencies, the step of the measurement in progress and of the last
+ * one filtered */
+static uint8_t touch_freq_hop_freqs[NUM_FREQ_STEPS] = {DEF_MEDIAN_FILTER_FREQUENCIES};
+static uint8_t touch_freq_hop_step;
+static uint8_t touch_freq_hop_last;
+
+/* Last signal on each hop frequency and the number of them measured since
+ * calibration, per node */
+static uint16_t touch_freq_hop_signals[NUM_FREQ_STEPS][DEF_NUM_CHANNELS];
+static uint8_t  touch_freq_hop_count[DEF_NUM_CHANNELS];
+
+/* Noise figure per hop frequency */
+static uint8_t touch_freq_hop_noise[NUM_FREQ_STEPS];
+
+#if DEF_FREQ_AUTOTUNE_ENABLE == 1u
+/* Consecutive noisy measurements per hop frequency, last frequency tried */
+static uint8_t touch_freq_hop_noisy[NUM_FREQ_STEPS];
+static uint8_t touch_freq_hop_candidate = TOUCH_FREQ_HOP_MAX_FREQ;
+#endif
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static uint16_t touch_freq_hop_median(uint16_t node);
+#if DEF_FREQ_AUTOTUNE_ENABLE == 1u
+static void touch_freq_hop_replace(uint8_t step);
+#endif
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+void touch_freq_hop_init(void)
+------------------------------------------------------------------------------
+Purpose: Selects the first hop frequency for the first measurement
+Input  : none
+Output : none
+Notes  : Call after qtm_ptc_init_acquisition_module()
+============================================================================*/
+void touch_freq_hop_init(void)
+{
+	touch_freq_hop_step = 0u;
+	touch_freq_hop_restart();
+	ptc_qtlib_acq_gen1.freq_option_select = touch_freq_hop_freqs[0];
+}
+
+/*============================================================================
+void touch_freq_hop_restart(void)
+------------------------------------------------------------------------------
+Purpose: Forgets the signals on all hop frequencies
+Input  : none
+Output : none
+Notes  : Each node is measured on all hop frequencies again before the keys
+         are processed. Used when the signals kept are too old to filter
+         with, e.g. after low power mode.
+============================================================================*/
+void touch_freq_hop_restart(void)
+{
+	memset(touch_freq_hop_count, 0, sizeof(touch_freq_hop_count));
+}
+
+/*============================================================================
+static uint16_t touch_freq_hop_median(uint16_t node)
+------------------------------------------------------------------------------
+Purpose: Median of the signals of a node on the hop frequencies
+Input  : Node
+Output : Median signal
+Notes  :
+============================================================================*/
+static uint16_t touch_freq_hop_median(uint16_t node)
+{
+	uint16_t sorted[NUM_FREQ_STEPS];
+	uint16_t signal;
+	uint8_t  i;
+	uint8_t  j;
+
+	for (i = 0u; i < NUM_FREQ_STEPS; i++) {
+		signal = touch_freq_hop_signals[i][node];
+		for (j = i; (j > 0u) && (sorted[j - 1u] > signal); j--) {
+			sorted[j] = sorted[j - 1u];
+		}
+		sorted[j] = signal;
+	}
+
+	return sorted[NUM_FREQ_STEPS / 2u];
+}
+
+#if DEF_FREQ_AUTOTUNE_ENABLE == 1u
+/*============================================================================
+static void touch_freq_hop_replace(uint8_t step)
+------------------------------------------------------------------------------
+Purpose: Replaces a noisy hop frequency by the next one not in use
+Input  : Hop step
+Output : none
+Notes  : The candidates are tried in turn over all frequencies, so one that
+         was replaced is not tried again at once. The median stands for the
+         signals on the new frequency until it has been measured.
+============================================================================*/
+static void touch_freq_hop_replace(uint8_t step)
+{
+	uint8_t  freq = touch_freq_hop_candidate;
+	uint8_t  i;
+	uint16_t node;
+
+	do {
+		freq = (freq >= TOUCH_FREQ_HOP_MAX_FREQ) ? FREQ_SEL_0 : (uint8_t)(freq + 1u);
+		for (i = 0u; (i < NUM_FREQ_STEPS) && (touch_freq_hop_freqs[i] != freq); i++)
+			;
+	} while (i < NUM_FREQ_STEPS);
+
+	touch_freq_hop_candidate   = freq;
+	touch_freq_hop_freqs[step] = freq;
+	touch_freq_hop_noise[step] = 0u;
+	touch_freq_hop_noisy[step] = 0u;
+
+	for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+		touch_freq_hop_signals[step][node] = ptc_qtlib_node_stat1[node].node_acq_signals;
+	}
+}
+#endif
+
+/*============================================================================
+uint8_t touch_freq_hop_process(const uint8_t *nodes, uint8_t count)
+------------------------------------------------------------------------------
+Purpose: Median filters the signals of a completed measurement sequence and
+         selects the hop frequency of the next one
+Input  : Nodes measured by the sequence and their number, 0 for all nodes
+Output : 1 while a node has not been measured on all hop frequencies since
+         calibration, the keys are not to be processed then
+Notes  : Call after qtm_acquisition_process() has returned TOUCH_SUCCESS and
+         before the key module. A discarded measurement is repeated on the
+         same frequency. The other nodes of a sequence of some nodes keep
+         their signals, and the noise figure is only taken from sequences of
+         all nodes, when the keys of the nodes not measured are not filtering.
+============================================================================*/
+uint8_t touch_freq_hop_process(const uint8_t *nodes, uint8_t count)
+{
+	uint8_t  step      = touch_freq_hop_step;
+	uint8_t  total     = (count != 0u) ? count : (uint8_t)DEF_NUM_CHANNELS;
+	uint16_t deviation = 0u;
+	uint8_t  measured  = 0u;
+	uint8_t  pending   = 0u;
+	uint8_t  n;
+	uint16_t node;
+	uint16_t signal;
+	uint16_t median;
+	uint8_t  i;
+
+	for (n = 0u; n < total; n++) {
+		node   = (count != 0u) ? nodes[n] : n;
+		signal = ptc_qtlib_node_stat1[node].node_acq_signals;
+
+		/* The signal follows the compensation capacitance while calibrating */
+		if (ptc_qtlib_node_stat1[node].node_acq_status & NODE_CAL_REQ) {
+			touch_freq_hop_count[node] = 0u;
+			continue;
+		}
+
+		if (touch_freq_hop_count[node] == 0u) {
+			for (i = 0u; i < NUM_FREQ_STEPS; i++) {
+				touch_freq_hop_signals[i][node] = signal;
+			}
+		} else {
+			touch_freq_hop_signals[step][node] = signal;
+		}
+		median                                      = touch_freq_hop_median(node);
+		ptc_qtlib_node_stat1[node].node_acq_signals = median;
+
+		if (touch_freq_hop_count[node] < NUM_FREQ_STEPS) {
+			if (++touch_freq_hop_count[node] < NUM_FREQ_STEPS) {
+				pending = 1u;
+			}
+			continue;
+		}
+
+		/* A touch raises the signal, only a drop below the median is noise */
+		if ((count == 0u) && (get_sensor_state(node) == QTM_KEY_STATE_NO_DET)) {
+			if ((signal < median) && ((uint16_t)(median - signal) > deviation)) {
+				deviation = (uint16_t)(median - signal);
+			}
+			measured = 1u;
+		}
+	}
+
+	if (measured) {
+		if (deviation > UINT8_MAX) {
+			deviation = UINT8_MAX;
+		}
+		touch_freq_hop_noise[step] = (uint8_t)((3u * touch_freq_hop_noise[step] + deviation + 2u) >> 2u);
+
+#if DEF_FREQ_AUTOTUNE_ENABLE == 1u
+		if (touch_freq_hop_noise[step] <= FREQ_AUTOTUNE_MAX_VARIANCE) {
+			touch_freq_hop_noisy[step] = 0u;
+		} else if (++touch_freq_hop_noisy[step] >= FREQ_AUTOTUNE_COUNT_IN) {
+			touch_freq_hop_replace(step);
+		}
+#endif
+	}
+
+	touch_freq_hop_last                   = step;
+	step                                  = (step + 1u < NUM_FREQ_STEPS) ? (uint8_t)(step + 1u) : 0u;
+	touch_freq_hop_step                   = step;
+	ptc_qtlib_acq_gen1.freq_option_select = touch_freq_hop_freqs[step];
+
+	return pending;
+}
+
+/*============================================================================
+uint16_t touch_freq_hop_get_last_signal(uint16_t node)
+------------------------------------------------------------------------------
+Purpose: Returns the signal of the last measurement before filtering
+Input  : Node
+Output : Unfiltered signal, the median if the measurement was made on a noisy
+         frequency or the node has not been measured on all of them yet
+Notes  : The median follows a touch one measurement later, this shows it at
+         once, e.g. to leave a slow scan rate.
+============================================================================*/
+uint16_t touch_freq_hop_get_last_signal(uint16_t node)
+{
+	if ((touch_freq_hop_count[node] < NUM_FREQ_STEPS)
+	    || (touch_freq_hop_noise[touch_freq_hop_last] > FREQ_AUTOTUNE_MAX_VARIANCE)) {
+		return ptc_qtlib_node_stat1[node].node_acq_signals;
+	}
+
+	return touch_freq_hop_signals[touch_freq_hop_last][node];
+}
+
+/*============================================================================
+uint8_t touch_freq_hop_get_freq(uint8_t step)
+------------------------------------------------------------------------------
+Purpose: Returns the acquisition frequency of a hop step
+Input  : Hop step, 0 to NUM_FREQ_STEPS - 1
+Output : FREQ_SEL_0 to FREQ_SEL_15
+Notes  :
+============================================================================*/
+uint8_t touch_freq_hop_get_freq(uint8_t step)
+{
+	return touch_freq_hop_freqs[step];
+}
+
+/*============================================================================
+uint8_t touch_freq_hop_get_noise(uint8_t step)
+------------------------------------------------------------------------------
+Purpose: Returns the noise figure of a hop step
+Input  : Hop step, 0 to NUM_FREQ_STEPS - 1
+Output : Filtered deviation of its signals below the median, in signal counts
+Notes  :
+============================================================================*/
+uint8_t touch_freq_hop_get_noise(uint8_t step)
+{
+	return touch_freq_hop_noise[step];
+}
+
+#endif
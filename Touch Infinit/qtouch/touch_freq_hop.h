@@ -0,0 +1,40 @@
+/*============================================================================
+Filename : touch_freq_hop.h
+Project : QTouch Modular Library
+Purpose : Frequency hopping with a median filter across the hop frequencies
+============================================================================*/
+
+#ifndef TOUCH_FREQ_HOP_H
+#define TOUCH_FREQ_HOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*----------------------------------------------------------------------------
+ *     include files
+ *----------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "touch.h"
+
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     prototypes
+ *----------------------------------------------------------------------------*/
+
+void     touch_freq_hop_init(void);
+uint8_t  touch_freq_hop_process(const uint8_t *nodes, uint8_t count);
+void     touch_freq_hop_restart(void);
+uint16_t touch_freq_hop_get_last_signal(uint16_t node);
+uint8_t  touch_freq_hop_get_freq(uint8_t step);
+uint8_t  touch_freq_hop_get_noise(uint8_t step);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // TOUCH_FREQ_HOP_H
@@ -0,0 +1,216 @@
+/*============================================================================
+Filename : touch_gesture.c
+Project : QTouch Modular Library
+Purpose : Tap, double tap, long press and hold repeat events per key
+
+------------------------------------------------------------------------------
+touch_gesture_process() is fed the detected keys and the time of each
+completed measurement and runs one state machine per key:
+
+  touch shorter than DEF_GESTURE_LONG_PRESS_MS      TAP on release
+  second touch within DEF_GESTURE_DOUBLE_TAP_MS      DOUBLE_TAP on the touch
+  touch held for DEF_GESTURE_LONG_PRESS_MS          LONG_PRESS, then REPEAT
+                                                    every DEF_GESTURE_REPEAT_MS
+  release after a long press                        LONG_RELEASE
+
+A tap of a key in DEF_GESTURE_DOUBLE_TAP_KEYS is only reported once the
+double tap time has passed without a second touch; taps of the other keys are
+reported on release. The events go into a queue of DEF_GESTURE_QUEUE_SIZE the
+application drains with touch_gesture_get_event().
+
+Times are only looked at when a measurement completes, so there is no timer
+of its own and each call costs a fixed amount per key. The timing resolution
+is the measurement period, which stays fast for DEF_TOUCH_IDLE_TIMEOUT_MS
+after a key was last active. A repeat interval missed by a slow measurement
+is skipped rather than caught up, so each key queues at most one event per
+measurement.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include "touch_gesture.h"
+
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *--------------------------------------------------------------------------*/
+#define TOUCH_GESTURE_QUEUE_MASK (DEF_GESTURE_QUEUE_SIZE - 1u)
+
+/* Queue entries: sensor in the low nibble, event type in the high nibble */
+#define TOUCH_GESTURE_ENTRY(sensor, type) ((uint8_t)(((type) << 4u) | (sensor)))
+
+_Static_assert((DEF_GESTURE_QUEUE_SIZE & TOUCH_GESTURE_QUEUE_MASK) == 0u, "DEF_GESTURE_QUEUE_SIZE must be a power of two");
+_Static_assert(DEF_GESTURE_QUEUE_SIZE <= 128u, "DEF_GESTURE_QUEUE_SIZE must be 128 or less");
+_Static_assert(DEF_NUM_SENSORS <= 16u, "gesture key mask holds 16 sensors");
+_Static_assert((DEF_GESTURE_LONG_PRESS_MS <= 0x7fffu) && (DEF_GESTURE_DOUBLE_TAP_MS <= 0x7fffu),
+               "gesture times must be 32767 ms or less");
+
+/* Key states */
+enum touch_gesture_state {
+	TOUCH_GESTURE_IDLE,
+	TOUCH_GESTURE_PRESSED,  /* Touched, not yet a long press */
+	TOUCH_GESTURE_TAPPED,   /* Released, waiting for a second touch */
+	TOUCH_GESTURE_HELD,     /* Long press */
+	TOUCH_GESTURE_DOUBLED   /* Second touch, waiting for its release */
+};
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+static enum touch_gesture_state touch_gesture_states[DEF_NUM_SENSORS];
+
+/* Time of the touch or release that started the state, of the last repeat
+ * while held */
+static uint16_t touch_gesture_times[DEF_NUM_SENSORS];
+
+static uint8_t touch_gesture_queue[DEF_GESTURE_QUEUE_SIZE];
+static uint8_t touch_gesture_head;
+static uint8_t touch_gesture_tail;
+
+static struct touch_gesture_stats touch_gesture_stats_data;
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static void touch_gesture_queue_event(uint8_t sensor, enum touch_gesture_type type);
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+static void touch_gesture_queue_event(uint8_t sensor, enum touch_gesture_type type)
+------------------------------------------------------------------------------
+Purpose: Adds an event to the queue
+Input  : Sensor and event type
+Output : none
+Notes  : The event is dropped if the queue is full.
+============================================================================*/
+static void touch_gesture_queue_event(uint8_t sensor, enum touch_gesture_type type)
+{
+	if ((uint8_t)(touch_gesture_head - touch_gesture_tail) >= DEF_GESTURE_QUEUE_SIZE) {
+		touch_gesture_stats_data.dropped++;
+		return;
+	}
+
+	touch_gesture_queue[touch_gesture_head & TOUCH_GESTURE_QUEUE_MASK] = TOUCH_GESTURE_ENTRY(sensor, type);
+	touch_gesture_head++;
+	touch_gesture_stats_data.events[type]++;
+}
+
+/*============================================================================
+void touch_gesture_process(uint16_t keys, uint16_t time_ms)
+------------------------------------------------------------------------------
+Purpose: Advances the gesture state machine of each key
+Input  : keys: bit n set while sensor n is detected, time_ms: time of the
+         measurement in milli seconds, wrapping
+Output : none
+Notes  : Call once per completed measurement.
+============================================================================*/
+void touch_gesture_process(uint16_t keys, uint16_t time_ms)
+{
+	uint8_t  sensor;
+	uint8_t  touched;
+	uint16_t elapsed;
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		touched = (keys >> sensor) & 1u;
+		elapsed = (uint16_t)(time_ms - touch_gesture_times[sensor]);
+
+		switch (touch_gesture_states[sensor]) {
+		case TOUCH_GESTURE_IDLE:
+			if (touched) {
+				touch_gesture_states[sensor] = TOUCH_GESTURE_PRESSED;
+				touch_gesture_times[sensor]  = time_ms;
+			}
+			break;
+
+		case TOUCH_GESTURE_PRESSED:
+			if (!touched) {
+				if (DEF_GESTURE_DOUBLE_TAP_KEYS & (1u << sensor)) {
+					touch_gesture_states[sensor] = TOUCH_GESTURE_TAPPED;
+					touch_gesture_times[sensor]  = time_ms;
+				} else {
+					touch_gesture_queue_event(sensor, TOUCH_GESTURE_TAP);
+					touch_gesture_states[sensor] = TOUCH_GESTURE_IDLE;
+				}
+			} else if (elapsed >= DEF_GESTURE_LONG_PRESS_MS) {
+				touch_gesture_queue_event(sensor, TOUCH_GESTURE_LONG_PRESS);
+				touch_gesture_states[sensor] = TOUCH_GESTURE_HELD;
+				touch_gesture_times[sensor]  = time_ms;
+			}
+			break;
+
+		case TOUCH_GESTURE_TAPPED:
+			if (elapsed >= DEF_GESTURE_DOUBLE_TAP_MS) {
+				touch_gesture_queue_event(sensor, TOUCH_GESTURE_TAP);
+				touch_gesture_states[sensor] = touched ? TOUCH_GESTURE_PRESSED : TOUCH_GESTURE_IDLE;
+				touch_gesture_times[sensor]  = time_ms;
+			} else if (touched) {
+				touch_gesture_queue_event(sensor, TOUCH_GESTURE_DOUBLE_TAP);
+				touch_gesture_states[sensor] = TOUCH_GESTURE_DOUBLED;
+			}
+			break;
+
+		case TOUCH_GESTURE_HELD:
+			if (!touched) {
+				touch_gesture_queue_event(sensor, TOUCH_GESTURE_LONG_RELEASE);
+				touch_gesture_states[sensor] = TOUCH_GESTURE_IDLE;
+			} else if ((DEF_GESTURE_REPEAT_MS != 0u) && (elapsed >= DEF_GESTURE_REPEAT_MS)) {
+				touch_gesture_queue_event(sensor, TOUCH_GESTURE_REPEAT);
+				/* Keep the interval, unless the measurements are further apart */
+				touch_gesture_times[sensor] = (elapsed >= 2u * DEF_GESTURE_REPEAT_MS)
+				                                  ? time_ms
+				                                  : (uint16_t)(touch_gesture_times[sensor] + DEF_GESTURE_REPEAT_MS);
+			}
+			break;
+
+		default:
+			if (!touched) {
+				touch_gesture_states[sensor] = TOUCH_GESTURE_IDLE;
+			}
+			break;
+		}
+	}
+}
+
+/*============================================================================
+uint8_t touch_gesture_get_event(struct touch_gesture_event *event)
+------------------------------------------------------------------------------
+Purpose: Takes the oldest event from the queue
+Input  : Destination of the event
+Output : 1 if an event was taken, 0 if the queue is empty
+Notes  :
+============================================================================*/
+uint8_t touch_gesture_get_event(struct touch_gesture_event *event)
+{
+	uint8_t entry;
+
+	if (touch_gesture_head == touch_gesture_tail) {
+		return 0u;
+	}
+
+	entry = touch_gesture_queue[touch_gesture_tail & TOUCH_GESTURE_QUEUE_MASK];
+	touch_gesture_tail++;
+
+	event->sensor = entry & 0x0Fu;
+	event->type   = (enum touch_gesture_type)(entry >> 4u);
+	return 1u;
+}
+
+/*============================================================================
+void touch_gesture_get_stats(struct touch_gesture_stats *stats)
+------------------------------------------------------------------------------
+Purpose: Copies the event counters
+Input  : Destination of the copy
+Output : none
+Notes  : The counters wrap.
+============================================================================*/
+void touch_gesture_get_stats(struct touch_gesture_stats *stats)
+{
+	*stats = touch_gesture_stats_data;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*============================================================================
+Filename : touch_gesture.h
+Project : QTouch Modular Library
+Purpose : Tap, double tap, long press and hold repeat events per key
+============================================================================*/
+
+#ifndef TOUCH_GESTURE_H
+#define TOUCH_GESTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*----------------------------------------------------------------------------
+ *     include files
+ *----------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "touch.h"
+
+#if DEF_TOUCH_GESTURE_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     type definitions
+ *----------------------------------------------------------------------------*/
+
+enum touch_gesture_type {
+	TOUCH_GESTURE_TAP,          /* Released before the long press time */
+	TOUCH_GESTURE_DOUBLE_TAP,   /* Touched again within the double tap time */
+	TOUCH_GESTURE_LONG_PRESS,   /* Held for the long press time */
+	TOUCH_GESTURE_REPEAT,       /* Still held, every repeat interval */
+	TOUCH_GESTURE_LONG_RELEASE, /* Released after a long press */
+	TOUCH_GESTURE_TYPES
+};
+
+struct touch_gesture_event {
+	uint8_t                 sensor;
+	enum touch_gesture_type type;
+};
+
+/* Events queued per type and events lost to a full queue */
+struct touch_gesture_stats {
+	uint16_t events[TOUCH_GESTURE_TYPES];
+	uint16_t dropped;
+};
+
+/*----------------------------------------------------------------------------
+ *     prototypes
+ *----------------------------------------------------------------------------*/
+
+void    touch_gesture_process(uint16_t keys, uint16_t time_ms);
+uint8_t touch_gesture_get_event(struct touch_gesture_event *event);
+void    touch_gesture_get_stats(struct touch_gesture_stats *stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // TOUCH_GESTURE_H
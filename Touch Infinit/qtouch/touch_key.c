@@ -0,0 +1,573 @@
+/*============================================================================
+Filename : touch_key.c
+Project : QTouch Modular Library
+Purpose : Open implementation of the touch key module (qtm_touch_key_0x0002)
+
+------------------------------------------------------------------------------
+Replaces libqtm_touch_key_t816_0x0002 when DEF_TOUCH_KEY_OPEN is 1u. It works
+on the same qtm_touch_key_control_t structures. The states of a key:
+
+  INIT      node calibrating         CAL once the acquisition calibration ends
+  CAL       TOUCH_KEY_CAL_COUNT      reference = signal, then steps of one
+                                     count towards it for the last
+                                     TOUCH_KEY_CAL_TRACK measurements
+  NO_DET    delta >= threshold       FILT_IN for sensor_touch_di measurements
+            -delta >= recal thr      ANTI_TCH for sensor_anti_touch_di
+  FILT_IN   delta > threshold        DETECT after the count, else NO_DET
+  DETECT    delta <= thr - hyst      FILT_OUT for sensor_touch_di
+  FILT_OUT  delta > thr - hyst       back to DETECT, else NO_DET after the count
+  ANTI_TCH  held for the count       node calibration requested, INIT
+
+The recal threshold is the key threshold shifted right by
+sensor_anti_touch_recal_thr, the hysteresis takes the threshold shifted right
+by channel_hysteresis + 1 off the threshold.
+
+A key of an AKS group does not enter or leave FILT_IN while another key of
+its group is in detect or above its threshold by more. While keys are
+unresolved a reburst is requested; with REBURST_UNRESOLVED the nodes of the
+resolved keys are disabled for the reburst and enabled again by the next
+call.
+
+Every QTLIB_TIMEBASE ms counted by qtm_update_qtlib_timer() and checked at
+the end of qtm_key_sensors_process(), the drift hold time counts down, or
+else the references of the keys in NO_DET drift by one count towards the
+signal at the drift rates. Keys held in DETECT for sensor_max_on_time of
+these periods are calibrated again, with the other keys of their AKS group.
+
+The group is walked with pointers kept in locals. The time count is read with
+interrupts disabled.
+
+The host builds of sim/ run this module in the firmware. The presses of the
+smoke script are detected, and replaying its compact capture gives the same
+detect states. It has not been run against the library.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "touch_key.h"
+#include "atomic.h"
+
+#if DEF_TOUCH_KEY_OPEN == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *--------------------------------------------------------------------------*/
+/* Node status of a calibration request */
+#define TOUCH_KEY_NODE_RECAL (NODE_ENABLED | NODE_CAL_REQ)
+
+/* Suspended and disabled keys */
+#define TOUCH_KEY_IS_ACTIVE(state) (((state) & (uint8_t)~QTM_KEY_STATE_SUSPEND) != 0u)
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+volatile uint16_t qtm_local_ms_timecount;
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static uint8_t touch_key_aks_blocked(const qtm_touch_key_control_t *control, uint16_t which_sensor_key,
+                                     uint16_t margin);
+static uint8_t touch_key_aks_filtering(const qtm_touch_key_control_t *control, uint16_t which_sensor_key);
+static void    touch_key_timebase(qtm_touch_key_control_t *control);
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+static uint8_t touch_key_aks_blocked(const qtm_touch_key_control_t *control, uint16_t which_sensor_key,
+                                     uint16_t margin)
+------------------------------------------------------------------------------
+Purpose: Checks whether another key of the AKS group keeps a key out of detect
+Input  : Key group, key number, delta of the key above its threshold
+Output : 1 if another key of the group is in detect or further above its
+         threshold, 0 otherwise
+Notes  : Keys before which_sensor_key have been processed already.
+============================================================================*/
+static uint8_t touch_key_aks_blocked(const qtm_touch_key_control_t *control, uint16_t which_sensor_key,
+                                     uint16_t margin)
+{
+	const qtm_touch_key_data_t *  key   = control->qtm_touch_key_data;
+	const qtm_touch_key_config_t *kcfg  = control->qtm_touch_key_config;
+	uint16_t                      num   = control->qtm_touch_key_group_config->num_key_sensors;
+	uint8_t                       group = kcfg[which_sensor_key].channel_aks_group;
+	uint16_t                      k;
+	uint16_t                      signal;
+	uint16_t                      delta;
+
+	for (k = 0u; k < num; k++, key++, kcfg++) {
+		if ((k == which_sensor_key) || (kcfg->channel_aks_group != group)) {
+			continue;
+		}
+		if (key->sensor_state & KEY_TOUCHED_MASK) {
+			return 1u;
+		}
+		signal = key->node_data_struct_ptr->node_acq_signals;
+		if (signal > key->channel_reference) {
+			delta = signal - key->channel_reference;
+			if ((delta > kcfg->channel_threshold) && ((uint16_t)(delta - kcfg->channel_threshold) > margin)) {
+				return 1u;
+			}
+		}
+	}
+
+	return 0u;
+}
+
+/*============================================================================
+static uint8_t touch_key_aks_filtering(const qtm_touch_key_control_t *control, uint16_t which_sensor_key)
+------------------------------------------------------------------------------
+Purpose: Checks whether another key of the AKS group is filtering in or out
+Input  : Key group, key number
+Output : 1 if a key of the same AKS group is in FILT_IN or FILT_OUT
+Notes  : A key without AKS group has no such key.
+============================================================================*/
+static uint8_t touch_key_aks_filtering(const qtm_touch_key_control_t *control, uint16_t which_sensor_key)
+{
+	const qtm_touch_key_data_t *  key   = control->qtm_touch_key_data;
+	const qtm_touch_key_config_t *kcfg  = control->qtm_touch_key_config;
+	uint16_t                      num   = control->qtm_touch_key_group_config->num_key_sensors;
+	uint8_t                       group = kcfg[which_sensor_key].channel_aks_group;
+	uint16_t                      k;
+
+	if (group == NO_AKS_GROUP) {
+		return 0u;
+	}
+
+	for (k = 0u; k < num; k++, key++, kcfg++) {
+		if ((k != which_sensor_key) && (kcfg->channel_aks_group == group)
+		    && ((key->sensor_state == QTM_KEY_STATE_FILT_IN) || (key->sensor_state == QTM_KEY_STATE_FILT_OUT))) {
+			return 1u;
+		}
+	}
+
+	return 0u;
+}
+
+/*============================================================================
+static void touch_key_timebase(qtm_touch_key_control_t *control)
+------------------------------------------------------------------------------
+Purpose: Drift and maximum on duration, once per QTLIB_TIMEBASE
+Input  : Key group
+Output : none
+Notes  : Drift waits for the drift hold time, which a key in detect restarts.
+============================================================================*/
+static void touch_key_timebase(qtm_touch_key_control_t *control)
+{
+	qtm_touch_key_group_data_t *        grp = control->qtm_touch_key_group_data;
+	const qtm_touch_key_group_config_t *cfg = control->qtm_touch_key_group_config;
+	qtm_touch_key_data_t *              key;
+	qtm_touch_key_data_t *              end = control->qtm_touch_key_data + cfg->num_key_sensors;
+	const qtm_touch_key_config_t *      kcfg;
+	uint16_t                            signal;
+	uint8_t                             group;
+
+	if (grp->dht_count_in != 0u) {
+		grp->dht_count_in--;
+	} else {
+		if (grp->tch_drift_count_in != 0u) {
+			grp->tch_drift_count_in--;
+		}
+		if (grp->antitch_drift_count_in != 0u) {
+			grp->antitch_drift_count_in--;
+		}
+
+		/* Towards touch */
+		if ((cfg->sensor_touch_drift_rate != 0u) && (grp->tch_drift_count_in == 0u)) {
+			for (key = control->qtm_touch_key_data; key < end; key++) {
+				if ((key->sensor_state == QTM_KEY_STATE_NO_DET) || (key->sensor_state == QTM_KEY_STATE_SUSPEND)) {
+					signal = key->node_data_struct_ptr->node_acq_signals;
+					if (key->channel_reference < signal) {
+						key->channel_reference++;
+					}
+				}
+			}
+			grp->tch_drift_count_in = cfg->sensor_touch_drift_rate;
+		}
+
+		/* Away from touch */
+		if ((cfg->sensor_anti_touch_drift_rate != 0u) && (grp->antitch_drift_count_in == 0u)) {
+			for (key = control->qtm_touch_key_data; key < end; key++) {
+				if ((key->sensor_state == QTM_KEY_STATE_NO_DET) || (key->sensor_state == QTM_KEY_STATE_SUSPEND)) {
+					signal = key->node_data_struct_ptr->node_acq_signals;
+					if (signal < key->channel_reference) {
+						key->channel_reference--;
+					}
+				}
+			}
+			grp->antitch_drift_count_in = cfg->sensor_anti_touch_drift_rate;
+		}
+	}
+
+	if (cfg->sensor_max_on_time == 0u) {
+		return;
+	}
+
+	kcfg = control->qtm_touch_key_config;
+	for (key = control->qtm_touch_key_data; key < end; key++, kcfg++) {
+		if (key->sensor_state != QTM_KEY_STATE_DETECT) {
+			continue;
+		}
+		if (key->sensor_state_counter != 0u) {
+			key->sensor_state_counter--;
+			continue;
+		}
+
+		/* Held too long, calibrate the key and the enabled keys of its group */
+		key->sensor_state                          = QTM_KEY_STATE_INIT;
+		key->node_data_struct_ptr->node_acq_status = TOUCH_KEY_NODE_RECAL;
+		group                                      = kcfg->channel_aks_group;
+		if (group != NO_AKS_GROUP) {
+			qtm_touch_key_data_t *        other      = control->qtm_touch_key_data;
+			const qtm_touch_key_config_t *other_kcfg = control->qtm_touch_key_config;
+
+			for (; other < end; other++, other_kcfg++) {
+				if ((other_kcfg->channel_aks_group == group)
+				    && (other->node_data_struct_ptr->node_acq_status & NODE_ENABLED)) {
+					other->sensor_state                          = QTM_KEY_STATE_INIT;
+					other->node_data_struct_ptr->node_acq_status = TOUCH_KEY_NODE_RECAL;
+				}
+			}
+		}
+	}
+}
+
+/*============================================================================
+touch_ret_t qtm_init_sensor_key(qtm_touch_key_control_t* qtm_lib_key_group_ptr, uint8_t which_sensor_key,
+qtm_acq_node_data_t* acq_lib_node_ptr)
+------------------------------------------------------------------------------
+Purpose: Initialize a touch key sensor
+Input  : Pointer to key group control data, key number, pointers to sensor node status and signal
+Output : TOUCH_SUCCESS, TOUCH_INVALID_POINTER
+Notes  : The key starts in INIT and calibrates with its node.
+============================================================================*/
+touch_ret_t qtm_init_sensor_key(qtm_touch_key_control_t *qtm_lib_key_group_ptr, uint8_t which_sensor_key,
+                                qtm_acq_node_data_t *acq_lib_node_ptr)
+{
+	qtm_touch_key_data_t *key;
+
+	if ((qtm_lib_key_group_ptr == NULL) || (acq_lib_node_ptr == NULL)) {
+		return TOUCH_INVALID_POINTER;
+	}
+
+	key                       = &qtm_lib_key_group_ptr->qtm_touch_key_data[which_sensor_key];
+	key->sensor_state         = QTM_KEY_STATE_INIT;
+	key->node_data_struct_ptr = acq_lib_node_ptr;
+
+	return TOUCH_SUCCESS;
+}
+
+/*============================================================================
+touch_ret_t qtm_key_sensors_process(qtm_touch_key_control_t* qtm_lib_key_group_ptr)
+------------------------------------------------------------------------------
+Purpose: Sensor key post-processing (touch detect state machine)
+Input  : Pointer to key group control data
+Output : TOUCH_SUCCESS, TOUCH_INVALID_POINTER
+Notes  : Call once per completed measurement, after qtm_acquisition_process().
+============================================================================*/
+touch_ret_t qtm_key_sensors_process(qtm_touch_key_control_t *qtm_lib_key_group_ptr)
+{
+	qtm_touch_key_group_data_t *        grp;
+	const qtm_touch_key_group_config_t *cfg;
+	qtm_touch_key_data_t *              key;
+	qtm_touch_key_data_t *              end;
+	const qtm_touch_key_config_t *      kcfg;
+	qtm_acq_node_data_t *               node;
+	uint16_t                            k;
+	uint16_t                            signal;
+	uint16_t                            reference;
+	uint16_t                            now;
+	uint16_t                            elapsed;
+	uint8_t                             threshold;
+	uint8_t                             threshold_out;
+	uint8_t                             unresolved = 0u;
+	uint8_t                             detect     = 0u;
+
+	if (qtm_lib_key_group_ptr == NULL) {
+		return TOUCH_INVALID_POINTER;
+	}
+
+	grp  = qtm_lib_key_group_ptr->qtm_touch_key_group_data;
+	cfg  = qtm_lib_key_group_ptr->qtm_touch_key_group_config;
+	key  = qtm_lib_key_group_ptr->qtm_touch_key_data;
+	end  = key + cfg->num_key_sensors;
+	kcfg = qtm_lib_key_group_ptr->qtm_touch_key_config;
+
+	for (k = 0u; key < end; k++, key++, kcfg++) {
+		node = key->node_data_struct_ptr;
+		if (node->node_acq_status & NODE_CAL_MASK) {
+			key->sensor_state = QTM_KEY_STATE_INIT;
+		}
+		signal        = node->node_acq_signals;
+		reference     = key->channel_reference;
+		threshold     = kcfg->channel_threshold;
+		threshold_out = threshold - (threshold >> (kcfg->channel_hysteresis + 1u));
+
+		switch (key->sensor_state) {
+		case QTM_KEY_STATE_INIT:
+			if (!(node->node_acq_status & NODE_CAL_MASK)) {
+				key->sensor_state         = QTM_KEY_STATE_CAL;
+				key->sensor_state_counter = TOUCH_KEY_CAL_COUNT;
+			}
+			unresolved = 1u;
+			break;
+
+		case QTM_KEY_STATE_CAL:
+			if (key->sensor_state_counter == 0u) {
+				key->sensor_state = QTM_KEY_STATE_NO_DET;
+				break;
+			}
+			if (key->sensor_state_counter > TOUCH_KEY_CAL_TRACK) {
+				key->channel_reference = signal;
+			} else if (signal > reference) {
+				key->channel_reference = reference + 1u;
+			} else if (signal < reference) {
+				key->channel_reference = reference - 1u;
+			}
+			key->sensor_state_counter--;
+			unresolved = 1u;
+			break;
+
+		case QTM_KEY_STATE_NO_DET:
+			if (signal > reference) {
+				if (((uint16_t)(signal - reference) >= threshold)
+				    && ((kcfg->channel_aks_group == NO_AKS_GROUP)
+				        || !touch_key_aks_blocked(qtm_lib_key_group_ptr, k, signal - reference - threshold))) {
+					key->sensor_state         = QTM_KEY_STATE_FILT_IN;
+					key->sensor_state_counter = cfg->sensor_touch_di;
+					unresolved                = 1u;
+				}
+			} else if (signal < reference) {
+				if (((uint16_t)(reference - signal) >= (uint8_t)(threshold >> cfg->sensor_anti_touch_recal_thr))
+				    && (cfg->sensor_anti_touch_di != 0u)) {
+					key->sensor_state         = QTM_KEY_STATE_ANTI_TCH;
+					key->sensor_state_counter = cfg->sensor_anti_touch_di;
+					unresolved                = 1u;
+				}
+			}
+			break;
+
+		case QTM_KEY_STATE_FILT_IN:
+			if ((signal <= reference) || ((uint16_t)(signal - reference) <= threshold)) {
+				key->sensor_state         = QTM_KEY_STATE_NO_DET;
+				key->sensor_state_counter = 0u;
+			} else if ((kcfg->channel_aks_group != NO_AKS_GROUP)
+			           && touch_key_aks_blocked(qtm_lib_key_group_ptr, k, signal - reference - threshold)) {
+				/* Held in FILT_IN by the group */
+			} else if (key->sensor_state_counter != 0u) {
+				key->sensor_state_counter--;
+				unresolved = 1u;
+			} else {
+				key->sensor_state         = QTM_KEY_STATE_DETECT;
+				key->sensor_state_counter = cfg->sensor_max_on_time;
+				detect                    = 1u;
+			}
+			break;
+
+		case QTM_KEY_STATE_DETECT:
+			grp->dht_count_in = cfg->sensor_drift_hold_time;
+			if ((signal < reference) || ((uint16_t)(signal - reference) <= threshold_out)) {
+				key->sensor_state         = QTM_KEY_STATE_FILT_OUT;
+				key->sensor_state_counter = cfg->sensor_touch_di;
+				unresolved                = 1u;
+			}
+			detect = 1u;
+			break;
+
+		case QTM_KEY_STATE_FILT_OUT:
+			if ((signal >= reference) && ((uint16_t)(signal - reference) > threshold_out)) {
+				key->sensor_state         = QTM_KEY_STATE_DETECT;
+				key->sensor_state_counter = cfg->sensor_max_on_time;
+			} else if (key->sensor_state_counter == 0u) {
+				key->sensor_state = QTM_KEY_STATE_NO_DET;
+			} else {
+				key->sensor_state_counter--;
+				/* A signal below the reference does not hold off the release */
+				if (signal >= reference) {
+					unresolved = 1u;
+				}
+			}
+			detect = 1u;
+			break;
+
+		case QTM_KEY_STATE_ANTI_TCH:
+			if ((signal >= reference)
+			    || ((uint16_t)(reference - signal) < (uint8_t)(threshold >> cfg->sensor_anti_touch_recal_thr))) {
+				key->sensor_state         = QTM_KEY_STATE_NO_DET;
+				key->sensor_state_counter = 0u;
+			} else if (key->sensor_state_counter != 0u) {
+				key->sensor_state_counter--;
+				unresolved = 1u;
+			} else {
+				/* Away from touch for too long, calibrate the node again */
+				key->sensor_state     = QTM_KEY_STATE_INIT;
+				node->node_acq_status = TOUCH_KEY_NODE_RECAL;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	/* Enable the nodes left out of the last reburst again */
+	if (grp->qtm_keys_status & QTM_KEY_REBURST) {
+		for (key = qtm_lib_key_group_ptr->qtm_touch_key_data; key < end; key++) {
+			node = key->node_data_struct_ptr;
+			if (!(node->node_acq_status & NODE_ENABLED) && TOUCH_KEY_IS_ACTIVE(key->sensor_state)) {
+				node->node_acq_status |= NODE_ENABLED;
+			}
+		}
+		grp->qtm_keys_status &= (uint8_t)~QTM_KEY_REBURST;
+	}
+
+	if (unresolved && (cfg->sensor_reburst_mode != REBURST_NONE)) {
+		grp->qtm_keys_status |= QTM_KEY_REBURST;
+
+		/* Only the unresolved keys and the AKS groups they hold are measured again */
+		if (cfg->sensor_reburst_mode == REBURST_UNRESOLVED) {
+			for (k = 0u, key = qtm_lib_key_group_ptr->qtm_touch_key_data; key < end; k++, key++) {
+				uint8_t enable;
+
+				if (!TOUCH_KEY_IS_ACTIVE(key->sensor_state)) {
+					enable = 0u;
+				} else if ((key->sensor_state == QTM_KEY_STATE_DETECT) || (key->sensor_state == QTM_KEY_STATE_NO_DET)) {
+					enable = touch_key_aks_filtering(qtm_lib_key_group_ptr, k);
+				} else {
+					enable = 1u;
+				}
+
+				if (enable) {
+					key->node_data_struct_ptr->node_acq_status |= NODE_ENABLED;
+				} else {
+					key->node_data_struct_ptr->node_acq_status &= (uint8_t)~NODE_ENABLED;
+				}
+			}
+		}
+	}
+
+	if (detect) {
+		grp->qtm_keys_status |= QTM_KEY_DETECT;
+	} else {
+		grp->qtm_keys_status &= (uint8_t)~QTM_KEY_DETECT;
+	}
+
+	/* Time base: more than QTLIB_TIMEBASE ms since the group time stamp. A
+	 * count that went back behind the time stamp is taken as wrapped. */
+	ENTER_CRITICAL(K);
+	now = qtm_local_ms_timecount;
+	EXIT_CRITICAL(K);
+
+	if ((uint16_t)(grp->acq_group_timestamp + QTLIB_TIMEBASE) < now) {
+		elapsed = now - grp->acq_group_timestamp;
+	} else if (now < grp->acq_group_timestamp) {
+		elapsed = now - grp->acq_group_timestamp - 1u;
+	} else {
+		return TOUCH_SUCCESS;
+	}
+
+	while (elapsed > QTLIB_TIMEBASE) {
+		elapsed -= QTLIB_TIMEBASE;
+		grp->acq_group_timestamp += QTLIB_TIMEBASE;
+		touch_key_timebase(qtm_lib_key_group_ptr);
+	}
+
+	return TOUCH_SUCCESS;
+}
+
+/*============================================================================
+touch_ret_t qtm_key_suspend(uint16_t which_sensor_key, qtm_touch_key_control_t* qtm_lib_key_group_ptr)
+------------------------------------------------------------------------------
+Purpose: Suspends acquisition measurements for the key
+Input  : Key number, Pointer to key group control data
+Output : TOUCH_SUCCESS, TOUCH_INVALID_POINTER, TOUCH_INVALID_INPUT_PARAM
+Notes  : The node is disabled, the reference keeps drifting.
+============================================================================*/
+touch_ret_t qtm_key_suspend(uint16_t which_sensor_key, qtm_touch_key_control_t *qtm_lib_key_group_ptr)
+{
+	qtm_touch_key_data_t *key;
+
+	if (qtm_lib_key_group_ptr == NULL) {
+		return TOUCH_INVALID_POINTER;
+	}
+	if (which_sensor_key >= qtm_lib_key_group_ptr->qtm_touch_key_group_config->num_key_sensors) {
+		return TOUCH_INVALID_INPUT_PARAM;
+	}
+
+	key               = &qtm_lib_key_group_ptr->qtm_touch_key_data[which_sensor_key];
+	key->sensor_state = QTM_KEY_STATE_SUSPEND;
+	key->node_data_struct_ptr->node_acq_status &= (uint8_t)~NODE_ENABLED;
+
+	return TOUCH_SUCCESS;
+}
+
+/*============================================================================
+touch_ret_t qtm_key_resume(uint16_t which_sensor_key, qtm_touch_key_control_t* qtm_lib_key_group_ptr)
+------------------------------------------------------------------------------
+Purpose: Resumes acquisition measurements for the key
+Input  : Key number, Pointer to key group control data
+Output : TOUCH_SUCCESS, TOUCH_INVALID_POINTER, TOUCH_INVALID_INPUT_PARAM
+Notes  : The key resumes in NO_DET from its drifted reference.
+============================================================================*/
+touch_ret_t qtm_key_resume(uint16_t which_sensor_key, qtm_touch_key_control_t *qtm_lib_key_group_ptr)
+{
+	qtm_touch_key_data_t *key;
+
+	if (qtm_lib_key_group_ptr == NULL) {
+		return TOUCH_INVALID_POINTER;
+	}
+	if (which_sensor_key >= qtm_lib_key_group_ptr->qtm_touch_key_group_config->num_key_sensors) {
+		return TOUCH_INVALID_INPUT_PARAM;
+	}
+
+	key               = &qtm_lib_key_group_ptr->qtm_touch_key_data[which_sensor_key];
+	key->sensor_state = QTM_KEY_STATE_NO_DET;
+	key->node_data_struct_ptr->node_acq_status |= NODE_ENABLED;
+
+	return TOUCH_SUCCESS;
+}
+
+/*============================================================================
+void qtm_update_qtlib_timer(uint16_t time_elapsed_since_update)
+------------------------------------------------------------------------------
+Purpose: Updates local variable with time period
+Input  : Number of ms since last update
+Output : none
+Notes  : Called from the RTC interrupt.
+============================================================================*/
+void qtm_update_qtlib_timer(uint16_t time_elapsed_since_update)
+{
+	qtm_local_ms_timecount += time_elapsed_since_update;
+}
+
+/*============================================================================
+uint16_t qtm_get_touch_keys_module_id(void)
+------------------------------------------------------------------------------
+Purpose: Returns the module ID
+Input  : none
+Output : Module ID
+Notes  : Same as the library, the module has the same API.
+============================================================================*/
+uint16_t qtm_get_touch_keys_module_id(void)
+{
+	return 0x0002u;
+}
+
+/*============================================================================
+uint8_t qtm_get_touch_keys_module_ver(void)
+------------------------------------------------------------------------------
+Purpose: Returns the module Firmware version
+Input  : none
+Output : TOUCH_KEY_MODULE_VER
+Notes  : none
+============================================================================*/
+uint8_t qtm_get_touch_keys_module_ver(void)
+{
+	return TOUCH_KEY_MODULE_VER;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*============================================================================
+Filename : touch_key.h
+Project : QTouch Modular Library
+Purpose : Open implementation of the touch key module (qtm_touch_key_0x0002)
+============================================================================*/
+
+#ifndef TOUCH_KEY_H
+#define TOUCH_KEY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*----------------------------------------------------------------------------
+ *     include files
+ *----------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "touch.h"
+
+#if DEF_TOUCH_KEY_OPEN == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *----------------------------------------------------------------------------*/
+
+/* Measurements of the key calibration. The reference follows the signal for
+ * the first ones and then steps towards it by one count for the last
+ * TOUCH_KEY_CAL_TRACK ones. */
+#define TOUCH_KEY_CAL_COUNT 8u
+#define TOUCH_KEY_CAL_TRACK 4u
+
+/* Version reported by qtm_get_touch_keys_module_ver(), the library replaced */
+#define TOUCH_KEY_MODULE_VER 0x14u
+
+/*----------------------------------------------------------------------------
+ *     global variables
+ *----------------------------------------------------------------------------*/
+
+/* Milli seconds passed to qtm_update_qtlib_timer(), wrapping. Same name as in
+ * the library, a replay clears it to start again from time 0. */
+extern volatile uint16_t qtm_local_ms_timecount;
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif /* TOUCH_KEY_H */
@@ -0,0 +1,229 @@
+/*============================================================================
+Filename : touch_profile.c
+Project : QTouch Modular Library
+Purpose : Time of each stage of the touch scan pipeline, counted by TCB0
+
+------------------------------------------------------------------------------
+TCB0 runs free in periodic interrupt mode at CLK_PER / 2 with CCMP at 0xFFFF,
+and its interrupt at each wrap extends the count to 32 bits. touch.c marks the
+begin and end of each stage with it; per stage the number of samples, the
+shortest, the longest and the sum are kept until they are read, which starts
+them again. The datastreamer sends them in profile frames, one stage per
+frame.
+
+The wrap interrupt also samples the interrupt entry latency: the counts from
+the wrap to the first instruction of the handler body. That is the interrupt
+response and the handler prologue, plus any time spent with interrupts
+disabled or in another handler, at points unrelated to the scan.
+
+Times include the interrupts serviced during the stage. TCB0 stops in
+standby, which no stage spans: the device only sleeps in Idle while a
+measurement or its post processing is pending.
+
+The module bus times its pulses with TCB0 as well, only one of them can be
+enabled.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include "touch_profile.h"
+#include "driver_init.h"
+#include "module_bus.h"
+#include "atomic.h"
+
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+
+#if MODULE_BUS_ENABLE == 1
+#error "The profiler and the module bus both need TCB0, disable MODULE_BUS_ENABLE."
+#endif
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+
+/* Upper 16 bits of the count */
+static volatile uint16_t touch_profile_overflows;
+
+/* Count at the begin of each stage */
+static uint32_t touch_profile_begin_count[TOUCH_PROFILE_STAGES];
+
+static struct touch_profile_stat touch_profile_stats[TOUCH_PROFILE_STAGES];
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static uint32_t touch_profile_read(void);
+static void     touch_profile_record(enum touch_profile_stage stage, uint32_t counts);
+static void     touch_profile_clear(enum touch_profile_stage stage);
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+void touch_profile_init(void)
+------------------------------------------------------------------------------
+Purpose: Starts TCB0 counting and clears the statistics
+Input  : none
+Output : none
+Notes  :
+============================================================================*/
+void touch_profile_init(void)
+{
+	uint8_t stage;
+
+	TCB0.CTRLA    = 0;
+	TCB0.CTRLB    = TCB_CNTMODE_INT_gc;
+	TCB0.CCMP     = 0xFFFFu;
+	TCB0.CNT      = 0;
+	TCB0.INTFLAGS = TCB_CAPT_bm;
+	TCB0.INTCTRL  = TCB_CAPT_bm;
+	TCB0.CTRLA    = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+
+	touch_profile_overflows = 0u;
+	for (stage = 0u; stage < TOUCH_PROFILE_STAGES; stage++) {
+		touch_profile_clear((enum touch_profile_stage)stage);
+	}
+}
+
+/*============================================================================
+static uint32_t touch_profile_read(void)
+------------------------------------------------------------------------------
+Purpose: 32-bit count
+Input  : none
+Output : Count
+Notes  : Call with interrupts disabled. A wrap whose interrupt has not run
+         yet is counted here. The flag is read after CNT, so with the flag
+         set a small count is past the wrap and a large one before it.
+============================================================================*/
+static uint32_t touch_profile_read(void)
+{
+	uint16_t overflows = touch_profile_overflows;
+	uint16_t count     = TCB0.CNT;
+	uint8_t  flags     = TCB0.INTFLAGS;
+
+	if ((flags & TCB_CAPT_bm) && (count < 0x8000u)) {
+		overflows++;
+	}
+
+	return ((uint32_t)overflows << 16) | count;
+}
+
+/*============================================================================
+static void touch_profile_record(enum touch_profile_stage stage, uint32_t counts)
+------------------------------------------------------------------------------
+Purpose: Adds a sample to the statistics of a stage
+Input  : Stage, time in counts
+Output : none
+Notes  : Call with interrupts disabled
+============================================================================*/
+static void touch_profile_record(enum touch_profile_stage stage, uint32_t counts)
+{
+	struct touch_profile_stat *stat = &touch_profile_stats[stage];
+
+	if (counts < stat->min) {
+		stat->min = counts;
+	}
+	if (counts > stat->max) {
+		stat->max = counts;
+	}
+	if ((stat->count != UINT16_MAX) && ((uint32_t)(stat->sum + counts) >= stat->sum)) {
+		stat->sum += counts;
+		stat->count++;
+	}
+}
+
+/*============================================================================
+static void touch_profile_clear(enum touch_profile_stage stage)
+------------------------------------------------------------------------------
+Purpose: Starts the statistics of a stage again
+Input  : Stage
+Output : none
+Notes  :
+============================================================================*/
+static void touch_profile_clear(enum touch_profile_stage stage)
+{
+	struct touch_profile_stat *stat = &touch_profile_stats[stage];
+
+	stat->count = 0u;
+	stat->min   = UINT32_MAX;
+	stat->max   = 0u;
+	stat->sum   = 0u;
+}
+
+/*============================================================================
+void touch_profile_begin(enum touch_profile_stage stage)
+------------------------------------------------------------------------------
+Purpose: Marks the begin of a stage
+Input  : Stage
+Output : none
+Notes  : TOUCH_PROFILE_PENDING and TOUCH_PROFILE_CYCLE begin with the end of
+         TOUCH_PROFILE_ACQUISITION, so a measurement started before the
+         previous one is processed does not move them.
+============================================================================*/
+void touch_profile_begin(enum touch_profile_stage stage)
+{
+	ENTER_CRITICAL(P);
+	touch_profile_begin_count[stage] = touch_profile_read();
+	EXIT_CRITICAL(P);
+}
+
+/*============================================================================
+void touch_profile_end(enum touch_profile_stage stage)
+------------------------------------------------------------------------------
+Purpose: Marks the end of a stage and adds its time to the statistics
+Input  : Stage
+Output : none
+Notes  :
+============================================================================*/
+void touch_profile_end(enum touch_profile_stage stage)
+{
+	uint32_t now;
+
+	ENTER_CRITICAL(P);
+	now = touch_profile_read();
+	touch_profile_record(stage, now - touch_profile_begin_count[stage]);
+	if (stage == TOUCH_PROFILE_ACQUISITION) {
+		touch_profile_begin_count[TOUCH_PROFILE_PENDING] = now;
+		touch_profile_begin_count[TOUCH_PROFILE_CYCLE]   = touch_profile_begin_count[stage];
+	}
+	EXIT_CRITICAL(P);
+}
+
+/*============================================================================
+void touch_profile_get(enum touch_profile_stage stage, struct touch_profile_stat *stat)
+------------------------------------------------------------------------------
+Purpose: Reads the statistics of a stage and starts them again
+Input  : Stage
+Output : Statistics since the last read, min is UINT32_MAX without samples
+Notes  :
+============================================================================*/
+void touch_profile_get(enum touch_profile_stage stage, struct touch_profile_stat *stat)
+{
+	ENTER_CRITICAL(P);
+	*stat = touch_profile_stats[stage];
+	touch_profile_clear(stage);
+	EXIT_CRITICAL(P);
+}
+
+/*============================================================================
+ISR(TCB0_INT_vect)
+------------------------------------------------------------------------------
+Purpose:  Interrupt handler for the TCB0 wrap
+Input    :  none
+Output  :  none
+Notes    :  CNT is 0 one count after the wrap, the latency is CNT + 1
+============================================================================*/
+ISR(TCB0_INT_vect)
+{
+	uint16_t latency = TCB0.CNT + 1u;
+
+	/* Interrupt flag has to be cleared manually */
+	TCB0.INTFLAGS = TCB_CAPT_bm;
+	touch_profile_overflows++;
+
+	touch_profile_record(TOUCH_PROFILE_LATENCY, latency);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*============================================================================
+Filename : touch_profile.h
+Project : QTouch Modular Library
+Purpose : Time of each stage of the touch scan pipeline, counted by TCB0
+============================================================================*/
+
+#ifndef TOUCH_PROFILE_H
+#define TOUCH_PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*----------------------------------------------------------------------------
+ *     include files
+ *----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <clock_config.h>
+
+#include "touch.h"
+
+#if DEF_TOUCH_PROFILE_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *----------------------------------------------------------------------------*/
+
+/* TCB0 counts per us, it counts CLK_PER / 2 */
+#define TOUCH_PROFILE_COUNTS_PER_US ((uint8_t)(F_CPU / 2000000ul))
+
+/*----------------------------------------------------------------------------
+ *     type definitions
+ *----------------------------------------------------------------------------*/
+
+/* Stages of the scan pipeline, in the order of the datastreamer profile
+ * frames */
+enum touch_profile_stage {
+	TOUCH_PROFILE_ACQUISITION, /* qtm_ptc_start_measurement_seq() to qtm_measure_complete_callback() */
+	TOUCH_PROFILE_EOC,         /* qtm_t81x_ptc_handler_eoc() in ADC0_RESRDY_vect */
+	TOUCH_PROFILE_PENDING,     /* qtm_measure_complete_callback() to the post processing */
+	TOUCH_PROFILE_ACQ_PROCESS, /* qtm_acquisition_process() */
+	TOUCH_PROFILE_KEY_PROCESS, /* qtm_key_sensors_process() */
+	TOUCH_PROFILE_OUTPUT,      /* datastreamer_output() */
+	TOUCH_PROFILE_CYCLE,       /* Start of the measurement to the end of its output */
+	TOUCH_PROFILE_LATENCY,     /* Interrupt entry latency */
+	TOUCH_PROFILE_STAGES
+};
+
+/* Times of one stage in TCB0 counts. The sum stops at the first sample that
+ * would overflow it, count and sum give the mean of the samples before. */
+struct touch_profile_stat {
+	uint16_t count;
+	uint32_t min;
+	uint32_t max;
+	uint32_t sum;
+};
+
+/*----------------------------------------------------------------------------
+ *     prototypes
+ *----------------------------------------------------------------------------*/
+
+void touch_profile_init(void);
+void touch_profile_begin(enum touch_profile_stage stage);
+void touch_profile_end(enum touch_profile_stage stage);
+void touch_profile_get(enum touch_profile_stage stage, struct touch_profile_stat *stat);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // TOUCH_PROFILE_H
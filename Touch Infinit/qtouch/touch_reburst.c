@@ -0,0 +1,270 @@
+/*============================================================================
+Filename : touch_reburst.c
+Project : QTouch Modular Library
+Purpose : Reburst of only the nodes whose keys filter in or out
+
+------------------------------------------------------------------------------
+While a key filters in or out, the key module requests a reburst and
+touch_process() measures again at once, DEF_TOUCH_DET_INT times for a touch.
+The sequence of acquisition set 1 walks all of its nodes for each of them,
+the ones REBURST_UNRESOLVED has disabled included.
+
+Here a reburst measures a second acquisition set instead, filled at the start
+of the measurement with the configuration and data of the nodes whose keys
+are in Filter In or Filter Out, and of the other keys of their AKS groups. Its
+nodes are nodes of set 1, whose pins qtm_ptc_init_acquisition_module() has
+assigned. After qtm_acquisition_process() their signals are copied back to set
+1, so the frequency hop median and the key module find them where they always
+are. The frequency hop median takes only these nodes then, see
+touch_reburst_get_measured(). The raw signals of the set go to a buffer of
+their own, the library stores them by the position of the node in the set it
+measures.
+
+All nodes are measured instead when more than DEF_TOUCH_REBURST_NODES keys
+filter, while a node calibrates or a key is in Anti-Touch, and with another
+reburst mode than REBURST_UNRESOLVED.
+
+When a key enters detect, the reburst measurements since the last measurement
+without a reburst request are counted for its touch.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include "touch_reburst.h"
+
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+
+_Static_assert((DEF_TOUCH_REBURST_NODES >= 1u) && (DEF_TOUCH_REBURST_NODES <= DEF_NUM_CHANNELS),
+               "DEF_TOUCH_REBURST_NODES must be 1 to DEF_NUM_CHANNELS");
+_Static_assert(DEF_NUM_SENSORS <= 16u, "The detect states of the keys are kept in 16 bits");
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+extern uint16_t                     touch_acq_signals_raw[DEF_NUM_CHANNELS];
+extern qtm_acq_node_group_config_t  ptc_qtlib_acq_gen1;
+extern qtm_acq_node_data_t          ptc_qtlib_node_stat1[DEF_NUM_CHANNELS];
+extern qtm_acq_t81x_node_config_t   ptc_seq_node_cfg1[DEF_NUM_CHANNELS];
+extern qtm_acquisition_control_t    qtlib_acq_set1;
+extern qtm_touch_key_group_config_t qtlib_key_grp_config_set1;
+extern qtm_touch_key_group_data_t   qtlib_key_grp_data_set1;
+extern qtm_touch_key_data_t         qtlib_key_data_set1[DEF_NUM_SENSORS];
+extern qtm_touch_key_config_t       qtlib_key_configs_set1[DEF_NUM_SENSORS];
+
+/* Set of the next reburst, the number of nodes is set at its start */
+static qtm_acq_node_group_config_t touch_reburst_gen
+    = {0u, DEF_SENSOR_TYPE, DEF_PTC_CAL_AUTO_TUNE, DEF_SEL_FREQ_INIT};
+static qtm_acq_t81x_node_config_t touch_reburst_cfg[DEF_TOUCH_REBURST_NODES];
+static qtm_acq_node_data_t        touch_reburst_data[DEF_TOUCH_REBURST_NODES];
+static uint16_t                   touch_reburst_raw[DEF_TOUCH_REBURST_NODES];
+static qtm_acquisition_control_t  touch_reburst_set
+    = {&touch_reburst_gen, &touch_reburst_cfg[0], &touch_reburst_data[0]};
+
+/* Nodes of set 1 in the set of the next reburst, none for all nodes */
+static uint8_t touch_reburst_nodes[DEF_TOUCH_REBURST_NODES];
+static uint8_t touch_reburst_count;
+
+/* Nodes of the last measurement merged into set 1, none for all nodes */
+static uint8_t touch_reburst_merged;
+
+/* Reburst measurements since the last one without a reburst request */
+static uint8_t touch_reburst_run;
+
+/* Keys in detect at the last key processing, one bit per key */
+static uint16_t touch_reburst_touched;
+
+static struct touch_reburst_stats touch_reburst_stats_data;
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static uint8_t touch_reburst_select(void);
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+qtm_acquisition_control_t *touch_reburst_acq_set(void)
+------------------------------------------------------------------------------
+Purpose: Returns the acquisition set of the next measurement
+Input  : none
+Output : Set of the filtering nodes for a selective reburst, else set 1
+Notes  : Call right before qtm_ptc_start_measurement_seq(). The nodes are
+         copied from set 1 then, with any change made to them since the keys
+         were processed.
+============================================================================*/
+qtm_acquisition_control_t *touch_reburst_acq_set(void)
+{
+	uint8_t i;
+	uint8_t node;
+
+	if (touch_reburst_count == 0u) {
+		return &qtlib_acq_set1;
+	}
+
+	for (i = 0u; i < touch_reburst_count; i++) {
+		node                  = touch_reburst_nodes[i];
+		touch_reburst_cfg[i]  = ptc_seq_node_cfg1[node];
+		touch_reburst_data[i] = ptc_qtlib_node_stat1[node];
+	}
+	touch_reburst_gen.num_sensor_nodes   = touch_reburst_count;
+	touch_reburst_gen.freq_option_select = ptc_qtlib_acq_gen1.freq_option_select;
+	qtm_ptc_qtlib_assign_signal_memory(&touch_reburst_raw[0]);
+
+	return &touch_reburst_set;
+}
+
+/*============================================================================
+void touch_reburst_merge(void)
+------------------------------------------------------------------------------
+Purpose: Copies the signals of a selective reburst back to set 1
+Input  : none
+Output : none
+Notes  : Call after qtm_acquisition_process(). The nodes do not calibrate in
+         a selective reburst, only their signals change. The next measurement
+         is of all nodes unless touch_reburst_update() selects others.
+============================================================================*/
+void touch_reburst_merge(void)
+{
+	uint8_t i;
+
+	touch_reburst_merged = touch_reburst_count;
+	if (touch_reburst_count == 0u) {
+		return;
+	}
+
+	for (i = 0u; i < touch_reburst_count; i++) {
+		ptc_qtlib_node_stat1[touch_reburst_nodes[i]].node_acq_signals = touch_reburst_data[i].node_acq_signals;
+	}
+	qtm_ptc_qtlib_assign_signal_memory(&touch_acq_signals_raw[0]);
+	touch_reburst_count = 0u;
+}
+
+/*============================================================================
+uint8_t touch_reburst_get_measured(const uint8_t **nodes)
+------------------------------------------------------------------------------
+Purpose: Returns the nodes of set 1 that the last measurement measured
+Input  : Pointer to set to the nodes
+Output : Number of nodes, 0 for all nodes
+Notes  : Valid from touch_reburst_merge() until touch_reburst_update()
+         selects the nodes of the next reburst.
+============================================================================*/
+uint8_t touch_reburst_get_measured(const uint8_t **nodes)
+{
+	*nodes = &touch_reburst_nodes[0];
+
+	return touch_reburst_merged;
+}
+
+/*============================================================================
+void touch_reburst_update(void)
+------------------------------------------------------------------------------
+Purpose: Counts the rebursts of the keys that entered detect and selects the
+         nodes of the next reburst
+Input  : none
+Output : none
+Notes  : Call after qtm_key_sensors_process().
+============================================================================*/
+void touch_reburst_update(void)
+{
+	uint16_t touched = 0u;
+	uint16_t entered;
+	uint16_t key;
+
+	for (key = 0u; key < DEF_NUM_SENSORS; key++) {
+		if (qtlib_key_data_set1[key].sensor_state & KEY_TOUCHED_MASK) {
+			touched |= (uint16_t)(1u << key);
+		}
+	}
+	entered               = touched & (uint16_t)~touch_reburst_touched;
+	touch_reburst_touched = touched;
+
+	for (; entered != 0u; entered &= (uint16_t)(entered - 1u)) {
+		touch_reburst_stats_data.touches++;
+		touch_reburst_stats_data.cycles += touch_reburst_run;
+		if (touch_reburst_run > touch_reburst_stats_data.max_cycles) {
+			touch_reburst_stats_data.max_cycles = touch_reburst_run;
+		}
+	}
+
+	if (!(qtlib_key_grp_data_set1.qtm_keys_status & QTM_KEY_REBURST)) {
+		touch_reburst_run = 0u;
+		return;
+	}
+
+	if (touch_reburst_run != UINT8_MAX) {
+		touch_reburst_run++;
+	}
+	touch_reburst_count = touch_reburst_select();
+	if (touch_reburst_count != 0u) {
+		touch_reburst_stats_data.selective++;
+	} else {
+		touch_reburst_stats_data.full++;
+	}
+}
+
+/*============================================================================
+static uint8_t touch_reburst_select(void)
+------------------------------------------------------------------------------
+Purpose: Selects the nodes of the next reburst
+Input  : none
+Output : Number of nodes, 0 for a measurement of all nodes
+Notes  : Key n is bound to node n.
+============================================================================*/
+static uint8_t touch_reburst_select(void)
+{
+	uint8_t  groups = 0u;
+	uint8_t  count  = 0u;
+	uint8_t  state;
+	uint8_t  aks;
+	uint16_t key;
+
+	if (qtlib_key_grp_config_set1.sensor_reburst_mode != REBURST_UNRESOLVED) {
+		return 0u;
+	}
+
+	/* AKS groups of the filtering keys */
+	for (key = 0u; key < DEF_NUM_SENSORS; key++) {
+		state = qtlib_key_data_set1[key].sensor_state;
+		if ((state == QTM_KEY_STATE_INIT) || (state == QTM_KEY_STATE_CAL) || (state == QTM_KEY_STATE_ANTI_TCH)
+		    || (ptc_qtlib_node_stat1[key].node_acq_status & NODE_CAL_REQ)) {
+			return 0u;
+		}
+		aks = qtlib_key_configs_set1[key].channel_aks_group;
+		if (((state == QTM_KEY_STATE_FILT_IN) || (state == QTM_KEY_STATE_FILT_OUT)) && (aks != NO_AKS_GROUP)) {
+			groups |= (uint8_t)(1u << (aks - 1u));
+		}
+	}
+
+	for (key = 0u; key < DEF_NUM_SENSORS; key++) {
+		state = qtlib_key_data_set1[key].sensor_state;
+		aks   = qtlib_key_configs_set1[key].channel_aks_group;
+		if ((state == QTM_KEY_STATE_FILT_IN) || (state == QTM_KEY_STATE_FILT_OUT)
+		    || ((aks != NO_AKS_GROUP) && (groups & (1u << (aks - 1u))) && (state != QTM_KEY_STATE_SUSPEND)
+		        && (state != QTM_KEY_STATE_DISABLE))) {
+			if (count == DEF_TOUCH_REBURST_NODES) {
+				return 0u;
+			}
+			touch_reburst_nodes[count++] = (uint8_t)key;
+		}
+	}
+
+	return count;
+}
+
+/*============================================================================
+void touch_reburst_get_stats(struct touch_reburst_stats *stats)
+------------------------------------------------------------------------------
+Purpose: Returns the reburst counts
+Input  : Counts to fill
+Output : none
+Notes  : The mean rebursts per touch is cycles / touches.
+============================================================================*/
+void touch_reburst_get_stats(struct touch_reburst_stats *stats)
+{
+	*stats = touch_reburst_stats_data;
+}
+
+#endif
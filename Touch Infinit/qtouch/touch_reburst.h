@@ -0,0 +1,52 @@
+/*============================================================================
+Filename : touch_reburst.h
+Project : QTouch Modular Library
+Purpose : Reburst of only the nodes whose keys filter in or out
+============================================================================*/
+
+#ifndef TOUCH_REBURST_H
+#define TOUCH_REBURST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*----------------------------------------------------------------------------
+ *     include files
+ *----------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "touch.h"
+
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+
+/*----------------------------------------------------------------------------
+ *     type definitions
+ *----------------------------------------------------------------------------*/
+
+/* Reburst counts, they wrap */
+struct touch_reburst_stats {
+	uint16_t touches;    /* Keys that entered detect */
+	uint16_t cycles;     /* Reburst measurements before they did */
+	uint8_t  max_cycles; /* Most reburst measurements before one of them */
+	uint16_t selective;  /* Reburst measurements of the filtering nodes only */
+	uint16_t full;       /* Reburst measurements of all nodes */
+};
+
+/*----------------------------------------------------------------------------
+ *     prototypes
+ *----------------------------------------------------------------------------*/
+
+qtm_acquisition_control_t *touch_reburst_acq_set(void);
+void                       touch_reburst_merge(void);
+uint8_t                    touch_reburst_get_measured(const uint8_t **nodes);
+void                       touch_reburst_update(void);
+void                       touch_reburst_get_stats(struct touch_reburst_stats *stats);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // TOUCH_REBURST_H
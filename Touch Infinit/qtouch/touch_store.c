@@ -0,0 +1,379 @@
+/*============================================================================
+Filename : touch_store.c
+Project : QTouch Modular Library
+Purpose : Persistent touch settings, calibration values and relay states in
+          EEPROM
+
+------------------------------------------------------------------------------
+The EEPROM holds TOUCH_STORE_SLOTS copies of struct touch_store_record, each
+in whole pages. Each change is written to the slot after the newest one, so
+the pages wear evenly and an interrupted write leaves the previous record
+intact. At start up the valid record with the highest sequence number is
+used; a record is valid if its version, channel count and CRC-16 match.
+
+Records are only written when the settings differ from the newest record, so
+a steady device does not write at all. Compensation capacitance values are
+taken once all keys are calibrated, key references of keys in No Detect
+when they have drifted by more than half the key threshold. Nothing is written
+while the supply is low, when a brown-out reset could cut the write short.
+============================================================================*/
+
+/*----------------------------------------------------------------------------
+  include files
+----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "touch_store.h"
+#include "driver_init.h"
+#include "supply_monitor.h"
+
+#if DEF_TOUCH_STORE_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *--------------------------------------------------------------------------*/
+/* No valid record found */
+#define TOUCH_STORE_NO_SLOT 0xFFu
+
+/* Bytes compared to detect a change, from num_channels up to the references */
+#define TOUCH_STORE_COMPARE_OFFSET offsetof(struct touch_store_record, num_channels)
+#define TOUCH_STORE_COMPARE_SIZE (offsetof(struct touch_store_record, reference) - TOUCH_STORE_COMPARE_OFFSET)
+
+_Static_assert(TOUCH_STORE_SLOTS >= 2u, "touch store record needs at least two EEPROM slots");
+_Static_assert(MAX_HYST <= (1u << TOUCH_STORE_HYST_BITS), "hysteresis settings do not fit the record");
+
+/*----------------------------------------------------------------------------
+  global variables
+----------------------------------------------------------------------------*/
+extern qtm_touch_key_group_config_t qtlib_key_grp_config_set1;
+extern qtm_touch_key_config_t       qtlib_key_configs_set1[DEF_NUM_SENSORS];
+
+extern uint8_t  touch_fast_period_ms;
+extern uint8_t  touch_idle_period_ms;
+extern uint16_t touch_idle_timeout_ms;
+
+/* Slot and sequence number of the newest record */
+static uint8_t touch_store_slot = TOUCH_STORE_NO_SLOT;
+static uint8_t touch_store_sequence;
+
+/* Pages of the next record written so far */
+static uint8_t touch_store_page;
+
+static uint16_t touch_store_relays;
+
+/*----------------------------------------------------------------------------
+  prototypes
+----------------------------------------------------------------------------*/
+static uint16_t touch_store_crc(const struct touch_store_record *record);
+static uint16_t touch_store_read_word(uint8_t offset);
+static void     touch_store_capture(struct touch_store_record *record);
+static uint8_t  touch_store_changed(const struct touch_store_record *record);
+
+/*----------------------------------------------------------------------------
+ *   function definitions
+ *--------------------------------------------------------------------------*/
+
+/*============================================================================
+static uint16_t touch_store_crc(const struct touch_store_record *record)
+------------------------------------------------------------------------------
+Purpose: CRC-16 of a record
+Input  : Record
+Output : CRC-16 of all bytes before the crc member
+Notes  :
+============================================================================*/
+static uint16_t touch_store_crc(const struct touch_store_record *record)
+{
+	const uint8_t *data = (const uint8_t *)record;
+	uint16_t       crc  = 0xFFFFu;
+	uint8_t        i;
+
+	for (i = 0u; i < offsetof(struct touch_store_record, crc); i++) {
+		crc = _crc16_update(crc, data[i]);
+	}
+
+	return crc;
+}
+
+/*============================================================================
+static uint16_t touch_store_read_word(uint8_t offset)
+------------------------------------------------------------------------------
+Purpose: Reads a 16-bit member of the newest record
+Input  : Offset of the member in the record
+Output : Value of the member, 0 if there is no record
+Notes  : Do not call while the EEPROM is being written.
+============================================================================*/
+static uint16_t touch_store_read_word(uint8_t offset)
+{
+	uint16_t value;
+
+	if (touch_store_slot == TOUCH_STORE_NO_SLOT) {
+		return 0u;
+	}
+
+	FLASH_read_eeprom_block(touch_store_slot * TOUCH_STORE_SLOT_SIZE + offset, (uint8_t *)&value, sizeof(value));
+
+	return value;
+}
+
+/*============================================================================
+static void touch_store_capture(struct touch_store_record *record)
+------------------------------------------------------------------------------
+Purpose: Fills a record with the current settings
+Input  : Record to fill
+Output : none
+Notes  : While the keys are calibrating the compensation capacitance values
+         and references of the newest record are kept, as well as the
+         reference of a key that is not in No Detect. The sequence number and
+         CRC are not set.
+============================================================================*/
+static void touch_store_capture(struct touch_store_record *record)
+{
+	uint16_t node;
+
+	memset(record, 0, sizeof(*record));
+	record->version      = TOUCH_STORE_VERSION;
+	record->num_channels = DEF_NUM_CHANNELS;
+	record->relays       = touch_store_relays;
+
+	for (node = 0u; node < DEF_NUM_SENSORS; node++) {
+		record->threshold[node] = qtlib_key_configs_set1[node].channel_threshold;
+		record->hysteresis[(node * TOUCH_STORE_HYST_BITS) >> 3u]
+		    |= (uint8_t)((qtlib_key_configs_set1[node].channel_hysteresis & TOUCH_STORE_HYST_MASK)
+		                 << ((node * TOUCH_STORE_HYST_BITS) & 7u));
+	}
+
+	record->touch_di              = qtlib_key_grp_config_set1.sensor_touch_di;
+	record->touch_drift_rate      = qtlib_key_grp_config_set1.sensor_touch_drift_rate;
+	record->anti_touch_drift_rate = qtlib_key_grp_config_set1.sensor_anti_touch_drift_rate;
+	record->drift_hold_time       = qtlib_key_grp_config_set1.sensor_drift_hold_time;
+	record->fast_period_ms        = touch_fast_period_ms;
+	record->idle_period_ms        = touch_idle_period_ms;
+	record->idle_timeout_ms       = touch_idle_timeout_ms;
+
+	if (touch_keys_calibrated()) {
+		for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+			record->comp_caps[node] = get_sensor_cc_val(node);
+		}
+	} else {
+		for (node = 0u; node < DEF_NUM_CHANNELS; node++) {
+			record->comp_caps[node] = touch_store_get_comp_caps(node);
+		}
+	}
+
+	for (node = 0u; node < DEF_NUM_SENSORS; node++) {
+		if (touch_keys_calibrated() && (get_sensor_state(node) == QTM_KEY_STATE_NO_DET)) {
+			record->reference[node] = get_sensor_node_reference(node);
+		} else {
+			record->reference[node] = touch_store_get_reference(node);
+		}
+	}
+}
+
+/*============================================================================
+static uint8_t touch_store_changed(const struct touch_store_record *record)
+------------------------------------------------------------------------------
+Purpose: Compares a captured record with the newest record
+Input  : Captured record
+Output : 1 if the record has to be written
+Notes  : References only count as changed when they differ by more than half
+         the key threshold, so drift alone rarely causes a write.
+============================================================================*/
+static uint8_t touch_store_changed(const struct touch_store_record *record)
+{
+	uint8_t sensor;
+	int16_t drift;
+
+	if ((touch_store_slot == TOUCH_STORE_NO_SLOT)
+	    || (memcmp((const uint8_t *)record + TOUCH_STORE_COMPARE_OFFSET,
+	               FLASH_eeprom_map(touch_store_slot * TOUCH_STORE_SLOT_SIZE + TOUCH_STORE_COMPARE_OFFSET),
+	               TOUCH_STORE_COMPARE_SIZE)
+	        != 0)) {
+		return 1u;
+	}
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		drift = (int16_t)(record->reference[sensor] - touch_store_get_reference(sensor));
+		if ((drift > (int16_t)(record->threshold[sensor] >> 1u)) || (-drift > (int16_t)(record->threshold[sensor] >> 1u))) {
+			return 1u;
+		}
+	}
+
+	return 0u;
+}
+
+/*============================================================================
+uint8_t touch_store_load(void)
+------------------------------------------------------------------------------
+Purpose: Finds the newest valid record and applies its settings
+Input  : none
+Output : 1 if a record was found, 0 if the defaults are kept
+Notes  : Called from touch_sensors_config() before the nodes are calibrated.
+         The compensation capacitance values and references are read back
+         with touch_store_get_comp_caps() and touch_store_get_reference().
+============================================================================*/
+uint8_t touch_store_load(void)
+{
+	struct touch_store_record record;
+	uint8_t                   slot;
+	uint8_t                   sensor;
+
+	touch_store_slot = TOUCH_STORE_NO_SLOT;
+
+	for (slot = 0u; slot < TOUCH_STORE_SLOTS; slot++) {
+		FLASH_read_eeprom_block(slot * TOUCH_STORE_SLOT_SIZE, (uint8_t *)&record, sizeof(record));
+		if ((record.version != TOUCH_STORE_VERSION) || (record.num_channels != DEF_NUM_CHANNELS)
+		    || (record.crc != touch_store_crc(&record))) {
+			continue;
+		}
+		/* Sequence numbers of the slots are within TOUCH_STORE_SLOTS of each other */
+		if ((touch_store_slot == TOUCH_STORE_NO_SLOT) || ((int8_t)(record.sequence - touch_store_sequence) > 0)) {
+			touch_store_slot     = slot;
+			touch_store_sequence = record.sequence;
+		}
+	}
+
+	if (touch_store_slot == TOUCH_STORE_NO_SLOT) {
+		return 0u;
+	}
+
+	FLASH_read_eeprom_block(touch_store_slot * TOUCH_STORE_SLOT_SIZE, (uint8_t *)&record, sizeof(record));
+
+	for (sensor = 0u; sensor < DEF_NUM_SENSORS; sensor++) {
+		if (record.threshold[sensor] != 0u) {
+			qtlib_key_configs_set1[sensor].channel_threshold = record.threshold[sensor];
+		}
+		qtlib_key_configs_set1[sensor].channel_hysteresis
+		    = (record.hysteresis[(sensor * TOUCH_STORE_HYST_BITS) >> 3u] >> ((sensor * TOUCH_STORE_HYST_BITS) & 7u))
+		      & TOUCH_STORE_HYST_MASK;
+	}
+
+	qtlib_key_grp_config_set1.sensor_touch_di              = record.touch_di;
+	qtlib_key_grp_config_set1.sensor_touch_drift_rate      = record.touch_drift_rate;
+	qtlib_key_grp_config_set1.sensor_anti_touch_drift_rate = record.anti_touch_drift_rate;
+	qtlib_key_grp_config_set1.sensor_drift_hold_time       = record.drift_hold_time;
+	touch_set_scan_rate(record.fast_period_ms, record.idle_period_ms, record.idle_timeout_ms);
+
+	touch_store_relays = record.relays;
+
+	return 1u;
+}
+
+/*============================================================================
+void touch_store_process(void)
+------------------------------------------------------------------------------
+Purpose: Writes a new record when the settings have changed
+Input  : none
+Output : none
+Notes  : Called from touch_process() after the key processing. Each call
+         starts at most one page write, which runs in the background; while
+         the EEPROM is busy, the keys calibrate or the supply is low the call
+         returns at once, so a calibration after reset writes one record. The
+         pages of a record spanning several pages are captured again for each
+         page, a change in between leaves a record with a bad CRC that load
+         skips.
+============================================================================*/
+void touch_store_process(void)
+{
+	struct touch_store_record record;
+	uint8_t                   slot;
+	uint8_t                   offset;
+	uint8_t                   size;
+
+	if (!FLASH_is_eeprom_ready() || !touch_keys_calibrated() || supply_monitor_is_low()) {
+		return;
+	}
+
+	touch_store_capture(&record);
+
+	if ((touch_store_page == 0u) && !touch_store_changed(&record)) {
+		return;
+	}
+
+	slot            = (touch_store_slot == TOUCH_STORE_NO_SLOT) ? 0u : (touch_store_slot + 1u) % TOUCH_STORE_SLOTS;
+	record.sequence = touch_store_sequence + 1u;
+	record.crc      = touch_store_crc(&record);
+
+	offset = touch_store_page * EEPROM_PAGE_SIZE;
+	size   = sizeof(record) - offset;
+	if (size > EEPROM_PAGE_SIZE) {
+		size = EEPROM_PAGE_SIZE;
+	}
+
+	if (FLASH_write_eeprom_page(slot * TOUCH_STORE_SLOT_SIZE + offset, (const uint8_t *)&record + offset, size)
+	    != NVM_OK) {
+		return;
+	}
+
+	if ((uint8_t)(offset + size) < sizeof(record)) {
+		touch_store_page++;
+	} else {
+		touch_store_page     = 0u;
+		touch_store_slot     = slot;
+		touch_store_sequence = record.sequence;
+	}
+}
+
+/*============================================================================
+uint16_t touch_store_get_comp_caps(uint16_t sensor_node)
+------------------------------------------------------------------------------
+Purpose: Returns the last good compensation capacitance value of a node
+Input  : Node number
+Output : Compensation capacitance value of the newest record, 0 if none
+Notes  : Do not call while the EEPROM is being written.
+============================================================================*/
+uint16_t touch_store_get_comp_caps(uint16_t sensor_node)
+{
+	if (sensor_node >= DEF_NUM_CHANNELS) {
+		return 0u;
+	}
+
+	return touch_store_read_word(offsetof(struct touch_store_record, comp_caps) + sensor_node * sizeof(uint16_t));
+}
+
+/*============================================================================
+uint16_t touch_store_get_reference(uint16_t sensor_node)
+------------------------------------------------------------------------------
+Purpose: Returns the key reference saved with the compensation capacitance
+         values
+Input  : Key number
+Output : Reference of the newest record, 0 if none
+Notes  : Do not call while the EEPROM is being written.
+============================================================================*/
+uint16_t touch_store_get_reference(uint16_t sensor_node)
+{
+	if (sensor_node >= DEF_NUM_SENSORS) {
+		return 0u;
+	}
+
+	return touch_store_read_word(offsetof(struct touch_store_record, reference) + sensor_node * sizeof(uint16_t));
+}
+
+/*============================================================================
+uint16_t touch_store_get_relays(void)
+------------------------------------------------------------------------------
+Purpose: Returns the relay states to restore at start up
+Input  : none
+Output : Bit n set: relay of sensor n on
+Notes  :
+============================================================================*/
+uint16_t touch_store_get_relays(void)
+{
+	return touch_store_relays;
+}
+
+/*============================================================================
+void touch_store_set_relays(uint16_t relays)
+------------------------------------------------------------------------------
+Purpose: Records the relay states
+Input  : Bit n set: relay of sensor n on
+Output : none
+Notes  : Written to the EEPROM by the next touch_store_process().
+============================================================================*/
+void touch_store_set_relays(uint16_t relays)
+{
+	touch_store_relays = relays;
+}
+
+#endif
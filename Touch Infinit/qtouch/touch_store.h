@@ -0,0 +1,87 @@
+/*============================================================================
+Filename : touch_store.h
+Project : QTouch Modular Library
+Purpose : Persistent touch settings, calibration values and relay states in
+          EEPROM
+============================================================================*/
+
+#ifndef TOUCH_STORE_H
+#define TOUCH_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*----------------------------------------------------------------------------
+ *     include files
+ *----------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include "touch.h"
+
+#if DEF_TOUCH_STORE_ENABLE == 1u
+
+/*----------------------------------------------------------------------------
+ *     defines
+ *----------------------------------------------------------------------------*/
+
+/* Layout version of struct touch_store_record, records of another version are
+ * ignored. Increment on any change of the record.
+ */
+#define TOUCH_STORE_VERSION 4u
+
+/* Hysteresis settings are below MAX_HYST, two bits each, so the record of a
+ * 9-gang panel takes two EEPROM pages */
+#define TOUCH_STORE_HYST_BITS 2u
+#define TOUCH_STORE_HYST_MASK ((1u << TOUCH_STORE_HYST_BITS) - 1u)
+#define TOUCH_STORE_HYST_BYTES ((DEF_NUM_SENSORS * TOUCH_STORE_HYST_BITS + 7u) / 8u)
+
+/*----------------------------------------------------------------------------
+ *     type definitions
+ *----------------------------------------------------------------------------*/
+
+/* Record as stored in a slot. The CRC-16 covers all bytes before it. */
+struct touch_store_record {
+	uint8_t  version;      /* TOUCH_STORE_VERSION */
+	uint8_t  sequence;     /* Incremented with each record written */
+	uint8_t  num_channels; /* DEF_NUM_CHANNELS of the firmware that wrote it */
+	uint16_t relays;       /* Bit n set: relay of sensor n on */
+	uint8_t  threshold[DEF_NUM_SENSORS];
+	uint8_t  hysteresis[TOUCH_STORE_HYST_BYTES]; /* Sensor n in bits 2n % 8 of byte 2n / 8 */
+	uint8_t  touch_di;
+	uint8_t  touch_drift_rate;
+	uint8_t  anti_touch_drift_rate;
+	uint8_t  drift_hold_time;
+	uint8_t  fast_period_ms;
+	uint8_t  idle_period_ms;
+	uint16_t idle_timeout_ms;
+	uint16_t comp_caps[DEF_NUM_CHANNELS]; /* Last good calibration, 0 if none */
+	uint16_t reference[DEF_NUM_SENSORS];  /* Key reference with these values */
+	uint16_t crc;
+};
+
+/* EEPROM space of one record, whole pages */
+#define TOUCH_STORE_SLOT_SIZE                                                                                          \
+	(((sizeof(struct touch_store_record) + EEPROM_PAGE_SIZE - 1u) / EEPROM_PAGE_SIZE) * EEPROM_PAGE_SIZE)
+
+/* Number of record slots, written in turn */
+#define TOUCH_STORE_SLOTS (EEPROM_SIZE / TOUCH_STORE_SLOT_SIZE)
+
+/*----------------------------------------------------------------------------
+ *     prototypes
+ *----------------------------------------------------------------------------*/
+
+uint8_t  touch_store_load(void);
+void     touch_store_process(void);
+uint16_t touch_store_get_comp_caps(uint16_t sensor_node);
+uint16_t touch_store_get_reference(uint16_t sensor_node);
+uint16_t touch_store_get_relays(void);
+void     touch_store_set_relays(uint16_t relays);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // TOUCH_STORE_H
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""Record the datastreamer output of a board as a touch capture for touch_replay.
+
+Data Visualizer and compact frames are both accepted, see
+datastreamer_UART_avr.c for the layouts.
+Frames are time stamped on reception, relative to the first frame. A raw
+dump of the USART output can be converted instead, with a fixed frame period.
+The capture format is described in sim_capture.h. Stage times sent in profile
+frames by firmware built with DEF_TOUCH_PROFILE_ENABLE are summed up per stage
+and printed at the end.
+
+    ds_capture.py --port /dev/ttyACM0 --output wet_panel.txt
+    ds_capture.py --input dump.bin --period 20 --output dump.txt
+"""
+
+import argparse
+import sys
+import time
+
+START_TOKEN = 0x55
+END_TOKEN = 0xAA
+NODE_BYTES = 10
+
+COMPACT_SYNC = 0xA5
+COMPACT_TYPE_SAMPLES = 0x00
+COMPACT_TYPE_INFO = 0x01
+COMPACT_TYPE_PROFILE = 0x04
+COMPACT_KEYFRAME = 0x10
+COMPACT_ERROR = 0x20
+COMPACT_HOP = 0x40
+COMPACT_VERSION = 1
+
+# enum touch_profile_stage of the firmware
+PROFILE_STAGES = ("acquisition", "eoc", "pending", "acq_process", "key_process",
+                  "output", "cycle", "latency")
+
+
+def crc8(data):
+    """CRC-8, polynomial 0x07, initial value 0."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def get_varint(payload, pos):
+    value = shift = 0
+    while True:
+        byte = payload[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+
+class Decoder:
+    """Datastreamer frame decoder for Data Visualizer and compact frames.
+
+    Compact frames are delta encoded, after a CRC error or a sequence gap they
+    are skipped until the next key frame. Their thresholds come from the
+    header frame and are 0 until one has been received. The frequency hop
+    bytes are checked and skipped, the capture does not keep them.
+    """
+
+    def __init__(self, num_nodes, hop_steps):
+        self.num_nodes = num_nodes
+        self.hop_steps = hop_steps
+        self.buf = bytearray()
+        self.synced = False
+        self.sequence = 0
+        self.last = [[0, 0, 0] for _ in range(num_nodes)]
+        self.thresholds = [0] * num_nodes
+        self.crc_errors = 0
+        # Per stage: samples, shortest, longest and summed time in us
+        self.profile = {}
+
+    def decode_dv(self):
+        length = 2 + NODE_BYTES * self.num_nodes + 1 + 2 * self.hop_steps + 2
+        buf = self.buf
+        if len(buf) < length:
+            return None, 0
+        if buf[length - 1] != END_TOKEN or buf[1] != buf[length - 2]:
+            return None, -1
+        nodes = []
+        for n in range(self.num_nodes):
+            p = 2 + NODE_BYTES * n
+            nodes.append((
+                buf[p] | buf[p + 1] << 8,          # signal
+                buf[p + 2] | buf[p + 3] << 8,      # reference
+                buf[p + 6] | buf[p + 7] << 8,      # cc
+                buf[p + 8],                        # state
+                buf[p + 9],                        # threshold
+            ))
+        return (buf[1], buf[2 + NODE_BYTES * self.num_nodes], nodes), length
+
+    def decode_compact(self):
+        buf = self.buf
+        if len(buf) < 2:
+            return None, 0
+        length = 4 + buf[1] + 1
+        if len(buf) < length:
+            return None, 0
+        if crc8(buf[1:length - 1]) != buf[length - 1]:
+            self.crc_errors += 1
+            self.synced = False
+            return None, -1
+        sequence, flags = buf[2], buf[3]
+        payload = bytes(buf[4:length - 1])
+        kind = flags & 0x0F
+        if kind == COMPACT_TYPE_INFO:
+            self.sequence = sequence
+            if (len(payload) == 2 + self.num_nodes and payload[0] == COMPACT_VERSION
+                    and payload[1] == self.num_nodes):
+                self.thresholds = list(payload[2:])
+            return None, length
+        if kind == COMPACT_TYPE_PROFILE:
+            self.decode_profile(payload)
+            return None, length
+        if kind != COMPACT_TYPE_SAMPLES:
+            return None, length
+        keyframe = bool(flags & COMPACT_KEYFRAME)
+        if not keyframe and (not self.synced or sequence != (self.sequence + 1) & 0xFF):
+            self.synced = False
+            return None, length
+        self.synced = False
+        self.sequence = sequence
+
+        bits = int.from_bytes(payload[:(2 * self.num_nodes + 7) // 8], "little")
+        pos = (2 * self.num_nodes + 7) // 8
+        error = 0
+        if flags & COMPACT_ERROR:
+            error = payload[pos]
+            pos += 1
+        nodes = []
+        try:
+            if flags & COMPACT_HOP:
+                pos += 1 + 2 * payload[pos]
+            for n in range(self.num_nodes):
+                count = 3 if bits >> (self.num_nodes + n) & 1 else 1
+                for i in range(count):
+                    value, pos = get_varint(payload, pos)
+                    if not keyframe:
+                        # Zigzag encoded difference
+                        value = (self.last[n][i] + ((value >> 1) ^ -(value & 1))) & 0xFFFF
+                    self.last[n][i] = value
+                signal, reference, cc = self.last[n]
+                nodes.append((signal, reference, cc, bits >> n & 1, self.thresholds[n]))
+        except IndexError:
+            return None, length
+        if pos != len(payload):
+            return None, length
+        self.synced = True
+        return (sequence, error, nodes), length
+
+    def decode_profile(self, payload):
+        if len(payload) < 2 or payload[0] == 0 or payload[1] >= len(PROFILE_STAGES):
+            return
+        counts_per_us, stage = payload[0], payload[1]
+        pos = 2
+        try:
+            samples, pos = get_varint(payload, pos)
+            values = []
+            for _ in range(3):
+                value, pos = get_varint(payload, pos)
+                values.append(value / counts_per_us)
+        except IndexError:
+            return
+        if pos != len(payload) or samples == 0:
+            return
+        low, high, mean = values
+        count, old_low, old_high, total = self.profile.get(stage, (0, low, high, 0.0))
+        self.profile[stage] = (count + samples, min(low, old_low), max(high, old_high),
+                               total + mean * samples)
+
+    def print_profile(self, file):
+        if not self.profile:
+            return
+        print("stage        samples    min us   mean us    max us", file=file)
+        for stage, (count, low, high, total) in sorted(self.profile.items()):
+            print("%-12s %7d %9.1f %9.1f %9.1f"
+                  % (PROFILE_STAGES[stage], count, low, total / count, high), file=file)
+
+    def put(self, byte):
+        """Feed one byte, return (sequence, error, nodes) or None."""
+        if not self.buf and byte not in (START_TOKEN, COMPACT_SYNC):
+            return None
+        self.buf.append(byte)
+        while self.buf:
+            if self.buf[0] == START_TOKEN:
+                frame, consumed = self.decode_dv()
+            else:
+                frame, consumed = self.decode_compact()
+            if consumed == 0:
+                return None
+            if consumed < 0:
+                # Not a frame, restart at the next start token
+                consumed = next((i for i in range(1, len(self.buf))
+                                 if self.buf[i] in (START_TOKEN, COMPACT_SYNC)), len(self.buf))
+            del self.buf[:consumed]
+            if frame is not None:
+                return frame
+        return None
+
+
+def decode(stream, num_nodes, hop_steps):
+    """Yield (sequence, error, nodes) for every frame in a byte iterator."""
+    decoder = Decoder(num_nodes, hop_steps)
+    for byte in stream:
+        frame = decoder.put(byte)
+        if frame is not None:
+            yield frame
+    if decoder.crc_errors:
+        print("%d CRC errors" % decoder.crc_errors, file=sys.stderr)
+    decoder.print_profile(sys.stderr)
+
+
+def serial_bytes(port, baud):
+    import serial
+
+    with serial.Serial(port, baud, timeout=1) as link:
+        while True:
+            for byte in link.read(link.in_waiting or 1):
+                yield byte
+
+
+def file_bytes(path):
+    with open(path, "rb") as dump:
+        yield from dump.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the board")
+    source.add_argument("--input", help="raw dump of the USART output")
+    parser.add_argument("--baud", type=int, default=38400)
+    parser.add_argument("--nodes", type=int, default=3,
+                        help="DEF_NUM_CHANNELS of the firmware")
+    parser.add_argument("--hop-steps", type=int, default=3,
+                        help="NUM_FREQ_STEPS of the firmware, 0 without frequency hop")
+    parser.add_argument("--period", type=int, default=20,
+                        help="frame period in ms for --input")
+    parser.add_argument("--output", help="capture file, default stdout")
+    args = parser.parse_args()
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    out.write("# touch capture, %d nodes\n" % args.nodes)
+    out.write("# time_ms sequence error, per node: signal reference cc state threshold\n")
+
+    if args.port:
+        stream = serial_bytes(args.port, args.baud)
+    else:
+        stream = file_bytes(args.input)
+
+    first = None
+    count = 0
+    try:
+        for sequence, error, nodes in decode(stream, args.nodes, args.hop_steps):
+            if args.port:
+                now = time.monotonic()
+                if first is None:
+                    first = now
+                time_ms = int((now - first) * 1000)
+            else:
+                time_ms = count * args.period
+            fields = [time_ms, sequence, error]
+            for node in nodes:
+                fields.extend(node)
+            out.write(" ".join(str(f) for f in fields) + "\n")
+            out.flush()
+            count += 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    print("%d frames" % count, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,33 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for utils/atomic.h.
+ *
+ * Critical sections save and restore the simulated global interrupt flag.
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint8_t sim_irq_save(void);
+void    sim_irq_restore(uint8_t state);
+void    sim_sei(void);
+void    sim_cli(void);
+
+#define ENTER_CRITICAL(P) uint8_t P = sim_irq_save()
+#define EXIT_CRITICAL(P) sim_irq_restore(P)
+
+#define DISABLE_INTERRUPTS() sim_cli()
+#define ENABLE_INTERRUPTS() sim_sei()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATOMIC_H */
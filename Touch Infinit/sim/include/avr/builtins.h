@@ -0,0 +1,10 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for <avr/builtins.h>.
+ */
+
+#ifndef SIM_AVR_BUILTINS_H
+#define SIM_AVR_BUILTINS_H
+
+#endif /* SIM_AVR_BUILTINS_H */
@@ -0,0 +1,28 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for <avr/interrupt.h>.
+ *
+ * ISR(vect) defines a plain function named after the vector so the simulator
+ * can dispatch it; sei()/cli() drive the simulated global interrupt flag.
+ */
+
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_sei(void);
+void sim_cli(void);
+
+#define ISR(vector, ...) void vector(void)
+#define sei() sim_sei()
+#define cli() sim_cli()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_AVR_INTERRUPT_H */
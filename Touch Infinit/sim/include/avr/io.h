@@ -0,0 +1,499 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for the ATtiny816 device header.
+ *
+ * Declares the peripheral register structures used by the application with the
+ * same member names and bit definitions as the device pack header, backed by
+ * plain RAM instances defined in sim_hw.c. Only the peripherals and bits used
+ * by the firmware are described.
+ */
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef volatile uint8_t  register8_t;
+typedef volatile uint16_t register16_t;
+
+#define _WORDREGISTER(regname) register16_t regname
+
+/* Memories */
+#define RAMSTART 0x3E00
+#define RAMSIZE 512
+#define RAMEND (RAMSTART + RAMSIZE - 1)
+#define EEPROM_START 0x1400
+#define EEPROM_SIZE 128
+#define EEPROM_PAGE_SIZE 32
+#define EEPROM_END (EEPROM_START + EEPROM_SIZE - 1)
+/* The mapped EEPROM is the simulated EEPROM array of sim_hw.c */
+extern uint8_t sim_eeprom[EEPROM_SIZE];
+#define MAPPED_EEPROM_START ((uintptr_t)&sim_eeprom[0])
+/* Likewise the user row */
+#define USER_SIGNATURES_SIZE 32
+extern uint8_t sim_userrow[USER_SIGNATURES_SIZE];
+#define USER_SIGNATURES_START ((uintptr_t)&sim_userrow[0])
+/* The SRAM is an array of sim_hw.c as well, which places the static data
+ * symbols of the linker script in it under other names, the C library of the
+ * host has a __data_start. The stack pointer points into it. */
+extern uint8_t  sim_sram[RAMSIZE];
+extern uint8_t *sim_SP;
+#define SP sim_SP
+#define __data_start sim_data_start
+#define __heap_start sim_heap_start
+
+/* Generic port pins */
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+/* CPU */
+typedef enum CCP_enum { CCP_SPM_gc = (0x9D << 0), CCP_IOREG_gc = (0xD8 << 0) } CCP_t;
+
+/*--------------------------------------------------------------------------
+BOD - Bod interface
+--------------------------------------------------------------------------*/
+typedef struct BOD_struct {
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t reserved_1[6];
+	register8_t VLMCTRLA;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register8_t STATUS;
+	register8_t reserved_2[4];
+} BOD_t;
+
+#define BOD_SLEEP_gm 0x03
+#define BOD_SLEEP_DIS_gc (0x00 << 0)
+#define BOD_SLEEP_ENABLED_gc (0x01 << 0)
+#define BOD_SLEEP_SAMPLED_gc (0x02 << 0)
+#define BOD_ACTIVE_gm 0x0C
+#define BOD_ACTIVE_DIS_gc (0x00 << 2)
+#define BOD_ACTIVE_ENABLED_gc (0x01 << 2)
+#define BOD_ACTIVE_SAMPLED_gc (0x02 << 2)
+#define BOD_LVL_gm 0x07
+#define BOD_VLMLVL_gm 0x03
+#define BOD_VLMLVL_5ABOVE_gc (0x00 << 0)
+#define BOD_VLMLVL_15ABOVE_gc (0x01 << 0)
+#define BOD_VLMLVL_25ABOVE_gc (0x02 << 0)
+#define BOD_VLMIE_bm 0x01
+#define BOD_VLMIE_bp 0
+#define BOD_VLMCFG_gm 0x06
+#define BOD_VLMCFG_BELOW_gc (0x00 << 1)
+#define BOD_VLMCFG_ABOVE_gc (0x01 << 1)
+#define BOD_VLMCFG_CROSS_gc (0x02 << 1)
+#define BOD_VLMIF_bm 0x01
+#define BOD_VLMS_bm 0x01
+
+/*--------------------------------------------------------------------------
+CLKCTRL - Clock controller
+--------------------------------------------------------------------------*/
+typedef struct CLKCTRL_struct {
+	register8_t MCLKCTRLA;
+	register8_t MCLKCTRLB;
+	register8_t MCLKLOCK;
+	register8_t MCLKSTATUS;
+	register8_t reserved_1[12];
+	register8_t OSC20MCTRLA;
+	register8_t OSC20MCALIBA;
+	register8_t OSC20MCALIBB;
+	register8_t reserved_2[5];
+	register8_t OSC32KCTRLA;
+	register8_t reserved_3[3];
+	register8_t XOSC32KCTRLA;
+	register8_t reserved_4[3];
+} CLKCTRL_t;
+
+#define CLKCTRL_PEN_bm 0x01
+#define CLKCTRL_PEN_bp 0
+#define CLKCTRL_PDIV_2X_gc (0x00 << 1)
+#define CLKCTRL_RUNSTDBY_bm 0x02
+#define CLKCTRL_RUNSTDBY_bp 1
+
+/*--------------------------------------------------------------------------
+CPUINT - Interrupt Controller
+--------------------------------------------------------------------------*/
+typedef struct CPUINT_struct {
+	register8_t CTRLA;
+	register8_t STATUS;
+	register8_t LVL0PRI;
+	register8_t LVL1VEC;
+} CPUINT_t;
+
+/*--------------------------------------------------------------------------
+NVMCTRL - Non-volatile Memory Controller
+--------------------------------------------------------------------------*/
+typedef struct NVMCTRL_struct {
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t STATUS;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register8_t reserved_1[1];
+	_WORDREGISTER(DATA);
+	_WORDREGISTER(ADDR);
+	register8_t reserved_2[6];
+} NVMCTRL_t;
+
+#define NVMCTRL_CMD_gm 0x07
+#define NVMCTRL_CMD_NONE_gc (0x00 << 0)
+#define NVMCTRL_CMD_PAGEWRITE_gc (0x01 << 0)
+#define NVMCTRL_CMD_PAGEERASE_gc (0x02 << 0)
+#define NVMCTRL_CMD_PAGEERASEWRITE_gc (0x03 << 0)
+#define NVMCTRL_CMD_PAGEBUFCLR_gc (0x04 << 0)
+#define NVMCTRL_CMD_CHIPERASE_gc (0x05 << 0)
+#define NVMCTRL_CMD_EEERASE_gc (0x06 << 0)
+#define NVMCTRL_CMD_FUSEWRITE_gc (0x07 << 0)
+#define NVMCTRL_FBUSY_bm 0x01
+#define NVMCTRL_EEBUSY_bm 0x02
+#define NVMCTRL_WRERROR_bm 0x04
+
+/*--------------------------------------------------------------------------
+PORT - I/O Ports
+--------------------------------------------------------------------------*/
+typedef struct PORT_struct {
+	register8_t DIR;
+	register8_t DIRSET;
+	register8_t DIRCLR;
+	register8_t DIRTGL;
+	register8_t OUT;
+	register8_t OUTSET;
+	register8_t OUTCLR;
+	register8_t OUTTGL;
+	register8_t IN;
+	register8_t INTFLAGS;
+	register8_t reserved_1[6];
+	register8_t PIN0CTRL;
+	register8_t PIN1CTRL;
+	register8_t PIN2CTRL;
+	register8_t PIN3CTRL;
+	register8_t PIN4CTRL;
+	register8_t PIN5CTRL;
+	register8_t PIN6CTRL;
+	register8_t PIN7CTRL;
+	register8_t reserved_2[8];
+} PORT_t;
+
+typedef enum PORT_ISC_enum {
+	PORT_ISC_INTDISABLE_gc    = (0x00 << 0),
+	PORT_ISC_BOTHEDGES_gc     = (0x01 << 0),
+	PORT_ISC_RISING_gc        = (0x02 << 0),
+	PORT_ISC_FALLING_gc       = (0x03 << 0),
+	PORT_ISC_INPUT_DISABLE_gc = (0x04 << 0),
+	PORT_ISC_LEVEL_gc         = (0x05 << 0)
+} PORT_ISC_t;
+
+#define PORT_ISC_gm 0x07
+#define PORT_PULLUPEN_bm 0x08
+#define PORT_PULLUPEN_bp 3
+#define PORT_INVEN_bm 0x80
+#define PORT_INVEN_bp 7
+
+typedef struct VPORT_struct {
+	register8_t DIR;
+	register8_t OUT;
+	register8_t IN;
+	register8_t INTFLAGS;
+} VPORT_t;
+
+/*--------------------------------------------------------------------------
+RSTCTRL - Reset controller
+--------------------------------------------------------------------------*/
+typedef struct RSTCTRL_struct {
+	register8_t RSTFR;
+	register8_t SWRR;
+	register8_t reserved_1[2];
+} RSTCTRL_t;
+
+#define RSTCTRL_PORF_bm 0x01
+#define RSTCTRL_BORF_bm 0x02
+#define RSTCTRL_EXTRF_bm 0x04
+#define RSTCTRL_WDRF_bm 0x08
+#define RSTCTRL_SWRF_bm 0x10
+#define RSTCTRL_UPDIRF_bm 0x20
+
+/*--------------------------------------------------------------------------
+RTC - Real-Time Counter
+--------------------------------------------------------------------------*/
+typedef struct RTC_struct {
+	register8_t CTRLA;
+	register8_t STATUS;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register8_t TEMP;
+	register8_t DBGCTRL;
+	register8_t reserved_1[1];
+	register8_t CLKSEL;
+	_WORDREGISTER(CNT);
+	_WORDREGISTER(PER);
+	_WORDREGISTER(CMP);
+	register8_t reserved_2[2];
+	register8_t PITCTRLA;
+	register8_t PITSTATUS;
+	register8_t PITINTCTRL;
+	register8_t PITINTFLAGS;
+	register8_t reserved_3[1];
+	register8_t PITDBGCTRL;
+	register8_t reserved_4[10];
+} RTC_t;
+
+#define RTC_RTCEN_bm 0x01
+#define RTC_RTCEN_bp 0
+#define RTC_PRESCALER_gm 0x78
+#define RTC_PRESCALER_DIV1_gc (0x00 << 3)
+#define RTC_PRESCALER_DIV2_gc (0x01 << 3)
+#define RTC_PRESCALER_DIV4_gc (0x02 << 3)
+#define RTC_PRESCALER_DIV8_gc (0x03 << 3)
+#define RTC_PRESCALER_DIV16_gc (0x04 << 3)
+#define RTC_PRESCALER_DIV32_gc (0x05 << 3)
+#define RTC_PRESCALER_DIV64_gc (0x06 << 3)
+#define RTC_RUNSTDBY_bm 0x80
+#define RTC_RUNSTDBY_bp 7
+#define RTC_CTRLABUSY_bm 0x01
+#define RTC_CNTBUSY_bm 0x02
+#define RTC_PERBUSY_bm 0x04
+#define RTC_CMPBUSY_bm 0x08
+#define RTC_OVF_bm 0x01
+#define RTC_OVF_bp 0
+#define RTC_CMP_bm 0x02
+#define RTC_CMP_bp 1
+#define RTC_PITEN_bm 0x01
+#define RTC_PITEN_bp 0
+#define RTC_PERIOD_gp 3
+#define RTC_PERIOD_OFF_gc (0x00 << 3)
+#define RTC_CTRLBUSY_bm 0x01
+#define RTC_PI_bm 0x01
+#define RTC_PI_bp 0
+
+/*--------------------------------------------------------------------------
+SLPCTRL - Sleep Controller
+--------------------------------------------------------------------------*/
+typedef struct SLPCTRL_struct {
+	register8_t CTRLA;
+} SLPCTRL_t;
+
+typedef enum SLPCTRL_SMODE_enum {
+	SLPCTRL_SMODE_IDLE_gc  = (0x00 << 1),
+	SLPCTRL_SMODE_STDBY_gc = (0x01 << 1),
+	SLPCTRL_SMODE_PDOWN_gc = (0x02 << 1)
+} SLPCTRL_SMODE_t;
+
+#define SLPCTRL_SEN_bm 0x01
+#define SLPCTRL_SEN_bp 0
+#define SLPCTRL_SMODE_gm 0x06
+
+/*--------------------------------------------------------------------------
+TCA - 16-bit Timer/Counter Type A
+--------------------------------------------------------------------------*/
+typedef struct TCA_SINGLE_struct {
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t CTRLC;
+	register8_t CTRLD;
+	register8_t CTRLECLR;
+	register8_t CTRLESET;
+	register8_t CTRLFCLR;
+	register8_t CTRLFSET;
+	register8_t EVCTRL;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register8_t reserved_1[2];
+	register8_t DBGCTRL;
+	register8_t TEMP;
+	register8_t reserved_2[17];
+	_WORDREGISTER(CNT);
+	register8_t reserved_3[4];
+	_WORDREGISTER(PER);
+	_WORDREGISTER(CMP0);
+	_WORDREGISTER(CMP1);
+	_WORDREGISTER(CMP2);
+	register8_t reserved_4[8];
+	_WORDREGISTER(PERBUF);
+	_WORDREGISTER(CMP0BUF);
+	_WORDREGISTER(CMP1BUF);
+	_WORDREGISTER(CMP2BUF);
+	register8_t reserved_5[2];
+} TCA_SINGLE_t;
+
+typedef union TCA_union {
+	TCA_SINGLE_t SINGLE;
+} TCA_t;
+
+#define TCA_SINGLE_ENABLE_bm 0x01
+#define TCA_SINGLE_CLKSEL_gm 0x0E
+#define TCA_SINGLE_CLKSEL_DIV1_gc (0x00 << 1)
+#define TCA_SINGLE_CLKSEL_DIV2_gc (0x01 << 1)
+#define TCA_SINGLE_CLKSEL_DIV4_gc (0x02 << 1)
+#define TCA_SINGLE_CLKSEL_DIV8_gc (0x03 << 1)
+#define TCA_SINGLE_CLKSEL_DIV16_gc (0x04 << 1)
+#define TCA_SINGLE_CLKSEL_DIV64_gc (0x05 << 1)
+#define TCA_SINGLE_CLKSEL_DIV256_gc (0x06 << 1)
+#define TCA_SINGLE_CLKSEL_DIV1024_gc (0x07 << 1)
+#define TCA_SINGLE_WGMODE_gm 0x07
+#define TCA_SINGLE_WGMODE_NORMAL_gc (0x00 << 0)
+#define TCA_SINGLE_OVF_bm 0x01
+#define TCA_SINGLE_CMP0_bm 0x10
+#define TCA_SINGLE_CMP1_bm 0x20
+#define TCA_SINGLE_CMP2_bm 0x40
+
+/*--------------------------------------------------------------------------
+TCB - 16-bit Timer Type B
+--------------------------------------------------------------------------*/
+typedef struct TCB_struct {
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t reserved_1[2];
+	register8_t EVCTRL;
+	register8_t INTCTRL;
+	register8_t INTFLAGS;
+	register8_t STATUS;
+	register8_t DBGCTRL;
+	register8_t TEMP;
+	_WORDREGISTER(CNT);
+	_WORDREGISTER(CCMP);
+	register8_t reserved_2[2];
+} TCB_t;
+
+#define TCB_ENABLE_bm 0x01
+#define TCB_CLKSEL_gm 0x06
+#define TCB_CLKSEL_CLKDIV1_gc (0x00 << 1)
+#define TCB_CLKSEL_CLKDIV2_gc (0x01 << 1)
+#define TCB_CLKSEL_CLKTCA_gc (0x02 << 1)
+#define TCB_RUNSTDBY_bm 0x40
+#define TCB_CNTMODE_gm 0x07
+#define TCB_CNTMODE_INT_gc (0x00 << 0)
+#define TCB_CAPT_bm 0x01
+
+/*--------------------------------------------------------------------------
+USART - Universal Synchronous and Asynchronous Receiver and Transmitter
+--------------------------------------------------------------------------*/
+typedef struct USART_struct {
+	register8_t RXDATAL;
+	register8_t RXDATAH;
+	register8_t TXDATAL;
+	register8_t TXDATAH;
+	register8_t STATUS;
+	register8_t CTRLA;
+	register8_t CTRLB;
+	register8_t CTRLC;
+	_WORDREGISTER(BAUD);
+	register8_t reserved_1[1];
+	register8_t DBGCTRL;
+	register8_t EVCTRL;
+	register8_t TXPLCTRL;
+	register8_t RXPLCTRL;
+	register8_t reserved_2[1];
+} USART_t;
+
+#define USART_WFB_bm 0x01
+#define USART_BDF_bm 0x02
+#define USART_ISFIF_bm 0x08
+#define USART_RXSIF_bm 0x10
+#define USART_DREIF_bm 0x20
+#define USART_TXCIF_bm 0x40
+#define USART_RXCIF_bm 0x80
+#define USART_ABEIE_bp 2
+#define USART_LBME_bp 3
+#define USART_RS485_OFF_gc (0x00 << 0)
+#define USART_RXSIE_bm 0x10
+#define USART_RXSIE_bp 4
+#define USART_DREIE_bm 0x20
+#define USART_DREIE_bp 5
+#define USART_TXCIE_bm 0x40
+#define USART_TXCIE_bp 6
+#define USART_RXCIE_bm 0x80
+#define USART_RXCIE_bp 7
+#define USART_MPCM_bp 0
+#define USART_RXMODE_NORMAL_gc (0x00 << 1)
+#define USART_ODME_bp 3
+#define USART_SFDEN_bm 0x10
+#define USART_SFDEN_bp 4
+#define USART_TXEN_bm 0x40
+#define USART_TXEN_bp 6
+#define USART_RXEN_bm 0x80
+#define USART_RXEN_bp 7
+#define USART_PERR_bm 0x02
+#define USART_FERR_bm 0x04
+#define USART_BUFOVF_bm 0x40
+
+/*--------------------------------------------------------------------------
+WDT - Watch-Dog Timer
+--------------------------------------------------------------------------*/
+typedef struct WDT_struct {
+	register8_t CTRLA;
+	register8_t STATUS;
+} WDT_t;
+
+#define WDT_PERIOD_gm 0x0F
+#define WDT_PERIOD_OFF_gc (0x00 << 0)
+#define WDT_PERIOD_8CLK_gc (0x01 << 0)
+#define WDT_PERIOD_16CLK_gc (0x02 << 0)
+#define WDT_PERIOD_32CLK_gc (0x03 << 0)
+#define WDT_PERIOD_64CLK_gc (0x04 << 0)
+#define WDT_PERIOD_128CLK_gc (0x05 << 0)
+#define WDT_PERIOD_256CLK_gc (0x06 << 0)
+#define WDT_PERIOD_512CLK_gc (0x07 << 0)
+#define WDT_PERIOD_1KCLK_gc (0x08 << 0)
+#define WDT_PERIOD_2KCLK_gc (0x09 << 0)
+#define WDT_PERIOD_4KCLK_gc (0x0A << 0)
+#define WDT_PERIOD_8KCLK_gc (0x0B << 0)
+#define WDT_WINDOW_gm 0xF0
+#define WDT_WINDOW_OFF_gc (0x00 << 4)
+#define WDT_WINDOW_8CLK_gc (0x01 << 4)
+#define WDT_WINDOW_16CLK_gc (0x02 << 4)
+#define WDT_WINDOW_32CLK_gc (0x03 << 4)
+#define WDT_WINDOW_64CLK_gc (0x04 << 4)
+#define WDT_SYNCBUSY_bm 0x01
+#define WDT_LOCK_bm 0x80
+
+/*--------------------------------------------------------------------------
+Peripheral instances
+--------------------------------------------------------------------------*/
+extern BOD_t     sim_BOD;
+extern CLKCTRL_t sim_CLKCTRL;
+extern CPUINT_t  sim_CPUINT;
+extern NVMCTRL_t sim_NVMCTRL;
+extern PORT_t    sim_PORTA, sim_PORTB, sim_PORTC;
+extern VPORT_t   sim_VPORTA, sim_VPORTB, sim_VPORTC;
+extern RSTCTRL_t sim_RSTCTRL;
+extern RTC_t     sim_RTC;
+extern SLPCTRL_t sim_SLPCTRL;
+extern TCA_t     sim_TCA0;
+extern TCB_t     sim_TCB0;
+extern USART_t   sim_USART0;
+extern WDT_t     sim_WDT;
+
+#define BOD sim_BOD
+#define CLKCTRL sim_CLKCTRL
+#define CPUINT sim_CPUINT
+#define NVMCTRL sim_NVMCTRL
+#define PORTA sim_PORTA
+#define PORTB sim_PORTB
+#define PORTC sim_PORTC
+#define VPORTA sim_VPORTA
+#define VPORTB sim_VPORTB
+#define VPORTC sim_VPORTC
+#define RSTCTRL sim_RSTCTRL
+#define RTC sim_RTC
+#define SLPCTRL sim_SLPCTRL
+#define TCA0 sim_TCA0
+#define TCB0 sim_TCB0
+#define USART0 sim_USART0
+#define WDT sim_WDT
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_AVR_IO_H */
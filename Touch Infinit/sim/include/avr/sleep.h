@@ -0,0 +1,25 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for <avr/sleep.h>.
+ *
+ * sleep_cpu() hands control to the simulator, which advances simulated time
+ * to the next wake-up event and runs the pending interrupt handlers.
+ */
+
+#ifndef SIM_AVR_SLEEP_H
+#define SIM_AVR_SLEEP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_sleep_cpu(void);
+
+#define sleep_cpu() sim_sleep_cpu()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_AVR_SLEEP_H */
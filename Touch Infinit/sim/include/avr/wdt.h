@@ -0,0 +1,26 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for <avr/wdt.h>.
+ *
+ * wdt_reset() kicks the simulated watchdog, which resets the device and so
+ * ends the simulation when it is kicked in the closed window or not kicked
+ * before the end of the open window.
+ */
+
+#ifndef SIM_AVR_WDT_H
+#define SIM_AVR_WDT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_wdt_reset(void);
+
+#define wdt_reset() sim_wdt_reset()
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_AVR_WDT_H */
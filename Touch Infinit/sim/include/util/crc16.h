@@ -0,0 +1,35 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for <util/crc16.h>.
+ *
+ * Same results as the avr-libc inline assembler versions.
+ */
+
+#ifndef SIM_UTIL_CRC16_H
+#define SIM_UTIL_CRC16_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC-16, polynomial 0xA001 (x^16 + x^15 + x^2 + 1, reflected) */
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
+{
+	uint8_t i;
+
+	crc ^= data;
+	for (i = 0; i < 8; i++) {
+		crc = (crc & 1u) ? (uint16_t)((crc >> 1) ^ 0xA001u) : (uint16_t)(crc >> 1);
+	}
+
+	return crc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_UTIL_CRC16_H */
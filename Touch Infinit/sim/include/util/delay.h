@@ -0,0 +1,23 @@
+/**
+ * \file
+ *
+ * \brief Host stand-in for <util/delay.h>.
+ */
+
+#ifndef SIM_UTIL_DELAY_H
+#define SIM_UTIL_DELAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sim_delay_us(double us);
+
+#define _delay_us(us) sim_delay_us(us)
+#define _delay_ms(ms) sim_delay_us((ms)*1000.0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_UTIL_DELAY_H */
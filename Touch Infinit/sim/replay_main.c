@@ -0,0 +1,600 @@
+/**
+ * \file
+ *
+ * \brief Touch capture replay engine.
+ *
+ * Feeds the node signals of a touch capture through the open key module
+ * (qtouch/touch_key.c) and scores the detections against known presses, for
+ * every combination of the given key thresholds, hysteresis settings and
+ * detect integration counts.
+ *
+ * Usage: touch_replay --capture file [--labels file] [--threshold list]
+ *                     [--hysteresis list] [--di list] [--max-latency ms]
+ *                     [--csv file] [--verbose] [--check]
+ *        touch_replay --capture file --conformance [--verbose] [--check]
+ *
+ * Lists are comma separated values or first:last:step ranges. Hysteresis is
+ * given in percent of the threshold (50, 25, 12.5 or 6.25). Without a list the
+ * thresholds recorded in the capture, the hysteresis of the sensor table and
+ * DEF_TOUCH_DET_INT are used. The other key parameters come from touch.h.
+ *
+ * The labels file holds one press per line, "<on_ms> <off_ms> <node>". Without
+ * it the detect state recorded in the capture is the reference, so a replay
+ * scores the parameters against the build that recorded the capture.
+ *
+ * Each frame of the capture is one measurement: the keys start from the
+ * references of the first frame after calibration, and the drift timer
+ * advances by the time between frames. Frames recorded while the board was
+ * still calibrating (a reference of 0) are skipped. Frames dropped by the board are missing from the capture, so
+ * detect integration sees the frames that were recorded.
+ *
+ * With --check the exit status is non-zero if any combination misses a press
+ * or reports a false detect.
+ *
+ * With --conformance the key module runs once with the recorded thresholds and
+ * the settings of touch.h, and its detect states and references are compared
+ * frame by frame with those recorded. On a capture of a board running the key
+ * library this checks touch_key.c against the library. The firmware of
+ * touch_sim runs touch_key.c itself, so on its captures this only checks that
+ * the replay reproduces the firmware. --verbose lists the frames that differ
+ * and --check fails on a detect state that differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "touch.h"
+#include "touch_key.h"
+#include "atomic.h"
+#include "sim_capture.h"
+#include "sim_score.h"
+
+#define REPLAY_MAX_VALUES 64u
+#define REPLAY_MAX_PRESSES 4096u
+
+/* Hysteresis settings in percent of the threshold, indexed by QTM_hysteresis_t */
+static const double replay_hysteresis_percent[MAX_HYST] = {50.0, 25.0, 12.5, 6.25};
+
+static const qtm_touch_key_config_t replay_default_keys[DEF_NUM_SENSORS] = TOUCH_KEY_CONFIGS;
+
+/* List of parameter values, empty for the configured default */
+struct replay_list {
+	unsigned count;
+	unsigned value[REPLAY_MAX_VALUES];
+};
+
+struct replay_params {
+	int      threshold;  /* -1: as recorded */
+	int      hysteresis; /* -1: TOUCH_SENSOR_TABLE */
+	int      di;
+	uint32_t max_latency_ms;
+};
+
+static struct sim_capture       replay_capture;
+static struct sim_score_press   replay_presses[REPLAY_MAX_PRESSES];
+static unsigned                 replay_num_presses;
+static struct sim_score_detect *replay_detects;
+
+/* The replay has no interrupts, critical sections of touch_key.c are empty */
+uint8_t sim_irq_save(void)
+{
+	return 0;
+}
+
+void sim_irq_restore(uint8_t state)
+{
+	(void)state;
+}
+
+/**
+ * \brief Parse a list of values, "a,b,c" or "first:last:step" or a mix
+ *
+ * \return 0 on success, -1 on a malformed list
+ */
+static int replay_parse_list(const char *text, struct replay_list *list, bool hysteresis)
+{
+	const char *p = text;
+
+	list->count = 0;
+	while (*p != '\0') {
+		char *   end;
+		double   first = strtod(p, &end);
+		double   last  = first;
+		double   step  = 1.0;
+		double   v;
+		unsigned h;
+
+		if (end == p) {
+			return -1;
+		}
+		p = end;
+		if (*p == ':') {
+			last = strtod(p + 1, &end);
+			if (end == p + 1) {
+				return -1;
+			}
+			p = end;
+			if (*p == ':') {
+				step = strtod(p + 1, &end);
+				if ((end == p + 1) || (step <= 0.0)) {
+					return -1;
+				}
+				p = end;
+			}
+		}
+
+		for (v = first; v <= last + 1e-9; v += step) {
+			if (list->count == REPLAY_MAX_VALUES) {
+				return -1;
+			}
+			if (hysteresis) {
+				for (h = 0; (h < MAX_HYST) && (replay_hysteresis_percent[h] != v); h++)
+					;
+				if (h == MAX_HYST) {
+					return -1;
+				}
+				list->value[list->count++] = h;
+			} else {
+				if ((v < 0.0) || (v > 255.0)) {
+					return -1;
+				}
+				list->value[list->count++] = (unsigned)v;
+			}
+		}
+
+		if (*p == ',') {
+			p++;
+		} else if (*p != '\0') {
+			return -1;
+		}
+	}
+	return (list->count != 0u) ? 0 : -1;
+}
+
+/**
+ * \brief Load the presses from a labels file
+ */
+static int replay_load_labels(const char *path)
+{
+	char     line[256];
+	FILE *   file = fopen(path, "r");
+	unsigned line_number = 0;
+
+	if (file == NULL) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), file) != NULL) {
+		unsigned long on_ms, off_ms;
+		unsigned      node;
+
+		line_number++;
+		if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0')) {
+			continue;
+		}
+		if ((sscanf(line, "%lu %lu %u", &on_ms, &off_ms, &node) != 3) || (off_ms < on_ms)
+		    || (node >= replay_capture.num_nodes) || (replay_num_presses == REPLAY_MAX_PRESSES)) {
+			fprintf(stderr, "%s:%u: malformed press\n", path, line_number);
+			fclose(file);
+			return -1;
+		}
+		replay_presses[replay_num_presses].node   = node;
+		replay_presses[replay_num_presses].on_ms  = on_ms;
+		replay_presses[replay_num_presses].off_ms = off_ms;
+		replay_num_presses++;
+	}
+	fclose(file);
+	return 0;
+}
+
+/**
+ * \brief Use the detect state recorded in the capture as the presses
+ */
+static void replay_presses_from_capture(void)
+{
+	uint8_t  node;
+	uint32_t f;
+
+	for (node = 0; node < replay_capture.num_nodes; node++) {
+		bool     touched = false;
+		uint32_t on_ms   = 0;
+
+		for (f = 0; f < replay_capture.num_frames; f++) {
+			const struct sim_capture_frame *frame = &replay_capture.frames[f];
+			bool                            now   = frame->node[node].state != 0u;
+
+			if (now && !touched) {
+				on_ms = frame->time_ms;
+			} else if (!now && touched && (replay_num_presses < REPLAY_MAX_PRESSES)) {
+				replay_presses[replay_num_presses].node   = node;
+				replay_presses[replay_num_presses].on_ms  = on_ms;
+				replay_presses[replay_num_presses].off_ms = frame->time_ms;
+				replay_num_presses++;
+			}
+			touched = now;
+		}
+		if (touched && (replay_num_presses < REPLAY_MAX_PRESSES)) {
+			replay_presses[replay_num_presses].node   = node;
+			replay_presses[replay_num_presses].on_ms  = on_ms;
+			replay_presses[replay_num_presses].off_ms = replay_capture.frames[f - 1u].time_ms;
+			replay_num_presses++;
+		}
+	}
+}
+
+/**
+ * \brief Index of the first frame with all keys calibrated, 0 if there is none
+ */
+static uint32_t replay_first_frame(void)
+{
+	uint32_t f;
+	uint8_t  node;
+
+	for (f = 0; f < replay_capture.num_frames; f++) {
+		for (node = 0; node < replay_capture.num_nodes; node++) {
+			if (replay_capture.frames[f].node[node].reference == 0u) {
+				break;
+			}
+		}
+		if (node == replay_capture.num_nodes) {
+			return f;
+		}
+	}
+	return 0;
+}
+
+/* Key group the capture is replayed through */
+struct replay_group {
+	qtm_acq_node_data_t          nodes[SIM_CAPTURE_MAX_NODES];
+	qtm_touch_key_data_t         keys[SIM_CAPTURE_MAX_NODES];
+	qtm_touch_key_config_t       key_configs[SIM_CAPTURE_MAX_NODES];
+	qtm_touch_key_group_data_t   group_data;
+	qtm_touch_key_group_config_t group_config;
+	qtm_touch_key_control_t      control;
+};
+
+static struct replay_group replay_group;
+
+/**
+ * \brief Set up the key group for a replay from the given frame
+ */
+static void replay_group_init(const struct replay_params *params, const struct sim_capture_frame *first)
+{
+	struct replay_group *              g      = &replay_group;
+	const qtm_touch_key_group_config_t config = {0,
+	                                             DEF_TOUCH_DET_INT,
+	                                             DEF_MAX_ON_DURATION,
+	                                             DEF_ANTI_TCH_DET_INT,
+	                                             DEF_ANTI_TCH_RECAL_THRSHLD,
+	                                             DEF_TCH_DRIFT_RATE,
+	                                             DEF_ANTI_TCH_DRIFT_RATE,
+	                                             DEF_DRIFT_HOLD_TIME,
+	                                             DEF_REBURST_MODE};
+	uint8_t                            node;
+
+	memset(g, 0, sizeof(*g));
+	g->group_config                 = config;
+	g->group_config.num_key_sensors = replay_capture.num_nodes;
+	if (params->di >= 0) {
+		g->group_config.sensor_touch_di = params->di;
+	}
+	g->control.qtm_touch_key_group_data   = &g->group_data;
+	g->control.qtm_touch_key_group_config = &g->group_config;
+	g->control.qtm_touch_key_data         = &g->keys[0];
+	g->control.qtm_touch_key_config       = &g->key_configs[0];
+	qtm_local_ms_timecount                = 0;
+
+	for (node = 0; node < replay_capture.num_nodes; node++) {
+		g->key_configs[node] = replay_default_keys[node < DEF_NUM_SENSORS ? node : 0u];
+		g->key_configs[node].channel_threshold
+		    = (params->threshold >= 0) ? (uint8_t)params->threshold : first->node[node].threshold;
+		if (params->hysteresis >= 0) {
+			g->key_configs[node].channel_hysteresis = params->hysteresis;
+		}
+		qtm_init_sensor_key(&g->control, node, &g->nodes[node]);
+		/* Start calibrated, from the references the board had */
+		g->keys[node].channel_reference = first->node[node].reference;
+		g->keys[node].sensor_state      = QTM_KEY_STATE_NO_DET;
+	}
+}
+
+/**
+ * \brief Process one frame of the capture, the time goes on by elapsed_ms
+ */
+static void replay_group_process(const struct sim_capture_frame *frame, uint32_t elapsed_ms)
+{
+	uint8_t node;
+
+	qtm_update_qtlib_timer(elapsed_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)elapsed_ms);
+	for (node = 0; node < replay_capture.num_nodes; node++) {
+		replay_group.nodes[node].node_acq_signals = frame->node[node].signal;
+		replay_group.nodes[node].node_acq_status  = NODE_ENABLED;
+	}
+	qtm_key_sensors_process(&replay_group.control);
+}
+
+/**
+ * \brief Run the capture through the key module with one parameter set
+ */
+static void replay_run(const struct replay_params *params, bool verbose, struct sim_score *score)
+{
+	uint32_t                        start = replay_first_frame();
+	const struct sim_capture_frame *first = &replay_capture.frames[start];
+	uint8_t                         touched[SIM_CAPTURE_MAX_NODES] = {0};
+	unsigned                        num_detects = 0;
+	uint32_t                        previous_ms = first->time_ms;
+	uint32_t                        f;
+	uint8_t                         node;
+
+	replay_group_init(params, first);
+
+	for (f = start; f < replay_capture.num_frames; f++) {
+		const struct sim_capture_frame *frame = &replay_capture.frames[f];
+
+		replay_group_process(frame, frame->time_ms - previous_ms);
+		previous_ms = frame->time_ms;
+
+		for (node = 0; node < replay_capture.num_nodes; node++) {
+			uint8_t now = (replay_group.keys[node].sensor_state & KEY_TOUCHED_MASK) ? 1u : 0u;
+
+			if (now && !touched[node]) {
+				replay_detects[num_detects].node    = node;
+				replay_detects[num_detects].time_ms = frame->time_ms;
+				num_detects++;
+			}
+			touched[node] = now;
+		}
+	}
+
+	sim_score_run(replay_presses, replay_num_presses, replay_detects, num_detects, params->max_latency_ms, verbose, score);
+}
+
+/**
+ * \brief Compare the key module with the detect states and references recorded
+ *
+ * Each frame starts from the references recorded with the frame before. The
+ * time base of the board runs from its start up, so its drift steps can fall
+ * in other frames than here, and this keeps them from carrying on into the
+ * following frames.
+ *
+ * \return Frames with a detect state that differs from the recording
+ */
+static unsigned replay_conformance(bool verbose)
+{
+	struct replay_params            params = {-1, -1, DEF_TOUCH_DET_INT, 0};
+	uint32_t                        start  = replay_first_frame();
+	const struct sim_capture_frame *first  = &replay_capture.frames[start];
+	uint32_t                        previous_ms = first->time_ms;
+	unsigned                        detect_mismatches    = 0;
+	unsigned                        reference_mismatches = 0;
+	uint32_t                        f;
+	uint8_t                         node;
+
+	replay_group_init(&params, first);
+
+	for (f = start + 1u; f < replay_capture.num_frames; f++) {
+		const struct sim_capture_frame *frame    = &replay_capture.frames[f];
+		const struct sim_capture_frame *previous = &replay_capture.frames[f - 1u];
+		bool                            detect_ok    = true;
+		bool                            reference_ok = true;
+
+		for (node = 0; node < replay_capture.num_nodes; node++) {
+			replay_group.keys[node].channel_reference = previous->node[node].reference;
+		}
+		replay_group_process(frame, frame->time_ms - previous_ms);
+		previous_ms = frame->time_ms;
+
+		for (node = 0; node < replay_capture.num_nodes; node++) {
+			const qtm_touch_key_data_t *   key      = &replay_group.keys[node];
+			const struct sim_capture_node *recorded = &frame->node[node];
+			bool                           detect   = (key->sensor_state & KEY_TOUCHED_MASK) != 0u;
+
+			if (detect != (recorded->state != 0u)) {
+				detect_ok = false;
+			} else if (key->channel_reference == recorded->reference) {
+				continue;
+			}
+			reference_ok = reference_ok && (key->channel_reference == recorded->reference);
+			if (verbose) {
+				printf("%10u ms node %u: detect %u reference %u, recorded detect %u reference %u\n",
+				       (unsigned)frame->time_ms,
+				       node,
+				       detect,
+				       key->channel_reference,
+				       recorded->state != 0u,
+				       recorded->reference);
+			}
+		}
+		detect_mismatches += !detect_ok;
+		reference_mismatches += !reference_ok;
+	}
+
+	printf("conformance       : %u frames, %u detect mismatches, %u reference mismatches\n",
+	       (unsigned)(replay_capture.num_frames - start - 1u),
+	       detect_mismatches,
+	       reference_mismatches);
+
+	return detect_mismatches;
+}
+
+static void replay_usage(const char *argv0)
+{
+	fprintf(stderr,
+	        "usage: %s --capture file [--labels file] [--threshold list]\n"
+	        "       [--hysteresis list] [--di list] [--max-latency ms]\n"
+	        "       [--csv file] [--verbose] [--check]\n"
+	        "       %s --capture file --conformance [--verbose] [--check]\n",
+	        argv0,
+	        argv0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *         capture_path   = NULL;
+	const char *         labels_path    = NULL;
+	const char *         csv_path       = NULL;
+	FILE *               csv            = NULL;
+	uint32_t             max_latency_ms = 250;
+	bool                 verbose        = false;
+	bool                 check          = false;
+	bool                 conformance    = false;
+	struct replay_list   thresholds     = {0};
+	struct replay_list   hysteresis     = {0};
+	struct replay_list   dis            = {0};
+	struct replay_params params;
+	unsigned             t, h, d;
+	unsigned             runs   = 0;
+	unsigned             failed = 0;
+	uint64_t             span_ms;
+	double               wall_s;
+	clock_t              start;
+	int                  i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--check")) {
+			check = true;
+		} else if (!strcmp(argv[i], "--verbose")) {
+			verbose = true;
+		} else if (!strcmp(argv[i], "--conformance")) {
+			conformance = true;
+		} else if (i + 1 >= argc) {
+			replay_usage(argv[0]);
+			return 2;
+		} else if (!strcmp(argv[i], "--capture")) {
+			capture_path = argv[++i];
+		} else if (!strcmp(argv[i], "--labels")) {
+			labels_path = argv[++i];
+		} else if (!strcmp(argv[i], "--csv")) {
+			csv_path = argv[++i];
+		} else if (!strcmp(argv[i], "--max-latency")) {
+			max_latency_ms = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--threshold") && !replay_parse_list(argv[i + 1], &thresholds, false)) {
+			i++;
+		} else if (!strcmp(argv[i], "--hysteresis") && !replay_parse_list(argv[i + 1], &hysteresis, true)) {
+			i++;
+		} else if (!strcmp(argv[i], "--di") && !replay_parse_list(argv[i + 1], &dis, false)) {
+			i++;
+		} else {
+			replay_usage(argv[0]);
+			return 2;
+		}
+	}
+	if (capture_path == NULL) {
+		replay_usage(argv[0]);
+		return 2;
+	}
+
+	if (sim_capture_load(capture_path, &replay_capture) != 0) {
+		return 2;
+	}
+	if (labels_path != NULL) {
+		if (replay_load_labels(labels_path) != 0) {
+			return 2;
+		}
+	} else {
+		replay_presses_from_capture();
+	}
+	replay_detects = calloc(replay_capture.num_frames, sizeof(*replay_detects) * replay_capture.num_nodes);
+	if (replay_detects == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+
+	if (csv_path != NULL) {
+		csv = fopen(csv_path, "w");
+		if (csv == NULL) {
+			perror(csv_path);
+			return 2;
+		}
+		fprintf(csv, "threshold,hysteresis,di,presses,misses,false_detects,latency_min_ms,latency_mean_ms,latency_max_ms\n");
+	}
+
+	span_ms = replay_capture.frames[replay_capture.num_frames - 1u].time_ms - replay_capture.frames[0].time_ms;
+	printf("capture           : %u frames, %u nodes, %.1f s, %u presses\n",
+	       (unsigned)replay_capture.num_frames,
+	       replay_capture.num_nodes,
+	       span_ms / 1000.0,
+	       replay_num_presses);
+
+	if (conformance) {
+		failed = replay_conformance(verbose);
+		free(replay_detects);
+		sim_capture_free(&replay_capture);
+		return (check && (failed != 0u)) ? 1 : 0;
+	}
+
+	printf("threshold hysteresis  di  presses  missed  false  latency min/mean/max ms\n");
+
+	params.max_latency_ms = max_latency_ms;
+	start                 = clock();
+	for (t = 0; t < (thresholds.count ? thresholds.count : 1u); t++) {
+		for (h = 0; h < (hysteresis.count ? hysteresis.count : 1u); h++) {
+			for (d = 0; d < (dis.count ? dis.count : 1u); d++) {
+				struct sim_score score;
+				char             threshold_text[8];
+				char             hysteresis_text[16];
+
+				params.threshold  = thresholds.count ? (int)thresholds.value[t] : -1;
+				params.hysteresis = hysteresis.count ? (int)hysteresis.value[h] : -1;
+				params.di         = dis.count ? (int)dis.value[d] : DEF_TOUCH_DET_INT;
+
+				replay_run(&params, verbose, &score);
+				runs++;
+				if ((score.misses != 0u) || (score.false_detects != 0u)) {
+					failed++;
+				}
+
+				if (params.threshold >= 0) {
+					snprintf(threshold_text, sizeof(threshold_text), "%d", params.threshold);
+				} else {
+					strcpy(threshold_text, "rec");
+				}
+				if (params.hysteresis >= 0) {
+					snprintf(hysteresis_text, sizeof(hysteresis_text), "%g%%", replay_hysteresis_percent[params.hysteresis]);
+				} else {
+					strcpy(hysteresis_text, "cfg");
+				}
+
+				printf("%9s %10s %3d %8u %7u %6u  %u/%.1f/%u\n",
+				       threshold_text,
+				       hysteresis_text,
+				       params.di,
+				       score.presses,
+				       score.misses,
+				       score.false_detects,
+				       (unsigned)score.latency_min_ms,
+				       score.latency_mean_ms,
+				       (unsigned)score.latency_max_ms);
+				if (csv != NULL) {
+					fprintf(csv,
+					        "%s,%s,%d,%u,%u,%u,%u,%.1f,%u\n",
+					        threshold_text,
+					        hysteresis_text,
+					        params.di,
+					        score.presses,
+					        score.misses,
+					        score.false_detects,
+					        (unsigned)score.latency_min_ms,
+					        score.latency_mean_ms,
+					        (unsigned)score.latency_max_ms);
+				}
+			}
+		}
+	}
+	wall_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("replayed          : %u combinations in %.3f s wall time (%.0fx real time)\n",
+	       runs,
+	       wall_s,
+	       wall_s > 0 ? (runs * span_ms / 1000.0) / wall_s : 0.0);
+
+	if (csv != NULL) {
+		fclose(csv);
+	}
+	free(replay_detects);
+	sim_capture_free(&replay_capture);
+
+	return (check && (failed != 0u)) ? 1 : 0;
+}
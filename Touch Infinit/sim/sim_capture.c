@@ -0,0 +1,485 @@
+/**
+ * \file
+ *
+ * \brief Datastreamer frame decoder and touch capture files.
+ *
+ * The decoder follows the frame layouts of datastreamer_UART_avr.c. Data
+ * Visualizer frames: start token 0x55, sequence, 10 bytes per channel, module
+ * error code, frequency and noise figure per hop step, sequence, end token
+ * 0xAA. The Data Visualizer header sent every
+ * 16th frame and partial frames dropped by the USART driver are skipped.
+ * Compact frames: sync 0xA5, length, sequence, flags, payload, CRC-8; the
+ * payload layout is described in datastreamer_UART_avr.c. Profile frames
+ * carry the sequence of the samples frame before them and leave the delta
+ * decoding alone.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_capture.h"
+
+#define SIM_CAPTURE_START_TOKEN 0x55u
+#define SIM_CAPTURE_END_TOKEN 0xaau
+
+#define SIM_CAPTURE_COMPACT_SYNC 0xa5u
+#define SIM_CAPTURE_COMPACT_TYPE_MASK 0x0fu
+#define SIM_CAPTURE_COMPACT_TYPE_SAMPLES 0x00u
+#define SIM_CAPTURE_COMPACT_TYPE_INFO 0x01u
+#define SIM_CAPTURE_COMPACT_TYPE_PROFILE 0x04u
+#define SIM_CAPTURE_COMPACT_KEYFRAME 0x10u
+#define SIM_CAPTURE_COMPACT_ERROR 0x20u
+#define SIM_CAPTURE_COMPACT_HOP 0x40u
+#define SIM_CAPTURE_COMPACT_VERSION 1u
+
+/* Outcome of decoding the start of the buffer */
+enum sim_capture_scan {
+	SIM_CAPTURE_MORE,  /* incomplete */
+	SIM_CAPTURE_BAD,   /* not a frame, resynchronise */
+	SIM_CAPTURE_SKIP,  /* valid frame without samples */
+	SIM_CAPTURE_FRAME, /* samples decoded */
+};
+
+#define SIM_CAPTURE_LINE_MAX 1024u
+
+static uint16_t sim_capture_frame_length(uint8_t num_nodes, uint8_t hop_steps)
+{
+	return 2u + SIM_CAPTURE_NODE_BYTES * num_nodes + 1u + 2u * hop_steps + 2u;
+}
+
+static uint16_t sim_capture_get_u16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void sim_capture_decoder_init(struct sim_capture_decoder *decoder, uint8_t num_nodes, uint8_t hop_steps)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->num_nodes = num_nodes;
+	decoder->hop_steps = hop_steps;
+}
+
+static bool sim_capture_is_start(uint8_t byte)
+{
+	return (byte == SIM_CAPTURE_START_TOKEN) || (byte == SIM_CAPTURE_COMPACT_SYNC);
+}
+
+static uint8_t sim_capture_crc8(const uint8_t *p, uint16_t length)
+{
+	uint8_t crc = 0;
+	uint8_t bit;
+
+	while (length--) {
+		crc ^= *p++;
+		for (bit = 0; bit < 8u; bit++) {
+			crc = (crc & 0x80u) ? (uint8_t)((crc << 1) ^ 0x07u) : (uint8_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/**
+ * \brief Read a LEB128 varint of at most 32 bits
+ *
+ * \return false if the varint runs past end
+ */
+static bool sim_capture_get_varint32(const uint8_t **p, const uint8_t *end, uint32_t *value)
+{
+	uint32_t result = 0;
+	unsigned shift  = 0;
+
+	while ((*p < end) && (shift < 35u)) {
+		uint8_t byte = *(*p)++;
+
+		result |= (uint32_t)(byte & 0x7fu) << shift;
+		if ((byte & 0x80u) == 0u) {
+			*value = result;
+			return true;
+		}
+		shift += 7u;
+	}
+	return false;
+}
+
+/**
+ * \brief Read a LEB128 varint of at most 16 bits
+ *
+ * \return false if the varint runs past end
+ */
+static bool sim_capture_get_varint(const uint8_t **p, const uint8_t *end, uint16_t *value)
+{
+	uint32_t result;
+
+	if (!sim_capture_get_varint32(p, end, &result)) {
+		return false;
+	}
+	*value = (uint16_t)result;
+	return true;
+}
+
+/**
+ * \brief Merge the stage times of a profile frame into the decoder
+ */
+static void sim_capture_decode_profile(struct sim_capture_decoder *decoder, const uint8_t *p, const uint8_t *end)
+{
+	struct sim_capture_profile *profile;
+	uint8_t                     counts_per_us;
+	uint8_t                     stage;
+	uint16_t                    samples;
+	uint32_t                    min;
+	uint32_t                    max;
+	uint32_t                    mean;
+
+	if ((end - p < 2) || (p[0] == 0u) || (p[1] >= SIM_CAPTURE_PROFILE_STAGES)) {
+		return;
+	}
+	counts_per_us = *p++;
+	stage         = *p++;
+	if (!sim_capture_get_varint(&p, end, &samples) || !sim_capture_get_varint32(&p, end, &min)
+	    || !sim_capture_get_varint32(&p, end, &max) || !sim_capture_get_varint32(&p, end, &mean) || (p != end)) {
+		return;
+	}
+
+	profile = &decoder->profile[stage];
+	profile->frames++;
+	if (samples == 0u) {
+		return;
+	}
+	if ((profile->samples == 0u) || ((double)min / counts_per_us < profile->min_us)) {
+		profile->min_us = (double)min / counts_per_us;
+	}
+	if ((double)max / counts_per_us > profile->max_us) {
+		profile->max_us = (double)max / counts_per_us;
+	}
+	profile->samples += samples;
+	profile->sum_us += (double)mean * samples / counts_per_us;
+}
+
+static enum sim_capture_scan sim_capture_decode_dv(struct sim_capture_decoder *decoder,
+                                                   struct sim_capture_frame *frame, uint16_t *consumed)
+{
+	uint16_t       length = sim_capture_frame_length(decoder->num_nodes, decoder->hop_steps);
+	const uint8_t *p      = decoder->buffer;
+	const uint8_t *hop    = &p[2u + SIM_CAPTURE_NODE_BYTES * decoder->num_nodes + 1u];
+	uint8_t        node;
+	uint8_t        step;
+
+	if (decoder->length < length) {
+		return SIM_CAPTURE_MORE;
+	}
+	if ((p[length - 1u] != SIM_CAPTURE_END_TOKEN) || (p[1] != p[length - 2u])) {
+		return SIM_CAPTURE_BAD;
+	}
+
+	frame->sequence = p[1];
+	for (node = 0u; node < decoder->num_nodes; node++) {
+		const uint8_t *n = &p[2u + SIM_CAPTURE_NODE_BYTES * node];
+
+		frame->node[node].signal    = sim_capture_get_u16(&n[0]);
+		frame->node[node].reference = sim_capture_get_u16(&n[2]);
+		frame->node[node].cc        = sim_capture_get_u16(&n[6]);
+		frame->node[node].state     = n[8];
+		frame->node[node].threshold = n[9];
+	}
+	frame->error = hop[-1];
+
+	frame->hop.steps = decoder->hop_steps;
+	for (step = 0u; step < decoder->hop_steps; step++) {
+		frame->hop.freq[step]  = hop[2u * step];
+		frame->hop.noise[step] = hop[2u * step + 1u];
+	}
+
+	*consumed = length;
+	return SIM_CAPTURE_FRAME;
+}
+
+static enum sim_capture_scan sim_capture_decode_compact(struct sim_capture_decoder *decoder,
+                                                        struct sim_capture_frame *frame, uint16_t *consumed)
+{
+	const uint8_t *p = decoder->buffer;
+	const uint8_t *end;
+	const uint8_t *bits;
+	uint16_t       length;
+	uint8_t        flags;
+	uint8_t        sequence;
+	bool           keyframe;
+	uint8_t        node;
+	uint8_t        step;
+
+	if (decoder->length < 2u) {
+		return SIM_CAPTURE_MORE;
+	}
+	length = 4u + p[1] + 1u;
+	if (length > SIM_CAPTURE_COMPACT_MAX) {
+		return SIM_CAPTURE_BAD;
+	}
+	if (decoder->length < length) {
+		return SIM_CAPTURE_MORE;
+	}
+	if (sim_capture_crc8(&p[1], length - 2u) != p[length - 1u]) {
+		decoder->crc_errors++;
+		decoder->synced = false;
+		return SIM_CAPTURE_BAD;
+	}
+
+	*consumed = length;
+	sequence  = p[2];
+	flags     = p[3];
+	end       = &p[length - 1u];
+	p         = &p[4];
+
+	if ((flags & SIM_CAPTURE_COMPACT_TYPE_MASK) == SIM_CAPTURE_COMPACT_TYPE_INFO) {
+		decoder->sequence = sequence;
+		if ((end - p == 2 + decoder->num_nodes) && (p[0] == SIM_CAPTURE_COMPACT_VERSION)
+		    && (p[1] == decoder->num_nodes)) {
+			memcpy(decoder->threshold, &p[2], decoder->num_nodes);
+		}
+		return SIM_CAPTURE_SKIP;
+	}
+	if ((flags & SIM_CAPTURE_COMPACT_TYPE_MASK) == SIM_CAPTURE_COMPACT_TYPE_PROFILE) {
+		sim_capture_decode_profile(decoder, p, end);
+		return SIM_CAPTURE_SKIP;
+	}
+	if ((flags & SIM_CAPTURE_COMPACT_TYPE_MASK) != SIM_CAPTURE_COMPACT_TYPE_SAMPLES) {
+		return SIM_CAPTURE_SKIP;
+	}
+
+	/* Difference frames need every frame since the last key frame */
+	keyframe = (flags & SIM_CAPTURE_COMPACT_KEYFRAME) != 0u;
+	if (!keyframe && (!decoder->synced || (sequence != (uint8_t)(decoder->sequence + 1u)))) {
+		decoder->synced = false;
+		return SIM_CAPTURE_SKIP;
+	}
+	decoder->synced   = false;
+	decoder->sequence = sequence;
+
+	bits = p;
+	p += (2u * decoder->num_nodes + 7u) / 8u;
+	frame->error = 0;
+	if ((flags & SIM_CAPTURE_COMPACT_ERROR) != 0u) {
+		frame->error = *p++;
+	}
+	if ((flags & SIM_CAPTURE_COMPACT_HOP) != 0u) {
+		if ((p >= end) || (*p > SIM_CAPTURE_MAX_HOP_STEPS) || (end - p < 1 + 2 * *p)) {
+			return SIM_CAPTURE_SKIP;
+		}
+		decoder->hop.steps = *p++;
+		for (step = 0u; step < decoder->hop.steps; step++) {
+			decoder->hop.freq[step]  = *p++;
+			decoder->hop.noise[step] = *p++;
+		}
+	}
+	if (p > end) {
+		return SIM_CAPTURE_SKIP;
+	}
+	frame->hop = decoder->hop;
+
+	for (node = 0u; node < decoder->num_nodes; node++) {
+		uint16_t *last    = decoder->last[node];
+		unsigned  present = decoder->num_nodes + node;
+		unsigned  value;
+
+		for (value = 0; value < 3u; value++) {
+			uint16_t v;
+
+			if ((value > 0u) && !(bits[present / 8u] & (1u << (present % 8u)))) {
+				break;
+			}
+			if (!sim_capture_get_varint(&p, end, &v)) {
+				return SIM_CAPTURE_SKIP;
+			}
+			/* Zigzag decode the difference */
+			last[value] = keyframe ? v : (uint16_t)(last[value] + ((v >> 1) ^ -(v & 1u)));
+		}
+
+		frame->node[node].signal    = last[0];
+		frame->node[node].reference = last[1];
+		frame->node[node].cc        = last[2];
+		frame->node[node].state     = (bits[node / 8u] >> (node % 8u)) & 1u;
+		frame->node[node].threshold = decoder->threshold[node];
+	}
+	if (p != end) {
+		return SIM_CAPTURE_SKIP;
+	}
+
+	decoder->synced = true;
+	frame->sequence = sequence;
+	return SIM_CAPTURE_FRAME;
+}
+
+/**
+ * \brief Feed one byte of the USART stream
+ *
+ * \return true when the byte completed a frame, which is stored in *frame.
+ *         The time stamp of the frame is left to the caller.
+ */
+bool sim_capture_decoder_put(struct sim_capture_decoder *decoder, uint8_t byte, struct sim_capture_frame *frame)
+{
+	enum sim_capture_scan scan;
+	uint16_t              consumed = 0;
+	uint16_t              start;
+
+	if ((decoder->length == 0u) && !sim_capture_is_start(byte)) {
+		decoder->skipped++;
+		return false;
+	}
+	decoder->buffer[decoder->length++] = byte;
+
+	while (decoder->length > 0u) {
+		if (decoder->buffer[0] == SIM_CAPTURE_START_TOKEN) {
+			scan = sim_capture_decode_dv(decoder, frame, &consumed);
+		} else {
+			scan = sim_capture_decode_compact(decoder, frame, &consumed);
+		}
+
+		if (scan == SIM_CAPTURE_MORE) {
+			return false;
+		}
+		if (scan == SIM_CAPTURE_BAD) {
+			/* Not a frame, restart at the next start token */
+			for (start = 1u; (start < decoder->length) && !sim_capture_is_start(decoder->buffer[start]); start++)
+				;
+			decoder->skipped += start;
+			consumed = start;
+		}
+
+		decoder->length -= consumed;
+		memmove(decoder->buffer, &decoder->buffer[consumed], decoder->length);
+		if (scan == SIM_CAPTURE_FRAME) {
+			decoder->frames++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void sim_capture_write_header(FILE *file, uint8_t num_nodes)
+{
+	fprintf(file, "# touch capture, %u nodes\n", num_nodes);
+	fprintf(file, "# time_ms sequence error, per node: signal reference cc state threshold\n");
+}
+
+void sim_capture_write_frame(FILE *file, uint8_t num_nodes, const struct sim_capture_frame *frame)
+{
+	uint8_t node;
+
+	fprintf(file, "%u %u %u", (unsigned)frame->time_ms, frame->sequence, frame->error);
+	for (node = 0u; node < num_nodes; node++) {
+		fprintf(file,
+		        " %u %u %u %u %u",
+		        frame->node[node].signal,
+		        frame->node[node].reference,
+		        frame->node[node].cc,
+		        frame->node[node].state,
+		        frame->node[node].threshold);
+	}
+	fputc('\n', file);
+}
+
+/**
+ * \brief Parse one capture line
+ *
+ * \return Number of nodes on the line, 0 if it is not a valid frame
+ */
+static uint8_t sim_capture_parse_line(char *line, struct sim_capture_frame *frame)
+{
+	unsigned long values[3u + 5u * SIM_CAPTURE_MAX_NODES];
+	unsigned      count = 0;
+	char *        p     = line;
+	char *        end;
+	uint8_t       node;
+
+	while (count < sizeof(values) / sizeof(values[0])) {
+		values[count] = strtoul(p, &end, 10);
+		if (end == p) {
+			break;
+		}
+		p = end;
+		count++;
+	}
+	if ((count < 8u) || (((count - 3u) % 5u) != 0u)) {
+		return 0;
+	}
+
+	frame->time_ms  = values[0];
+	frame->sequence = values[1];
+	frame->error    = values[2];
+	for (node = 0u; node < (count - 3u) / 5u; node++) {
+		const unsigned long *v = &values[3u + 5u * node];
+
+		frame->node[node].signal    = v[0];
+		frame->node[node].reference = v[1];
+		frame->node[node].cc        = v[2];
+		frame->node[node].state     = v[3];
+		frame->node[node].threshold = v[4];
+	}
+	return node;
+}
+
+/**
+ * \brief Load a capture file
+ *
+ * All frames must have the same number of nodes. Frames are expected in time
+ * order.
+ *
+ * \return 0 on success, -1 on error (reported on stderr)
+ */
+int sim_capture_load(const char *path, struct sim_capture *capture)
+{
+	char     line[SIM_CAPTURE_LINE_MAX];
+	FILE *   file = fopen(path, "r");
+	uint32_t capacity = 0;
+	uint32_t line_number = 0;
+	uint8_t  num_nodes;
+
+	memset(capture, 0, sizeof(*capture));
+	if (file == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		struct sim_capture_frame frame;
+
+		line_number++;
+		if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0')) {
+			continue;
+		}
+		num_nodes = sim_capture_parse_line(line, &frame);
+		if ((num_nodes == 0u) || ((capture->num_nodes != 0u) && (num_nodes != capture->num_nodes))) {
+			fprintf(stderr, "%s:%u: malformed frame\n", path, (unsigned)line_number);
+			fclose(file);
+			sim_capture_free(capture);
+			return -1;
+		}
+		capture->num_nodes = num_nodes;
+
+		if (capture->num_frames == capacity) {
+			struct sim_capture_frame *frames;
+
+			capacity = capacity ? 2u * capacity : 1024u;
+			frames   = realloc(capture->frames, capacity * sizeof(*frames));
+			if (frames == NULL) {
+				fprintf(stderr, "%s: out of memory\n", path);
+				fclose(file);
+				sim_capture_free(capture);
+				return -1;
+			}
+			capture->frames = frames;
+		}
+		capture->frames[capture->num_frames++] = frame;
+	}
+
+	fclose(file);
+	if (capture->num_frames == 0u) {
+		fprintf(stderr, "%s: no frames\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+void sim_capture_free(struct sim_capture *capture)
+{
+	free(capture->frames);
+	memset(capture, 0, sizeof(*capture));
+}
@@ -0,0 +1,129 @@
+/**
+ * \file
+ *
+ * \brief Datastreamer frame decoder and touch capture files.
+ *
+ * A capture is a text file with one line per datastreamer frame:
+ *
+ *   <time_ms> <sequence> <error> then per node
+ *   <signal> <reference> <cc> <state> <threshold>
+ *
+ * Lines starting with '#' are comments. The delta is not stored, it is
+ * signal - reference. State is the detect bit of the datastreamer frame.
+ * Data Visualizer and compact datastreamer frames are both decoded; compact
+ * frames carry the thresholds in the header frame only, they are 0 until one
+ * has been received. The frequency hop data of the frames is decoded but not
+ * stored in captures, nor are the stage times of the profile frames, which
+ * the decoder merges per stage.
+ * Captures are written by ds_capture.py from a board and by touch_sim
+ * --capture from a simulation run.
+ */
+
+#ifndef SIM_CAPTURE_H_INCLUDED
+#define SIM_CAPTURE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_CAPTURE_MAX_NODES 16u
+
+#define SIM_CAPTURE_MAX_HOP_STEPS 7u
+
+/* Bytes per node in a Data Visualizer frame */
+#define SIM_CAPTURE_NODE_BYTES 10u
+
+/* Largest Data Visualizer frame: start token, sequence, nodes, error code,
+ * frequency and noise figure per hop step, sequence, end token. Larger than
+ * any compact frame, it sizes the decoder buffer. */
+#define SIM_CAPTURE_DV_MAX (2u + SIM_CAPTURE_NODE_BYTES * SIM_CAPTURE_MAX_NODES + 1u + 2u * SIM_CAPTURE_MAX_HOP_STEPS + 2u)
+
+/* Largest compact frame: sync, length, sequence, flags, state bits, error
+ * code, hop step count, frequency and noise figure per hop step, three 3-byte
+ * varints per node, CRC */
+#define SIM_CAPTURE_COMPACT_MAX                                                                                        \
+	(4u + (2u * SIM_CAPTURE_MAX_NODES + 7u) / 8u + 1u + 1u + 2u * SIM_CAPTURE_MAX_HOP_STEPS + 9u * SIM_CAPTURE_MAX_NODES \
+	 + 1u)
+
+struct sim_capture_node {
+	uint16_t signal;
+	uint16_t reference;
+	uint16_t cc;
+	uint8_t  state;
+	uint8_t  threshold;
+};
+
+/* Acquisition frequency and noise figure of each frequency hop step */
+struct sim_capture_hop {
+	uint8_t steps;
+	uint8_t freq[SIM_CAPTURE_MAX_HOP_STEPS];
+	uint8_t noise[SIM_CAPTURE_MAX_HOP_STEPS];
+};
+
+/* Stages of the profile frames, enum touch_profile_stage of the firmware */
+#define SIM_CAPTURE_PROFILE_STAGES 8u
+
+/* Profile frames of one stage merged: frames, samples in them, and the
+ * shortest, longest and summed stage time in us */
+struct sim_capture_profile {
+	uint32_t frames;
+	uint64_t samples;
+	double   min_us;
+	double   max_us;
+	double   sum_us;
+};
+
+struct sim_capture_frame {
+	uint32_t                time_ms;
+	uint8_t                 sequence;
+	uint8_t                 error;
+	struct sim_capture_hop  hop;
+	struct sim_capture_node node[SIM_CAPTURE_MAX_NODES];
+};
+
+/* Byte stream decoder, resynchronises on the start tokens. Compact frames
+ * are delta encoded, after a CRC error or a sequence gap frames are skipped
+ * until the next key frame. Data Visualizer frames have a fixed layout, the
+ * number of hop steps in them has to be given. Compact frames carry the hop
+ * data in key frames, the last one received is reported with every frame.
+ */
+struct sim_capture_decoder {
+	uint8_t                    num_nodes;
+	uint8_t                    hop_steps;
+	uint16_t                   length;
+	uint8_t                    buffer[SIM_CAPTURE_DV_MAX];
+	bool                       synced;
+	uint8_t                    sequence;
+	uint16_t                   last[SIM_CAPTURE_MAX_NODES][3];
+	uint8_t                    threshold[SIM_CAPTURE_MAX_NODES];
+	struct sim_capture_hop     hop;
+	struct sim_capture_profile profile[SIM_CAPTURE_PROFILE_STAGES];
+	uint32_t                   frames;
+	uint32_t                   skipped;
+	uint32_t                   crc_errors;
+};
+
+struct sim_capture {
+	uint8_t                   num_nodes;
+	uint32_t                  num_frames;
+	struct sim_capture_frame *frames;
+};
+
+void sim_capture_decoder_init(struct sim_capture_decoder *decoder, uint8_t num_nodes, uint8_t hop_steps);
+bool sim_capture_decoder_put(struct sim_capture_decoder *decoder, uint8_t byte, struct sim_capture_frame *frame);
+
+void sim_capture_write_header(FILE *file, uint8_t num_nodes);
+void sim_capture_write_frame(FILE *file, uint8_t num_nodes, const struct sim_capture_frame *frame);
+
+int  sim_capture_load(const char *path, struct sim_capture *capture);
+void sim_capture_free(struct sim_capture *capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_CAPTURE_H_INCLUDED */
@@ -0,0 +1,1491 @@
+/**
+ * \file
+ *
+ * \brief Host simulation of the ATtiny816 core and peripherals.
+ *
+ * Provides the register instances behind sim/include/avr/io.h, the global
+ * interrupt flag, interrupt dispatch to the firmware ISR functions and an
+ * event-driven model of simulated time:
+ *
+ * - RTC: CNT follows simulated time at the rate set by CTRLA, a compare match
+ *   raises RTC_CNT_vect when INTCTRL.CMP is set. The PIT calls
+ *   sim_qtm_pit_event() each period while PITEN is set.
+ * - USART0: the data register empty interrupt is dispatched while DREIE is
+ *   set and the transmitter is free. A byte written by the handler is passed
+ *   to the UART sink and occupies the transmitter for ten bit times, then
+ *   TXCIF is set and the transmit complete interrupt is dispatched if TXCIE is
+ *   set.
+ *   Received bytes are delivered at their scheduled time through RXDATAL and
+ *   the receive complete interrupt. In standby a byte is only received with
+ *   start frame detection enabled, otherwise it is lost.
+ * - NVMCTRL: the firmware reads and writes the EEPROM array directly, there
+ *   is no page buffer. The page erase/write command counts a write of each
+ *   page whose content changed since the last command and sets EEBUSY for
+ *   the page programming time.
+ * - PTC: the acquisition fake schedules ADC0_RESRDY_vect/ADC0_WCOMP_vect with
+ *   sim_hw_raise_irq_at().
+ * - PORTA to PORTC: input levels scheduled with sim_hw_set_pin_at() are
+ *   applied to IN at their time, and a pin change sets the flag in INTFLAGS
+ *   and raises the port interrupt as selected by the ISC bits of its
+ *   PINnCTRL. A mains zero-cross detector toggles PC3 the same way at each
+ *   zero-cross, the first one at SIM_MAINS_PHASE_NS. Changes of OUT are
+ *   passed to the pin monitor at the time they are made.
+ * - BOD: VDD dips below the voltage level monitor threshold at the times
+ *   added with sim_hw_add_supply_dip(). STATUS.VLMS follows VDD and
+ *   BOD_VLM_vect is raised on the crossings selected by VLMCFG while VLMIE is
+ *   set.
+ * - TCA0: normal mode only. While ENABLE is set CNT counts CLK_PER divided
+ *   as selected by CLKSEL up to PER, and halts in standby. A compare match of
+ *   channel n raises TCA0_CMPn_vect, the overflow raises TCA0_OVF_vect, each
+ *   if enabled in INTCTRL. CMPnBUF is copied to CMPn at the overflow. CNT is
+ *   only read when the timer is enabled and only written when it stops.
+ * - TCB0: periodic interrupt mode only. While ENABLE is set CNT counts
+ *   CLK_PER or CLK_PER / 2 up to CCMP, which raises TCB0_INT_vect if
+ *   enabled in INTCTRL, and starts again from 0. It halts in standby. CNT
+ *   follows the count before each interrupt handler and at the start of each
+ *   critical section, where INTFLAGS also shows a pending interrupt, and a
+ *   different value written by the firmware restarts the count from there.
+ * - SRAM: the static data of the firmware lives in host memory, the first
+ *   SIM_SRAM_STATIC bytes of sim_sram stand in for it. The stack pointer
+ *   starts SIM_MAIN_STACK bytes below RAMEND, for the frames of the main
+ *   loop, and each interrupt handler pushes SIM_ISR_STACK bytes below it.
+ *   The stack does not grow with the calls of the firmware on the host.
+ * - WDT: counts 1.024 kHz clocks from the write of CTRLA and from each
+ *   wdr, in all sleep modes. A wdr within the closed window set by WINDOW, or
+ *   none until the end of the open window set by PERIOD, resets the device,
+ *   which ends the run.
+ *
+ * Flags that are cleared by writing one on the device are kept here and not in
+ * the register copies, since a plain RAM write would set them instead.
+ */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <atomic.h>
+
+#include "sim_hw.h"
+
+#define SIM_RTC_CLOCK_HZ 32768ull
+#define SIM_F_CPU 20000000ull
+
+/* Main loop passes without sleeping before the simulation is aborted */
+#define SIM_SPIN_LIMIT 10000000ul
+
+#define SIM_NEVER UINT64_MAX
+
+/* Supply dips below the voltage level monitor threshold */
+#define SIM_MAX_SUPPLY_DIPS 8u
+
+/* TCA0 interrupt sources */
+#define SIM_TCA_IRQS                                                                                                   \
+	((1ul << SIM_IRQ_TCA0_OVF) | (1ul << SIM_IRQ_TCA0_CMP0) | (1ul << SIM_IRQ_TCA0_CMP1) | (1ul << SIM_IRQ_TCA0_CMP2))
+
+/* Zero-cross detector input and the time of the first zero-cross */
+#define SIM_ZERO_CROSS_PIN PIN3_bm
+#define SIM_MAINS_PHASE_NS 3300000ull
+
+/* Input changes scheduled on the ports */
+#define SIM_MAX_PIN_EVENTS 32u
+
+/* Watchdog clock */
+#define SIM_WDT_CLOCK_HZ 1024ull
+
+/* Static data and stack use of the firmware on the device, see sim_sram */
+#define SIM_SRAM_STATIC 320
+#define SIM_MAIN_STACK 64u
+#define SIM_ISR_STACK 24u
+
+/* Value of a macro as a string */
+#define SIM_STR_(x) #x
+#define SIM_STR(x) SIM_STR_(x)
+
+/* EEPROM page erase/write time */
+#define SIM_EEPROM_WRITE_NS (4u * SIM_NS_PER_MS)
+
+#if EEPROM_SIZE / EEPROM_PAGE_SIZE != SIM_EEPROM_PAGES
+#error "SIM_EEPROM_PAGES does not match the EEPROM of the device header"
+#endif
+
+/* Register instances */
+BOD_t     sim_BOD;
+CLKCTRL_t sim_CLKCTRL;
+CPUINT_t  sim_CPUINT;
+NVMCTRL_t sim_NVMCTRL;
+PORT_t    sim_PORTA, sim_PORTB, sim_PORTC;
+VPORT_t   sim_VPORTA, sim_VPORTB, sim_VPORTC;
+RSTCTRL_t sim_RSTCTRL;
+RTC_t     sim_RTC;
+SLPCTRL_t sim_SLPCTRL;
+TCA_t     sim_TCA0;
+TCB_t     sim_TCB0;
+USART_t   sim_USART0;
+WDT_t     sim_WDT;
+
+/* EEPROM, erased, and its content at the last write command. It is kept over
+ * sim_hw_reset() like on the device. */
+uint8_t        sim_eeprom[EEPROM_SIZE] = {[0 ... EEPROM_SIZE - 1] = 0xFF};
+static uint8_t sim_eeprom_cells[EEPROM_SIZE] = {[0 ... EEPROM_SIZE - 1] = 0xFF};
+
+/* User row, the same way */
+uint8_t        sim_userrow[USER_SIGNATURES_SIZE] = {[0 ... USER_SIGNATURES_SIZE - 1] = 0xFF};
+static uint8_t sim_userrow_cells[USER_SIGNATURES_SIZE] = {[0 ... USER_SIGNATURES_SIZE - 1] = 0xFF};
+
+/* SRAM and the stack pointer, and the linker script symbols of the start of
+ * the static data and of the free RAM above it, see avr/io.h */
+uint8_t  sim_sram[RAMSIZE] = {0};
+uint8_t *sim_SP;
+__asm__(".globl sim_data_start\n\t.set sim_data_start, sim_sram\n\t"
+        ".globl sim_heap_start\n\t.set sim_heap_start, sim_sram + " SIM_STR(SIM_SRAM_STATIC));
+
+/* Firmware interrupt handlers, empty unless the firmware defines them */
+__attribute__((weak)) void BOD_VLM_vect(void)
+{
+}
+__attribute__((weak)) void PORTA_PORT_vect(void)
+{
+}
+__attribute__((weak)) void PORTB_PORT_vect(void)
+{
+}
+__attribute__((weak)) void PORTC_PORT_vect(void)
+{
+}
+__attribute__((weak)) void RTC_CNT_vect(void)
+{
+}
+__attribute__((weak)) void RTC_PIT_vect(void)
+{
+}
+__attribute__((weak)) void TCA0_OVF_vect(void)
+{
+}
+__attribute__((weak)) void TCA0_CMP0_vect(void)
+{
+}
+__attribute__((weak)) void TCA0_CMP1_vect(void)
+{
+}
+__attribute__((weak)) void TCA0_CMP2_vect(void)
+{
+}
+__attribute__((weak)) void TCB0_INT_vect(void)
+{
+}
+__attribute__((weak)) void ADC0_RESRDY_vect(void)
+{
+}
+__attribute__((weak)) void ADC0_WCOMP_vect(void)
+{
+}
+__attribute__((weak)) void USART0_RXC_vect(void)
+{
+}
+__attribute__((weak)) void USART0_DRE_vect(void)
+{
+}
+__attribute__((weak)) void USART0_TXC_vect(void)
+{
+}
+
+static void (*const sim_vectors[SIM_IRQ_COUNT])(void) = {
+    BOD_VLM_vect,
+    PORTA_PORT_vect,
+    PORTB_PORT_vect,
+    PORTC_PORT_vect,
+    RTC_CNT_vect,
+    RTC_PIT_vect,
+    TCA0_OVF_vect,
+    TCA0_CMP0_vect,
+    TCA0_CMP1_vect,
+    TCA0_CMP2_vect,
+    TCB0_INT_vect,
+    ADC0_RESRDY_vect,
+    ADC0_WCOMP_vect,
+    USART0_RXC_vect,
+    USART0_DRE_vect,
+    USART0_TXC_vect,
+};
+
+static const char *const sim_irq_names[SIM_IRQ_COUNT] = {
+    "BOD_VLM",
+    "PORTA_PORT",
+    "PORTB_PORT",
+    "PORTC_PORT",
+    "RTC_CNT",
+    "RTC_PIT",
+    "TCA0_OVF",
+    "TCA0_CMP0",
+    "TCA0_CMP1",
+    "TCA0_CMP2",
+    "TCB0_INT",
+    "ADC0_RESRDY",
+    "ADC0_WCOMP",
+    "USART0_RXC",
+    "USART0_DRE",
+    "USART0_TXC",
+};
+
+static uint64_t sim_now_ns;
+static uint64_t sim_end_ns;
+static jmp_buf  sim_exit;
+
+static bool     sim_irq_enabled;
+static bool     sim_in_isr;
+static uint32_t sim_irq_pending;
+static uint64_t sim_irq_due[SIM_IRQ_COUNT];
+
+static uint64_t sim_rtc_ticks;
+static uint64_t sim_pit_next_ns;
+static uint64_t sim_uart_busy_until_ns;
+static uint64_t sim_eeprom_busy_until_ns;
+
+/* Mains: half period, 0 without mains, and the number of the next zero-cross */
+static double   sim_mains_half_ns;
+static uint64_t sim_mains_next;
+
+/* Port interrupt flags, outputs last passed to the monitor and the input
+ * changes to come, in time order */
+struct sim_pin_event {
+	uint64_t time_ns;
+	uint8_t  port;
+	uint8_t  mask;
+	bool     level;
+};
+
+static uint8_t              sim_port_flags[SIM_PORTS];
+static uint8_t              sim_port_out[SIM_PORTS];
+static struct sim_pin_event sim_pin_events[SIM_MAX_PIN_EVENTS];
+static uint8_t              sim_num_pin_events;
+
+/* Supply dips, start and end times, and the number of edges passed */
+static uint64_t sim_supply_edges[2u * SIM_MAX_SUPPLY_DIPS];
+static uint8_t  sim_supply_num_edges;
+static uint8_t  sim_supply_next;
+
+/* TCA0: counting, time CNT was last 0 and the compare channels matched since */
+static bool     sim_tca_running;
+static uint64_t sim_tca_period_ns;
+static uint8_t  sim_tca_matched;
+
+/* TCB0: counting, time CNT was last 0 and the count last put into CNT */
+static bool     sim_tcb_running;
+static uint64_t sim_tcb_period_ns;
+static uint16_t sim_tcb_cnt;
+
+/* Watchdog: start of the closed window */
+static uint64_t sim_wdt_kick_ns;
+
+static const struct sim_uart_rx *sim_uart_rx_bytes;
+static size_t                    sim_uart_rx_count;
+static size_t                    sim_uart_rx_next;
+
+static unsigned long       sim_spin_count;
+static FILE *              sim_uart_sink;
+static void                (*sim_uart_monitor)(uint8_t byte, uint64_t time_ns);
+static void                (*sim_observer)(uint64_t time_ns);
+static void                (*sim_pin_monitor)(enum sim_port port, uint8_t out, uint64_t time_ns);
+static struct sim_hw_stats sim_stats;
+
+/**
+ * \brief RTC count rate from the prescaler setting
+ */
+static uint64_t sim_rtc_hz(void)
+{
+	return SIM_RTC_CLOCK_HZ >> ((RTC.CTRLA & RTC_PRESCALER_gm) >> 3);
+}
+
+/**
+ * \brief Absolute RTC tick count at a point in time
+ */
+static uint64_t sim_rtc_ticks_at(uint64_t time_ns)
+{
+	return (time_ns * sim_rtc_hz()) / SIM_NS_PER_S;
+}
+
+/**
+ * \brief First point in time at which an absolute RTC tick count is reached
+ */
+static uint64_t sim_rtc_tick_time(uint64_t ticks)
+{
+	uint64_t hz = sim_rtc_hz();
+
+	return (ticks * SIM_NS_PER_S + hz - 1u) / hz;
+}
+
+/**
+ * \brief Time of the next RTC compare match
+ */
+static uint64_t sim_rtc_next_match(void)
+{
+	uint64_t delta;
+
+	if (!(RTC.CTRLA & RTC_RTCEN_bm) || !(RTC.INTCTRL & RTC_CMP_bm)) {
+		return SIM_NEVER;
+	}
+
+	delta = (uint16_t)(RTC.CMP - (uint16_t)sim_rtc_ticks);
+	if (delta == 0u) {
+		delta = 0x10000u;
+	}
+
+	return sim_rtc_tick_time(sim_rtc_ticks + delta);
+}
+
+/**
+ * \brief PIT period from RTC.PITCTRLA
+ */
+static uint64_t sim_pit_period_ns(void)
+{
+	uint8_t period = (RTC.PITCTRLA >> RTC_PERIOD_gp) & 0x0fu;
+
+	if (period == 0u) {
+		return SIM_NEVER;
+	}
+
+	return ((1ull << (period + 1u)) * SIM_NS_PER_S) / SIM_RTC_CLOCK_HZ;
+}
+
+/**
+ * \brief Time of the next PIT event
+ */
+static uint64_t sim_rtc_next_pit(void)
+{
+	uint64_t period;
+
+	if (!(RTC.PITCTRLA & RTC_PITEN_bm)) {
+		sim_pit_next_ns = SIM_NEVER;
+		return SIM_NEVER;
+	}
+
+	period = sim_pit_period_ns();
+	if ((sim_pit_next_ns == SIM_NEVER) && (period != SIM_NEVER)) {
+		sim_pit_next_ns = sim_now_ns + period;
+	}
+
+	return sim_pit_next_ns;
+}
+
+/**
+ * \brief Duration of one USART frame (start, 8 data, stop bits)
+ */
+static uint64_t sim_uart_frame_ns(void)
+{
+	uint64_t baud_reg = USART0.BAUD ? USART0.BAUD : 2083u;
+
+	return (10u * SIM_NS_PER_S * 16u * baud_reg) / (64u * SIM_F_CPU);
+}
+
+/**
+ * \brief Raise the level triggered USART interrupts whose condition holds
+ *
+ * \return true if one of them is pending
+ */
+static bool sim_uart_irq_update(void)
+{
+	if (sim_now_ns < sim_uart_busy_until_ns) {
+		return false;
+	}
+
+	if (USART0.CTRLA & USART_DREIE_bm) {
+		sim_irq_pending |= 1ul << SIM_IRQ_USART0_DRE;
+	}
+	if ((USART0.CTRLA & USART_TXCIE_bm) && (USART0.STATUS & USART_TXCIF_bm)) {
+		sim_irq_pending |= 1ul << SIM_IRQ_USART0_TXC;
+	}
+
+	return (sim_irq_pending & ((1ul << SIM_IRQ_USART0_DRE) | (1ul << SIM_IRQ_USART0_TXC))) != 0u;
+}
+
+/**
+ * \brief Run the data register empty handler and capture the byte it sends
+ *
+ * The handler acknowledges TXCIF before it writes TXDATAL, which leaves the
+ * bit set in the RAM copy of STATUS and marks that a byte was written.
+ */
+static void sim_uart_dre(void)
+{
+	USART0.STATUS = USART_DREIF_bm;
+	USART0_DRE_vect();
+
+	if (USART0.STATUS & USART_TXCIF_bm) {
+		sim_uart_busy_until_ns = sim_now_ns + sim_uart_frame_ns();
+		sim_stats.uart_bytes++;
+		if (sim_uart_sink != NULL) {
+			fputc(USART0.TXDATAL, sim_uart_sink);
+		}
+		if (sim_uart_monitor != NULL) {
+			sim_uart_monitor(USART0.TXDATAL, sim_uart_busy_until_ns);
+		}
+		USART0.STATUS = 0;
+	} else {
+		USART0.STATUS = USART_DREIF_bm | USART_TXCIF_bm;
+	}
+}
+
+/**
+ * \brief Time the next byte arrives at the USART receiver
+ */
+static uint64_t sim_uart_rx_time(void)
+{
+	return (sim_uart_rx_next < sim_uart_rx_count) ? sim_uart_rx_bytes[sim_uart_rx_next].time_ns : SIM_NEVER;
+}
+
+/**
+ * \brief Deliver the bytes that have arrived to the USART receiver
+ */
+static void sim_uart_receive(bool standby)
+{
+	while (sim_uart_rx_time() <= sim_now_ns) {
+		uint8_t byte = sim_uart_rx_bytes[sim_uart_rx_next++].byte;
+
+		if (!(USART0.CTRLB & USART_RXEN_bm) || (standby && !(USART0.CTRLB & USART_SFDEN_bm))
+		    || (sim_irq_pending & (1ul << SIM_IRQ_USART0_RXC))) {
+			/* Receiver off, asleep or the previous byte not read yet */
+			sim_stats.uart_rx_lost++;
+			continue;
+		}
+		USART0.RXDATAL = byte;
+		sim_stats.uart_rx_bytes++;
+		if (USART0.CTRLA & USART_RXCIE_bm) {
+			sim_irq_pending |= 1ul << SIM_IRQ_USART0_RXC;
+		}
+	}
+}
+
+/**
+ * \brief Registers of a port
+ */
+static PORT_t *sim_port(uint8_t port)
+{
+	static PORT_t *const ports[SIM_PORTS] = {&sim_PORTA, &sim_PORTB, &sim_PORTC};
+
+	return ports[port];
+}
+
+/**
+ * \brief Virtual port registers of a port
+ */
+static VPORT_t *sim_vport(uint8_t port)
+{
+	static VPORT_t *const vports[SIM_PORTS] = {&sim_VPORTA, &sim_VPORTB, &sim_VPORTC};
+
+	return vports[port];
+}
+
+/**
+ * \brief Set the input level of port pins and sense the change
+ *
+ * \param[in] port  Port
+ * \param[in] mask  Pins to set
+ * \param[in] level Level to set them to
+ */
+static void sim_pin_set(uint8_t port, uint8_t mask, bool level)
+{
+	VPORT_t *vport   = sim_vport(port);
+	uint8_t  changed = (uint8_t)((level ? ~vport->IN : vport->IN) & mask);
+	uint8_t  pin;
+	uint8_t  isc;
+
+	vport->IN = level ? (uint8_t)(vport->IN | mask) : (uint8_t)(vport->IN & ~mask);
+	sim_port(port)->IN = vport->IN;
+
+	for (pin = 0; pin < 8u; pin++) {
+		if (!(changed & (1u << pin))) {
+			continue;
+		}
+		isc = (&sim_port(port)->PIN0CTRL)[pin] & PORT_ISC_gm;
+		if ((isc == PORT_ISC_BOTHEDGES_gc) || ((isc == PORT_ISC_RISING_gc) && level)
+		    || ((isc == PORT_ISC_FALLING_gc) && !level)) {
+			sim_port_flags[port] |= 1u << pin;
+			sim_irq_pending |= 1ul << (SIM_IRQ_PORTA_PORT + port);
+		}
+	}
+}
+
+/**
+ * \brief Time of the next scheduled input change
+ */
+static uint64_t sim_pin_next_ns(void)
+{
+	return (sim_num_pin_events != 0u) ? sim_pin_events[0].time_ns : SIM_NEVER;
+}
+
+/**
+ * \brief Apply the input changes that are due now
+ */
+static void sim_pin_event(void)
+{
+	while ((sim_num_pin_events != 0u) && (sim_pin_events[0].time_ns == sim_now_ns)) {
+		sim_pin_set(sim_pin_events[0].port, sim_pin_events[0].mask, sim_pin_events[0].level);
+		sim_num_pin_events--;
+		memmove(&sim_pin_events[0], &sim_pin_events[1], sim_num_pin_events * sizeof(sim_pin_events[0]));
+	}
+}
+
+/**
+ * \brief Pass the output changes made since the last call to the pin monitor
+ */
+static void sim_pin_monitor_check(void)
+{
+	uint8_t port;
+	uint8_t out;
+
+	for (port = 0; port < SIM_PORTS; port++) {
+		out = sim_vport(port)->OUT;
+		if (out != sim_port_out[port]) {
+			sim_port_out[port] = out;
+			if (sim_pin_monitor != NULL) {
+				sim_pin_monitor((enum sim_port)port, out, sim_now_ns);
+			}
+		}
+	}
+}
+
+/**
+ * \brief Time of a zero-cross of the mains
+ */
+static uint64_t sim_mains_zero_cross_ns(uint64_t number)
+{
+	return SIM_MAINS_PHASE_NS + (uint64_t)(number * sim_mains_half_ns + 0.5);
+}
+
+/**
+ * \brief Time the zero-cross detector output changes next
+ */
+static uint64_t sim_mains_next_ns(void)
+{
+	return (sim_mains_half_ns > 0) ? sim_mains_zero_cross_ns(sim_mains_next) : SIM_NEVER;
+}
+
+/**
+ * \brief Toggle the zero-cross detector output and sense the pin change
+ */
+static void sim_mains_edge(void)
+{
+	sim_mains_next++;
+	sim_pin_set(SIM_PORT_C, SIM_ZERO_CROSS_PIN, !(VPORTC.IN & SIM_ZERO_CROSS_PIN));
+}
+
+/**
+ * \brief Time VDD crosses the voltage level monitor threshold next
+ */
+static uint64_t sim_supply_next_ns(void)
+{
+	return (sim_supply_next < sim_supply_num_edges) ? sim_supply_edges[sim_supply_next] : SIM_NEVER;
+}
+
+/**
+ * \brief Cross the voltage level monitor threshold
+ */
+static void sim_supply_edge(void)
+{
+	uint8_t cfg = BOD.INTCTRL & BOD_VLMCFG_gm;
+	bool    low = (sim_supply_next++ & 1u) == 0u;
+
+	BOD.STATUS = low ? BOD_VLMS_bm : 0u;
+
+	if ((BOD.INTCTRL & BOD_VLMIE_bm)
+	    && ((cfg == BOD_VLMCFG_CROSS_gc) || ((cfg == BOD_VLMCFG_BELOW_gc) && low)
+	        || ((cfg == BOD_VLMCFG_ABOVE_gc) && !low))) {
+		sim_irq_pending |= 1ul << SIM_IRQ_BOD_VLM;
+	}
+}
+
+/**
+ * \brief Duration of one TCA0 count from CLKSEL
+ */
+static uint64_t sim_tca_tick_ns(void)
+{
+	static const uint16_t div[8] = {1u, 2u, 4u, 8u, 16u, 64u, 256u, 1024u};
+
+	return (div[(TCA0.SINGLE.CTRLA & TCA_SINGLE_CLKSEL_gm) >> 1] * SIM_NS_PER_S) / SIM_F_CPU;
+}
+
+/**
+ * \brief Compare value of a TCA0 channel
+ */
+static uint16_t sim_tca_cmp(uint8_t channel)
+{
+	return (&TCA0.SINGLE.CMP0)[channel];
+}
+
+/**
+ * \brief Follow the firmware starting or stopping TCA0
+ */
+static void sim_tca_sync(void)
+{
+	bool    enabled = (TCA0.SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm) != 0u;
+	uint8_t channel;
+
+	if (enabled && !sim_tca_running) {
+		sim_tca_running   = true;
+		sim_tca_period_ns = sim_now_ns - TCA0.SINGLE.CNT * sim_tca_tick_ns();
+		sim_tca_matched   = 0;
+		for (channel = 0; channel < 3u; channel++) {
+			if (sim_tca_cmp(channel) < TCA0.SINGLE.CNT) {
+				sim_tca_matched |= 1u << channel;
+			}
+		}
+	} else if (!enabled && sim_tca_running) {
+		sim_tca_running = false;
+		TCA0.SINGLE.CNT = (uint16_t)((sim_now_ns - sim_tca_period_ns) / sim_tca_tick_ns());
+		sim_irq_pending &= ~SIM_TCA_IRQS;
+	}
+}
+
+/**
+ * \brief Time of a compare match of a TCA0 channel in the current period
+ */
+static uint64_t sim_tca_match_ns(uint8_t channel)
+{
+	if ((sim_tca_matched & (1u << channel)) || (sim_tca_cmp(channel) > TCA0.SINGLE.PER)) {
+		return SIM_NEVER;
+	}
+
+	return sim_tca_period_ns + sim_tca_cmp(channel) * sim_tca_tick_ns();
+}
+
+/**
+ * \brief Time of the next TCA0 compare match or overflow
+ */
+static uint64_t sim_tca_next_ns(void)
+{
+	uint64_t next;
+	uint64_t t;
+	uint8_t  channel;
+
+	if (!sim_tca_running) {
+		return SIM_NEVER;
+	}
+
+	next = sim_tca_period_ns + (TCA0.SINGLE.PER + 1ull) * sim_tca_tick_ns();
+	for (channel = 0; channel < 3u; channel++) {
+		t = sim_tca_match_ns(channel);
+		if (t < next) {
+			next = t;
+		}
+	}
+
+	return next;
+}
+
+/**
+ * \brief Raise the TCA0 compare matches that are due now
+ */
+static void sim_tca_compare(void)
+{
+	uint8_t channel;
+
+	for (channel = 0; channel < 3u; channel++) {
+		if (sim_tca_match_ns(channel) == sim_now_ns) {
+			sim_tca_matched |= 1u << channel;
+			if (TCA0.SINGLE.INTCTRL & (TCA_SINGLE_CMP0_bm << channel)) {
+				sim_irq_pending |= 1ul << (SIM_IRQ_TCA0_CMP0 + channel);
+			}
+		}
+	}
+}
+
+/**
+ * \brief Raise the TCA0 events that are due now
+ */
+static void sim_tca_event(void)
+{
+	if (!sim_tca_running) {
+		return;
+	}
+
+	sim_tca_compare();
+
+	if (sim_tca_period_ns + (TCA0.SINGLE.PER + 1ull) * sim_tca_tick_ns() == sim_now_ns) {
+		sim_tca_period_ns = sim_now_ns;
+		sim_tca_matched   = 0;
+		TCA0.SINGLE.CMP0  = TCA0.SINGLE.CMP0BUF;
+		TCA0.SINGLE.CMP1  = TCA0.SINGLE.CMP1BUF;
+		TCA0.SINGLE.CMP2  = TCA0.SINGLE.CMP2BUF;
+		if (TCA0.SINGLE.INTCTRL & TCA_SINGLE_OVF_bm) {
+			sim_irq_pending |= 1ul << SIM_IRQ_TCA0_OVF;
+		}
+		/* A compare value of 0 matches right away */
+		sim_tca_compare();
+	}
+}
+
+/**
+ * \brief Duration of one TCB0 count from CLKSEL
+ */
+static uint64_t sim_tcb_tick_ns(void)
+{
+	return ((TCB0.CTRLA & TCB_CLKSEL_gm) == TCB_CLKSEL_CLKDIV1_gc) ? SIM_NS_PER_S / SIM_F_CPU
+	                                                               : 2u * SIM_NS_PER_S / SIM_F_CPU;
+}
+
+/**
+ * \brief Follow the firmware starting, stopping or restarting TCB0
+ *
+ * CNT is only changed by the firmware when it differs from the count last
+ * put into it.
+ */
+static void sim_tcb_sync(void)
+{
+	bool enabled = (TCB0.CTRLA & TCB_ENABLE_bm) != 0u;
+
+	if (enabled && (!sim_tcb_running || (TCB0.CNT != sim_tcb_cnt))) {
+		sim_tcb_running   = true;
+		sim_tcb_period_ns = sim_now_ns - TCB0.CNT * sim_tcb_tick_ns();
+		sim_tcb_cnt       = TCB0.CNT;
+	} else if (!enabled && sim_tcb_running) {
+		sim_tcb_running = false;
+		sim_irq_pending &= ~(1ul << SIM_IRQ_TCB0_INT);
+	}
+}
+
+/**
+ * \brief Put the current count into CNT and the pending interrupt into
+ *        INTFLAGS while TCB0 runs
+ *
+ * CNT stays at CCMP for the count after the match.
+ */
+static void sim_tcb_update_cnt(void)
+{
+	if (!sim_tcb_running) {
+		return;
+	}
+
+	TCB0.INTFLAGS = (sim_irq_pending & (1ul << SIM_IRQ_TCB0_INT)) ? TCB_CAPT_bm : 0u;
+
+	sim_tcb_cnt = (sim_now_ns >= sim_tcb_period_ns)
+	                  ? (uint16_t)((sim_now_ns - sim_tcb_period_ns) / sim_tcb_tick_ns())
+	                  : TCB0.CCMP;
+	TCB0.CNT = sim_tcb_cnt;
+}
+
+/**
+ * \brief Time CNT reaches CCMP
+ */
+static uint64_t sim_tcb_next_ns(void)
+{
+	return sim_tcb_running ? sim_tcb_period_ns + TCB0.CCMP * sim_tcb_tick_ns() : SIM_NEVER;
+}
+
+/**
+ * \brief Raise the TCB0 interrupt when CNT reaches CCMP and start counting
+ *        from 0 again
+ */
+static void sim_tcb_event(void)
+{
+	if (sim_tcb_next_ns() != sim_now_ns) {
+		return;
+	}
+
+	sim_tcb_period_ns = sim_now_ns + sim_tcb_tick_ns();
+	if (TCB0.INTCTRL & TCB_CAPT_bm) {
+		sim_irq_pending |= 1ul << SIM_IRQ_TCB0_INT;
+	}
+}
+
+/**
+ * \brief Time of a number of watchdog clocks
+ */
+static uint64_t sim_wdt_clocks_ns(uint32_t clocks)
+{
+	return ((uint64_t)clocks * SIM_NS_PER_S) / SIM_WDT_CLOCK_HZ;
+}
+
+/**
+ * \brief Length of a window from its PERIOD or WINDOW setting, 0 when off
+ */
+static uint64_t sim_wdt_window_ns(uint8_t setting)
+{
+	return (setting != 0u) ? sim_wdt_clocks_ns(4ul << setting) : 0u;
+}
+
+/**
+ * \brief Time at which the watchdog resets the device unless kicked
+ */
+static uint64_t sim_wdt_next_ns(void)
+{
+	uint8_t ctrla = WDT.CTRLA;
+
+	if (!(ctrla & WDT_PERIOD_gm)) {
+		return SIM_NEVER;
+	}
+
+	return sim_wdt_kick_ns + sim_wdt_window_ns((ctrla & WDT_WINDOW_gm) >> 4) + sim_wdt_window_ns(ctrla & WDT_PERIOD_gm);
+}
+
+/**
+ * \brief Watchdog reset, the run ends here
+ */
+static void sim_wdt_fire(void)
+{
+	sim_stats.wdt_reset_ns = sim_now_ns;
+	RSTCTRL.RSTFR |= RSTCTRL_WDRF_bm;
+	longjmp(sim_exit, 1);
+}
+
+/**
+ * \brief Call the handlers of all pending interrupts in priority order
+ */
+static void sim_dispatch(void)
+{
+	uint8_t irq;
+
+	if (sim_in_isr) {
+		return;
+	}
+
+	sim_pin_monitor_check();
+
+	while (sim_irq_enabled) {
+		sim_uart_irq_update();
+
+		for (irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+			if (sim_irq_pending & (1ul << irq)) {
+				break;
+			}
+		}
+		if (irq == SIM_IRQ_COUNT) {
+			return;
+		}
+
+		sim_irq_pending &= ~(1ul << irq);
+		sim_stats.irq_count[irq]++;
+		sim_in_isr = true;
+		sim_tcb_sync();
+		sim_tcb_update_cnt();
+		memset(sim_SP - SIM_ISR_STACK + 1, 0, SIM_ISR_STACK);
+		sim_SP -= SIM_ISR_STACK;
+
+		switch (irq) {
+		case SIM_IRQ_BOD_VLM:
+			BOD.INTFLAGS = BOD_VLMIF_bm;
+			BOD_VLM_vect();
+			BOD.INTFLAGS = 0;
+			break;
+		case SIM_IRQ_PORTA_PORT:
+		case SIM_IRQ_PORTB_PORT:
+		case SIM_IRQ_PORTC_PORT:
+			sim_port(irq - SIM_IRQ_PORTA_PORT)->INTFLAGS = sim_port_flags[irq - SIM_IRQ_PORTA_PORT];
+			sim_port_flags[irq - SIM_IRQ_PORTA_PORT]     = 0;
+			sim_vectors[irq]();
+			sim_port(irq - SIM_IRQ_PORTA_PORT)->INTFLAGS = 0;
+			break;
+		case SIM_IRQ_RTC_CNT:
+			RTC.INTFLAGS = RTC_CMP_bm;
+			RTC_CNT_vect();
+			RTC.INTFLAGS = 0;
+			break;
+		case SIM_IRQ_RTC_PIT:
+			RTC.PITINTFLAGS = RTC_PI_bm;
+			RTC_PIT_vect();
+			RTC.PITINTFLAGS = 0;
+			break;
+		case SIM_IRQ_TCA0_OVF:
+		case SIM_IRQ_TCA0_CMP0:
+		case SIM_IRQ_TCA0_CMP1:
+		case SIM_IRQ_TCA0_CMP2:
+			TCA0.SINGLE.INTFLAGS = (irq == SIM_IRQ_TCA0_OVF) ? TCA_SINGLE_OVF_bm
+			                                                 : (uint8_t)(TCA_SINGLE_CMP0_bm << (irq - SIM_IRQ_TCA0_CMP0));
+			sim_vectors[irq]();
+			TCA0.SINGLE.INTFLAGS = 0;
+			sim_tca_sync();
+			break;
+		case SIM_IRQ_TCB0_INT:
+			TCB0.INTFLAGS = TCB_CAPT_bm;
+			TCB0_INT_vect();
+			TCB0.INTFLAGS = 0;
+			break;
+		case SIM_IRQ_USART0_DRE:
+			if (USART0.CTRLA & USART_DREIE_bm) {
+				sim_uart_dre();
+			}
+			break;
+		case SIM_IRQ_USART0_TXC:
+			if (USART0.CTRLA & USART_TXCIE_bm) {
+				USART0_TXC_vect();
+			}
+			break;
+		default:
+			sim_vectors[irq]();
+			break;
+		}
+
+		sim_SP += SIM_ISR_STACK;
+		sim_tcb_sync();
+		sim_pin_monitor_check();
+		sim_in_isr = false;
+	}
+}
+
+/**
+ * \brief Move simulated time to the next event, at most to a target time
+ *
+ * Raises the interrupts of the events reached.
+ *
+ * \param[in] target_ns Time not to advance beyond
+ * \param[in] standby   The core is in standby, CLK_PER based peripherals halt
+ */
+static void sim_step(uint64_t target_ns, bool standby)
+{
+	uint64_t next  = target_ns;
+	uint64_t match = sim_rtc_next_match();
+	uint64_t pit   = sim_rtc_next_pit();
+	uint64_t tca;
+	uint64_t tcb;
+	uint8_t  irq;
+
+	sim_pin_monitor_check();
+	sim_tca_sync();
+	tca = sim_tca_next_ns();
+	sim_tcb_sync();
+	tcb = sim_tcb_next_ns();
+
+	if (match < next) {
+		next = match;
+	}
+	if (pit < next) {
+		next = pit;
+	}
+	for (irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+		if (sim_irq_due[irq] < next) {
+			next = sim_irq_due[irq];
+		}
+	}
+	if (sim_uart_rx_time() < next) {
+		next = sim_uart_rx_time();
+	}
+	if (sim_mains_next_ns() < next) {
+		next = sim_mains_next_ns();
+	}
+	if (sim_supply_next_ns() < next) {
+		next = sim_supply_next_ns();
+	}
+	if (sim_wdt_next_ns() < next) {
+		next = sim_wdt_next_ns();
+	}
+	if (sim_pin_next_ns() < next) {
+		next = sim_pin_next_ns();
+	}
+	if (!standby && (tca < next)) {
+		next = tca;
+	}
+	if (!standby && (tcb < next)) {
+		next = tcb;
+	}
+
+	/* CLK_PER is off in standby, a running USART frame stalls and the timers
+	 * halt */
+	if (standby && (sim_uart_busy_until_ns > sim_now_ns)) {
+		sim_uart_busy_until_ns += next - sim_now_ns;
+	}
+	if (sim_tca_running) {
+		if (standby) {
+			sim_tca_period_ns += next - sim_now_ns;
+		} else {
+			sim_stats.tca_running_ns += next - sim_now_ns;
+		}
+	}
+	if (sim_tcb_running && standby) {
+		sim_tcb_period_ns += next - sim_now_ns;
+	}
+
+	sim_now_ns    = next;
+	sim_rtc_ticks = sim_rtc_ticks_at(sim_now_ns);
+	RTC.CNT       = (uint16_t)sim_rtc_ticks;
+
+	if (sim_now_ns >= sim_eeprom_busy_until_ns) {
+		NVMCTRL.STATUS &= (uint8_t)~NVMCTRL_EEBUSY_bm;
+	}
+
+	/* The last frame has left the shift register */
+	if (sim_now_ns >= sim_uart_busy_until_ns) {
+		USART0.STATUS |= USART_TXCIF_bm | USART_DREIF_bm;
+	}
+
+	if (match == sim_now_ns) {
+		sim_irq_pending |= 1ul << SIM_IRQ_RTC_CNT;
+	}
+	if (pit == sim_now_ns) {
+		sim_pit_next_ns += sim_pit_period_ns();
+		if (RTC.PITINTCTRL & RTC_PI_bm) {
+			sim_irq_pending |= 1ul << SIM_IRQ_RTC_PIT;
+		}
+		if (sim_qtm_pit_event()) {
+			sim_irq_pending |= 1ul << SIM_IRQ_ADC0_WCOMP;
+		}
+	}
+	for (irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+		if (sim_irq_due[irq] == sim_now_ns) {
+			sim_irq_due[irq] = SIM_NEVER;
+			sim_irq_pending |= 1ul << irq;
+		}
+	}
+	if (sim_mains_next_ns() == sim_now_ns) {
+		sim_mains_edge();
+	}
+	while (sim_supply_next_ns() == sim_now_ns) {
+		sim_supply_edge();
+	}
+	if (sim_wdt_next_ns() == sim_now_ns) {
+		sim_wdt_fire();
+	}
+	sim_pin_event();
+	sim_tca_event();
+	sim_tcb_event();
+	sim_uart_receive(standby);
+}
+
+/**
+ * \brief Earliest point in time anything can happen
+ */
+static uint64_t sim_next_event(bool standby)
+{
+	uint64_t next = sim_end_ns;
+	uint64_t t;
+	uint8_t  irq;
+
+	t = sim_rtc_next_match();
+	if (t < next) {
+		next = t;
+	}
+	t = sim_rtc_next_pit();
+	if (t < next) {
+		next = t;
+	}
+	for (irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+		if (sim_irq_due[irq] < next) {
+			next = sim_irq_due[irq];
+		}
+	}
+	t = sim_uart_rx_time();
+	if (t < next) {
+		next = t;
+	}
+	t = sim_mains_next_ns();
+	if (t < next) {
+		next = t;
+	}
+	t = sim_supply_next_ns();
+	if (t < next) {
+		next = t;
+	}
+	t = sim_wdt_next_ns();
+	if (t < next) {
+		next = t;
+	}
+	t = sim_pin_next_ns();
+	if (t < next) {
+		next = t;
+	}
+	sim_tca_sync();
+	t = sim_tca_next_ns();
+	if (!standby && (t < next)) {
+		next = t;
+	}
+	sim_tcb_sync();
+	t = sim_tcb_next_ns();
+	if (!standby && (t < next)) {
+		next = t;
+	}
+	if (!standby && (USART0.CTRLA & (USART_DREIE_bm | USART_TXCIE_bm)) && (sim_uart_busy_until_ns < next)) {
+		next = sim_uart_busy_until_ns > sim_now_ns ? sim_uart_busy_until_ns : sim_now_ns;
+	}
+
+	return next;
+}
+
+/* Core */
+
+uint8_t sim_irq_save(void)
+{
+	uint8_t state = sim_irq_enabled;
+
+	sim_irq_enabled = false;
+	sim_tcb_sync();
+	sim_tcb_update_cnt();
+	return state;
+}
+
+void sim_irq_restore(uint8_t state)
+{
+	sim_irq_enabled = state;
+	sim_dispatch();
+}
+
+void sim_sei(void)
+{
+	sim_irq_enabled = true;
+	sim_dispatch();
+}
+
+void sim_cli(void)
+{
+	sim_irq_enabled = false;
+
+	if (++sim_spin_count > SIM_SPIN_LIMIT) {
+		fprintf(stderr, "sim: main loop has not slept for %lu passes at %.3f ms\n",
+		        sim_spin_count,
+		        (double)sim_now_ns / SIM_NS_PER_MS);
+		exit(2);
+	}
+}
+
+void sim_sleep_cpu(void)
+{
+	bool standby;
+
+	if (!(SLPCTRL.CTRLA & SLPCTRL_SEN_bm)) {
+		return;
+	}
+
+	sim_spin_count = 0;
+	sim_stats.sleep_count++;
+	if (sim_observer != NULL) {
+		sim_observer(sim_now_ns);
+	}
+
+	standby = ((SLPCTRL.CTRLA & SLPCTRL_SMODE_gm) != SLPCTRL_SMODE_IDLE_gc);
+
+	/* Sleep until an event raises an interrupt */
+	while (!sim_irq_pending && !(!standby && sim_uart_irq_update())) {
+		if (sim_now_ns >= sim_end_ns) {
+			longjmp(sim_exit, 1);
+		}
+		sim_step(sim_next_event(standby), standby);
+	}
+
+	sim_dispatch();
+}
+
+void sim_delay_us(double us)
+{
+	uint64_t target_ns = sim_now_ns + (uint64_t)(us * 1000.0);
+
+	while (sim_now_ns < target_ns) {
+		sim_step(target_ns, false);
+		sim_dispatch();
+	}
+}
+
+void sim_wdt_reset(void)
+{
+	uint8_t ctrla = WDT.CTRLA;
+
+	if (!(ctrla & WDT_PERIOD_gm)) {
+		return;
+	}
+	if (sim_now_ns < sim_wdt_kick_ns + sim_wdt_window_ns((ctrla & WDT_WINDOW_gm) >> 4)) {
+		sim_stats.wdt_window_violations++;
+		sim_wdt_fire();
+	}
+
+	sim_wdt_kick_ns = sim_now_ns;
+	sim_stats.wdt_kicks++;
+}
+
+/**
+ * \brief Execute an NVMCTRL command written to CTRLA
+ */
+static void sim_nvm_command(uint8_t command)
+{
+	uint8_t page;
+
+	if (command != NVMCTRL_CMD_PAGEERASEWRITE_gc) {
+		return;
+	}
+
+	/* Only the page written to differs from its cells */
+	if (memcmp(sim_userrow_cells, sim_userrow, USER_SIGNATURES_SIZE) != 0) {
+		memcpy(sim_userrow_cells, sim_userrow, USER_SIGNATURES_SIZE);
+		sim_stats.userrow_writes++;
+		sim_eeprom_busy_until_ns = sim_now_ns + SIM_EEPROM_WRITE_NS;
+		NVMCTRL.STATUS |= NVMCTRL_EEBUSY_bm;
+		NVMCTRL.CTRLA = NVMCTRL_CMD_NONE_gc;
+		return;
+	}
+
+	for (page = 0; page < SIM_EEPROM_PAGES; page++) {
+		uint8_t *cells = &sim_eeprom_cells[page * EEPROM_PAGE_SIZE];
+
+		if (memcmp(cells, &sim_eeprom[page * EEPROM_PAGE_SIZE], EEPROM_PAGE_SIZE) != 0) {
+			memcpy(cells, &sim_eeprom[page * EEPROM_PAGE_SIZE], EEPROM_PAGE_SIZE);
+			sim_stats.eeprom_page_writes[page]++;
+		}
+	}
+	sim_stats.eeprom_writes++;
+	sim_eeprom_busy_until_ns = sim_now_ns + SIM_EEPROM_WRITE_NS;
+	NVMCTRL.STATUS |= NVMCTRL_EEBUSY_bm;
+	NVMCTRL.CTRLA = NVMCTRL_CMD_NONE_gc;
+}
+
+/* Configuration change protection, in assembler on the device */
+void protected_write_io(void *addr, uint8_t magic, uint8_t value)
+{
+	(void)magic;
+	*(volatile uint8_t *)addr = value;
+
+	if (addr == (void *)&NVMCTRL.CTRLA) {
+		sim_nvm_command(value & NVMCTRL_CMD_gm);
+	}
+	if (addr == (void *)&WDT.CTRLA) {
+		sim_wdt_kick_ns = sim_now_ns;
+	}
+}
+
+/* Simulator interface */
+
+void sim_hw_reset(void)
+{
+	memset(&sim_BOD, 0, sizeof(sim_BOD));
+	memset(&sim_CLKCTRL, 0, sizeof(sim_CLKCTRL));
+	memset(&sim_CPUINT, 0, sizeof(sim_CPUINT));
+	memset(&sim_NVMCTRL, 0, sizeof(sim_NVMCTRL));
+	memset(&sim_PORTA, 0, sizeof(sim_PORTA));
+	memset(&sim_PORTB, 0, sizeof(sim_PORTB));
+	memset(&sim_PORTC, 0, sizeof(sim_PORTC));
+	memset(&sim_VPORTA, 0, sizeof(sim_VPORTA));
+	memset(&sim_VPORTB, 0, sizeof(sim_VPORTB));
+	memset(&sim_VPORTC, 0, sizeof(sim_VPORTC));
+	memset(&sim_RSTCTRL, 0, sizeof(sim_RSTCTRL));
+	memset(&sim_RTC, 0, sizeof(sim_RTC));
+	memset(&sim_SLPCTRL, 0, sizeof(sim_SLPCTRL));
+	memset(&sim_TCA0, 0, sizeof(sim_TCA0));
+	memset(&sim_TCB0, 0, sizeof(sim_TCB0));
+	memset(&sim_USART0, 0, sizeof(sim_USART0));
+	memset(&sim_WDT, 0, sizeof(sim_WDT));
+	memset(sim_sram, 0, sizeof(sim_sram));
+	sim_SP = &sim_sram[RAMSIZE - 1u - SIM_MAIN_STACK];
+
+	sim_RSTCTRL.RSTFR = RSTCTRL_PORF_bm;
+	sim_USART0.STATUS = USART_DREIF_bm;
+
+	sim_now_ns               = 0;
+	sim_irq_enabled          = false;
+	sim_in_isr               = false;
+	sim_irq_pending          = 0;
+	sim_rtc_ticks            = 0;
+	sim_pit_next_ns          = SIM_NEVER;
+	sim_uart_busy_until_ns   = 0;
+	sim_eeprom_busy_until_ns = 0;
+	sim_uart_rx_next         = 0;
+	sim_mains_next           = 0;
+	sim_num_pin_events       = 0;
+	sim_supply_next          = 0;
+	sim_tca_running          = false;
+	sim_tca_period_ns        = 0;
+	sim_tca_matched          = 0;
+	sim_tcb_running          = false;
+	sim_tcb_period_ns        = 0;
+	sim_tcb_cnt              = 0;
+	sim_wdt_kick_ns          = 0;
+	sim_spin_count           = 0;
+	memset(sim_port_flags, 0, sizeof(sim_port_flags));
+	memset(sim_port_out, 0, sizeof(sim_port_out));
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	for (uint8_t irq = 0; irq < SIM_IRQ_COUNT; irq++) {
+		sim_irq_due[irq] = SIM_NEVER;
+	}
+}
+
+/**
+ * \brief Run the firmware from reset for a span of simulated time
+ *
+ * firmware_main() does not return; the simulation ends at the first sleep
+ * once the end time has been reached.
+ */
+void sim_hw_run(uint64_t duration_ns)
+{
+	sim_end_ns = sim_now_ns + duration_ns;
+
+	if (setjmp(sim_exit) == 0) {
+		firmware_main();
+	}
+}
+
+uint64_t sim_time_ns(void)
+{
+	return sim_now_ns;
+}
+
+void sim_hw_raise_irq_at(enum sim_irq irq, uint64_t time_ns)
+{
+	if (time_ns <= sim_now_ns) {
+		sim_irq_pending |= 1ul << irq;
+		if (sim_irq_enabled) {
+			sim_dispatch();
+		}
+	} else {
+		sim_irq_due[irq] = time_ns;
+	}
+}
+
+void sim_hw_cancel_irq(enum sim_irq irq)
+{
+	sim_irq_due[irq] = SIM_NEVER;
+	sim_irq_pending &= ~(1ul << irq);
+}
+
+void sim_hw_set_mains(double frequency_hz)
+{
+	sim_mains_half_ns = (frequency_hz > 0) ? SIM_NS_PER_S / (2.0 * frequency_hz) : 0;
+	sim_mains_next    = 0;
+}
+
+/**
+ * \brief Add a dip of VDD below the voltage level monitor threshold
+ *
+ * Dips must be added in time order and must not overlap.
+ *
+ * \return 0 on success, -1 if there are too many or they are out of order
+ */
+int sim_hw_add_supply_dip(uint64_t start_ns, uint64_t end_ns)
+{
+	if ((sim_supply_num_edges == 2u * SIM_MAX_SUPPLY_DIPS) || (end_ns <= start_ns)
+	    || ((sim_supply_num_edges != 0u) && (start_ns <= sim_supply_edges[sim_supply_num_edges - 1u]))) {
+		return -1;
+	}
+
+	sim_supply_edges[sim_supply_num_edges++] = start_ns;
+	sim_supply_edges[sim_supply_num_edges++] = end_ns;
+	return 0;
+}
+
+int64_t sim_hw_mains_phase_error_ns(uint64_t time_ns)
+{
+	uint64_t number;
+	int64_t  error;
+
+	if ((sim_mains_half_ns <= 0) || (time_ns < SIM_MAINS_PHASE_NS)) {
+		return 0;
+	}
+
+	number = (uint64_t)((time_ns - SIM_MAINS_PHASE_NS) / sim_mains_half_ns + 0.5);
+	error  = (int64_t)(time_ns - sim_mains_zero_cross_ns(number));
+	return error;
+}
+
+/**
+ * \brief Schedule a change of the input level of a port pin
+ *
+ * Changes for the same time are applied in the order they were scheduled.
+ *
+ * \return 0 on success, -1 if too many changes are scheduled
+ */
+int sim_hw_set_pin_at(enum sim_port port, uint8_t pin, bool level, uint64_t time_ns)
+{
+	uint8_t i;
+
+	if (sim_num_pin_events == SIM_MAX_PIN_EVENTS) {
+		return -1;
+	}
+	if (time_ns < sim_now_ns) {
+		time_ns = sim_now_ns;
+	}
+
+	for (i = sim_num_pin_events; (i > 0u) && (sim_pin_events[i - 1u].time_ns > time_ns); i--) {
+		sim_pin_events[i] = sim_pin_events[i - 1u];
+	}
+	sim_pin_events[i].time_ns = time_ns;
+	sim_pin_events[i].port    = (uint8_t)port;
+	sim_pin_events[i].mask    = (uint8_t)(1u << pin);
+	sim_pin_events[i].level   = level;
+	sim_num_pin_events++;
+	return 0;
+}
+
+/**
+ * \brief Set the function called with the OUT register of a port whenever
+ *        the firmware changes it
+ */
+void sim_hw_set_pin_monitor(void (*monitor)(enum sim_port port, uint8_t out, uint64_t time_ns))
+{
+	sim_pin_monitor = monitor;
+}
+
+void sim_hw_set_uart_sink(FILE *sink)
+{
+	sim_uart_sink = sink;
+}
+
+void sim_hw_set_uart_monitor(void (*monitor)(uint8_t byte, uint64_t time_ns))
+{
+	sim_uart_monitor = monitor;
+}
+
+/**
+ * \brief Schedule bytes for the USART receiver, sorted by time
+ *
+ * The array is used in place and must stay valid during the run.
+ */
+void sim_hw_set_uart_rx(const struct sim_uart_rx *rx, size_t count)
+{
+	sim_uart_rx_bytes = rx;
+	sim_uart_rx_count = count;
+	sim_uart_rx_next  = 0;
+}
+
+void sim_hw_set_observer(void (*observer)(uint64_t time_ns))
+{
+	sim_observer = observer;
+}
+
+void sim_hw_get_stats(struct sim_hw_stats *stats)
+{
+	*stats = sim_stats;
+}
+
+/**
+ * \brief Load the EEPROM content from a binary image of EEPROM_SIZE bytes
+ *
+ * \return 0 on success, -1 on error
+ */
+int sim_hw_load_eeprom(const char *path)
+{
+	FILE * f = fopen(path, "rb");
+	size_t n;
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	n = fread(sim_eeprom, 1, sizeof(sim_eeprom), f);
+	fclose(f);
+	if (n != sizeof(sim_eeprom)) {
+		fprintf(stderr, "%s: expected %u bytes\n", path, (unsigned)sizeof(sim_eeprom));
+		return -1;
+	}
+	memcpy(sim_eeprom_cells, sim_eeprom, sizeof(sim_eeprom));
+	return 0;
+}
+
+/**
+ * \brief Save the programmed EEPROM content as a binary image
+ *
+ * Bytes loaded without a following write command are not saved.
+ *
+ * \return 0 on success, -1 on error
+ */
+int sim_hw_save_eeprom(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	if (fwrite(sim_eeprom_cells, 1, sizeof(sim_eeprom_cells), f) != sizeof(sim_eeprom_cells)) {
+		perror(path);
+		fclose(f);
+		return -1;
+	}
+	return fclose(f) == 0 ? 0 : -1;
+}
+
+const char *sim_hw_irq_name(enum sim_irq irq)
+{
+	return sim_irq_names[irq];
+}
@@ -0,0 +1,114 @@
+/**
+ * \file
+ *
+ * \brief Host simulation of the ATtiny816 core and peripherals.
+ *
+ * The firmware runs unmodified on the host against the register stand-ins in
+ * sim/include. Code executes in zero simulated time; time only advances when
+ * the firmware sleeps or busy-waits, and is then moved directly to the next
+ * peripheral event, so long periods are simulated in a fraction of a second.
+ */
+
+#ifndef SIM_HW_H_INCLUDED
+#define SIM_HW_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_NS_PER_MS 1000000ull
+#define SIM_NS_PER_S 1000000000ull
+
+/* EEPROM pages of the device */
+#define SIM_EEPROM_PAGES 4u
+
+/* Interrupt sources modelled by the simulator, in vector (priority) order */
+enum sim_irq {
+	SIM_IRQ_BOD_VLM,
+	SIM_IRQ_PORTA_PORT,
+	SIM_IRQ_PORTB_PORT,
+	SIM_IRQ_PORTC_PORT,
+	SIM_IRQ_RTC_CNT,
+	SIM_IRQ_RTC_PIT,
+	SIM_IRQ_TCA0_OVF,
+	SIM_IRQ_TCA0_CMP0,
+	SIM_IRQ_TCA0_CMP1,
+	SIM_IRQ_TCA0_CMP2,
+	SIM_IRQ_TCB0_INT,
+	SIM_IRQ_ADC0_RESRDY,
+	SIM_IRQ_ADC0_WCOMP,
+	SIM_IRQ_USART0_RXC,
+	SIM_IRQ_USART0_DRE,
+	SIM_IRQ_USART0_TXC,
+	SIM_IRQ_COUNT
+};
+
+/* I/O ports */
+enum sim_port {
+	SIM_PORT_A,
+	SIM_PORT_B,
+	SIM_PORT_C,
+	SIM_PORTS
+};
+
+/* Run statistics */
+struct sim_hw_stats {
+	uint64_t irq_count[SIM_IRQ_COUNT];             /* Handler calls per source */
+	uint64_t sleep_count;                          /* Number of sleep instructions */
+	uint64_t uart_bytes;                           /* Bytes sent by the USART */
+	uint64_t uart_rx_bytes;                        /* Bytes received by the USART */
+	uint64_t uart_rx_lost;                         /* Bytes sent to a USART that could not receive them */
+	uint64_t eeprom_writes;                        /* EEPROM page erase/write commands */
+	uint64_t userrow_writes;                       /* User row erase/write commands */
+	uint64_t eeprom_page_writes[SIM_EEPROM_PAGES]; /* Changes programmed per EEPROM page */
+	uint64_t tca_running_ns;                       /* Time TCA0 was counting */
+	uint64_t wdt_kicks;                            /* Watchdog resets by wdr */
+	uint64_t wdt_window_violations;                /* wdr in the closed window */
+	uint64_t wdt_reset_ns;                         /* Time of the watchdog reset, 0 if none */
+};
+
+/* Byte sent to the USART receiver */
+struct sim_uart_rx {
+	uint64_t time_ns; /* End of the stop bit */
+	uint8_t  byte;
+};
+
+/* Firmware entry point, main() renamed at compile time */
+int firmware_main(void);
+
+void     sim_hw_reset(void);
+void     sim_hw_run(uint64_t duration_ns);
+uint64_t sim_time_ns(void);
+
+void sim_hw_raise_irq_at(enum sim_irq irq, uint64_t time_ns);
+void sim_hw_cancel_irq(enum sim_irq irq);
+
+void    sim_hw_set_mains(double frequency_hz);
+int     sim_hw_add_supply_dip(uint64_t start_ns, uint64_t end_ns);
+int64_t sim_hw_mains_phase_error_ns(uint64_t time_ns);
+
+int  sim_hw_set_pin_at(enum sim_port port, uint8_t pin, bool level, uint64_t time_ns);
+void sim_hw_set_pin_monitor(void (*monitor)(enum sim_port port, uint8_t out, uint64_t time_ns));
+
+void sim_hw_set_uart_sink(FILE *sink);
+void sim_hw_set_uart_monitor(void (*monitor)(uint8_t byte, uint64_t time_ns));
+void sim_hw_set_uart_rx(const struct sim_uart_rx *rx, size_t count);
+void sim_hw_set_observer(void (*observer)(uint64_t time_ns));
+void sim_hw_get_stats(struct sim_hw_stats *stats);
+int  sim_hw_load_eeprom(const char *path);
+int  sim_hw_save_eeprom(const char *path);
+
+const char *sim_hw_irq_name(enum sim_irq irq);
+
+/* Called by the hardware model on each RTC PIT period while the PIT is enabled */
+bool sim_qtm_pit_event(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_HW_H_INCLUDED */
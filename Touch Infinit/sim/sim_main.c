@@ -0,0 +1,731 @@
+/**
+ * \file
+ *
+ * \brief Host simulation driver.
+ *
+ * Runs the firmware from reset against the simulated peripherals for a span of
+ * simulated time, optionally driven by a touch script, and reports interrupt,
+ * sleep and UART statistics together with the detection latency of every
+ * scripted press.
+ *
+ * Usage: touch_sim [--time ms] [--script file] [--noise counts] [--seed n]
+ *                  [--uart file] [--capture file] [--rx file]
+ *                  [--eeprom-in file] [--eeprom-out file] [--cc-shift n]
+ *                  [--mains hz] [--freq-noise sel:counts] [--max-latency ms]
+ *                  [--supply-dip ms:ms] [--brown-out] [--ptc-hang ms] [--ptc-slow ms:ms]
+ *                  [--modules mask] [--module-drop n] [--module-stuck mask]
+ *                  [--check]
+ *
+ * --uart writes the raw USART output, --capture the datastreamer frames as a
+ * touch capture for touch_replay. --rx sends bytes to the USART receiver, one
+ * line per burst: <time_ms> followed by hex bytes, sent back to back at
+ * 38400 baud.
+ *
+ * --eeprom-in starts with an EEPROM image saved by --eeprom-out of an earlier
+ * run instead of an erased EEPROM, like a reset or power cycle of the board.
+ * --cc-shift changes the compensation capacitance that balances each node,
+ * so values saved before no longer fit, as after a change of the front panel.
+ *
+ * --mains feeds a zero-cross signal of that frequency to the ZERO_CROSS input.
+ * The relay outputs on PORTB are taken to move their contacts after the
+ * configured operate or release time, and the distance to the nearest
+ * zero-cross is reported. From the coil switching until the contacts have
+ * settled every node reads SIM_RELAY_NOISE counts high, which shows as false
+ * detects unless the firmware blanks the acquisition.
+ *
+ * --freq-noise adds uniform noise of the given amplitude to measurements on
+ * acquisition frequency FREQ_SEL_<sel>, and may be repeated. The frequencies
+ * and noise figures last reported by the datastreamer are printed.
+ *
+ * --supply-dip takes VDD below the voltage level monitor threshold from the
+ * first time for the second one, in ms, and may be repeated in time order.
+ * Relay coils switched on while VDD is low are counted. --brown-out starts the
+ * firmware from a brown-out reset instead of a power-on reset.
+ *
+ * --ptc-hang stops measurements from completing from the given time on, in
+ * ms. --ptc-slow makes every measurement from the first time on complete the
+ * second time late, in ms. The run ends at a watchdog reset, and the kicks,
+ * the late cycles and the stage blamed for the reset are reported.
+ *
+ * --modules connects relay modules to the module bus, bit n for module n on
+ * BUTTON_MODn+1 and RELAY_MODn+1. Commands to a module that is not connected
+ * go unanswered. --module-drop leaves the first n commands to each module
+ * unanswered, --module-stuck gives modules whose relay contacts never move.
+ * The bus statistics of the firmware are reported with the relay states of
+ * the modules at the end of the run and the states they last reported.
+ *
+ * The RAM use of the firmware is reported as the firmware reports it to the
+ * host, with the stack free at its high-water mark. The simulated core models
+ * the static data and the stack with fixed sizes, see sim_hw.c.
+ *
+ * The stage times of the datastreamer profile frames, sent with
+ * DEF_TOUCH_PROFILE_ENABLE, are reported as mean and maximum per stage. The
+ * simulated core takes no time to run code, only the waits for the PTC and
+ * for the main loop to be woken show.
+ *
+ * With DEF_TOUCH_SELECTIVE_REBURST the reburst measurements per touch are
+ * reported, and how many of them measured only the filtering nodes.
+ *
+ * With --check the exit status is non-zero when a scripted press is missed or
+ * a key is detected outside of a scripted press.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "touch.h"
+#include "sleep_scheduler.h"
+#include "timer_queue.h"
+#include "usart_basic.h"
+#include "relay_scheduler.h"
+#include "touch_gesture.h"
+#include "led_pwm.h"
+#include "supply_monitor.h"
+#include "wdt_supervisor.h"
+#include "module_bus.h"
+#include "ram_monitor.h"
+#include "touch_reburst.h"
+#include "sim_hw.h"
+#include "sim_qtm.h"
+#include "sim_module.h"
+#include "sim_capture.h"
+#include "sim_score.h"
+
+#define SIM_MAX_TRANSITIONS 4096u
+#define SIM_MAX_RX_BYTES 4096u
+#define SIM_MAX_SUPPLY_DIPS 8u
+
+/* Acquisition frequencies FREQ_SEL_0 to FREQ_SEL_15 */
+#define SIM_FREQ_SELS 16u
+
+/* Signal disturbance while a relay switches */
+#define SIM_RELAY_NOISE 150
+
+/* One byte on the USART receive line: start, 8 data and stop bits */
+#define SIM_RX_BYTE_NS (10u * SIM_NS_PER_S / 38400u)
+
+extern qtm_touch_key_config_t       qtlib_key_configs_set1[DEF_NUM_SENSORS];
+extern qtm_touch_key_group_config_t qtlib_key_grp_config_set1;
+
+/* Key detect transition seen by the observer */
+struct sim_transition {
+	uint64_t time_ns;
+	uint8_t  key;
+	uint8_t  touched;
+};
+
+static struct sim_transition sim_transitions[SIM_MAX_TRANSITIONS];
+static uint16_t              sim_num_transitions;
+static uint8_t               sim_key_touched[DEF_NUM_SENSORS];
+
+static struct sim_capture_decoder sim_decoder;
+static FILE *                     sim_capture_file;
+
+/* Frequency hop data of the last datastreamer frame */
+static struct sim_capture_hop sim_hop;
+
+#if DEF_TOUCH_FREQ_HOP_ENABLE == 1u
+#define SIM_HOP_STEPS NUM_FREQ_STEPS
+#else
+#define SIM_HOP_STEPS 0u
+#endif
+
+/* Stages of the touch processing cycle supervised by the watchdog */
+static const char *const sim_wdt_stages[WDT_SUPERVISOR_STAGES + 1u] = {"start", "eoc", "process", "output", "none"};
+
+/* Stages of the datastreamer profile frames */
+static const char *const sim_profile_stages[SIM_CAPTURE_PROFILE_STAGES]
+    = {"acquisition", "eoc", "pending", "acq_process", "key_process", "output", "cycle", "latency"};
+
+static struct sim_uart_rx sim_rx[SIM_MAX_RX_BYTES];
+static size_t             sim_num_rx;
+
+/* Relay outputs and their switching statistics */
+static uint8_t  sim_relay_outputs;
+static unsigned sim_relay_switches;
+static int64_t  sim_relay_error_max_ns;
+static unsigned sim_relay_low_pulls;
+
+/**
+ * \brief Record relay output changes, called on every sleep
+ */
+static void sim_observe_relays(uint64_t time_ns)
+{
+	uint8_t  outputs = VPORTB.OUT & VPORTB.DIR;
+	uint8_t  changed = outputs ^ sim_relay_outputs;
+	uint8_t  pin;
+	uint64_t contact_ns;
+	int64_t  error_ns;
+
+	for (pin = 0; pin < 8u; pin++) {
+		if (!(changed & (1u << pin))) {
+			continue;
+		}
+		contact_ns = time_ns
+		             + 1000u * ((outputs & (1u << pin)) ? RELAY_SCHEDULER_OPERATE_US : RELAY_SCHEDULER_RELEASE_US);
+		error_ns = sim_hw_mains_phase_error_ns(contact_ns);
+		if (error_ns < 0) {
+			error_ns = -error_ns;
+		}
+		if (error_ns > sim_relay_error_max_ns) {
+			sim_relay_error_max_ns = error_ns;
+		}
+		sim_qtm_add_disturbance(time_ns, contact_ns + 1000u * RELAY_SCHEDULER_BOUNCE_US, SIM_RELAY_NOISE);
+		sim_relay_switches++;
+		if ((outputs & (1u << pin)) && (BOD.STATUS & BOD_VLMS_bm)) {
+			sim_relay_low_pulls++;
+		}
+	}
+	sim_relay_outputs = outputs;
+}
+
+/**
+ * \brief Record key detect transitions, called on every sleep
+ */
+static void sim_observe(uint64_t time_ns)
+{
+	uint8_t key;
+	uint8_t touched;
+
+	sim_observe_relays(time_ns);
+
+	for (key = 0; key < DEF_NUM_SENSORS; key++) {
+		touched = (get_sensor_state(key) & KEY_TOUCHED_MASK) ? 1u : 0u;
+		if (touched != sim_key_touched[key]) {
+			sim_key_touched[key] = touched;
+			if (sim_num_transitions < SIM_MAX_TRANSITIONS) {
+				sim_transitions[sim_num_transitions].time_ns = time_ns;
+				sim_transitions[sim_num_transitions].key     = key;
+				sim_transitions[sim_num_transitions].touched = touched;
+				sim_num_transitions++;
+			}
+		}
+	}
+}
+
+/**
+ * \brief Score the observed detections against the scripted presses
+ *
+ * A press is a script interval in which a node delta is at or above the key
+ * threshold.
+ *
+ * \return Number of misses plus false detections
+ */
+static unsigned sim_check_presses(uint32_t max_latency_ms, uint64_t end_ns)
+{
+	static struct sim_score_press  presses[SIM_MAX_TRANSITIONS];
+	static struct sim_score_detect detects[SIM_MAX_TRANSITIONS];
+	unsigned                       num_presses = 0, num_detects = 0;
+	struct sim_score               score;
+	uint16_t                       i, j;
+
+	for (i = 0; i < sim_qtm_event_count(); i++) {
+		const struct sim_qtm_event *ev = sim_qtm_event_get(i);
+		uint64_t                    off_ms = end_ns / SIM_NS_PER_MS;
+
+		if ((ev->node >= DEF_NUM_SENSORS) || (ev->delta < qtlib_key_configs_set1[ev->node].channel_threshold)) {
+			continue;
+		}
+		/* Only the event starting the press */
+		if (i > 0) {
+			bool pressed = false;
+			for (j = i; j-- > 0;) {
+				const struct sim_qtm_event *prev = sim_qtm_event_get(j);
+				if (prev->node == ev->node) {
+					pressed = prev->delta >= qtlib_key_configs_set1[ev->node].channel_threshold;
+					break;
+				}
+			}
+			if (pressed) {
+				continue;
+			}
+		}
+
+		for (j = i + 1; j < sim_qtm_event_count(); j++) {
+			const struct sim_qtm_event *next = sim_qtm_event_get(j);
+			if ((next->node == ev->node) && (next->delta < qtlib_key_configs_set1[ev->node].channel_threshold)) {
+				off_ms = next->time_ms;
+				break;
+			}
+		}
+		if ((uint64_t)ev->time_ms * SIM_NS_PER_MS >= end_ns) {
+			continue;
+		}
+		presses[num_presses].node   = ev->node;
+		presses[num_presses].on_ms  = ev->time_ms;
+		presses[num_presses].off_ms = off_ms;
+		num_presses++;
+	}
+
+	for (j = 0; j < sim_num_transitions; j++) {
+		if (sim_transitions[j].touched) {
+			detects[num_detects].node    = sim_transitions[j].key;
+			detects[num_detects].time_ms = sim_transitions[j].time_ns / SIM_NS_PER_MS;
+			num_detects++;
+		}
+	}
+
+	sim_score_run(presses, num_presses, detects, num_detects, max_latency_ms, true, &score);
+
+	printf("presses           : %u, missed %u, false detects %u\n", score.presses, score.misses, score.false_detects);
+	if (score.presses > score.misses) {
+		printf("detect latency    : min %u ms, mean %.1f ms, max %u ms\n",
+		       (unsigned)score.latency_min_ms,
+		       score.latency_mean_ms,
+		       (unsigned)score.latency_max_ms);
+	}
+
+	return score.misses + score.false_detects;
+}
+
+/**
+ * \brief Decode the datastreamer frames sent by the firmware, and write them to
+ * the capture file if there is one
+ */
+static void sim_capture_byte(uint8_t byte, uint64_t time_ns)
+{
+	struct sim_capture_frame frame;
+
+	if (sim_capture_decoder_put(&sim_decoder, byte, &frame)) {
+		frame.time_ms = time_ns / SIM_NS_PER_MS;
+		sim_hop       = frame.hop;
+		if (sim_capture_file != NULL) {
+			sim_capture_write_frame(sim_capture_file, DEF_NUM_CHANNELS, &frame);
+		}
+	}
+}
+
+/**
+ * \brief Load the bytes to send to the USART receiver
+ *
+ * \return 0 on success, -1 on error (reported on stderr)
+ */
+static int sim_load_rx(const char *path)
+{
+	char     line[1024];
+	FILE *   file = fopen(path, "r");
+	unsigned line_number = 0;
+
+	if (file == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		char *   p = line;
+		char *   end;
+		uint64_t time_ns;
+
+		line_number++;
+		if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0')) {
+			continue;
+		}
+		time_ns = strtoul(p, &end, 10) * SIM_NS_PER_MS;
+		if ((end == p) || ((sim_num_rx != 0u) && (time_ns < sim_rx[sim_num_rx - 1u].time_ns))) {
+			fprintf(stderr, "%s:%u: malformed line\n", path, line_number);
+			fclose(file);
+			return -1;
+		}
+		for (p = end;; p = end) {
+			unsigned long byte = strtoul(p, &end, 16);
+
+			if (end == p) {
+				break;
+			}
+			if (sim_num_rx == SIM_MAX_RX_BYTES) {
+				fprintf(stderr, "%s: too many bytes\n", path);
+				fclose(file);
+				return -1;
+			}
+			time_ns += SIM_RX_BYTE_NS;
+			sim_rx[sim_num_rx].time_ns = time_ns;
+			sim_rx[sim_num_rx].byte    = (uint8_t)byte;
+			sim_num_rx++;
+		}
+	}
+
+	fclose(file);
+	return 0;
+}
+
+static void sim_usage(const char *argv0)
+{
+	fprintf(stderr,
+	        "usage: %s [--time ms] [--script file] [--noise counts] [--seed n]\n"
+	        "       [--uart file] [--capture file] [--rx file]\n"
+	        "       [--eeprom-in file] [--eeprom-out file] [--cc-shift n] [--mains hz]\n"
+	        "       [--freq-noise sel:counts] [--max-latency ms]\n"
+	        "       [--supply-dip ms:ms] [--brown-out] [--ptc-hang ms] [--ptc-slow ms:ms]\n"
+	        "       [--modules mask] [--module-drop n] [--module-stuck mask] [--check]\n",
+	        argv0);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t                    time_ms        = 10000;
+	uint32_t                    max_latency_ms = 250;
+	const char *                script         = NULL;
+	const char *                uart_path      = NULL;
+	const char *                capture_path   = NULL;
+	const char *                rx_path        = NULL;
+	const char *                eeprom_in      = NULL;
+	const char *                eeprom_out     = NULL;
+	FILE *                      uart_file      = NULL;
+	uint16_t                    noise          = 0;
+	int                         cc_shift       = 0;
+	double                      mains_hz       = 0;
+	uint16_t                    freq_noise[SIM_FREQ_SELS] = {0};
+	char *                      end;
+	unsigned long               freq;
+	uint32_t                    seed           = 1;
+	bool                        check          = false;
+	bool                        brown_out      = false;
+	uint32_t                    dips[SIM_MAX_SUPPLY_DIPS][2];
+	unsigned                    num_dips       = 0;
+	long                        ptc_hang_ms    = -1;
+	unsigned long               ptc_slow[2]    = {0, 0};
+	unsigned long               modules        = 0;
+	unsigned long               module_drop    = 0;
+	unsigned long               module_stuck   = 0;
+	struct sim_hw_stats         hw;
+	struct sim_qtm_stats        qtm;
+	struct sleep_stats          sleep;
+	struct touch_gesture_stats  gestures;
+	struct supply_monitor_stats supply;
+	struct wdt_supervisor_stats watchdog;
+#if RAM_MONITOR_ENABLE == 1
+	struct ram_monitor_stats    ram;
+#endif
+#if MODULE_BUS_ENABLE == 1
+	struct module_bus_stats     bus;
+#endif
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+	struct touch_reburst_stats reburst;
+#endif
+	uint32_t                    profile_frames = 0;
+	struct sim_module_stats     module;
+	uint32_t                    total_ticks = 0;
+	double                      wall_s;
+	clock_t                     start;
+	unsigned                    errors = 0;
+	int                         i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--check")) {
+			check = true;
+		} else if (!strcmp(argv[i], "--brown-out")) {
+			brown_out = true;
+		} else if (i + 1 >= argc) {
+			sim_usage(argv[0]);
+			return 2;
+		} else if (!strcmp(argv[i], "--time")) {
+			time_ms = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--script")) {
+			script = argv[++i];
+		} else if (!strcmp(argv[i], "--noise")) {
+			noise = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--seed")) {
+			seed = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--uart")) {
+			uart_path = argv[++i];
+		} else if (!strcmp(argv[i], "--capture")) {
+			capture_path = argv[++i];
+		} else if (!strcmp(argv[i], "--rx")) {
+			rx_path = argv[++i];
+		} else if (!strcmp(argv[i], "--eeprom-in")) {
+			eeprom_in = argv[++i];
+		} else if (!strcmp(argv[i], "--eeprom-out")) {
+			eeprom_out = argv[++i];
+		} else if (!strcmp(argv[i], "--cc-shift")) {
+			cc_shift = strtol(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--mains")) {
+			mains_hz = strtod(argv[++i], NULL);
+		} else if (!strcmp(argv[i], "--freq-noise")) {
+			freq = strtoul(argv[++i], &end, 0);
+			if ((*end != ':') || (freq >= SIM_FREQ_SELS)) {
+				sim_usage(argv[0]);
+				return 2;
+			}
+			freq_noise[freq] = strtoul(end + 1, NULL, 0);
+		} else if (!strcmp(argv[i], "--supply-dip")) {
+			dips[num_dips][0] = strtoul(argv[++i], &end, 0);
+			if ((*end != ':') || (num_dips == SIM_MAX_SUPPLY_DIPS)) {
+				sim_usage(argv[0]);
+				return 2;
+			}
+			dips[num_dips][1] = strtoul(end + 1, NULL, 0);
+			num_dips++;
+		} else if (!strcmp(argv[i], "--ptc-hang")) {
+			ptc_hang_ms = strtol(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--ptc-slow")) {
+			ptc_slow[0] = strtoul(argv[++i], &end, 0);
+			if (*end != ':') {
+				sim_usage(argv[0]);
+				return 2;
+			}
+			ptc_slow[1] = strtoul(end + 1, NULL, 0);
+		} else if (!strcmp(argv[i], "--modules")) {
+			modules = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--module-drop")) {
+			module_drop = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--module-stuck")) {
+			module_stuck = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--max-latency")) {
+			max_latency_ms = strtoul(argv[++i], NULL, 0);
+		} else {
+			sim_usage(argv[0]);
+			return 2;
+		}
+	}
+
+	sim_hw_reset();
+	sim_hw_set_mains(mains_hz);
+	for (i = 0; i < (int)num_dips; i++) {
+		if (sim_hw_add_supply_dip((uint64_t)dips[i][0] * SIM_NS_PER_MS, (uint64_t)dips[i][1] * SIM_NS_PER_MS) != 0) {
+			fprintf(stderr, "supply dips must be in time order, at most %u\n", SIM_MAX_SUPPLY_DIPS);
+			return 2;
+		}
+	}
+	if (brown_out) {
+		RSTCTRL.RSTFR = RSTCTRL_BORF_bm;
+	}
+	sim_module_reset();
+	sim_module_attach((uint8_t)modules);
+	sim_module_set_drop(module_drop);
+	sim_module_set_stuck((uint8_t)module_stuck);
+	sim_qtm_reset();
+	if (ptc_hang_ms >= 0) {
+		sim_qtm_set_hang((uint64_t)ptc_hang_ms * SIM_NS_PER_MS);
+	}
+	if (ptc_slow[1] != 0u) {
+		sim_qtm_set_slow((uint64_t)ptc_slow[0] * SIM_NS_PER_MS, (uint64_t)ptc_slow[1] * SIM_NS_PER_MS);
+	}
+	sim_qtm_set_noise(noise, seed);
+	for (i = 0; i < (int)SIM_FREQ_SELS; i++) {
+		sim_qtm_set_freq_noise(i, freq_noise[i]);
+	}
+	for (i = 0; i < DEF_NUM_CHANNELS; i++) {
+		sim_qtm_set_comp_caps(i, 0x2000 + i + cc_shift);
+	}
+	if ((script != NULL) && (sim_qtm_load_script(script) != 0)) {
+		return 2;
+	}
+	if (uart_path != NULL) {
+		uart_file = fopen(uart_path, "wb");
+		if (uart_file == NULL) {
+			perror(uart_path);
+			return 2;
+		}
+		sim_hw_set_uart_sink(uart_file);
+	}
+	if (capture_path != NULL) {
+		sim_capture_file = fopen(capture_path, "w");
+		if (sim_capture_file == NULL) {
+			perror(capture_path);
+			return 2;
+		}
+		sim_capture_write_header(sim_capture_file, DEF_NUM_CHANNELS);
+	}
+	sim_capture_decoder_init(&sim_decoder, DEF_NUM_CHANNELS, SIM_HOP_STEPS);
+	sim_hw_set_uart_monitor(sim_capture_byte);
+	if (rx_path != NULL) {
+		if (sim_load_rx(rx_path) != 0) {
+			return 2;
+		}
+		sim_hw_set_uart_rx(sim_rx, sim_num_rx);
+	}
+	if ((eeprom_in != NULL) && (sim_hw_load_eeprom(eeprom_in) != 0)) {
+		return 2;
+	}
+	sim_hw_set_observer(sim_observe);
+
+	start = clock();
+	sim_hw_run((uint64_t)time_ms * SIM_NS_PER_MS);
+	wall_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	if (uart_file != NULL) {
+		fclose(uart_file);
+	}
+	if (sim_capture_file != NULL) {
+		fclose(sim_capture_file);
+	}
+	if ((eeprom_out != NULL) && (sim_hw_save_eeprom(eeprom_out) != 0)) {
+		return 2;
+	}
+
+	sim_hw_get_stats(&hw);
+	sim_qtm_get_stats(&qtm);
+	sleep_scheduler_get_stats(&sleep);
+	for (i = 0; i < SLEEP_STATE_COUNT; i++) {
+		total_ticks += sleep.residency_ticks[i];
+	}
+
+	printf("simulated         : %.3f s in %.3f s wall time (%.0fx real time)\n",
+	       (double)sim_time_ns() / SIM_NS_PER_S,
+	       wall_s,
+	       wall_s > 0 ? ((double)sim_time_ns() / SIM_NS_PER_S) / wall_s : 0.0);
+	printf("acquisitions      : %llu (%.1f/s)\n",
+	       (unsigned long long)qtm.acquisitions,
+	       qtm.acquisitions / ((double)sim_time_ns() / SIM_NS_PER_S));
+	printf("autoscan          : %llu samples, %llu wakeups\n",
+	       (unsigned long long)qtm.autoscan_samples,
+	       (unsigned long long)qtm.wcomp_wakeups);
+	printf("interrupts        :");
+	for (i = 0; i < SIM_IRQ_COUNT; i++) {
+		printf(" %s %llu", sim_hw_irq_name(i), (unsigned long long)hw.irq_count[i]);
+	}
+	printf("\n");
+	printf("sleeps            : %llu\n", (unsigned long long)hw.sleep_count);
+	if (total_ticks != 0u) {
+		printf("residency         : active %.1f%%, idle %.1f%%, standby %.1f%%\n",
+		       100.0 * sleep.residency_ticks[SLEEP_STATE_ACTIVE] / total_ticks,
+		       100.0 * sleep.residency_ticks[SLEEP_STATE_IDLE] / total_ticks,
+		       100.0 * sleep.residency_ticks[SLEEP_STATE_STANDBY] / total_ticks);
+	}
+	printf("uart              : %llu bytes, %u frames dropped\n",
+	       (unsigned long long)hw.uart_bytes,
+	       USART_get_tx_overflow_frames());
+#if USART_RX_ENABLE == 1
+	printf("uart rx           : %llu bytes, %llu lost, %u overflowed\n",
+	       (unsigned long long)hw.uart_rx_bytes,
+	       (unsigned long long)hw.uart_rx_lost,
+	       USART_get_rx_overflow_bytes());
+#else
+	printf("uart rx           : receiver off, %llu bytes lost\n", (unsigned long long)hw.uart_rx_lost);
+#endif
+	supply_monitor_get_stats(&supply);
+	printf("supply            : %u dips, %u relay pulls while low, reset cause 0x%02x, %u brown-outs, %llu user row writes\n",
+	       supply.dips,
+	       sim_relay_low_pulls,
+	       supply.reset_cause,
+	       supply.brownouts,
+	       (unsigned long long)hw.userrow_writes);
+	wdt_supervisor_get_stats(&watchdog);
+	printf("watchdog          : %u kicks, %u late cycles, ", watchdog.kicks, watchdog.late);
+	if (hw.wdt_reset_ns != 0u) {
+		printf("reset at %.1f ms in stage %s%s\n",
+		       (double)hw.wdt_reset_ns / SIM_NS_PER_MS,
+		       sim_wdt_stages[(wdt_supervisor_get_overrun_stage() != WDT_SUPERVISOR_STAGE_NONE)
+		                          ? wdt_supervisor_get_overrun_stage()
+		                          : wdt_supervisor_get_pending_stage()],
+		       (hw.wdt_window_violations != 0u) ? " by a kick in the closed window" : "");
+	} else {
+		printf("no reset\n");
+	}
+#if RAM_MONITOR_ENABLE == 1
+	/* Scanned again like for a read by the host */
+	ram_monitor_scan();
+	ram_monitor_get_stats(&ram);
+	printf("ram               : static %u bytes, stack %u bytes, %u free\n", ram.static_size, ram.stack_size, ram.stack_free);
+#else
+	printf("ram               : not monitored\n");
+#endif
+	for (i = 0; i < (int)SIM_CAPTURE_PROFILE_STAGES; i++) {
+		profile_frames += sim_decoder.profile[i].frames;
+	}
+	printf("profile           : %u frames", profile_frames);
+	if (profile_frames != 0u) {
+		printf(", mean/max us:");
+		for (i = 0; i < (int)SIM_CAPTURE_PROFILE_STAGES; i++) {
+			const struct sim_capture_profile *profile = &sim_decoder.profile[i];
+
+			printf(" %s %.1f/%.1f",
+			       sim_profile_stages[i],
+			       (profile->samples != 0u) ? profile->sum_us / profile->samples : 0.0,
+			       profile->max_us);
+		}
+	}
+	printf("\n");
+#if DEF_TOUCH_SELECTIVE_REBURST == 1u
+	touch_reburst_get_stats(&reburst);
+	printf("reburst           : %u touches, mean/max %.1f/%u cycles per touch, %u selective, %u full\n",
+	       reburst.touches,
+	       (reburst.touches != 0u) ? (double)reburst.cycles / reburst.touches : 0.0,
+	       reburst.max_cycles,
+	       reburst.selective,
+	       reburst.full);
+#else
+	printf("reburst           : all nodes\n");
+#endif
+#if MODULE_BUS_ENABLE == 1
+	module_bus_get_stats(&bus);
+	printf("module bus        : %u commands, %u acks, %u retries, %u failures, %u mismatches, max latency %u us\n",
+	       bus.commands,
+	       bus.acks,
+	       bus.retries,
+	       bus.failures,
+	       bus.mismatches,
+	       bus.max_latency);
+#else
+	printf("module bus        : disabled\n");
+#endif
+	sim_module_get_stats(&module);
+	printf("modules           : %llu commands, %llu dropped, %llu protocol errors, relays",
+	       (unsigned long long)module.commands,
+	       (unsigned long long)module.dropped,
+	       (unsigned long long)module.protocol_errors);
+	for (i = 0; i < (int)SIM_MODULE_COUNT; i++) {
+		printf(" %u", sim_module_get_relay(i, sim_time_ns()));
+	}
+#if MODULE_BUS_ENABLE == 1
+	printf(", reported");
+	for (i = 0; i < (int)SIM_MODULE_COUNT; i++) {
+		printf(" %u", module_bus_get(i));
+	}
+#endif
+	printf("\n");
+	printf("leds              : levels");
+	for (i = 0; i < LED_PWM_COUNT; i++) {
+		printf(" %u", led_pwm_get(i));
+	}
+	/* The LEDs are active low on PC0 to PC2 */
+	printf(", lit %u, pwm running %.1f%%\n",
+	       !(VPORTC.OUT & PIN0_bm) + !(VPORTC.OUT & PIN1_bm) + !(VPORTC.OUT & PIN2_bm),
+	       100.0 * hw.tca_running_ns / sim_time_ns());
+	touch_gesture_get_stats(&gestures);
+	printf("gestures          : %u taps, %u double taps, %u long presses, %u repeats, %u dropped\n",
+	       gestures.events[TOUCH_GESTURE_TAP],
+	       gestures.events[TOUCH_GESTURE_DOUBLE_TAP],
+	       gestures.events[TOUCH_GESTURE_LONG_PRESS],
+	       gestures.events[TOUCH_GESTURE_REPEAT],
+	       gestures.dropped);
+	printf("frequency hop     : freq sel");
+	for (i = 0; i < sim_hop.steps; i++) {
+		printf(" %u", sim_hop.freq[i]);
+	}
+	printf(", noise");
+	for (i = 0; i < sim_hop.steps; i++) {
+		printf(" %u", sim_hop.noise[i]);
+	}
+	printf("\n");
+	printf("relays            : %u switched, contact phase error max %lld us, %llu acquisitions disturbed\n",
+	       sim_relay_switches,
+	       (long long)(sim_relay_error_max_ns / 1000),
+	       (unsigned long long)qtm.disturbed);
+	printf("ready             : %u ms after reset, %llu node calibrations\n",
+	       touch_get_ready_time_ms(),
+	       (unsigned long long)qtm.calibrations);
+	printf("eeprom            : %llu writes, per page",
+	       (unsigned long long)hw.eeprom_writes);
+	for (i = 0; i < (int)SIM_EEPROM_PAGES; i++) {
+		printf(" %llu", (unsigned long long)hw.eeprom_page_writes[i]);
+	}
+	printf("\n");
+	printf("key thresholds    :");
+	for (i = 0; i < DEF_NUM_SENSORS; i++) {
+		printf(" %u", qtlib_key_configs_set1[i].channel_threshold);
+	}
+	printf(", hysteresis");
+	for (i = 0; i < DEF_NUM_SENSORS; i++) {
+		printf(" %u", qtlib_key_configs_set1[i].channel_hysteresis);
+	}
+	printf(", detect integration %u, period %u ms\n",
+	       qtlib_key_grp_config_set1.sensor_touch_di,
+	       touch_get_measurement_period());
+
+	errors = sim_check_presses(max_latency_ms, sim_time_ns());
+
+	return (check && (errors != 0u)) ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * \file
+ *
+ * \brief Host model of the relay modules on the module bus.
+ *
+ * Each attached module watches its BUTTON_MOD line through the pin monitor of
+ * the hardware model and decodes the width of every high pulse like the
+ * module firmware would, in units of MODULE_BUS_UNIT_US with one unit of
+ * tolerance:
+ *
+ * - A valid command is acknowledged SIM_MODULE_ACK_DELAY_NS after its end
+ *   with a pulse on the RELAY_MOD line of the module, scheduled with
+ *   sim_hw_set_pin_at(), whose width gives the state of the relay contacts
+ *   at that time.
+ * - A switching command energises or releases the coil at once, and the
+ *   contacts follow SIM_MODULE_MOVE_NS later, so the acknowledgement still
+ *   reports the old state.
+ * - Fault injection: sim_module_set_drop() leaves the first commands to each
+ *   module unanswered, like noise on the line, and sim_module_set_stuck()
+ *   gives modules whose contacts never move.
+ */
+
+#include <string.h>
+
+#include <avr/io.h>
+
+#include "module_bus.h"
+#include "sim_hw.h"
+#include "sim_module.h"
+
+/* Time from the end of a command to the acknowledgement */
+#define SIM_MODULE_ACK_DELAY_NS 30000ull
+
+/* Time the relay contacts take to move */
+#define SIM_MODULE_MOVE_NS (10u * SIM_NS_PER_MS)
+
+#define SIM_MODULE_UNIT_NS (MODULE_BUS_UNIT_US * 1000ull)
+
+/* BUTTON_MOD pins on PORTA, RELAY_MOD ports and pins */
+static const uint8_t sim_module_cmd_pins[SIM_MODULE_COUNT]  = {3u, 2u, 1u};
+static const uint8_t sim_module_ack_ports[SIM_MODULE_COUNT] = {SIM_PORT_A, SIM_PORT_B, SIM_PORT_B};
+static const uint8_t sim_module_ack_pins[SIM_MODULE_COUNT]  = {7u, 2u, 4u};
+
+/* State of one module: command line level and the time it went high, relay
+ * state before and after the contacts move and the time they move */
+struct sim_module {
+	bool     line;
+	uint64_t rise_ns;
+	bool     from;
+	bool     to;
+	uint64_t move_ns;
+	unsigned dropped;
+};
+
+static struct sim_module       sim_modules[SIM_MODULE_COUNT];
+static uint8_t                 sim_module_attached;
+static uint8_t                 sim_module_stuck;
+static unsigned                sim_module_drop;
+static struct sim_module_stats sim_module_stats_data;
+
+/**
+ * \brief Decode a command pulse and answer it
+ */
+static void sim_module_command(uint8_t module, uint64_t width_ns, uint64_t time_ns)
+{
+	struct sim_module *m     = &sim_modules[module];
+	unsigned           units = (unsigned)((width_ns + SIM_MODULE_UNIT_NS / 2u) / SIM_MODULE_UNIT_NS);
+	uint64_t           ack_ns;
+	bool               on;
+
+	if ((units != MODULE_BUS_OFF_UNITS) && (units != MODULE_BUS_ON_UNITS) && (units != MODULE_BUS_QUERY_UNITS)) {
+		sim_module_stats_data.protocol_errors++;
+		return;
+	}
+	sim_module_stats_data.commands++;
+
+	if (m->dropped < sim_module_drop) {
+		m->dropped++;
+		sim_module_stats_data.dropped++;
+		return;
+	}
+
+	ack_ns = time_ns + SIM_MODULE_ACK_DELAY_NS;
+	on     = sim_module_get_relay(module, ack_ns);
+	sim_hw_set_pin_at(sim_module_ack_ports[module], sim_module_ack_pins[module], true, ack_ns);
+	sim_hw_set_pin_at(sim_module_ack_ports[module],
+	                  sim_module_ack_pins[module],
+	                  false,
+	                  ack_ns + (on ? MODULE_BUS_ON_UNITS : MODULE_BUS_OFF_UNITS) * SIM_MODULE_UNIT_NS);
+
+	if ((units != MODULE_BUS_QUERY_UNITS) && !(sim_module_stuck & (1u << module))) {
+		m->from    = sim_module_get_relay(module, time_ns);
+		m->to      = (units == MODULE_BUS_ON_UNITS);
+		m->move_ns = time_ns + SIM_MODULE_MOVE_NS;
+	}
+}
+
+/**
+ * \brief Follow the BUTTON_MOD lines, called on every change of a port output
+ */
+static void sim_module_monitor(enum sim_port port, uint8_t out, uint64_t time_ns)
+{
+	struct sim_module *m;
+	uint8_t            module;
+	bool               line;
+
+	if (port != SIM_PORT_A) {
+		return;
+	}
+
+	for (module = 0; module < SIM_MODULE_COUNT; module++) {
+		if (!(sim_module_attached & (1u << module))) {
+			continue;
+		}
+		m    = &sim_modules[module];
+		line = (out & (1u << sim_module_cmd_pins[module])) != 0u;
+		if (line && !m->line) {
+			m->rise_ns = time_ns;
+		} else if (!line && m->line) {
+			sim_module_command(module, time_ns - m->rise_ns, time_ns);
+		}
+		m->line = line;
+	}
+}
+
+void sim_module_reset(void)
+{
+	memset(sim_modules, 0, sizeof(sim_modules));
+	memset(&sim_module_stats_data, 0, sizeof(sim_module_stats_data));
+	sim_module_attached = 0;
+	sim_module_stuck    = 0;
+	sim_module_drop     = 0;
+}
+
+/**
+ * \brief Connect relay modules to the bus
+ *
+ * \param[in] modules Mask of the modules present
+ */
+void sim_module_attach(uint8_t modules)
+{
+	sim_module_attached = modules;
+	sim_hw_set_pin_monitor((modules != 0u) ? sim_module_monitor : NULL);
+}
+
+/**
+ * \brief Leave the first commands to each module unanswered
+ */
+void sim_module_set_drop(unsigned count)
+{
+	sim_module_drop = count;
+}
+
+/**
+ * \brief Set the modules whose relay contacts do not move
+ */
+void sim_module_set_stuck(uint8_t modules)
+{
+	sim_module_stuck = modules;
+}
+
+/**
+ * \brief State of the relay contacts of a module at a point in time
+ */
+bool sim_module_get_relay(uint8_t module, uint64_t time_ns)
+{
+	const struct sim_module *m = &sim_modules[module];
+
+	return (time_ns >= m->move_ns) ? m->to : m->from;
+}
+
+void sim_module_get_stats(struct sim_module_stats *stats)
+{
+	*stats = sim_module_stats_data;
+}
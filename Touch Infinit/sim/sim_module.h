@@ -0,0 +1,37 @@
+/**
+ * \file
+ *
+ * \brief Host model of the relay modules on the module bus.
+ */
+
+#ifndef SIM_MODULE_H_INCLUDED
+#define SIM_MODULE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_MODULE_COUNT 3u
+
+/* Relay module statistics */
+struct sim_module_stats {
+	uint64_t commands;        /* Valid commands received */
+	uint64_t dropped;         /* Commands left unanswered by fault injection */
+	uint64_t protocol_errors; /* Command pulses of no valid width */
+};
+
+void sim_module_reset(void);
+void sim_module_attach(uint8_t modules);
+void sim_module_set_drop(unsigned count);
+void sim_module_set_stuck(uint8_t modules);
+bool sim_module_get_relay(uint8_t module, uint64_t time_ns);
+void sim_module_get_stats(struct sim_module_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_MODULE_H_INCLUDED */
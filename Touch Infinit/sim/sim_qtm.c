@@ -0,0 +1,524 @@
+/**
+ * \file
+ *
+ * \brief Replay-driven stand-in for the QTouch acquisition module.
+ *
+ * Replaces libqtm_acq_runtime_t816 in the host build. Node signals come from a
+ * touch script instead of the PTC: each node reads a fixed baseline plus the
+ * delta of the last script event for that node, plus optional uniform noise
+ * and uniform noise of the acquisition frequency in use, like interference
+ * near one of the PTC sampling frequencies.
+ * A measurement sequence takes the PTC conversion time of its nodes and
+ * completes through ADC0_RESRDY_vect like on the device.
+ *
+ * Each node has a compensation capacitance value that balances it. A node
+ * measured with another value reads SIM_QTM_CC_COUNTS per unit of difference
+ * away from its baseline, as after a warm start with stale values. A
+ * calibration takes SIM_QTM_CAL_BURSTS measurements, like the successive
+ * approximation of the library, and then sets the balancing value.
+ *
+ * Disturbances such as relay switching add a delta to all nodes of every
+ * measurement sequence that overlaps them.
+ *
+ * From the time set with sim_qtm_set_hang() on, a measurement sequence never
+ * completes, like a PTC that does not raise its end of conversion. From the
+ * time set with sim_qtm_set_slow() on, each one completes a delay late.
+ *
+ * The last set given to qtm_ptc_init_acquisition_module() is the panel, node n
+ * of the script is its node n. A measurement sequence of another set, such as
+ * a reburst of a few nodes, finds its nodes on the panel by their X and Y
+ * lines. A node on the lines of several panel nodes, like the low power node,
+ * is one more node of its own, SIM_QTM_LUMP_NODE, that reads the deltas of all
+ * of them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "touch.h"
+#include "sim_hw.h"
+#include "sim_qtm.h"
+#include "touch_key.h"
+
+/* PTC time per accumulated sample */
+#define SIM_QTM_SAMPLE_NS 12000u
+
+#define SIM_QTM_MAX_EVENTS 4096u
+
+#define SIM_QTM_DEFAULT_BASELINE 512u
+
+/* Signal change per unit of compensation capacitance mismatch */
+#define SIM_QTM_CC_COUNTS 8
+
+/* Measurements taken by a compensation capacitance calibration */
+#define SIM_QTM_CAL_BURSTS 8u
+
+#define SIM_QTM_DEFAULT_CC 0x2000u
+
+#define SIM_QTM_MAX_DISTURBANCES 8u
+
+/* Node combining the lines of several panel nodes */
+#define SIM_QTM_LUMP_NODE SIM_QTM_MAX_NODES
+
+/* FREQ_SEL_0 to FREQ_SEL_15 */
+#define SIM_QTM_NUM_FREQS 16u
+
+/* Time span in which the node signals are disturbed */
+struct sim_qtm_disturbance {
+	uint64_t start_ns;
+	uint64_t end_ns;
+	int16_t  delta;
+};
+
+static struct sim_qtm_event sim_qtm_events[SIM_QTM_MAX_EVENTS];
+static uint16_t             sim_qtm_num_events;
+static uint16_t             sim_qtm_next_event;
+
+static uint16_t sim_qtm_baseline[SIM_QTM_MAX_NODES + 1u];
+static int16_t  sim_qtm_delta[SIM_QTM_MAX_NODES];
+static uint16_t sim_qtm_cc[SIM_QTM_MAX_NODES + 1u];
+static uint8_t  sim_qtm_cal_bursts[SIM_QTM_MAX_NODES + 1u];
+static uint16_t sim_qtm_noise;
+static uint16_t sim_qtm_freq_noise[SIM_QTM_NUM_FREQS];
+static uint32_t sim_qtm_seed;
+
+static struct sim_qtm_disturbance sim_qtm_disturbances[SIM_QTM_MAX_DISTURBANCES];
+static uint8_t                    sim_qtm_next_disturbance;
+static int16_t                    sim_qtm_disturbance_delta;
+static uint64_t                   sim_qtm_start_ns;
+static uint64_t                   sim_qtm_hang_ns;
+static uint64_t                   sim_qtm_slow_ns;
+static uint64_t                   sim_qtm_slow_delay_ns;
+
+static qtm_acquisition_control_t *sim_qtm_panel;
+static qtm_acquisition_control_t *sim_qtm_acq;
+static uint16_t *                 sim_qtm_raw;
+static void (*sim_qtm_measure_callback)(void);
+static uint8_t sim_qtm_busy;
+
+static qtm_auto_scan_config_t *sim_qtm_autoscan;
+static void (*sim_qtm_autoscan_callback)(void);
+static uint16_t sim_qtm_autoscan_reference;
+
+static struct sim_qtm_stats sim_qtm_stats_data;
+
+/* Script and signal model */
+
+void sim_qtm_reset(void)
+{
+	uint8_t node;
+
+	sim_qtm_next_event = 0;
+	for (node = 0; node <= SIM_QTM_LUMP_NODE; node++) {
+		if (sim_qtm_baseline[node] == 0u) {
+			sim_qtm_baseline[node] = SIM_QTM_DEFAULT_BASELINE + 16u * node;
+		}
+		if (sim_qtm_cc[node] == 0u) {
+			sim_qtm_cc[node] = SIM_QTM_DEFAULT_CC + node;
+		}
+		if (node < SIM_QTM_MAX_NODES) {
+			sim_qtm_delta[node] = 0;
+		}
+		sim_qtm_cal_bursts[node] = 0;
+	}
+
+	sim_qtm_panel             = NULL;
+	sim_qtm_acq               = NULL;
+	sim_qtm_raw               = NULL;
+	sim_qtm_measure_callback  = NULL;
+	sim_qtm_busy              = 0;
+	sim_qtm_autoscan          = NULL;
+	sim_qtm_autoscan_callback = NULL;
+	sim_qtm_disturbance_delta = 0;
+	sim_qtm_next_disturbance  = 0;
+	sim_qtm_hang_ns           = UINT64_MAX;
+	sim_qtm_slow_ns           = UINT64_MAX;
+	sim_qtm_slow_delay_ns     = 0;
+	memset(sim_qtm_disturbances, 0, sizeof(sim_qtm_disturbances));
+	memset(sim_qtm_freq_noise, 0, sizeof(sim_qtm_freq_noise));
+	qtm_local_ms_timecount = 0;
+	memset(&sim_qtm_stats_data, 0, sizeof(sim_qtm_stats_data));
+}
+
+static int sim_qtm_event_compare(const void *a, const void *b)
+{
+	const struct sim_qtm_event *ea = a;
+	const struct sim_qtm_event *eb = b;
+
+	return (ea->time_ms > eb->time_ms) - (ea->time_ms < eb->time_ms);
+}
+
+/**
+ * \brief Load a touch script
+ *
+ * One event per line: "<time_ms> <node> <delta>". Blank lines and lines
+ * starting with '#' are ignored. Events are sorted by time.
+ *
+ * \return 0 on success, -1 on error
+ */
+int sim_qtm_load_script(const char *path)
+{
+	FILE *   f = fopen(path, "r");
+	char     line[128];
+	unsigned lineno = 0;
+	unsigned long time_ms;
+	unsigned node;
+	int      delta;
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	sim_qtm_num_events = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		lineno++;
+		if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0')) {
+			continue;
+		}
+		if ((sscanf(line, "%lu %u %d", &time_ms, &node, &delta) != 3) || (node >= SIM_QTM_MAX_NODES)) {
+			fprintf(stderr, "%s:%u: expected <time_ms> <node> <delta>\n", path, lineno);
+			fclose(f);
+			return -1;
+		}
+		if (sim_qtm_num_events == SIM_QTM_MAX_EVENTS) {
+			fprintf(stderr, "%s:%u: more than %u events\n", path, lineno, SIM_QTM_MAX_EVENTS);
+			fclose(f);
+			return -1;
+		}
+		sim_qtm_events[sim_qtm_num_events].time_ms = time_ms;
+		sim_qtm_events[sim_qtm_num_events].node    = node;
+		sim_qtm_events[sim_qtm_num_events].delta   = delta;
+		sim_qtm_num_events++;
+	}
+	fclose(f);
+
+	qsort(sim_qtm_events, sim_qtm_num_events, sizeof(sim_qtm_events[0]), sim_qtm_event_compare);
+	return 0;
+}
+
+void sim_qtm_set_noise(uint16_t amplitude, uint32_t seed)
+{
+	sim_qtm_noise = amplitude;
+	sim_qtm_seed  = seed;
+}
+
+void sim_qtm_set_freq_noise(uint8_t freq, uint16_t amplitude)
+{
+	if (freq < SIM_QTM_NUM_FREQS) {
+		sim_qtm_freq_noise[freq] = amplitude;
+	}
+}
+
+void sim_qtm_set_baseline(uint8_t node, uint16_t signal)
+{
+	if (node < SIM_QTM_MAX_NODES) {
+		sim_qtm_baseline[node] = signal;
+	}
+}
+
+void sim_qtm_set_comp_caps(uint8_t node, uint16_t comp_caps)
+{
+	if ((node < SIM_QTM_MAX_NODES) && (comp_caps != 0u)) {
+		sim_qtm_cc[node] = comp_caps;
+	}
+}
+
+void sim_qtm_add_disturbance(uint64_t start_ns, uint64_t end_ns, int16_t delta)
+{
+	/* The oldest one is replaced, it has passed long ago */
+	sim_qtm_disturbances[sim_qtm_next_disturbance].start_ns = start_ns;
+	sim_qtm_disturbances[sim_qtm_next_disturbance].end_ns   = end_ns;
+	sim_qtm_disturbances[sim_qtm_next_disturbance].delta    = delta;
+	sim_qtm_next_disturbance = (sim_qtm_next_disturbance + 1u) % SIM_QTM_MAX_DISTURBANCES;
+}
+
+void sim_qtm_set_hang(uint64_t time_ns)
+{
+	sim_qtm_hang_ns = time_ns;
+}
+
+void sim_qtm_set_slow(uint64_t time_ns, uint64_t delay_ns)
+{
+	sim_qtm_slow_ns       = time_ns;
+	sim_qtm_slow_delay_ns = delay_ns;
+}
+
+uint16_t sim_qtm_event_count(void)
+{
+	return sim_qtm_num_events;
+}
+
+const struct sim_qtm_event *sim_qtm_event_get(uint16_t index)
+{
+	return &sim_qtm_events[index];
+}
+
+void sim_qtm_get_stats(struct sim_qtm_stats *stats)
+{
+	*stats = sim_qtm_stats_data;
+}
+
+/**
+ * \brief Uniform noise in -amplitude to amplitude
+ */
+static int32_t sim_qtm_random(uint16_t amplitude)
+{
+	sim_qtm_seed = sim_qtm_seed * 1103515245u + 12345u;
+	return (int32_t)((sim_qtm_seed >> 16) % (2u * amplitude + 1u)) - amplitude;
+}
+
+/**
+ * \brief Panel node of a node of a set, by its X and Y lines
+ *
+ * \return Panel node, SIM_QTM_LUMP_NODE for a node on the lines of several
+ */
+static uint16_t sim_qtm_panel_node(const qtm_acquisition_control_t *acq, uint16_t node)
+{
+	const qtm_acq_t81x_node_config_t *cfg = &acq->qtm_acq_node_config[node];
+	uint16_t                          i;
+
+	if (acq == sim_qtm_panel) {
+		return node;
+	}
+	for (i = 0; i < sim_qtm_panel->qtm_acq_node_group_config->num_sensor_nodes; i++) {
+		if ((sim_qtm_panel->qtm_acq_node_config[i].node_xmask == cfg->node_xmask)
+		    && (sim_qtm_panel->qtm_acq_node_config[i].node_ymask == cfg->node_ymask)) {
+			return i;
+		}
+	}
+	return SIM_QTM_LUMP_NODE;
+}
+
+/**
+ * \brief Sum of the deltas of the panel nodes on the lines of a node
+ */
+static int32_t sim_qtm_lump_delta(const qtm_acq_t81x_node_config_t *cfg)
+{
+	const qtm_acq_t81x_node_config_t *panel;
+	int32_t                           delta = 0;
+	uint16_t                          i;
+
+	for (i = 0; i < sim_qtm_panel->qtm_acq_node_group_config->num_sensor_nodes; i++) {
+		panel = &sim_qtm_panel->qtm_acq_node_config[i];
+		if (!(panel->node_xmask & (uint8_t)~cfg->node_xmask) && !(panel->node_ymask & (uint8_t)~cfg->node_ymask)) {
+			delta += sim_qtm_delta[i];
+		}
+	}
+	return delta;
+}
+
+/**
+ * \brief Signal of a node of a set at the current simulated time
+ */
+static uint16_t sim_qtm_sample(const qtm_acquisition_control_t *acq, uint16_t node)
+{
+	uint32_t now_ms     = sim_time_ns() / SIM_NS_PER_MS;
+	uint16_t panel_node = sim_qtm_panel_node(acq, node);
+	int32_t  signal;
+	uint8_t  freq;
+
+	while ((sim_qtm_next_event < sim_qtm_num_events) && (sim_qtm_events[sim_qtm_next_event].time_ms <= now_ms)) {
+		sim_qtm_delta[sim_qtm_events[sim_qtm_next_event].node] = sim_qtm_events[sim_qtm_next_event].delta;
+		sim_qtm_next_event++;
+	}
+
+	signal = (int32_t)sim_qtm_baseline[panel_node] + sim_qtm_disturbance_delta;
+	if (panel_node == SIM_QTM_LUMP_NODE) {
+		signal += sim_qtm_lump_delta(&acq->qtm_acq_node_config[node]);
+	} else {
+		signal += sim_qtm_delta[panel_node];
+	}
+	signal += ((int32_t)sim_qtm_cc[panel_node] - acq->qtm_acq_node_data[node].node_comp_caps) * SIM_QTM_CC_COUNTS;
+	if (sim_qtm_noise != 0u) {
+		signal += sim_qtm_random(sim_qtm_noise);
+	}
+	freq = acq->qtm_acq_node_group_config->freq_option_select;
+	if ((freq < SIM_QTM_NUM_FREQS) && (sim_qtm_freq_noise[freq] != 0u)) {
+		signal += sim_qtm_random(sim_qtm_freq_noise[freq]);
+	}
+
+	if (signal < 0) {
+		signal = 0;
+	} else if (signal > 0xffff) {
+		signal = 0xffff;
+	}
+	return (uint16_t)signal;
+}
+
+/* Acquisition module */
+
+touch_ret_t qtm_ptc_init_acquisition_module(qtm_acquisition_control_t *qtm_acq_control_ptr)
+{
+	sim_qtm_panel = qtm_acq_control_ptr;
+	sim_qtm_acq   = qtm_acq_control_ptr;
+	return TOUCH_SUCCESS;
+}
+
+touch_ret_t qtm_ptc_qtlib_assign_signal_memory(uint16_t *qtm_signal_raw_data_ptr)
+{
+	sim_qtm_raw = qtm_signal_raw_data_ptr;
+	return TOUCH_SUCCESS;
+}
+
+touch_ret_t qtm_enable_sensor_node(qtm_acquisition_control_t *qtm_acq_control_ptr, uint16_t qtm_which_node_number)
+{
+	if (qtm_which_node_number >= qtm_acq_control_ptr->qtm_acq_node_group_config->num_sensor_nodes) {
+		return TOUCH_INVALID_INPUT_PARAM;
+	}
+	qtm_acq_control_ptr->qtm_acq_node_data[qtm_which_node_number].node_acq_status |= NODE_ENABLED;
+	return TOUCH_SUCCESS;
+}
+
+touch_ret_t qtm_calibrate_sensor_node(qtm_acquisition_control_t *qtm_acq_control_ptr, uint16_t qtm_which_node_number)
+{
+	if (qtm_which_node_number >= qtm_acq_control_ptr->qtm_acq_node_group_config->num_sensor_nodes) {
+		return TOUCH_INVALID_INPUT_PARAM;
+	}
+	qtm_acq_control_ptr->qtm_acq_node_data[qtm_which_node_number].node_acq_status |= NODE_CAL_REQ;
+	return TOUCH_SUCCESS;
+}
+
+touch_ret_t qtm_ptc_start_measurement_seq(qtm_acquisition_control_t *qtm_acq_control_pointer,
+                                          void (*measure_complete_callback)(void))
+{
+	uint64_t duration = 0;
+	uint16_t node;
+
+	if (sim_qtm_autoscan != NULL) {
+		return TOUCH_INVALID_LIB_STATE;
+	}
+	if (sim_qtm_busy) {
+		return TOUCH_ACQ_INCOMPLETE;
+	}
+
+	sim_qtm_acq              = qtm_acq_control_pointer;
+	sim_qtm_measure_callback = measure_complete_callback;
+	sim_qtm_busy             = 1;
+	sim_qtm_start_ns         = sim_time_ns();
+
+	for (node = 0; node < sim_qtm_acq->qtm_acq_node_group_config->num_sensor_nodes; node++) {
+		if (sim_qtm_acq->qtm_acq_node_data[node].node_acq_status & NODE_ENABLED) {
+			duration += (uint64_t)SIM_QTM_SAMPLE_NS << sim_qtm_acq->qtm_acq_node_config[node].node_oversampling;
+		}
+	}
+
+	if (sim_time_ns() >= sim_qtm_slow_ns) {
+		duration += sim_qtm_slow_delay_ns;
+	}
+	if (sim_time_ns() < sim_qtm_hang_ns) {
+		sim_hw_raise_irq_at(SIM_IRQ_ADC0_RESRDY, sim_time_ns() + duration);
+	}
+	return TOUCH_SUCCESS;
+}
+
+void qtm_t81x_ptc_handler_eoc(void)
+{
+	qtm_acq_node_data_t *data;
+	uint16_t             node;
+	uint16_t             panel_node;
+
+	if (!sim_qtm_busy) {
+		return;
+	}
+
+	for (node = 0; node < SIM_QTM_MAX_DISTURBANCES; node++) {
+		const struct sim_qtm_disturbance *d = &sim_qtm_disturbances[node];
+
+		if ((d->delta != 0) && (d->start_ns <= sim_time_ns()) && (d->end_ns > sim_qtm_start_ns)) {
+			sim_qtm_disturbance_delta += d->delta;
+		}
+	}
+	if (sim_qtm_disturbance_delta != 0) {
+		sim_qtm_stats_data.disturbed++;
+	}
+
+	for (node = 0; node < sim_qtm_acq->qtm_acq_node_group_config->num_sensor_nodes; node++) {
+		data = &sim_qtm_acq->qtm_acq_node_data[node];
+		if (!(data->node_acq_status & NODE_ENABLED)) {
+			continue;
+		}
+		panel_node = sim_qtm_panel_node(sim_qtm_acq, node);
+		if (data->node_acq_status & NODE_CAL_REQ) {
+			if (!(data->node_acq_status & NODE_STATUS_MASK)) {
+				data->node_acq_status |= NODE_CC_CAL << NODE_STATUS_POS;
+				sim_qtm_cal_bursts[panel_node] = SIM_QTM_CAL_BURSTS;
+			}
+			/* The last step measures with the final value */
+			if (--sim_qtm_cal_bursts[panel_node] == 0u) {
+				data->node_comp_caps = sim_qtm_cc[panel_node];
+				sim_qtm_stats_data.calibrations++;
+				data->node_acq_status &= (uint8_t)~(NODE_CAL_REQ | NODE_STATUS_MASK);
+			}
+		}
+		data->node_acq_signals = sim_qtm_sample(sim_qtm_acq, node);
+		if (sim_qtm_raw != NULL) {
+			sim_qtm_raw[node] = data->node_acq_signals;
+		}
+	}
+
+	sim_qtm_disturbance_delta = 0;
+	sim_qtm_busy              = 0;
+	sim_qtm_stats_data.acquisitions++;
+	if (sim_qtm_measure_callback != NULL) {
+		sim_qtm_measure_callback();
+	}
+}
+
+touch_ret_t qtm_acquisition_process(void)
+{
+	return TOUCH_SUCCESS;
+}
+
+touch_ret_t qtm_autoscan_sensor_node(qtm_auto_scan_config_t *qtm_auto_scan_config_ptr,
+                                     void (*auto_scan_callback)(void))
+{
+	if (sim_qtm_busy) {
+		return TOUCH_ACQ_INCOMPLETE;
+	}
+
+	sim_qtm_autoscan           = qtm_auto_scan_config_ptr;
+	sim_qtm_autoscan_callback  = auto_scan_callback;
+	sim_qtm_autoscan_reference = sim_qtm_sample(qtm_auto_scan_config_ptr->qtm_acq_control,
+	                                            qtm_auto_scan_config_ptr->auto_scan_node_number);
+	return TOUCH_SUCCESS;
+}
+
+touch_ret_t qtm_autoscan_node_cancel(void)
+{
+	sim_qtm_autoscan = NULL;
+	sim_hw_cancel_irq(SIM_IRQ_ADC0_WCOMP);
+	return TOUCH_SUCCESS;
+}
+
+/**
+ * \brief Autoscan measurement triggered by the RTC PIT
+ *
+ * \return true if the window comparator fires
+ */
+bool sim_qtm_pit_event(void)
+{
+	uint16_t signal;
+
+	if (sim_qtm_autoscan == NULL) {
+		return false;
+	}
+
+	sim_qtm_stats_data.autoscan_samples++;
+	signal = sim_qtm_sample(sim_qtm_autoscan->qtm_acq_control, sim_qtm_autoscan->auto_scan_node_number);
+
+	return (int32_t)signal - sim_qtm_autoscan_reference > sim_qtm_autoscan->auto_scan_node_threshold;
+}
+
+void qtm_t81x_ptc_handler_wcomp(void)
+{
+	if (sim_qtm_autoscan == NULL) {
+		return;
+	}
+
+	sim_qtm_stats_data.wcomp_wakeups++;
+	if (sim_qtm_autoscan_callback != NULL) {
+		sim_qtm_autoscan_callback();
+	}
+}
@@ -0,0 +1,53 @@
+/**
+ * \file
+ *
+ * \brief Replay-driven stand-in for the QTouch acquisition and key modules.
+ */
+
+#ifndef SIM_QTM_H_INCLUDED
+#define SIM_QTM_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_QTM_MAX_NODES 16u
+
+/* One step of the touch script: from time_ms on, node reads baseline + delta */
+struct sim_qtm_event {
+	uint32_t time_ms;
+	uint8_t  node;
+	int16_t  delta;
+};
+
+/* Acquisition statistics */
+struct sim_qtm_stats {
+	uint64_t acquisitions;     /* Completed measurement sequences */
+	uint64_t autoscan_samples; /* Autoscan measurements on PIT events */
+	uint64_t wcomp_wakeups;    /* Autoscan window comparator hits */
+	uint64_t calibrations;     /* Node compensation capacitance calibrations */
+	uint64_t disturbed;        /* Measurement sequences overlapping a disturbance */
+};
+
+void sim_qtm_reset(void);
+int  sim_qtm_load_script(const char *path);
+void sim_qtm_set_noise(uint16_t amplitude, uint32_t seed);
+void sim_qtm_set_freq_noise(uint8_t freq, uint16_t amplitude);
+void sim_qtm_set_baseline(uint8_t node, uint16_t signal);
+void sim_qtm_set_comp_caps(uint8_t node, uint16_t comp_caps);
+void sim_qtm_add_disturbance(uint64_t start_ns, uint64_t end_ns, int16_t delta);
+void sim_qtm_set_hang(uint64_t time_ns);
+void sim_qtm_set_slow(uint64_t time_ns, uint64_t delay_ns);
+
+uint16_t                    sim_qtm_event_count(void);
+const struct sim_qtm_event *sim_qtm_event_get(uint16_t index);
+
+void sim_qtm_get_stats(struct sim_qtm_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_QTM_H_INCLUDED */
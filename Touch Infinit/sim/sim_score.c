@@ -0,0 +1,75 @@
+/**
+ * \file
+ *
+ * \brief Scoring of key detections against known presses.
+ *
+ * A press is detected if its key goes into detect within max_latency_ms of
+ * the start of the press; the latency is measured to the first such detect.
+ * Every detect of the key from the start of the press until max_latency_ms
+ * after its end belongs to the press. Detects that belong to no press are
+ * false detects.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_score.h"
+
+void sim_score_run(const struct sim_score_press *presses, unsigned num_presses, const struct sim_score_detect *detects,
+                   unsigned num_detects, uint32_t max_latency_ms, bool verbose, struct sim_score *score)
+{
+	uint8_t *attributed = calloc(num_detects ? num_detects : 1u, 1);
+	uint64_t latency_sum = 0;
+	unsigned i, j;
+
+	memset(score, 0, sizeof(*score));
+	score->latency_min_ms = UINT32_MAX;
+
+	for (i = 0; i < num_presses; i++) {
+		const struct sim_score_press *press = &presses[i];
+		bool                          found = false;
+
+		score->presses++;
+		for (j = 0; j < num_detects; j++) {
+			const struct sim_score_detect *detect = &detects[j];
+
+			if ((detect->node != press->node) || (detect->time_ms < press->on_ms)
+			    || (detect->time_ms > press->off_ms + max_latency_ms)) {
+				continue;
+			}
+			attributed[j] = 1;
+			if (!found && (detect->time_ms <= press->on_ms + max_latency_ms)) {
+				uint32_t latency = detect->time_ms - press->on_ms;
+
+				found = true;
+				latency_sum += latency;
+				score->latency_min_ms = latency < score->latency_min_ms ? latency : score->latency_min_ms;
+				score->latency_max_ms = latency > score->latency_max_ms ? latency : score->latency_max_ms;
+			}
+		}
+		if (!found) {
+			score->misses++;
+			if (verbose) {
+				printf("  miss: key %u pressed at %u ms\n", press->node, (unsigned)press->on_ms);
+			}
+		}
+	}
+
+	for (j = 0; j < num_detects; j++) {
+		if (!attributed[j]) {
+			score->false_detects++;
+			if (verbose) {
+				printf("  false detect: key %u at %u ms\n", detects[j].node, (unsigned)detects[j].time_ms);
+			}
+		}
+	}
+
+	if (score->presses > score->misses) {
+		score->latency_mean_ms = (double)latency_sum / (score->presses - score->misses);
+	} else {
+		score->latency_min_ms = 0;
+	}
+
+	free(attributed);
+}
@@ -0,0 +1,46 @@
+/**
+ * \file
+ *
+ * \brief Scoring of key detections against known presses.
+ */
+
+#ifndef SIM_SCORE_H_INCLUDED
+#define SIM_SCORE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A finger on a node from on_ms until off_ms */
+struct sim_score_press {
+	uint8_t  node;
+	uint32_t on_ms;
+	uint32_t off_ms;
+};
+
+/* A key going into detect */
+struct sim_score_detect {
+	uint8_t  node;
+	uint32_t time_ms;
+};
+
+struct sim_score {
+	unsigned presses;
+	unsigned misses;
+	unsigned false_detects;
+	uint32_t latency_min_ms;
+	uint32_t latency_max_ms;
+	double   latency_mean_ms;
+};
+
+void sim_score_run(const struct sim_score_press *presses, unsigned num_presses, const struct sim_score_detect *detects,
+                   unsigned num_detects, uint32_t max_latency_ms, bool verbose, struct sim_score *score);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_SCORE_H_INCLUDED */
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Read and write touch parameters of a running board over the datastreamer port.
+
+The command protocol is described in datastreamer_command.c. Commands are
+repeated until the board answers, telemetry frames in between are skipped.
+The firmware has to be built with DEF_TOUCH_COMMAND_RX_ENABLE=1u, which takes
+RELAY3 from key 3.
+
+    touch_tune.py --port /dev/ttyACM0 get threshold 0
+    touch_tune.py --port /dev/ttyACM0 set threshold 0 35
+    touch_tune.py --port /dev/ttyACM0 set di 0 6
+    touch_tune.py --port /dev/ttyACM0 get stack-free
+    touch_tune.py --port /dev/ttyACM0 header
+"""
+
+import argparse
+import sys
+import time
+
+from ds_capture import COMPACT_SYNC, crc8
+
+TYPE_COMMAND = 0x02
+TYPE_RESPONSE = 0x03
+
+OPCODE_READ = 0x01
+OPCODE_WRITE = 0x02
+OPCODE_HEADER = 0x03
+
+PARAMETERS = {
+    "threshold": 0x01,
+    "hysteresis": 0x02,
+    "di": 0x03,
+    "drift": 0x04,
+    "anti-touch-drift": 0x05,
+    "drift-hold": 0x06,
+    "period": 0x07,
+    "idle-period": 0x08,
+    "idle-timeout": 0x09,
+    "static-ram": 0x0A,
+    "stack-free": 0x0B,
+}
+
+STATUS = ["ok", "bad command", "bad parameter", "bad index", "bad value"]
+
+
+def command_frame(sequence, payload):
+    body = bytes([len(payload), sequence, TYPE_COMMAND]) + bytes(payload)
+    return bytes([COMPACT_SYNC]) + body + bytes([crc8(body)])
+
+
+def find_response(buf, sequence):
+    """Return the response payload for sequence from buf, or None."""
+    pos = buf.find(COMPACT_SYNC)
+    while pos >= 0 and pos + 2 <= len(buf):
+        end = pos + 4 + buf[pos + 1] + 1
+        if (end <= len(buf) and crc8(buf[pos + 1:end - 1]) == buf[end - 1]
+                and buf[pos + 3] & 0x0F == TYPE_RESPONSE and buf[pos + 2] == sequence
+                and buf[pos + 1] == 6):
+            return buf[pos + 4:end - 1]
+        pos = buf.find(COMPACT_SYNC, pos + 1)
+    return None
+
+
+def transact(link, payload, retries=5, timeout=0.5):
+    sequence = int(time.monotonic() * 1000) & 0xFF
+    for _ in range(retries):
+        link.write(command_frame(sequence, payload))
+        buf = bytearray()
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            buf += link.read(link.in_waiting or 1)
+            response = find_response(buf, sequence)
+            if response is not None:
+                return response
+    raise SystemExit("no response from the board")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", required=True, help="serial port of the board")
+    parser.add_argument("--baud", type=int, default=38400)
+    parser.add_argument("action", choices=["get", "set", "header"])
+    parser.add_argument("parameter", nargs="?", choices=sorted(PARAMETERS))
+    parser.add_argument("index", nargs="?", type=int, default=0,
+                        help="key for threshold and hysteresis, 0 otherwise")
+    parser.add_argument("value", nargs="?", type=int)
+    args = parser.parse_args()
+
+    if args.action == "header":
+        payload = [OPCODE_HEADER, 0, 0]
+    elif args.parameter is None or (args.action == "set" and args.value is None):
+        parser.error("parameter, index and value required")
+    elif args.action == "get":
+        payload = [OPCODE_READ, PARAMETERS[args.parameter], args.index]
+    else:
+        payload = [OPCODE_WRITE, PARAMETERS[args.parameter], args.index,
+                   args.value & 0xFF, args.value >> 8 & 0xFF]
+
+    import serial
+
+    with serial.Serial(args.port, args.baud, timeout=0.05) as link:
+        response = transact(link, payload)
+
+    status = response[0]
+    if status != 0:
+        print(STATUS[status] if status < len(STATUS) else "status %d" % status,
+              file=sys.stderr)
+        return 1
+    if args.action != "header":
+        print(response[4] | response[5] << 8)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
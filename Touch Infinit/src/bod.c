@@ -40,6 +40,11 @@
 /**
  * \brief Initialize Brownout Detector
  *
+ * The BOD level and its operation in active and sleep modes are set by the
+ * BODCFG fuse. The voltage level monitor only works while the BOD is enabled
+ * in active mode, and is set to raise BOD_VLM_vect both when VDD falls below
+ * BOD_VLM_LEVEL and when it rises above it again.
+ *
  * \return Initialization status.
  */
 int8_t BOD_init()
@@ -47,10 +52,20 @@ int8_t BOD_init()
 
 	// ccp_write_io((void*)&(BOD.CTRLA),BOD_SLEEP_DIS_gc /* Disabled */);
 
-	// BOD.INTCTRL = 0 << BOD_VLMIE_bp /* voltage level monitor interrrupt enable: disabled */
-	//		 | BOD_VLMCFG_BELOW_gc; /* Interrupt when supply goes below VLM level */
+	BOD.VLMCTRLA = BOD_VLM_LEVEL;
 
-	// BOD.VLMCTRLA = BOD_VLMLVL_5ABOVE_gc; /* VLM threshold 5% above BOD level */
+	BOD.INTCTRL = 1 << BOD_VLMIE_bp /* voltage level monitor interrrupt enable: enabled */
+	              | BOD_VLMCFG_CROSS_gc; /* Interrupt when supply crosses VLM level */
 
 	return 0;
 }
+
+/**
+ * \brief Check whether VDD is below the voltage level monitor threshold
+ *
+ * \return true while VDD is below BOD_VLM_LEVEL
+ */
+bool BOD_is_supply_low(void)
+{
+	return (BOD.STATUS & BOD_VLMS_bm) != 0;
+}
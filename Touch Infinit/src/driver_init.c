@@ -199,6 +199,18 @@ void system_init()
 
 	LED_TOUCH1_set_dir(PORT_DIR_OUT);
 
+	/* PORT setting on PC3 */
+
+	// Set pin direction to input
+	ZERO_CROSS_set_dir(PORT_DIR_IN);
+
+	ZERO_CROSS_set_pull_mode(
+	    // <y> Pull configuration
+	    // <id> pad_pull_config
+	    // <PORT_PULL_OFF"> Off
+	    // <PORT_PULL_UP"> Pull-up
+	    PORT_PULL_OFF);
+
 	CLKCTRL_init();
 
 	Timer_init();
@@ -0,0 +1,298 @@
+/**
+ * \file
+ *
+ * \brief TCA0 based LED PWM with gamma corrected fades.
+ *
+ * The LEDs on PC0 to PC2 have no timer waveform output on this device, so
+ * TCA0 times the PWM and its interrupts switch the pins:
+ *
+ * - TCA0 counts CLK_PER / 64 up to LED_PWM_PERIOD - 1. The overflow
+ *   interrupt turns on the LEDs that are not off, the compare interrupt of
+ *   channel n turns LED n off again. A fully on or off LED has a compare
+ *   value beyond the period and no compare interrupt.
+ * - Brightness levels are mapped to compare values by a gamma table in flash,
+ *   so a fade looks even to the eye.
+ * - The overflow interrupt also steps the fades, in 1/256 levels, and loads
+ *   the compare values of the next period into the compare buffer
+ *   registers, which the timer takes over at the next overflow without a
+ *   glitch.
+ *
+ * TCA0 only runs while a fade is in progress or an LED is between off and
+ * fully on. Otherwise the pins are left at a steady level and the device can
+ * go to standby, where CLK_PER and so TCA0 stop.
+ */
+
+/**
+ * \defgroup doc_driver_system_led_pwm LED PWM
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <led_pwm.h>
+#include <atmel_start.h>
+#include <atomic.h>
+
+#if LED_PWM_ENABLE == 1
+
+/* Interrupts of the compare channels in use */
+#define LED_PWM_CMP_bm ((uint8_t)(((1u << LED_PWM_COUNT) - 1u) << 4))
+
+/* TCA0 clock periods per PWM period, 1/1000 s */
+#define LED_PWM_PERIODS(ms) (((uint32_t)(ms) * (F_CPU / 1000u)) / (64u * LED_PWM_PERIOD))
+
+#if LED_PWM_COUNT > 3u
+#error "LED_PWM_COUNT must be 3 or less, TCA0 has three compare channels"
+#endif
+
+/* Compare value per level, gamma 2.2. In flash, which is mapped into the data
+ * space on this device. */
+static const uint16_t led_pwm_gamma[LED_PWM_MAX_LEVEL + 1u] = {
+    0,   1,   2,   3,   4,   5,   6,   8,   11,  14,  18,  22,  27,  32,  37,  44,
+    50,  57,  65,  73,  82,  91,  101, 112, 123, 134, 146, 159, 172, 186, 200, 215,
+    231, 247, 264, 281, 299, 318, 337, 357, 377, 398, 420, 442, 465, 488, 513, 537,
+    563, 589, 616, 643, 671, 700, 729, 760, 790, 822, 854, 886, 920, 954, 989, 1024,
+};
+
+static led_pwm_output_cb_t led_pwm_output;
+
+/* Current level and fade step per PWM period, in 1/256 levels, target level
+ * and the compare value in effect for the current period */
+static volatile uint16_t led_pwm_level[LED_PWM_COUNT];
+static volatile uint16_t led_pwm_step[LED_PWM_COUNT];
+static volatile uint8_t  led_pwm_target[LED_PWM_COUNT];
+static volatile uint16_t led_pwm_duty[LED_PWM_COUNT];
+
+static volatile bool led_pwm_running;
+
+/**
+ * \brief Compare buffer register of an LED
+ */
+static inline register16_t *led_pwm_cmpbuf(uint8_t led)
+{
+	return &(&TCA0.SINGLE.CMP0BUF)[led];
+}
+
+/**
+ * \brief Compare value for a duty
+ *
+ * An LED that is off is not turned on at the overflow, so its channel is set
+ * beyond the period like a fully on one, which saves its compare interrupt.
+ */
+static inline uint16_t led_pwm_compare_value(uint16_t duty)
+{
+	return (duty != 0u) ? duty : LED_PWM_PERIOD;
+}
+
+/**
+ * \brief Move the level of an LED one PWM period on towards its target
+ *
+ * \return true while the LED is fading
+ */
+static bool led_pwm_step_level(uint8_t led)
+{
+	uint16_t level  = led_pwm_level[led];
+	uint16_t target = (uint16_t)led_pwm_target[led] << 8;
+	uint16_t step   = led_pwm_step[led];
+
+	if (level == target) {
+		return false;
+	}
+
+	if (level < target) {
+		level = (target - level > step) ? level + step : target;
+	} else {
+		level = (level - target > step) ? level - step : target;
+	}
+	led_pwm_level[led] = level;
+	return true;
+}
+
+/**
+ * \brief Start TCA0 with the current levels
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void led_pwm_start(void)
+{
+	uint8_t  led;
+	uint16_t duty;
+
+	for (led = 0; led < LED_PWM_COUNT; led++) {
+		duty                     = led_pwm_gamma[led_pwm_level[led] >> 8];
+		led_pwm_duty[led]        = duty;
+		(&TCA0.SINGLE.CMP0)[led] = led_pwm_compare_value(duty);
+		*led_pwm_cmpbuf(led)     = led_pwm_compare_value(duty);
+		led_pwm_output(led, duty != 0u);
+	}
+
+	TCA0.SINGLE.CNT      = 0;
+	TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm | LED_PWM_CMP_bm;
+	TCA0.SINGLE.INTCTRL  = TCA_SINGLE_OVF_bm | LED_PWM_CMP_bm;
+	TCA0.SINGLE.CTRLA    = TCA_SINGLE_CLKSEL_DIV64_gc | TCA_SINGLE_ENABLE_bm;
+	led_pwm_running      = true;
+}
+
+/**
+ * \brief Stop TCA0 and leave the LEDs at a steady level
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void led_pwm_stop(void)
+{
+	uint8_t led;
+
+	TCA0.SINGLE.CTRLA   = 0;
+	TCA0.SINGLE.INTCTRL = 0;
+	led_pwm_running     = false;
+
+	for (led = 0; led < LED_PWM_COUNT; led++) {
+		led_pwm_output(led, led_pwm_duty[led] != 0u);
+	}
+}
+
+/**
+ * \brief Initialise the LED PWM
+ *
+ * All LEDs are switched off, system_init() leaves the active low LED pins
+ * driven low.
+ *
+ * \param[in] output Function driving the LED outputs
+ */
+void led_pwm_init(led_pwm_output_cb_t output)
+{
+	uint8_t led;
+
+	led_pwm_output = output;
+	for (led = 0; led < LED_PWM_COUNT; led++) {
+		led_pwm_output(led, false);
+	}
+
+	TCA0.SINGLE.CTRLA = 0;
+	TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_NORMAL_gc;
+	TCA0.SINGLE.PER   = LED_PWM_PERIOD - 1u;
+}
+
+/**
+ * \brief Fade an LED to a brightness level
+ *
+ * A fade to the level the LED is already heading to carries on unchanged,
+ * so the function can be called with the same level on every update.
+ *
+ * \param[in] led     LED number, 0 to LED_PWM_COUNT - 1
+ * \param[in] level   Brightness, 0 to LED_PWM_MAX_LEVEL
+ * \param[in] time_ms Duration of the fade over the whole range, 0 to switch
+ *                    at once
+ */
+void led_pwm_fade(uint8_t led, uint8_t level, uint16_t time_ms)
+{
+	uint32_t periods = LED_PWM_PERIODS(time_ms);
+	uint16_t step;
+	uint16_t duty;
+
+	if (level > LED_PWM_MAX_LEVEL) {
+		level = LED_PWM_MAX_LEVEL;
+	}
+	if (level == led_pwm_target[led]) {
+		return;
+	}
+
+	/* The same rate for any distance, a short fade takes less time */
+	step = (periods != 0u) ? (uint16_t)(((uint32_t)LED_PWM_MAX_LEVEL << 8) / periods) : UINT16_MAX;
+	if (step == 0u) {
+		step = 1u;
+	}
+
+	ENTER_CRITICAL(L);
+	led_pwm_target[led] = level;
+	led_pwm_step[led]   = step;
+
+	if (!led_pwm_running) {
+		/* A switch to fully on or off needs no PWM */
+		if ((step == UINT16_MAX) && ((level == 0u) || (level == LED_PWM_MAX_LEVEL))) {
+			led_pwm_level[led] = (uint16_t)level << 8;
+			duty               = led_pwm_gamma[level];
+			led_pwm_duty[led]  = duty;
+			led_pwm_output(led, duty != 0u);
+		} else {
+			led_pwm_start();
+		}
+	}
+	EXIT_CRITICAL(L);
+}
+
+/**
+ * \brief Get the current brightness of an LED
+ *
+ * \param[in] led LED number, 0 to LED_PWM_COUNT - 1
+ *
+ * \return Brightness, 0 to LED_PWM_MAX_LEVEL
+ */
+uint8_t led_pwm_get(uint8_t led)
+{
+	uint16_t level;
+
+	ENTER_CRITICAL(L);
+	level = led_pwm_level[led];
+	EXIT_CRITICAL(L);
+
+	return (uint8_t)(level >> 8);
+}
+
+/**
+ * \brief Report whether TCA0 is running, which needs CLK_PER
+ *
+ * \return true while an LED fades or is dimmed
+ */
+bool led_pwm_is_running(void)
+{
+	return led_pwm_running;
+}
+
+/**
+ * \brief Start of a PWM period, called from the TCA0 overflow interrupt
+ *
+ * Turns on the LEDs that are not off, steps the fades and loads the compare
+ * values of the next period. Stops TCA0 once no LED needs it.
+ */
+void led_pwm_overflow_isr(void)
+{
+	uint8_t  led;
+	uint16_t duty;
+	bool     needed = false;
+
+	for (led = 0; led < LED_PWM_COUNT; led++) {
+		if (led_pwm_duty[led] != 0u) {
+			led_pwm_output(led, true);
+		}
+	}
+
+	for (led = 0; led < LED_PWM_COUNT; led++) {
+		if (led_pwm_step_level(led)) {
+			needed = true;
+		}
+		duty = led_pwm_gamma[led_pwm_level[led] >> 8];
+		if ((duty != 0u) && (duty < LED_PWM_PERIOD)) {
+			needed = true;
+		}
+		led_pwm_duty[led]    = duty;
+		*led_pwm_cmpbuf(led) = led_pwm_compare_value(duty);
+	}
+
+	if (!needed) {
+		led_pwm_stop();
+	}
+}
+
+/**
+ * \brief End of the on time of an LED, called from the TCA0 compare interrupt
+ *
+ * \param[in] led LED number, the compare channel
+ */
+void led_pwm_compare_isr(uint8_t led)
+{
+	led_pwm_output(led, false);
+}
+
+#endif
+
+/** @} */
@@ -0,0 +1,463 @@
+/**
+ * \file
+ *
+ * \brief Relay module bus on the BUTTON_MOD and RELAY_MOD lines.
+ *
+ * Each relay module is connected by a pair of lines that idle low: the
+ * BUTTON_MOD output carries commands to the module and the RELAY_MOD input
+ * its acknowledgements. Information is in the width of high pulses, in units
+ * of MODULE_BUS_UNIT_US:
+ *
+ * - A command is a pulse of MODULE_BUS_OFF_UNITS, MODULE_BUS_ON_UNITS or
+ *   MODULE_BUS_QUERY_UNITS. The module answers within MODULE_BUS_ACK_DELAY
+ *   units of its end with a pulse of MODULE_BUS_OFF_UNITS or
+ *   MODULE_BUS_ON_UNITS for the state of its relay contacts, so a command
+ *   takes 16 units, 800 us, at most.
+ * - TCB0 times the phases of a transaction in periodic interrupt mode at
+ *   CLK_PER / 2. It is restarted at each phase with the longest time the
+ *   phase may take, its interrupt ends the command pulse or times out the
+ *   acknowledgement. The edges of the acknowledgement are timed by the pin
+ *   interrupt of the RELAY_MOD line, which is only enabled while waiting.
+ * - A command that is not acknowledged, or is answered with a pulse of no
+ *   valid width, is sent again after MODULE_BUS_GAP_UNITS, up to
+ *   MODULE_BUS_RETRIES times. The module is then taken to be absent until it
+ *   answers again.
+ * - The relay contacts move after the acknowledgement of a switching
+ *   command, so the state is read back MODULE_BUS_SETTLE_MS later and
+ *   counted as a mismatch if it differs from the request.
+ *
+ * One transaction runs at a time. Requests are kept as module masks like in
+ * the relay scheduler, switching commands before queries and the lowest
+ * module first. TCB0 needs CLK_PER, the device only goes to idle while a
+ * transaction runs.
+ */
+
+/**
+ * \defgroup doc_driver_system_module_bus Module Bus
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <module_bus.h>
+#include <atmel_start.h>
+#include <timer_queue.h>
+#include <atomic.h>
+
+#if MODULE_BUS_ENABLE == 1
+
+#if MODULE_BUS_MODULES > 3u
+#error "MODULE_BUS_MODULES must be 3 or less, there are three pairs of lines"
+#endif
+
+#if (MODULE_BUS_MODULES > 1u) && (DEF_TOUCH_DATA_STREAMER_ENABLE == 1u)
+#error "MODULE_BUS_MODULES must be 1 with DEF_TOUCH_DATA_STREAMER_ENABLE, RELAY_MOD2 is USART0 TxD"
+#endif
+
+/* TCB0 counts per unit and per us */
+#define MODULE_BUS_TICKS_PER_US ((uint16_t)(F_CPU / 2000000ul))
+#define MODULE_BUS_TICKS(units) ((uint16_t)((units)*MODULE_BUS_UNIT_US * MODULE_BUS_TICKS_PER_US))
+
+/* Longest acknowledgement pulse and wait for it, one unit of tolerance */
+#define MODULE_BUS_ACK_MAX_UNITS (MODULE_BUS_ON_UNITS + 2u)
+#define MODULE_BUS_ACK_WAIT_UNITS (MODULE_BUS_ACK_DELAY + 1u)
+
+/* Phases of a transaction */
+enum module_bus_phase {
+	MODULE_BUS_IDLE,     /* No transaction */
+	MODULE_BUS_COMMAND,  /* Command pulse high */
+	MODULE_BUS_ACK_WAIT, /* Waiting for the acknowledgement */
+	MODULE_BUS_ACK,      /* Acknowledgement pulse high */
+	MODULE_BUS_GAP,      /* Line idle before the command is sent again */
+};
+
+/* Command pulse widths */
+static const uint8_t module_bus_units[] = {MODULE_BUS_OFF_UNITS, MODULE_BUS_ON_UNITS, MODULE_BUS_QUERY_UNITS};
+
+/* Transaction in progress: phase, module, command, retries so far and TCB0
+ * counts since the start of the first command pulse */
+static volatile uint8_t module_bus_phase;
+static uint8_t          module_bus_module;
+static uint8_t          module_bus_command;
+static uint8_t          module_bus_tries;
+static uint16_t         module_bus_elapsed;
+
+/* Requested relay states, switching commands and queries to send, modules
+ * to read back once settled and whose next query checks the request */
+static volatile uint8_t module_bus_target;
+static volatile uint8_t module_bus_send;
+static volatile uint8_t module_bus_poll;
+static volatile uint8_t module_bus_settling;
+static volatile uint8_t module_bus_verify;
+
+/* Relay states reported and modules that answered their last command */
+static volatile uint8_t module_bus_state;
+static volatile uint8_t module_bus_present;
+
+static struct timer_struct     module_bus_settle_timer;
+static struct module_bus_stats module_bus_stats_data;
+
+/**
+ * \brief Drive the command line of a module
+ */
+static void module_bus_drive(uint8_t module, bool level)
+{
+	switch (module) {
+	case 0:
+		BUTTON_MOD1_set_level(level);
+		break;
+	case 1:
+		BUTTON_MOD2_set_level(level);
+		break;
+	default:
+		BUTTON_MOD3_set_level(level);
+		break;
+	}
+}
+
+/**
+ * \brief Read the acknowledgement line of a module
+ */
+static bool module_bus_sense(uint8_t module)
+{
+	switch (module) {
+	case 0:
+		return RELAY_MOD1_get_level();
+	case 1:
+		return RELAY_MOD2_get_level();
+	default:
+		return RELAY_MOD3_get_level();
+	}
+}
+
+/**
+ * \brief Enable or disable the pin interrupt of the acknowledgement line
+ *
+ * A flag left from a disabled interrupt is cleared.
+ */
+static void module_bus_listen(uint8_t module, bool on)
+{
+	PORT_ISC_t isc = on ? PORT_ISC_BOTHEDGES_gc : PORT_ISC_INTDISABLE_gc;
+
+	switch (module) {
+	case 0:
+		RELAY_MOD1_set_isc(isc);
+		PORTA.INTFLAGS = PIN7_bm;
+		break;
+	case 1:
+		RELAY_MOD2_set_isc(isc);
+		PORTB.INTFLAGS = PIN2_bm;
+		break;
+	default:
+		RELAY_MOD3_set_isc(isc);
+		PORTB.INTFLAGS = PIN4_bm;
+		break;
+	}
+}
+
+/**
+ * \brief Restart TCB0 to interrupt after a number of counts
+ */
+static void module_bus_timer_start(uint16_t ticks)
+{
+	TCB0.CTRLA    = 0;
+	TCB0.CNT      = 0;
+	TCB0.CCMP     = ticks;
+	TCB0.INTFLAGS = TCB_CAPT_bm;
+	TCB0.CTRLA    = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+}
+
+/**
+ * \brief Send the command pulse of the current transaction
+ */
+static void module_bus_transmit(void)
+{
+	module_bus_drive(module_bus_module, true);
+	module_bus_phase = MODULE_BUS_COMMAND;
+	module_bus_timer_start(MODULE_BUS_TICKS(module_bus_units[module_bus_command]));
+}
+
+/**
+ * \brief Start the next transaction if the bus is free
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void module_bus_next(void)
+{
+	uint8_t pending;
+	uint8_t module;
+	uint8_t mask;
+
+	if (module_bus_phase != MODULE_BUS_IDLE) {
+		return;
+	}
+
+	pending = module_bus_send ? module_bus_send : module_bus_poll;
+	if (pending == 0u) {
+		return;
+	}
+
+	for (module = 0; !(pending & (1u << module)); module++)
+		;
+	mask = (uint8_t)(1u << module);
+
+	if (module_bus_send & mask) {
+		module_bus_command = (module_bus_target & mask) ? MODULE_BUS_ON : MODULE_BUS_OFF;
+		module_bus_send &= (uint8_t)~mask;
+	} else {
+		module_bus_command = MODULE_BUS_QUERY;
+		module_bus_poll &= (uint8_t)~mask;
+	}
+
+	module_bus_module  = module;
+	module_bus_tries   = 0;
+	module_bus_elapsed = 0;
+	module_bus_stats_data.commands++;
+	module_bus_transmit();
+}
+
+/**
+ * \brief End the current transaction and start the next one
+ */
+static void module_bus_finish(void)
+{
+	TCB0.CTRLA       = 0;
+	module_bus_phase = MODULE_BUS_IDLE;
+	module_bus_next();
+}
+
+/**
+ * \brief Send the command again after a gap, or give up on the module
+ */
+static void module_bus_retry(void)
+{
+	uint8_t mask = (uint8_t)(1u << module_bus_module);
+
+	module_bus_listen(module_bus_module, false);
+
+	if (module_bus_tries < MODULE_BUS_RETRIES) {
+		module_bus_tries++;
+		module_bus_stats_data.retries++;
+		module_bus_phase = MODULE_BUS_GAP;
+		module_bus_timer_start(MODULE_BUS_TICKS(MODULE_BUS_GAP_UNITS));
+		return;
+	}
+
+	module_bus_stats_data.failures++;
+	module_bus_present &= (uint8_t)~mask;
+	module_bus_verify &= (uint8_t)~mask;
+	module_bus_finish();
+}
+
+/**
+ * \brief Take the relay state from a valid acknowledgement
+ */
+static void module_bus_acknowledged(bool on)
+{
+	uint8_t  mask    = (uint8_t)(1u << module_bus_module);
+	uint16_t latency = module_bus_elapsed / MODULE_BUS_TICKS_PER_US;
+
+	module_bus_stats_data.acks++;
+	if (latency > module_bus_stats_data.max_latency) {
+		module_bus_stats_data.max_latency = latency;
+	}
+
+	module_bus_present |= mask;
+	if (on) {
+		module_bus_state |= mask;
+	} else {
+		module_bus_state &= (uint8_t)~mask;
+	}
+
+	if (module_bus_command != MODULE_BUS_QUERY) {
+		/* Read the contacts back once they have moved */
+		module_bus_settling |= mask;
+		timer_start(&module_bus_settle_timer, TIMER_MS_TO_TICKS(MODULE_BUS_SETTLE_MS), 0);
+	} else if (module_bus_verify & mask) {
+		module_bus_verify &= (uint8_t)~mask;
+		/* A newer request is still to be sent and checked by itself */
+		if (!(module_bus_send & mask) && (on != ((module_bus_target & mask) != 0u))) {
+			module_bus_stats_data.mismatches++;
+		}
+	}
+
+	module_bus_finish();
+}
+
+/**
+ * \brief Settle timer, queries the modules switched
+ */
+static void module_bus_settle_handler(void)
+{
+	module_bus_poll |= module_bus_settling;
+	module_bus_verify |= module_bus_settling;
+	module_bus_settling = 0;
+	module_bus_next();
+}
+
+/**
+ * \brief Initialise the module bus
+ *
+ * The command lines are left low, as set by system_init(). All modules are
+ * taken to be absent and off until they answer.
+ */
+void module_bus_init(void)
+{
+	uint8_t module;
+
+	module_bus_settle_timer.callback = module_bus_settle_handler;
+
+	TCB0.CTRLA   = 0;
+	TCB0.CTRLB   = TCB_CNTMODE_INT_gc;
+	TCB0.INTCTRL = TCB_CAPT_bm;
+
+	for (module = 0; module < MODULE_BUS_MODULES; module++) {
+		module_bus_drive(module, false);
+		module_bus_listen(module, false);
+	}
+	module_bus_phase = MODULE_BUS_IDLE;
+}
+
+/**
+ * \brief Request the relay state of a module
+ *
+ * The command is sent even if the state was requested before, so the module
+ * follows a request made while it was absent.
+ *
+ * \param[in] module Module number, 0 to MODULE_BUS_MODULES - 1
+ * \param[in] on     Relay on
+ */
+void module_bus_set(uint8_t module, bool on)
+{
+	uint8_t mask = (uint8_t)(1u << module);
+
+	ENTER_CRITICAL(M);
+	if (on) {
+		module_bus_target |= mask;
+	} else {
+		module_bus_target &= (uint8_t)~mask;
+	}
+	module_bus_send |= mask;
+	module_bus_next();
+	EXIT_CRITICAL(M);
+}
+
+/**
+ * \brief Read the relay state of a module back
+ *
+ * \param[in] module Module number, 0 to MODULE_BUS_MODULES - 1
+ */
+void module_bus_query(uint8_t module)
+{
+	ENTER_CRITICAL(M);
+	module_bus_poll |= (uint8_t)(1u << module);
+	module_bus_next();
+	EXIT_CRITICAL(M);
+}
+
+/**
+ * \brief Get the relay state a module last reported
+ *
+ * \param[in] module Module number, 0 to MODULE_BUS_MODULES - 1
+ *
+ * \return true if the relay contacts were closed
+ */
+bool module_bus_get(uint8_t module)
+{
+	return (module_bus_state & (1u << module)) != 0u;
+}
+
+/**
+ * \brief Report whether a module answered its last command
+ *
+ * \param[in] module Module number, 0 to MODULE_BUS_MODULES - 1
+ */
+bool module_bus_is_present(uint8_t module)
+{
+	return (module_bus_present & (1u << module)) != 0u;
+}
+
+/**
+ * \brief Report whether a transaction runs, which needs CLK_PER
+ */
+bool module_bus_is_busy(void)
+{
+	return module_bus_phase != MODULE_BUS_IDLE;
+}
+
+/**
+ * \brief Get the module bus statistics
+ *
+ * \param[out] stats Copy of the statistics
+ */
+void module_bus_get_stats(struct module_bus_stats *stats)
+{
+	ENTER_CRITICAL(M);
+	*stats = module_bus_stats_data;
+	EXIT_CRITICAL(M);
+}
+
+/**
+ * \brief End of a phase, called from the TCB0 interrupt
+ *
+ * Ends the command pulse and waits for the acknowledgement, sends the
+ * command again after a gap, or times out the acknowledgement.
+ */
+void module_bus_timer_isr(void)
+{
+	module_bus_elapsed += TCB0.CCMP;
+
+	switch (module_bus_phase) {
+	case MODULE_BUS_COMMAND:
+		module_bus_drive(module_bus_module, false);
+		module_bus_listen(module_bus_module, true);
+		module_bus_phase = MODULE_BUS_ACK_WAIT;
+		module_bus_timer_start(MODULE_BUS_TICKS(MODULE_BUS_ACK_WAIT_UNITS));
+		break;
+	case MODULE_BUS_GAP:
+		module_bus_transmit();
+		break;
+	case MODULE_BUS_ACK_WAIT:
+	case MODULE_BUS_ACK:
+		/* No acknowledgement, or a line stuck high */
+		module_bus_retry();
+		break;
+	default:
+		TCB0.CTRLA = 0;
+		break;
+	}
+}
+
+/**
+ * \brief Edge on the acknowledgement line of a module, called from the pin
+ *        interrupt
+ *
+ * \param[in] module Module number, 0 to MODULE_BUS_MODULES - 1
+ */
+void module_bus_line_isr(uint8_t module)
+{
+	uint16_t count = TCB0.CNT;
+	bool     high  = module_bus_sense(module);
+
+	if (module != module_bus_module) {
+		return;
+	}
+
+	if ((module_bus_phase == MODULE_BUS_ACK_WAIT) && high) {
+		module_bus_elapsed += count;
+		module_bus_phase = MODULE_BUS_ACK;
+		module_bus_timer_start(MODULE_BUS_TICKS(MODULE_BUS_ACK_MAX_UNITS));
+	} else if ((module_bus_phase == MODULE_BUS_ACK) && !high) {
+		module_bus_elapsed += count;
+		module_bus_listen(module, false);
+		if (count < MODULE_BUS_TICKS(1u)) {
+			/* A glitch, not an acknowledgement */
+			module_bus_retry();
+		} else {
+			module_bus_acknowledged(count >= MODULE_BUS_TICKS(MODULE_BUS_OFF_UNITS + 1u));
+		}
+	}
+}
+
+#endif
+
+/** @} */
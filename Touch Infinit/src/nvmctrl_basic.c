@@ -0,0 +1,189 @@
+/**
+ * \file
+ *
+ * \brief NVMCTRL basic driver.
+ *
+ (c) 2020 Microchip Technology Inc. and its subsidiaries.
+
+    Subject to your compliance with these terms,you may use this software and
+    any derivatives exclusively with Microchip products.It is your responsibility
+    to comply with third party license terms applicable to your use of third party
+    software (including open source software) that may accompany Microchip software.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ */
+
+/**
+ * \defgroup doc_driver_nvmctrl_basic NVMCTRL Basic
+ * \ingroup doc_driver_nvmctrl
+ *
+ * \section doc_driver_nvmctrl_basic_rev Revision History
+ * - v0.0.0.1 Initial Commit
+ *
+ * The EEPROM is mapped into the data space and read like RAM. A store to the
+ * mapped EEPROM loads the page buffer, the page erase/write command then
+ * programs the loaded bytes of that page only. Programming takes a few ms and
+ * runs in the background, FLASH_write_eeprom_page() does not wait for it.
+ *
+ * The user row is a single page written the same way. It is kept over a chip
+ * erase and can be read through UPDI even when the application does not run.
+ *
+ *@{
+ */
+#include <nvmctrl_basic.h>
+#include <ccp.h>
+
+/**
+ * \brief Load bytes of one page into the page buffer and write the page
+ *
+ * \param[in] dst  Data space address of the first byte
+ * \param[in] data Data to write
+ * \param[in] size Number of bytes, within one page
+ *
+ * \return NVM_OK if the write was started, NVM_BUSY if a previous write has not
+ *         completed yet
+ */
+static nvmctrl_status_t FLASH_write_page(volatile uint8_t *dst, const uint8_t *data, uint8_t size)
+{
+	if (!FLASH_is_eeprom_ready()) {
+		return NVM_BUSY;
+	}
+
+	/* Discard bytes loaded by an earlier, abandoned write */
+	ccp_write_spm((void *)&NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+
+	while (size--) {
+		*dst++ = *data++;
+	}
+
+	ccp_write_spm((void *)&NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+
+	return NVM_OK;
+}
+
+/**
+ * \brief Read one byte from the EEPROM
+ *
+ * \param[in] eeprom_adr Offset in the EEPROM
+ *
+ * \return The byte read
+ */
+uint8_t FLASH_read_eeprom_byte(eeprom_adr_t eeprom_adr)
+{
+	return *(const volatile uint8_t *)(MAPPED_EEPROM_START + eeprom_adr);
+}
+
+/**
+ * \brief Read a block from the EEPROM
+ *
+ * \param[in]  eeprom_adr Offset in the EEPROM
+ * \param[out] data       Buffer for the data read
+ * \param[in]  size       Number of bytes to read
+ */
+void FLASH_read_eeprom_block(eeprom_adr_t eeprom_adr, uint8_t *data, size_t size)
+{
+	const volatile uint8_t *src = (const volatile uint8_t *)(MAPPED_EEPROM_START + eeprom_adr);
+
+	while (size--) {
+		*data++ = *src++;
+	}
+}
+
+/**
+ * \brief Pointer to the mapped EEPROM, for reading in place
+ *
+ * \param[in] eeprom_adr Offset in the EEPROM
+ *
+ * \return Data space address of the EEPROM byte
+ */
+const uint8_t *FLASH_eeprom_map(eeprom_adr_t eeprom_adr)
+{
+	return (const uint8_t *)(MAPPED_EEPROM_START + eeprom_adr);
+}
+
+/**
+ * \brief Start writing data within one EEPROM page
+ *
+ * The bytes are loaded into the page buffer and the page erase/write command
+ * is issued. The function returns without waiting for the write to complete,
+ * FLASH_is_eeprom_ready() reports when it has. The EEPROM must not be read
+ * until then, a read stalls the CPU while the EEPROM is busy.
+ *
+ * \param[in] eeprom_adr Offset in the EEPROM of the first byte
+ * \param[in] data       Data to write
+ * \param[in] size       Number of bytes, the block must not cross a page
+ *
+ * \return NVM_OK if the write was started, NVM_BUSY if a previous write has not
+ *         completed yet, NVM_ERROR if the block does not fit in one page
+ */
+nvmctrl_status_t FLASH_write_eeprom_page(eeprom_adr_t eeprom_adr, const uint8_t *data, uint8_t size)
+{
+	if ((size == 0) || ((uint16_t)eeprom_adr + size > EEPROM_SIZE)
+	    || ((eeprom_adr / EEPROM_PAGE_SIZE) != ((eeprom_adr + size - 1) / EEPROM_PAGE_SIZE))) {
+		return NVM_ERROR;
+	}
+
+	return FLASH_write_page((volatile uint8_t *)(MAPPED_EEPROM_START + eeprom_adr), data, size);
+}
+
+/**
+ * \brief Read a block from the user row
+ *
+ * \param[in]  offset Offset in the user row
+ * \param[out] data   Buffer for the data read
+ * \param[in]  size   Number of bytes to read
+ */
+void FLASH_read_userrow_block(uint8_t offset, uint8_t *data, size_t size)
+{
+	const volatile uint8_t *src = (const volatile uint8_t *)(USER_SIGNATURES_START + offset);
+
+	while (size--) {
+		*data++ = *src++;
+	}
+}
+
+/**
+ * \brief Start writing data to the user row
+ *
+ * Like FLASH_write_eeprom_page(), the function returns without waiting for the
+ * write to complete and FLASH_is_eeprom_ready() reports when it has.
+ *
+ * \param[in] offset Offset in the user row of the first byte
+ * \param[in] data   Data to write
+ * \param[in] size   Number of bytes
+ *
+ * \return NVM_OK if the write was started, NVM_BUSY if a previous write has not
+ *         completed yet, NVM_ERROR if the block does not fit in the user row
+ */
+nvmctrl_status_t FLASH_write_userrow(uint8_t offset, const uint8_t *data, uint8_t size)
+{
+	if ((size == 0) || ((uint16_t)offset + size > USER_SIGNATURES_SIZE)) {
+		return NVM_ERROR;
+	}
+
+	return FLASH_write_page((volatile uint8_t *)(USER_SIGNATURES_START + offset), data, size);
+}
+
+/**
+ * \brief Check if the EEPROM can be read and written
+ *
+ * \return true when no EEPROM write is in progress
+ */
+bool FLASH_is_eeprom_ready(void)
+{
+	return !(NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+}
+
+/** @} */
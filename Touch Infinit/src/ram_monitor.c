@@ -0,0 +1,122 @@
+/**
+ * \file
+ *
+ * \brief RAM usage and stack high-water mark.
+ *
+ * The 512 bytes of SRAM hold the static data of the firmware and, above it,
+ * the stack, which grows down from RAMEND towards the static data. Nothing
+ * stops it from running into the static data, so the margin left is tracked
+ * on the device:
+ *
+ * - ram_monitor_init() paints the RAM between the end of the static data and
+ *   the stack pointer with RAM_MONITOR_PAINT. It is called first thing in
+ *   atmel_start_init(), with interrupts still disabled, so only main() has
+ *   used stack by then.
+ * - ram_monitor_process() scans the painted RAM from the bottom up for the
+ *   first byte that was written every RAM_MONITOR_PERIOD_MS. Only the bytes
+ *   below the mark found by the scan before are read, as many as the stack
+ *   has free, which takes some 50 us.
+ * - The static data size, the stack size and the fewest bytes the stack has
+ *   left free are read by the host over the datastreamer command protocol,
+ *   which scans again first. Without the command receiver nothing can read
+ *   them, and the monitor is not built, see RAM_MONITOR_ENABLE.
+ *
+ * A local that leaves bytes unwritten in its frame, such as a frame buffer,
+ * does not hide the deeper frames, since the scan starts from the bottom.
+ * An interrupt nested deeper than any seen before shows at the next scan.
+ */
+
+/**
+ * \defgroup doc_driver_system_ram_monitor RAM Monitor
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <ram_monitor.h>
+#include <timer_queue.h>
+
+#if RAM_MONITOR_ENABLE == 1
+
+/* Time between two scans */
+#define RAM_MONITOR_PERIOD_TICKS TIMER_MS_TO_TICKS(RAM_MONITOR_PERIOD_MS)
+
+/* Start of the static data and of the free RAM above it, from the linker
+ * script */
+extern uint8_t __data_start;
+extern uint8_t __heap_start;
+
+/* Lowest byte of the stack written so far */
+static uint8_t *ram_monitor_mark;
+
+/* Time of the last scan, in timer ticks */
+static uint16_t ram_monitor_scanned;
+
+/**
+ * \brief Paint the free RAM below the stack
+ *
+ * Call with interrupts disabled. The frame of this function is above the stack
+ * pointer, all RAM below it is free.
+ */
+void ram_monitor_init(void)
+{
+	uint8_t *p   = &__heap_start;
+	uint8_t *top = (uint8_t *)SP;
+
+	/* SP points at the next byte to push */
+	while (p <= top) {
+		*p++ = RAM_MONITOR_PAINT;
+	}
+
+	ram_monitor_mark    = p;
+	ram_monitor_scanned = 0;
+}
+
+/**
+ * \brief Scan for the stack high-water mark every RAM_MONITOR_PERIOD_MS
+ *
+ * Called from the main loop.
+ */
+void ram_monitor_process(void)
+{
+	uint16_t now = timer_now();
+
+	if ((uint16_t)(now - ram_monitor_scanned) < RAM_MONITOR_PERIOD_TICKS) {
+		return;
+	}
+	ram_monitor_scanned = now;
+
+	ram_monitor_scan();
+}
+
+/**
+ * \brief Scan for the stack high-water mark now
+ *
+ * The first byte that lost its paint, from the bottom, is the deepest the
+ * stack has reached.
+ */
+void ram_monitor_scan(void)
+{
+	uint8_t *p = &__heap_start;
+
+	while ((p < ram_monitor_mark) && (*p == RAM_MONITOR_PAINT)) {
+		p++;
+	}
+
+	ram_monitor_mark = p;
+}
+
+/**
+ * \brief Get the RAM usage as of the last scan
+ *
+ * \param[out] stats RAM usage
+ */
+void ram_monitor_get_stats(struct ram_monitor_stats *stats)
+{
+	stats->static_size = (uint16_t)(&__heap_start - &__data_start);
+	stats->stack_size  = RAMSIZE - stats->static_size;
+	stats->stack_free  = (uint16_t)(ram_monitor_mark - &__heap_start);
+}
+
+#endif
+
+/** @} */
@@ -0,0 +1,399 @@
+/**
+ * \file
+ *
+ * \brief Zero-cross synchronised relay switching.
+ *
+ * Relay transitions are timed so the contacts move at a zero-cross of the
+ * mains voltage, which reduces inrush current, contact wear and the noise
+ * coupled into the touch sensors:
+ *
+ * - The zero-cross detector on ZERO_CROSS (PC3) toggles at each zero-cross.
+ *   Both edges are timestamped with the RTC in the PORTC interrupt. Period
+ *   and phase are fitted to RELAY_LOCK_EDGES half periods in the mains
+ *   frequency range and then tracked by an alpha-beta filter, in 1/16 RTC
+ *   ticks, which averages out the 1/1024 s resolution of a single timestamp.
+ * - A request waits for the next zero-cross edge. The coil is then switched
+ *   at the operate or release time before a later zero-cross, at least
+ *   RELAY_MIN_LEAD16 after the edge, with a one-shot software timer.
+ *   Requests made while a transition is in flight wait for the next edge.
+ * - Touch acquisition is blanked from RELAY_SCHEDULER_BLANK_LEAD_US before
+ *   the coil is switched until the contacts have settled.
+ * - Without a stable zero-cross signal, e.g. on a DC supply, a request is
+ *   carried out after RELAY_SCHEDULER_SYNC_TIMEOUT_MS.
+ * - While held, e.g. when the supply sags, relays are not switched on, since
+ *   the coil current could take VDD below the BOD level. A pending make
+ *   transition is cancelled and the requests are carried out once released.
+ *   Relays are still switched off.
+ *
+ * The pin interrupt is only enabled while requests are outstanding, so the
+ * device is not woken a hundred times a second when no relay switches. This
+ * costs the lock time on the first edges of a request, about 90 ms at 50 Hz.
+ * The coil is switched at an RTC tick, so the contacts move within about
+ * half a tick of the zero-cross, or one and a half when another timer due
+ * the tick before pushes the compare out by the timer queue's minimum lead.
+ */
+
+/**
+ * \defgroup doc_driver_system_relay_scheduler Relay Scheduler
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <relay_scheduler.h>
+#include <timer_queue.h>
+#include <atmel_start_pins.h>
+#include <atomic.h>
+#include "touch_api_ptc.h"
+
+/* Convert us to 1/16 RTC ticks */
+#define RELAY_TICKS16(us) ((uint16_t)((((uint32_t)(us)) * (TIMER_TICKS_PER_SECOND * 16u) + 500000u) / 1000000u))
+
+/* Accepted half mains periods, 1/16 ticks, with one tick of timestamp jitter */
+#define RELAY_HALF_PERIOD_MIN (RELAY_TICKS16(500000u / RELAY_SCHEDULER_MAX_HZ) - 16u)
+#define RELAY_HALF_PERIOD_MAX (RELAY_TICKS16(500000u / RELAY_SCHEDULER_MIN_HZ) + 16u)
+
+/* Largest deviation of an edge from the predicted zero-cross, 1/16 ticks */
+#define RELAY_PHASE_TOLERANCE 48
+
+/* Half periods the phase and period are first fitted to */
+#define RELAY_LOCK_EDGES 8u
+
+/* Longer of the operate and release time */
+#if RELAY_SCHEDULER_OPERATE_US > RELAY_SCHEDULER_RELEASE_US
+#define RELAY_MOVE_MAX_US RELAY_SCHEDULER_OPERATE_US
+#else
+#define RELAY_MOVE_MAX_US RELAY_SCHEDULER_RELEASE_US
+#endif
+
+/* Shortest time from the zero-cross edge to switching the coil, 1/16 ticks:
+ * the blanking lead plus the lead the timer queue needs */
+#define RELAY_MIN_LEAD16 (RELAY_TICKS16(RELAY_SCHEDULER_BLANK_LEAD_US) + 32)
+
+static relay_output_cb_t relay_output;
+
+/* Requested relay states, states driven, and transitions in flight, bit n
+ * for relay n */
+static volatile uint16_t relay_target;
+static volatile uint16_t relay_state;
+static volatile uint16_t relay_due_on;
+static volatile uint16_t relay_due_off;
+
+/* Relays are not switched on while set */
+static volatile bool relay_held;
+
+/* Zero-cross tracking: last zero-cross and half mains period, in 1/16 ticks,
+ * and the number of edges seen, RELAY_LOCK_EDGES + 1 once tracking. While
+ * locking, the first edge and the sum of the times of the later ones since
+ * it. */
+static uint16_t         relay_zc_phase;
+static uint16_t         relay_half_period;
+static volatile uint8_t relay_lock;
+static uint16_t         relay_lock_start;
+static uint16_t         relay_lock_sum;
+
+static struct timer_struct relay_make_timer;
+static struct timer_struct relay_break_timer;
+static struct timer_struct relay_sync_timer;
+
+/**
+ * \brief Relays whose requested state differs from the state they are heading to
+ *
+ * \param[out] off Relays to switch off
+ *
+ * \return Relays to switch on
+ */
+static uint16_t relay_pending(uint16_t *off)
+{
+	uint16_t expected = (relay_state | relay_due_on) & (uint16_t)~relay_due_off;
+
+	*off = expected & (uint16_t)~relay_target;
+	return relay_held ? 0u : relay_target & (uint16_t)~expected;
+}
+
+/**
+ * \brief Start following the mains phase if a request is outstanding
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void relay_request(void)
+{
+	uint16_t off;
+
+	if (relay_pending(&off) | off) {
+		if ((PORTC.PIN3CTRL & PORT_ISC_gm) != PORT_ISC_BOTHEDGES_gc) {
+			relay_lock = 0;
+			ZERO_CROSS_set_isc(PORT_ISC_BOTHEDGES_gc);
+		}
+		timer_start(&relay_sync_timer, TIMER_MS_TO_TICKS(RELAY_SCHEDULER_SYNC_TIMEOUT_MS), 0);
+	}
+}
+
+/**
+ * \brief Drive the outputs of a set of relays
+ */
+static void relay_apply(uint16_t relays, bool on)
+{
+	uint8_t relay;
+
+	for (relay = 0; relay < RELAY_SCHEDULER_RELAYS; relay++) {
+		if (relays & (1u << relay)) {
+			relay_output(relay, on);
+		}
+	}
+
+	if (on) {
+		relay_state |= relays;
+	} else {
+		relay_state &= (uint16_t)~relays;
+	}
+}
+
+/**
+ * \brief Blank touch acquisition around switching a coil
+ *
+ * \param[in] fire   RTC count at which the coil is switched
+ * \param[in] move16 Operate or release time of the relay, 1/16 ticks
+ */
+static void relay_blank(uint16_t fire, uint16_t move16)
+{
+	touch_blank_acquisition(fire - RELAY_TICKS16(RELAY_SCHEDULER_BLANK_LEAD_US) / 16u,
+	                        fire + (move16 + RELAY_TICKS16(RELAY_SCHEDULER_BOUNCE_US) + 15u) / 16u);
+}
+
+/**
+ * \brief Turn the zero-cross interrupt off once nothing is left to switch
+ */
+static void relay_idle_check(void)
+{
+	uint16_t off;
+
+	if ((relay_pending(&off) | off) || timer_is_running(&relay_make_timer)
+	    || timer_is_running(&relay_break_timer)) {
+		return;
+	}
+
+	timer_stop(&relay_sync_timer);
+	ZERO_CROSS_set_isc(PORT_ISC_INTDISABLE_gc);
+	relay_lock = 0;
+}
+
+/**
+ * \brief Make transition timer, switches the coils of the relays turned on
+ */
+static void relay_make_handler(void)
+{
+	relay_apply(relay_due_on, true);
+	relay_due_on = 0;
+	relay_idle_check();
+}
+
+/**
+ * \brief Break transition timer, releases the coils of the relays turned off
+ */
+static void relay_break_handler(void)
+{
+	relay_apply(relay_due_off, false);
+	relay_due_off = 0;
+	relay_idle_check();
+}
+
+/**
+ * \brief Switch the outstanding requests at once, without the mains phase
+ */
+static void relay_sync_timeout_handler(void)
+{
+	uint16_t off;
+	uint16_t on = relay_pending(&off);
+
+	if ((on | off) == 0u) {
+		return;
+	}
+
+	relay_blank(timer_now(), RELAY_TICKS16(RELAY_MOVE_MAX_US));
+	relay_apply(on, true);
+	relay_apply(off, false);
+	relay_idle_check();
+}
+
+/**
+ * \brief Time one transition to the mains phase
+ *
+ * \param[in] timer  Transition timer to start
+ * \param[in] move16 Operate or release time of the relay, 1/16 ticks
+ */
+static void relay_start(struct timer_struct *timer, uint16_t move16)
+{
+	uint16_t now = timer_now();
+	int16_t  delay16;
+	uint16_t delay;
+
+	/* Switch the coil so the contacts move at the first zero-cross far enough
+	 * ahead. The timer expires at the start of a tick. */
+	delay16 = (int16_t)(relay_zc_phase + relay_half_period - (uint16_t)(now << 4)) - (int16_t)move16;
+	while (delay16 < (int16_t)RELAY_MIN_LEAD16) {
+		delay16 += (int16_t)relay_half_period;
+	}
+	delay = ((uint16_t)delay16 + 8u) >> 4;
+
+	timer_start(timer, delay, 0);
+	relay_blank(now + delay, move16);
+}
+
+/**
+ * \brief Initialise the relay scheduler
+ *
+ * All relays are taken to be off, as set by system_init().
+ *
+ * \param[in] output Function driving the relay outputs
+ */
+void relay_scheduler_init(relay_output_cb_t output)
+{
+	relay_output               = output;
+	relay_make_timer.callback  = relay_make_handler;
+	relay_break_timer.callback = relay_break_handler;
+	relay_sync_timer.callback  = relay_sync_timeout_handler;
+
+	ZERO_CROSS_set_isc(PORT_ISC_INTDISABLE_gc);
+}
+
+/**
+ * \brief Request a relay state
+ *
+ * The relay is switched at a later zero-cross of the mains, once the
+ * zero-cross input has been tracked for a few edges. A request that reverses
+ * one not carried out yet cancels it.
+ *
+ * \param[in] relay Relay number, below RELAY_SCHEDULER_RELAYS
+ * \param[in] on    Relay on
+ */
+void relay_scheduler_set(uint8_t relay, bool on)
+{
+	ENTER_CRITICAL(R);
+	if (on) {
+		relay_target |= (uint16_t)(1u << relay);
+	} else {
+		relay_target &= (uint16_t)~(1u << relay);
+	}
+
+	relay_request();
+	EXIT_CRITICAL(R);
+}
+
+/**
+ * \brief Hold back or release switching relays on
+ *
+ * May be called from interrupt context.
+ *
+ * \param[in] hold Defer switching relays on until called with false
+ */
+void relay_scheduler_hold(bool hold)
+{
+	ENTER_CRITICAL(R);
+	relay_held = hold;
+
+	if (hold) {
+		if (timer_is_running(&relay_make_timer)) {
+			timer_stop(&relay_make_timer);
+			relay_due_on = 0;
+		}
+		relay_idle_check();
+	} else {
+		relay_request();
+	}
+	EXIT_CRITICAL(R);
+}
+
+/**
+ * \brief Get the requested state of a relay
+ *
+ * \param[in] relay Relay number, below RELAY_SCHEDULER_RELAYS
+ *
+ * \return true if the relay is on or about to be switched on
+ */
+bool relay_scheduler_get(uint8_t relay)
+{
+	return (relay_target & (1u << relay)) != 0u;
+}
+
+/**
+ * \brief Report whether the mains phase is being tracked
+ *
+ * \return true while the zero-cross edges fit the mains frequency
+ */
+bool relay_scheduler_is_synchronised(void)
+{
+	return relay_lock > RELAY_LOCK_EDGES;
+}
+
+/**
+ * \brief Zero-cross edge, called from the PORTC interrupt
+ *
+ * Tracks the mains phase and times the outstanding requests.
+ */
+void relay_scheduler_zero_cross_isr(void)
+{
+	/* The edge came during the tick read, half a tick before on average */
+	uint16_t now16 = (uint16_t)(timer_now() << 4) + 8u;
+	uint16_t since = now16 - relay_zc_phase;
+	int16_t  error;
+	uint16_t off;
+
+	if (relay_lock <= RELAY_LOCK_EDGES) {
+		if ((relay_lock == 0u) || (since < RELAY_HALF_PERIOD_MIN) || (since > RELAY_HALF_PERIOD_MAX)) {
+			/* First edge, or not mains: start over */
+			relay_lock_start = now16;
+			relay_lock_sum   = 0;
+			relay_zc_phase   = now16;
+			relay_lock       = 1;
+			return;
+		}
+		relay_zc_phase = now16;
+		relay_lock_sum += (uint16_t)(now16 - relay_lock_start);
+		if (relay_lock++ < RELAY_LOCK_EDGES) {
+			return;
+		}
+
+		/* Fit period and phase to the edges: the period from the first to the
+		 * last, the phase from the mean deviation of all of them */
+		relay_half_period = (uint16_t)(now16 - relay_lock_start) / RELAY_LOCK_EDGES;
+		relay_zc_phase    = relay_lock_start + RELAY_LOCK_EDGES * relay_half_period
+		                 + (int16_t)(relay_lock_sum - relay_half_period * (RELAY_LOCK_EDGES * (RELAY_LOCK_EDGES + 1u) / 2u))
+		                       / (int16_t)(RELAY_LOCK_EDGES + 1u);
+	} else {
+		/* Ignore glitches well before the predicted zero-cross */
+		if (since < (relay_half_period >> 1)) {
+			return;
+		}
+
+		error = (int16_t)(since - relay_half_period);
+		if ((error > RELAY_PHASE_TOLERANCE) || (error < -RELAY_PHASE_TOLERANCE)) {
+			/* Missed edges or a different frequency, start over */
+			relay_lock_start = now16;
+			relay_lock_sum   = 0;
+			relay_zc_phase   = now16;
+			relay_lock       = 1;
+			return;
+		}
+
+		relay_zc_phase += relay_half_period + error / 4;
+		relay_half_period += error / 16;
+	}
+
+	if (timer_is_running(&relay_make_timer) || timer_is_running(&relay_break_timer)) {
+		return;
+	}
+
+	relay_due_on  = relay_pending(&off);
+	relay_due_off = off;
+	if (relay_due_on != 0u) {
+		relay_start(&relay_make_timer, RELAY_TICKS16(RELAY_SCHEDULER_OPERATE_US));
+	}
+	if (relay_due_off != 0u) {
+		relay_start(&relay_break_timer, RELAY_TICKS16(RELAY_SCHEDULER_RELEASE_US));
+	}
+	if ((relay_due_on | relay_due_off) != 0u) {
+		timer_stop(&relay_sync_timer);
+	}
+}
+
+/** @} */
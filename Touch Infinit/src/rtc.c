@@ -50,17 +50,17 @@ int8_t Timer_init()
 
 	// RTC.CNT = 0x0; /* Counter: 0x0 */
 
-	RTC.CTRLA = RTC_PRESCALER_DIV1_gc   /* 1 */
+	RTC.CTRLA = RTC_PRESCALER_DIV32_gc  /* 32 */
 	            | 1 << RTC_RTCEN_bp     /* Enable: enabled */
 	            | 1 << RTC_RUNSTDBY_bp; /* Run In Standby: enabled */
 
-	// RTC.PER = 0xffff; /* Period: 0xffff */
+	RTC.PER = 0xffff; /* Period: 0xffff */
 
 	// RTC.CLKSEL = RTC_CLKSEL_INT32K_gc; /* 32KHz Internal Ultra Low Power Oscillator (OSCULP32K) */
 
 	// RTC.DBGCTRL = 0 << RTC_DBGRUN_bp; /* Run in debug: disabled */
 
-	RTC.INTCTRL = 1 << RTC_CMP_bp    /* Compare Match Interrupt enable: enabled */
+	RTC.INTCTRL = 0 << RTC_CMP_bp    /* Compare Match Interrupt enable: disabled, enabled by the timer queue */
 	              | 0 << RTC_OVF_bp; /* Overflow Interrupt enable: disabled */
 
 	// RTC.PITCTRLA = RTC_PERIOD_OFF_gc /* Off */
@@ -0,0 +1,149 @@
+/**
+ * \file
+ *
+ * \brief Main loop sleep scheduler.
+ *
+ * Called once per main loop pass, after the touch and application work is done.
+ * With interrupts disabled it checks whether anything is left to process and,
+ * if not, puts the core to sleep in the deepest mode the running peripherals
+ * allow:
+ *
+ * - Idle while a PTC measurement sequence is running (the PTC needs CLK_PER and
+ *   ends the sequence with ADC0_RESRDY_vect), while the UART is still sending,
+ *   while TCA0 times the LED PWM or while TCB0 times a module bus transaction.
+ * - Standby otherwise. Only the RTC keeps running (RUNSTDBY) and RTC_CNT_vect
+ *   wakes the core when the next software timer expires. In touch low power
+ *   mode the PTC autoscan also runs in standby and wakes the core with
+ *   ADC0_WCOMP_vect.
+ *
+ * Residency is accounted from the free-running RTC counter: the time between
+ * two transitions is credited to the state the core was in.
+ */
+
+/**
+ * \defgroup doc_driver_system_sleep_scheduler Sleep Scheduler
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <sleep_scheduler.h>
+#include <slpctrl.h>
+#include <usart_basic.h>
+#include <timer_queue.h>
+#include <led_pwm.h>
+#include <module_bus.h>
+#include <atomic.h>
+#include <avr/sleep.h>
+#include "touch_api_ptc.h"
+
+static struct sleep_stats sleep_stats_data;
+
+/* RTC count at the last state transition */
+static uint16_t sleep_last_transition;
+
+/**
+ * \brief Select the sleep mode for the current peripheral activity
+ *
+ * \return SLEEP_STATE_IDLE or SLEEP_STATE_STANDBY
+ */
+static uint8_t sleep_scheduler_select_state(void)
+{
+	if (touch_measurement_in_progress() || !USART_is_tx_idle()) {
+		return SLEEP_STATE_IDLE;
+	}
+
+#if LED_PWM_ENABLE == 1
+	if (led_pwm_is_running()) {
+		return SLEEP_STATE_IDLE;
+	}
+#endif
+
+#if MODULE_BUS_ENABLE == 1
+	if (module_bus_is_busy()) {
+		return SLEEP_STATE_IDLE;
+	}
+#endif
+
+	return SLEEP_STATE_STANDBY;
+}
+
+/**
+ * \brief Credit the time since the last transition to a state
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void sleep_scheduler_account(uint8_t state)
+{
+	uint16_t now = timer_now();
+
+	sleep_stats_data.residency_ticks[state] += (uint16_t)(now - sleep_last_transition);
+	sleep_last_transition = now;
+}
+
+/**
+ * \brief Put the core to sleep until the next interrupt if there is no work
+ *
+ * Interrupts are disabled while deciding, and the sleep instruction directly
+ * follows the sei, so an interrupt that sets a work flag cannot be lost between
+ * the check and the sleep.
+ */
+void sleep_scheduler_run(void)
+{
+	uint8_t state;
+
+	cpu_irq_disable();
+
+	if (touch_processing_pending()) {
+		cpu_irq_enable();
+		return;
+	}
+
+	state = sleep_scheduler_select_state();
+	if (state == SLEEP_STATE_IDLE) {
+		SLPCTRL_set_sleep_mode(SLPCTRL_SMODE_IDLE_gc);
+	} else {
+		SLPCTRL_set_sleep_mode(SLPCTRL_SMODE_STDBY_gc);
+	}
+
+	sleep_scheduler_account(SLEEP_STATE_ACTIVE);
+	sleep_stats_data.entries[state]++;
+
+	cpu_irq_enable();
+	sleep_cpu();
+
+	/* The waking interrupt has run, the time it took is counted as sleep */
+	cpu_irq_disable();
+	sleep_scheduler_account(state);
+	sleep_stats_data.entries[SLEEP_STATE_ACTIVE]++;
+	cpu_irq_enable();
+}
+
+/**
+ * \brief Get a consistent copy of the residency statistics
+ *
+ * \param[out] stats Destination of the copy
+ */
+void sleep_scheduler_get_stats(struct sleep_stats *stats)
+{
+	ENTER_CRITICAL(R);
+	*stats = sleep_stats_data;
+	EXIT_CRITICAL(R);
+}
+
+/**
+ * \brief Reset the residency statistics
+ */
+void sleep_scheduler_clear_stats(void)
+{
+	uint8_t i;
+
+	ENTER_CRITICAL(R);
+	for (i = 0; i < SLEEP_STATE_COUNT; i++) {
+		sleep_stats_data.entries[i]         = 0;
+		sleep_stats_data.residency_ticks[i] = 0;
+	}
+	sleep_last_transition = timer_now();
+	EXIT_CRITICAL(R);
+}
+
+/** @} */
@@ -44,8 +44,8 @@
 int8_t SLPCTRL_init()
 {
 
-	// SLPCTRL.CTRLA = 0 << SLPCTRL_SEN_bp /* Sleep enable: disabled */
-	//		 | SLPCTRL_SMODE_IDLE_gc; /* Idle mode */
+	SLPCTRL.CTRLA = 1 << SLPCTRL_SEN_bp          /* Sleep enable: enabled */
+	                | SLPCTRL_SMODE_IDLE_gc; /* Idle mode */
 
 	return 0;
 }
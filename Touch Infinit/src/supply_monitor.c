@@ -0,0 +1,198 @@
+/**
+ * \file
+ *
+ * \brief Supply voltage monitoring and load shedding.
+ *
+ * A relay coil pulling in while the supply sags can take VDD below the BOD
+ * level and reset the device in the middle of a switching sequence. The BOD
+ * voltage level monitor warns before that happens:
+ *
+ * - BOD_VLM_vect is raised when VDD crosses BOD_VLM_LEVEL, a few percent above
+ *   the BOD level, in either direction. The application callback then sheds
+ *   load while VDD is low, e.g. defers pulling in relays.
+ * - supply_monitor_is_low() lets the main loop skip work that is not urgent or
+ *   must not be cut short by a reset, such as datastreamer frames and EEPROM
+ *   writes.
+ * - The reset cause is taken from RSTCTRL.RSTFR at start up and the flags are
+ *   cleared, so the next reset reports its own cause only.
+ * - The reset cause and a count of brown-out resets are logged in the user
+ *   row, where they survive a chip erase and can be read through UPDI from a
+ *   unit returned from the field. supply_monitor_process() writes the log from
+ *   the main loop once the EEPROM is idle and the supply is not low, so at
+ *   most one write follows each reset.
+ *
+ * The monitor needs the BOD to be enabled in active mode by the BODCFG fuse.
+ * With the BOD disabled the supply never reads low.
+ */
+
+/**
+ * \defgroup doc_driver_system_supply_monitor Supply Monitor
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <supply_monitor.h>
+#include <bod.h>
+#include <rstctrl.h>
+#include <nvmctrl_basic.h>
+#include <atomic.h>
+#include <stddef.h>
+#include <util/crc16.h>
+
+/* Layout version of the reset log, an erased user row reads 0xFF */
+#define SUPPLY_MONITOR_LOG_VERSION 1u
+
+/* Reset log in the user row */
+struct supply_monitor_log {
+	uint8_t  version;
+	uint8_t  reset_cause; /* RSTCTRL.RSTFR of the last reset */
+	uint16_t brownouts;   /* Brown-out resets, saturating */
+	uint16_t crc;         /* CRC-16 of the bytes above */
+};
+
+static supply_monitor_cb_t supply_monitor_changed;
+
+static volatile bool     supply_monitor_low;
+static volatile uint16_t supply_monitor_dips;
+
+static struct supply_monitor_log supply_monitor_log;
+static bool                      supply_monitor_log_dirty;
+
+/**
+ * \brief CRC-16 of a reset log, all bytes before the crc member
+ */
+static uint16_t supply_monitor_log_crc(const struct supply_monitor_log *log)
+{
+	const uint8_t *data = (const uint8_t *)log;
+	uint16_t       crc  = 0xFFFFu;
+	uint8_t        i;
+
+	for (i = 0; i < offsetof(struct supply_monitor_log, crc); i++) {
+		crc = _crc16_update(crc, data[i]);
+	}
+
+	return crc;
+}
+
+/**
+ * \brief Load the reset log and add the last reset to it
+ *
+ * An erased or corrupt log starts again from zero.
+ */
+static void supply_monitor_log_reset(uint8_t reset_cause)
+{
+	struct supply_monitor_log *log = &supply_monitor_log;
+
+	FLASH_read_userrow_block(SUPPLY_MONITOR_USERROW_OFFSET, (uint8_t *)log, sizeof(*log));
+	if ((log->version != SUPPLY_MONITOR_LOG_VERSION) || (log->crc != supply_monitor_log_crc(log))) {
+		log->version             = SUPPLY_MONITOR_LOG_VERSION;
+		log->reset_cause         = 0;
+		log->brownouts           = 0;
+		supply_monitor_log_dirty = true;
+	}
+
+	if (log->reset_cause != reset_cause) {
+		log->reset_cause         = reset_cause;
+		supply_monitor_log_dirty = true;
+	}
+	if ((reset_cause & RSTCTRL_BORF_bm) && (log->brownouts != UINT16_MAX)) {
+		log->brownouts++;
+		supply_monitor_log_dirty = true;
+	}
+	log->crc = supply_monitor_log_crc(log);
+}
+
+/**
+ * \brief Follow the voltage level monitor status
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void supply_monitor_update(void)
+{
+	bool low = BOD_is_supply_low();
+
+	if (low == supply_monitor_low) {
+		return;
+	}
+
+	supply_monitor_low = low;
+	if (low) {
+		supply_monitor_dips++;
+	}
+	if (supply_monitor_changed != NULL) {
+		supply_monitor_changed(low);
+	}
+}
+
+/**
+ * \brief Initialise the supply monitor
+ *
+ * Takes the reset cause into the reset log and reports a supply that is
+ * already low to the callback. Call once after BOD_init().
+ *
+ * \param[in] changed Function shedding and restoring load
+ */
+void supply_monitor_init(supply_monitor_cb_t changed)
+{
+	supply_monitor_log_reset(RSTCTRL_get_reset_cause());
+	RSTCTRL_clear_reset_cause();
+
+	ENTER_CRITICAL(S);
+	supply_monitor_changed = changed;
+	supply_monitor_low     = false;
+	supply_monitor_update();
+	EXIT_CRITICAL(S);
+}
+
+/**
+ * \brief Write the reset log to the user row when it has changed
+ *
+ * Call from the main loop. The write is retried on later calls while the
+ * EEPROM is busy or the supply is low.
+ */
+void supply_monitor_process(void)
+{
+	if (!supply_monitor_log_dirty || supply_monitor_low) {
+		return;
+	}
+
+	if (FLASH_write_userrow(SUPPLY_MONITOR_USERROW_OFFSET, (const uint8_t *)&supply_monitor_log,
+	                        sizeof(supply_monitor_log))
+	    == NVM_OK) {
+		supply_monitor_log_dirty = false;
+	}
+}
+
+/**
+ * \brief Check whether load is being shed
+ *
+ * \return true while VDD is below the voltage level monitor threshold
+ */
+bool supply_monitor_is_low(void)
+{
+	return supply_monitor_low;
+}
+
+/**
+ * \brief Get the supply monitoring statistics
+ *
+ * \param[out] stats Copy of the statistics
+ */
+void supply_monitor_get_stats(struct supply_monitor_stats *stats)
+{
+	ENTER_CRITICAL(S);
+	stats->dips        = supply_monitor_dips;
+	stats->reset_cause = supply_monitor_log.reset_cause;
+	stats->brownouts   = supply_monitor_log.brownouts;
+	EXIT_CRITICAL(S);
+}
+
+/**
+ * \brief Voltage level monitor crossing, called from the BOD_VLM interrupt
+ */
+void supply_monitor_vlm_isr(void)
+{
+	supply_monitor_update();
+}
+
+/** @} */
@@ -0,0 +1,208 @@
+/**
+ * \file
+ *
+ * \brief Tickless software timer queue.
+ *
+ * The RTC counts freely over its full 16-bit range at 1024 Hz and RTC.CMP is
+ * programmed for the earliest deadline in the queue only, so the core is woken
+ * when a timer actually expires instead of on every tick. The compare
+ * interrupt is disabled while the queue is empty.
+ *
+ * Timers are kept in a singly linked list sorted by due time. Times are
+ * compared as signed 16-bit differences, so delays and periods are limited to
+ * TIMER_MAX_TICKS (about 32 s). Callbacks run from RTC_CNT_vect.
+ */
+
+/**
+ * \defgroup doc_driver_system_timer_queue Timer Queue
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <timer_queue.h>
+#include <atomic.h>
+
+/* Minimum distance between the counter and a new compare value. RTC.CMP is
+ * synchronized to the RTC clock domain, a compare value closer than this could
+ * be passed before it takes effect and would only match after a counter wrap. */
+#define TIMER_MIN_LEAD 2u
+
+static struct timer_struct *timer_head;
+
+/**
+ * \brief Insert a timer into the queue, sorted by due time
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void timer_enqueue(struct timer_struct *timer)
+{
+	struct timer_struct **link = &timer_head;
+
+	while ((*link != NULL) && ((int16_t)((*link)->due - timer->due) <= 0)) {
+		link = &(*link)->next;
+	}
+
+	timer->next = *link;
+	*link       = timer;
+}
+
+/**
+ * \brief Remove a timer from the queue if it is linked
+ *
+ * Interrupts must be disabled by the caller.
+ *
+ * \return true if the timer was in the queue
+ */
+static bool timer_dequeue(struct timer_struct *timer)
+{
+	struct timer_struct **link = &timer_head;
+
+	while (*link != NULL) {
+		if (*link == timer) {
+			*link       = timer->next;
+			timer->next = NULL;
+			return true;
+		}
+		link = &(*link)->next;
+	}
+
+	return false;
+}
+
+/**
+ * \brief Program RTC.CMP for the head of the queue
+ *
+ * Interrupts must be disabled by the caller.
+ */
+static void timer_program(void)
+{
+	uint16_t now;
+	uint16_t due;
+
+	if (timer_head == NULL) {
+		RTC.INTCTRL &= ~RTC_CMP_bm;
+		return;
+	}
+
+	now = RTC.CNT;
+	due = timer_head->due;
+	if ((int16_t)(due - now) < (int16_t)TIMER_MIN_LEAD) {
+		due = now + TIMER_MIN_LEAD;
+	}
+
+	while (RTC.STATUS & RTC_CMPBUSY_bm) /* wait for RTC synchronization */
+		;
+	RTC.CMP = due;
+	RTC.INTCTRL |= RTC_CMP_bm;
+}
+
+/**
+ * \brief Read the RTC counter
+ *
+ * \return Current time in RTC ticks
+ */
+uint16_t timer_now(void)
+{
+	uint16_t now;
+
+	ENTER_CRITICAL(R);
+	now = RTC.CNT;
+	EXIT_CRITICAL(R);
+
+	return now;
+}
+
+/**
+ * \brief Start or restart a timer
+ *
+ * The callback must be set before the timer is started.
+ *
+ * \param[in] timer  Timer to start
+ * \param[in] delay  Ticks until the first expiry, up to TIMER_MAX_TICKS
+ * \param[in] period Reload in ticks for a periodic timer, 0 for a one-shot timer
+ */
+void timer_start(struct timer_struct *timer, uint16_t delay, uint16_t period)
+{
+	if (delay > TIMER_MAX_TICKS) {
+		delay = TIMER_MAX_TICKS;
+	}
+	if (period > TIMER_MAX_TICKS) {
+		period = TIMER_MAX_TICKS;
+	}
+
+	ENTER_CRITICAL(R);
+	timer_dequeue(timer);
+	timer->due    = RTC.CNT + delay;
+	timer->period = period;
+	timer_enqueue(timer);
+	timer_program();
+	EXIT_CRITICAL(R);
+}
+
+/**
+ * \brief Stop a timer, no effect if it is not running
+ *
+ * \param[in] timer Timer to stop
+ */
+void timer_stop(struct timer_struct *timer)
+{
+	ENTER_CRITICAL(R);
+	if (timer_dequeue(timer)) {
+		timer_program();
+	}
+	EXIT_CRITICAL(R);
+}
+
+/**
+ * \brief Check whether a timer is in the queue
+ *
+ * \param[in] timer Timer to check
+ *
+ * \return true if the timer is running
+ */
+bool timer_is_running(const struct timer_struct *timer)
+{
+	struct timer_struct *t;
+	bool                 running = false;
+
+	ENTER_CRITICAL(R);
+	for (t = timer_head; t != NULL; t = t->next) {
+		if (t == timer) {
+			running = true;
+			break;
+		}
+	}
+	EXIT_CRITICAL(R);
+
+	return running;
+}
+
+/**
+ * \brief Run the callbacks of all expired timers and program the next deadline
+ *
+ * Called from RTC_CNT_vect after the compare flag has been cleared. Periodic
+ * timers are re-queued before their callback runs, so a callback may stop or
+ * restart its own timer. The reload is added to the previous due time, so the
+ * period does not drift with interrupt latency.
+ */
+void timer_queue_isr(void)
+{
+	struct timer_struct *timer;
+
+	while ((timer_head != NULL) && ((int16_t)(timer_head->due - RTC.CNT) <= 0)) {
+		timer       = timer_head;
+		timer_head  = timer->next;
+		timer->next = NULL;
+
+		if (timer->period != 0u) {
+			timer->due += timer->period;
+			timer_enqueue(timer);
+		}
+
+		timer->callback();
+	}
+
+	timer_program();
+}
+
+/** @} */
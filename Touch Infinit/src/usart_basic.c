@@ -39,6 +39,35 @@
 #include <usart_basic.h>
 #include <atomic.h>
 
+/* Transmit ring buffer used by the interrupt-driven TX path.
+ * Single producer (USART_write_buffer) and single consumer (DRE ISR): the head
+ * index is only written by the producer and the tail index only by the ISR, so
+ * no critical section is needed on an 8-bit core. The indices run freely and
+ * are masked on access, which keeps all USART_TX_BUFFER_SIZE slots usable.
+ */
+static uint8_t          USART_txbuf[USART_TX_BUFFER_SIZE];
+static volatile uint8_t USART_tx_head;
+static volatile uint8_t USART_tx_tail;
+
+/* Set once a byte has been loaded by the DRE ISR, until TXCIF reports that the
+ * last byte has left the shift register.
+ */
+static volatile bool USART_tx_shifting;
+
+/* Overflow statistics: frames rejected and the number of bytes they held */
+static volatile uint16_t USART_tx_overflow_frames;
+static volatile uint16_t USART_tx_overflow_bytes;
+
+#if USART_RX_ENABLE == 1
+/* Receive ring buffer filled by the RXC ISR, same scheme as the transmit ring
+ * with the roles swapped: the ISR owns the head, USART_read_buffer() the tail.
+ */
+static uint8_t           USART_rxbuf[USART_RX_BUFFER_SIZE];
+static volatile uint8_t  USART_rx_head;
+static volatile uint8_t  USART_rx_tail;
+static volatile uint16_t USART_rx_overflow_bytes;
+#endif
+
 /**
  * \brief Initialize USART interface
  * If module is configured to disabled state, the clock to the USART is disabled
@@ -53,20 +82,32 @@ int8_t USART_init()
 
 	USART0.BAUD = (uint16_t)USART0_BAUD_RATE(38400); /* set baud rate register */
 
-	// USART0.CTRLA = 0 << USART_ABEIE_bp /* Auto-baud Error Interrupt Enable: disabled */
-	//		 | 0 << USART_DREIE_bp /* Data Register Empty Interrupt Enable: disabled */
-	//		 | 0 << USART_LBME_bp /* Loop-back Mode Enable: disabled */
-	//		 | USART_RS485_OFF_gc /* RS485 Mode disabled */
-	//		 | 0 << USART_RXCIE_bp /* Receive Complete Interrupt Enable: disabled */
-	//		 | 0 << USART_RXSIE_bp /* Receiver Start Frame Interrupt Enable: disabled */
-	//		 | 0 << USART_TXCIE_bp; /* Transmit Complete Interrupt Enable: disabled */
-
-	USART0.CTRLB = 0 << USART_MPCM_bp       /* Multi-processor Communication Mode: disabled */
-	               | 0 << USART_ODME_bp     /* Open Drain Mode Enable: disabled */
-	               | 1 << USART_RXEN_bp     /* Receiver Enable: enabled */
-	               | USART_RXMODE_NORMAL_gc /* Normal mode */
-	               | 0 << USART_SFDEN_bp    /* Start Frame Detection Enable: disabled */
-	               | 1 << USART_TXEN_bp;    /* Transmitter Enable: enabled */
+	USART_tx_head            = 0;
+	USART_tx_tail            = 0;
+	USART_tx_shifting        = false;
+	USART_tx_overflow_frames = 0;
+	USART_tx_overflow_bytes  = 0;
+#if USART_RX_ENABLE == 1
+	USART_rx_head           = 0;
+	USART_rx_tail           = 0;
+	USART_rx_overflow_bytes = 0;
+#endif
+
+	USART0.CTRLA = 0 << USART_ABEIE_bp /* Auto-baud Error Interrupt Enable: disabled */
+	               | 0 << USART_DREIE_bp /* Data Register Empty Interrupt Enable: disabled */
+	               | 0 << USART_LBME_bp  /* Loop-back Mode Enable: disabled */
+	               | USART_RS485_OFF_gc  /* RS485 Mode disabled */
+	               | USART_RX_ENABLE << USART_RXCIE_bp /* Receive Complete Interrupt Enable */
+	               | 0 << USART_RXSIE_bp /* Receiver Start Frame Interrupt Enable: disabled */
+	               | 0 << USART_TXCIE_bp; /* Transmit Complete Interrupt Enable: disabled */
+
+	/* Start frame detection lets a received byte wake the device from Standby */
+	USART0.CTRLB = 0 << USART_MPCM_bp                   /* Multi-processor Communication Mode: disabled */
+	               | 0 << USART_ODME_bp                 /* Open Drain Mode Enable: disabled */
+	               | USART_RX_ENABLE << USART_RXEN_bp   /* Receiver Enable */
+	               | USART_RXMODE_NORMAL_gc             /* Normal mode */
+	               | USART_RX_ENABLE << USART_SFDEN_bp  /* Start Frame Detection Enable */
+	               | 1 << USART_TXEN_bp;                /* Transmitter Enable: enabled */
 
 	// USART0.CTRLC = USART_CMODE_ASYNCHRONOUS_gc /* Asynchronous Mode */
 	//		 | USART_CHSIZE_8BIT_gc /* Character size: 8 bit */
@@ -93,7 +134,7 @@ int8_t USART_init()
  */
 void USART_enable()
 {
-	USART0.CTRLB |= USART_RXEN_bm | USART_TXEN_bm;
+	USART0.CTRLB |= (USART_RX_ENABLE ? USART_RXEN_bm : 0) | USART_TXEN_bm;
 }
 
 /**
@@ -182,6 +223,8 @@ bool USART_is_tx_busy()
  * \brief Read one character from USART
  *
  * Function will block if a character is not available.
+ * The character bypasses the receive ring buffer, so it can only be used with
+ * the Receive Complete interrupt disabled.
  *
  * \return Data read from the USART module
  */
@@ -196,6 +239,8 @@ uint8_t USART_read()
  * \brief Write one character to USART
  *
  * Function will block until a character can be accepted.
+ * The character bypasses the transmit ring buffer, so it must not be mixed
+ * with USART_write_buffer() while the ring is draining.
  *
  * \param[in] data The character to write to the USART
  *
@@ -207,3 +252,197 @@ void USART_write(const uint8_t data)
 		;
 	USART0.TXDATAL = data;
 }
+
+/**
+ * \brief Queue a block of data for interrupt-driven transmission
+ *
+ * The block is copied into the transmit ring buffer and sent by the Data
+ * Register Empty interrupt. The function never blocks: if the ring does not
+ * have room for the whole block nothing is queued and the overflow counters
+ * are updated, so a frame is either sent completely or not at all.
+ *
+ * \param[in] data Pointer to the data to send
+ * \param[in] len  Number of bytes to send
+ *
+ * \return Queue status
+ * \retval true  The block was queued
+ * \retval false The ring buffer was too full, the block was dropped
+ */
+bool USART_write_buffer(const uint8_t *data, uint8_t len)
+{
+	uint8_t head = USART_tx_head;
+
+	if ((uint8_t)(USART_TX_BUFFER_SIZE - (uint8_t)(head - USART_tx_tail)) < len) {
+		USART_tx_overflow_frames++;
+		USART_tx_overflow_bytes += len;
+		return false;
+	}
+
+	while (len--) {
+		USART_txbuf[head & USART_TX_BUFFER_MASK] = *data++;
+		head++;
+	}
+
+	/* Publish the new data, then make sure the DRE interrupt drains it. If the
+	 * ISR empties the ring and clears DREIE between the read and the write of
+	 * CTRLA, the worst case is one spurious interrupt that finds the ring empty.
+	 */
+	USART_tx_head = head;
+	USART0.CTRLA |= USART_DREIE_bm;
+
+	return true;
+}
+
+/**
+ * \brief Get the free space in the transmit ring buffer
+ *
+ * \return Number of bytes that can be queued without overflow
+ */
+uint8_t USART_tx_buffer_free()
+{
+	return (uint8_t)(USART_TX_BUFFER_SIZE - (uint8_t)(USART_tx_head - USART_tx_tail));
+}
+
+/**
+ * \brief Check if the interrupt-driven transmitter is completely idle
+ *
+ * The USART clock is stopped in Standby sleep, so the device may only enter
+ * Standby once the ring is empty and the last byte has been shifted out.
+ *
+ * \return Transmitter idle status
+ * \retval true  Nothing queued and nothing in the shift register
+ * \retval false Data is still being transmitted
+ */
+bool USART_is_tx_idle()
+{
+	if (USART_tx_head != USART_tx_tail) {
+		return false;
+	}
+
+	if (USART_tx_shifting && (USART0.STATUS & USART_TXCIF_bm)) {
+		USART_tx_shifting = false;
+	}
+
+	return !USART_tx_shifting;
+}
+
+/**
+ * \brief Get the number of frames dropped because the transmit ring was full
+ *
+ * \return Dropped frame count
+ */
+uint16_t USART_get_tx_overflow_frames()
+{
+	return USART_tx_overflow_frames;
+}
+
+/**
+ * \brief Get the number of bytes dropped because the transmit ring was full
+ *
+ * \return Dropped byte count
+ */
+uint16_t USART_get_tx_overflow_bytes()
+{
+	return USART_tx_overflow_bytes;
+}
+
+#if USART_RX_ENABLE == 1
+/**
+ * \brief Read received data from the receive ring buffer
+ *
+ * The function never blocks.
+ *
+ * \param[out] data Destination of the data
+ * \param[in]  len  Maximum number of bytes to read
+ *
+ * \return Number of bytes read
+ */
+uint8_t USART_read_buffer(uint8_t *data, uint8_t len)
+{
+	uint8_t tail  = USART_rx_tail;
+	uint8_t count = 0;
+
+	while ((count < len) && (tail != USART_rx_head)) {
+		data[count++] = USART_rxbuf[tail & USART_RX_BUFFER_MASK];
+		tail++;
+	}
+	USART_rx_tail = tail;
+
+	return count;
+}
+
+/**
+ * \brief Get the number of bytes waiting in the receive ring buffer
+ *
+ * \return Number of bytes USART_read_buffer() can return
+ */
+uint8_t USART_rx_count()
+{
+	return (uint8_t)(USART_rx_head - USART_rx_tail);
+}
+
+/**
+ * \brief Get the number of received bytes dropped because the ring was full
+ *
+ * \return Dropped byte count
+ */
+uint16_t USART_get_rx_overflow_bytes()
+{
+	return USART_rx_overflow_bytes;
+}
+
+/**
+ * \brief Receive Complete interrupt
+ *
+ * Moves the received byte to the receive ring buffer. The byte is dropped and
+ * counted when the ring is full.
+ */
+ISR(USART0_RXC_vect)
+{
+	uint8_t head = USART_rx_head;
+	uint8_t data = USART0.RXDATAL;
+
+	if ((uint8_t)(head - USART_rx_tail) < USART_RX_BUFFER_SIZE) {
+		USART_rxbuf[head & USART_RX_BUFFER_MASK] = data;
+		USART_rx_head                            = ++head;
+	} else {
+		USART_rx_overflow_bytes++;
+	}
+}
+#endif
+
+/**
+ * \brief Data Register Empty interrupt
+ *
+ * Moves the next byte from the transmit ring buffer to the USART. Once the ring
+ * is empty it disables itself and enables the Transmit Complete interrupt.
+ */
+ISR(USART0_DRE_vect)
+{
+	uint8_t tail = USART_tx_tail;
+
+	if (tail != USART_tx_head) {
+		/* Restart transmit-complete tracking for this byte */
+		USART0.STATUS     = USART_TXCIF_bm;
+		USART_tx_shifting = true;
+		USART0.TXDATAL    = USART_txbuf[tail & USART_TX_BUFFER_MASK];
+		USART_tx_tail     = ++tail;
+	}
+
+	if (tail == USART_tx_head) {
+		USART0.CTRLA = (USART0.CTRLA & ~USART_DREIE_bm) | USART_TXCIE_bm;
+	}
+}
+
+/**
+ * \brief Transmit Complete interrupt
+ *
+ * Wakes the core from Idle sleep when the last byte has left the shift
+ * register, so the sleep scheduler can move on to Standby instead of idling
+ * until the next timer interrupt.
+ */
+ISR(USART0_TXC_vect)
+{
+	USART0.CTRLA &= ~USART_TXCIE_bm;
+	USART_tx_shifting = false;
+}
@@ -0,0 +1,283 @@
+/**
+ * \file
+ *
+ * \brief Watchdog supervision of the touch processing cycle.
+ *
+ * The watchdog runs in window mode and is only kicked when a touch processing
+ * cycle has passed through all of its stages in order, so a stall anywhere in
+ * the cycle resets the device instead of leaving it frozen:
+ *
+ * - touch_process() and the measurement complete callback report each stage
+ *   with wdt_supervisor_checkpoint(). The start of a measurement begins a new
+ *   cycle.
+ * - Each stage is checked against its deadline from the stage before it. When
+ *   the output stage is reached with all stages seen and none of them late,
+ *   the watchdog is kicked. Kicks are at least twice the closed window apart,
+ *   which leaves a margin for the tolerance of the ULP oscillator. A late
+ *   cycle is counted and not kicked.
+ * - The stages reached and the last stage past its deadline are kept in a RAM
+ *   section that start up code does not clear. After a watchdog reset the
+ *   stage past its deadline, or else the first stage not reached, is logged in
+ *   the user row with a count of watchdog resets, for a post-mortem through
+ *   UPDI. A stage past its deadline is forgotten with the next kick.
+ *
+ * The longest time between cycles, the drift measurements in low power mode,
+ * must stay well within the open window.
+ */
+
+/**
+ * \defgroup doc_driver_system_wdt_supervisor Watchdog Supervisor
+ * \ingroup doc_driver_system
+ *
+ *@{
+ */
+#include <wdt_supervisor.h>
+#include <ccp.h>
+#include <nvmctrl_basic.h>
+#include <rstctrl.h>
+#include <supply_monitor.h>
+#include <timer_queue.h>
+#include <atomic.h>
+#include <avr/wdt.h>
+#include <stddef.h>
+#include <util/crc16.h>
+
+/* Layout version of the watchdog log, an erased user row reads 0xFF */
+#define WDT_SUPERVISOR_LOG_VERSION 1u
+
+/* Stages of a completed cycle */
+#define WDT_SUPERVISOR_ALL_STAGES ((uint8_t)((1u << WDT_SUPERVISOR_STAGES) - 1u))
+
+/* Shortest time between two kicks */
+#define WDT_SUPERVISOR_KICK_TICKS TIMER_MS_TO_TICKS(2u * WDT_SUPERVISOR_WINDOW_CLK)
+
+/* Deadline of each stage from the stage before it, in timer ticks */
+static const uint16_t wdt_supervisor_deadline[WDT_SUPERVISOR_STAGES] = {
+    0u,
+    TIMER_MS_TO_TICKS(WDT_SUPERVISOR_EOC_DEADLINE_MS),
+    TIMER_MS_TO_TICKS(WDT_SUPERVISOR_PROCESS_DEADLINE_MS),
+    TIMER_MS_TO_TICKS(WDT_SUPERVISOR_OUTPUT_DEADLINE_MS),
+};
+
+/* Watchdog log in the user row */
+struct wdt_supervisor_log {
+	uint8_t  version;
+	uint8_t  stage;  /* Stage past its deadline or not reached before the last watchdog reset */
+	uint16_t resets; /* Watchdog resets, saturating */
+	uint16_t crc;    /* CRC-16 of the bytes above */
+};
+
+/* Stages reached in the current cycle and their complement, kept over a reset */
+static volatile uint8_t wdt_supervisor_progress __attribute__((section(".noinit")));
+static volatile uint8_t wdt_supervisor_check __attribute__((section(".noinit")));
+
+/* Last stage past its deadline since the last kick and its complement, kept
+ * over a reset */
+static volatile uint8_t wdt_supervisor_overrun __attribute__((section(".noinit")));
+static volatile uint8_t wdt_supervisor_overrun_check __attribute__((section(".noinit")));
+
+/* Last stage reached and the last kick, in timer ticks */
+static uint16_t wdt_supervisor_stage_time;
+static uint16_t wdt_supervisor_kick;
+
+/* A stage was past its deadline since the last output stage. A measurement
+ * that takes longer than the measurement period completes after the next one
+ * has started, so this is not cleared by the start stage. */
+static bool wdt_supervisor_cycle_late;
+
+static uint16_t wdt_supervisor_kicks;
+static uint16_t wdt_supervisor_late;
+
+static struct wdt_supervisor_log wdt_supervisor_log;
+static bool                      wdt_supervisor_log_dirty;
+
+/**
+ * \brief CRC-16 of a watchdog log, all bytes before the crc member
+ */
+static uint16_t wdt_supervisor_log_crc(const struct wdt_supervisor_log *log)
+{
+	const uint8_t *data = (const uint8_t *)log;
+	uint16_t       crc  = 0xFFFFu;
+	uint8_t        i;
+
+	for (i = 0; i < offsetof(struct wdt_supervisor_log, crc); i++) {
+		crc = _crc16_update(crc, data[i]);
+	}
+
+	return crc;
+}
+
+/**
+ * \brief Load the watchdog log and add a watchdog reset to it
+ *
+ * An erased or corrupt log starts again from zero.
+ */
+static void wdt_supervisor_log_reset(void)
+{
+	struct wdt_supervisor_log *log = &wdt_supervisor_log;
+
+	FLASH_read_userrow_block(WDT_SUPERVISOR_USERROW_OFFSET, (uint8_t *)log, sizeof(*log));
+	if ((log->version != WDT_SUPERVISOR_LOG_VERSION) || (log->crc != wdt_supervisor_log_crc(log))) {
+		log->version             = WDT_SUPERVISOR_LOG_VERSION;
+		log->stage               = WDT_SUPERVISOR_STAGE_NONE;
+		log->resets              = 0;
+		wdt_supervisor_log_dirty = true;
+	}
+
+	if (RSTCTRL_get_reset_cause() & RSTCTRL_WDRF_bm) {
+		/* The progress is lost with the supply, e.g. when the watchdog
+		 * fired while the supply failed */
+		if (wdt_supervisor_get_overrun_stage() != WDT_SUPERVISOR_STAGE_NONE) {
+			log->stage = wdt_supervisor_get_overrun_stage();
+		} else if (wdt_supervisor_check == (uint8_t)~wdt_supervisor_progress) {
+			log->stage = wdt_supervisor_get_pending_stage();
+		} else {
+			log->stage = WDT_SUPERVISOR_STAGE_NONE;
+		}
+		if (log->resets != UINT16_MAX) {
+			log->resets++;
+		}
+		wdt_supervisor_log_dirty = true;
+	}
+	log->crc = wdt_supervisor_log_crc(log);
+}
+
+/**
+ * \brief Initialise the supervisor and start the watchdog
+ *
+ * Logs a watchdog reset. Call once after atmel_start_init() and before the
+ * reset flags are cleared by supply_monitor_init().
+ */
+void wdt_supervisor_init(void)
+{
+	wdt_supervisor_log_reset();
+
+	/* Until the first measurement starts, a stall is reported as its start */
+	wdt_supervisor_progress      = WDT_SUPERVISOR_ALL_STAGES;
+	wdt_supervisor_check         = (uint8_t)~WDT_SUPERVISOR_ALL_STAGES;
+	wdt_supervisor_overrun       = WDT_SUPERVISOR_STAGE_NONE;
+	wdt_supervisor_overrun_check = (uint8_t)~WDT_SUPERVISOR_STAGE_NONE;
+	wdt_supervisor_kick          = timer_now();
+
+	while (WDT.STATUS & WDT_SYNCBUSY_bm) /* wait for the previous setting to take effect */
+		;
+	ccp_write_io((void *)&WDT.CTRLA, WDT_SUPERVISOR_WINDOW | WDT_SUPERVISOR_PERIOD);
+}
+
+/**
+ * \brief Report a stage of the touch processing cycle as reached
+ *
+ * Checks the stage against its deadline and kicks the watchdog at the output
+ * stage of a complete cycle with no stage late. May be called from interrupt
+ * context.
+ *
+ * \param[in] stage Stage reached
+ */
+void wdt_supervisor_checkpoint(enum wdt_supervisor_stage stage)
+{
+	uint16_t now = timer_now();
+	uint8_t  progress;
+
+	ENTER_CRITICAL(W);
+	if (stage == WDT_SUPERVISOR_STAGE_START) {
+		progress = 1u << WDT_SUPERVISOR_STAGE_START;
+	} else {
+		progress = wdt_supervisor_progress | (uint8_t)(1u << stage);
+		if ((uint16_t)(now - wdt_supervisor_stage_time) > wdt_supervisor_deadline[stage]) {
+			wdt_supervisor_overrun       = stage;
+			wdt_supervisor_overrun_check = (uint8_t)~stage;
+			wdt_supervisor_cycle_late    = true;
+		}
+	}
+	wdt_supervisor_progress   = progress;
+	wdt_supervisor_check      = (uint8_t)~progress;
+	wdt_supervisor_stage_time = now;
+
+	if (stage == WDT_SUPERVISOR_STAGE_OUTPUT) {
+		if (wdt_supervisor_cycle_late) {
+			wdt_supervisor_late++;
+			wdt_supervisor_cycle_late = false;
+		} else if ((progress == WDT_SUPERVISOR_ALL_STAGES)
+		           && ((uint16_t)(now - wdt_supervisor_kick) >= WDT_SUPERVISOR_KICK_TICKS)) {
+			wdt_reset();
+			wdt_supervisor_kick          = now;
+			wdt_supervisor_overrun       = WDT_SUPERVISOR_STAGE_NONE;
+			wdt_supervisor_overrun_check = (uint8_t)~WDT_SUPERVISOR_STAGE_NONE;
+			wdt_supervisor_kicks++;
+		}
+	}
+	EXIT_CRITICAL(W);
+}
+
+/**
+ * \brief Get the first stage the current cycle has not reached yet
+ *
+ * \return The stage, WDT_SUPERVISOR_STAGE_START once a cycle has completed
+ */
+enum wdt_supervisor_stage wdt_supervisor_get_pending_stage(void)
+{
+	uint8_t progress = wdt_supervisor_progress;
+	uint8_t stage;
+
+	if (progress == WDT_SUPERVISOR_ALL_STAGES) {
+		return WDT_SUPERVISOR_STAGE_START;
+	}
+
+	for (stage = 0; (progress >> stage) & 1u; stage++)
+		;
+
+	return (enum wdt_supervisor_stage)stage;
+}
+
+/**
+ * \brief Get the last stage past its deadline since the last kick
+ *
+ * \return The stage, WDT_SUPERVISOR_STAGE_NONE if no stage was late or the
+ *         record did not survive a reset
+ */
+enum wdt_supervisor_stage wdt_supervisor_get_overrun_stage(void)
+{
+	uint8_t stage = wdt_supervisor_overrun;
+
+	if ((wdt_supervisor_overrun_check != (uint8_t)~stage) || (stage >= WDT_SUPERVISOR_STAGES)) {
+		return WDT_SUPERVISOR_STAGE_NONE;
+	}
+
+	return (enum wdt_supervisor_stage)stage;
+}
+
+/**
+ * \brief Write the watchdog log to the user row when it has changed
+ *
+ * Call from the main loop. The write is retried on later calls while the
+ * EEPROM is busy or the supply is low.
+ */
+void wdt_supervisor_process(void)
+{
+	if (!wdt_supervisor_log_dirty || supply_monitor_is_low()) {
+		return;
+	}
+
+	if (FLASH_write_userrow(WDT_SUPERVISOR_USERROW_OFFSET, (const uint8_t *)&wdt_supervisor_log,
+	                        sizeof(wdt_supervisor_log))
+	    == NVM_OK) {
+		wdt_supervisor_log_dirty = false;
+	}
+}
+
+/**
+ * \brief Get the watchdog supervision statistics
+ *
+ * \param[out] stats Copy of the statistics
+ */
+void wdt_supervisor_get_stats(struct wdt_supervisor_stats *stats)
+{
+	ENTER_CRITICAL(W);
+	stats->kicks      = wdt_supervisor_kicks;
+	stats->late       = wdt_supervisor_late;
+	stats->last_stage = wdt_supervisor_log.stage;
+	stats->resets     = wdt_supervisor_log.resets;
+	EXIT_CRITICAL(W);
+}
+
+/** @} */